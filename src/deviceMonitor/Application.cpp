@@ -1,4 +1,11 @@
 #include "Application.hpp"
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
 
 ////////////////////////////////////////////////////////////////////////////////
 Application &Application::get(void)
@@ -8,17 +15,24 @@ Application &Application::get(void)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-int Application::run(void)
+int Application::run(const int signalFd, const std::chrono::steady_clock::time_point &startTime)
 {
     LOG_MSG_INF("starting application main loop");
 
-    if ((api == nullptr) || (processor == nullptr))
+    if ((api == nullptr) || (processor == nullptr) || (stopEvent < 0))
     {
         LOG_MSG_FTL("api and/or processor not initialized; unable to run application");
         return EXIT_FAILURE;
     }
 
-    bool apiStarted(api->start());
+    // query threads must exist before the first request is accepted
+    if (!QueryEngine::start(Configuration::get().getQuerySettings().threads))
+    {
+        LOG_MSG_FTL("failed to start query engine");
+        return EXIT_FAILURE;
+    }
+
+    bool apiStarted(api->start(startTime));
 
     bool processorStarted(false);
 
@@ -27,44 +41,161 @@ int Application::run(void)
         processorStarted = processor->start();
     }
 
-    if (apiStarted && processorStarted)
+    if (!apiStarted || !processorStarted)
+    {
+        LOG_MSG_FTL("failed to start api and/or message processor");
+        QueryEngine::stop();
+        return EXIT_FAILURE;
+    }
+
+    struct pollfd descriptors[2];
+    descriptors[0].fd = signalFd;
+    descriptors[0].events = POLLIN;
+    descriptors[1].fd = stopEvent;
+    descriptors[1].events = POLLIN;
+
+    while (runApplication)
     {
-        while (runApplication)
+        // main loop wakes at least once per tick of liveness tracker
+        const int ready(poll(descriptors, 2, livenessPeriod));
+
+        if (ready == 0)
+        {
+            evictIdle();
+            HistoryStore::sweep(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+            checkpoint(false);
+            continue;
+        }
+
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            LOG_FMT_ERR("main loop poll failed; %s", strerror(errno));
+            break;
+        }
+
+        struct signalfd_siginfo signalInfo;
+
+        if (((descriptors[0].revents & POLLIN) != 0) && (read(signalFd, &signalInfo, sizeof(signalInfo)) == sizeof(signalInfo)))
+        {
+            LOG_FMT_INF("received termination signal %" PRIu32, signalInfo.ssi_signo);
+            runApplication = false;
+        }
+
+        uint64_t stopCount(0);
+
+        if (((descriptors[1].revents & POLLIN) != 0) && (read(stopEvent, &stopCount, sizeof(stopCount)) == sizeof(stopCount)))
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+            runApplication = false;
         }
     }
-    else
+
+    shutdown();
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Application::stop(void)
+{
+    LOG_MSG_INF("stopping main loop");
+    runApplication = false;
+
+    const uint64_t stopCount(1);
+
+    if (write(stopEvent, &stopCount, sizeof(stopCount)) != sizeof(stopCount))
     {
-        LOG_MSG_FTL("failed to start api and/or message processor");
-        return EXIT_FAILURE;
+        LOG_FMT_ERR("unable to wake main loop; %s", strerror(errno));
     }
-    
-    processor->stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Application::shutdown(void)
+{
+    const std::chrono::steady_clock::time_point shutdownStart(std::chrono::steady_clock::now());
+
+    // no new messages are accepted from here on
+    api->stop();
+    CaptureTap::close();
+    QueryEngine::stop();
+
+    const uint64_t drained(processor->stop());
+    // nothing is left to replay after final checkpoint, except what it failed to save
+    checkpoint(true);
+    // every applied batch is in the log before messages left in memory are spooled
+    WriteAheadLog::close();
+    const uint64_t persisted(api->persistBacklog());
+    const AbstractAPI::BacklogStatus backlog(api->getBacklogStatus());
+
     delete processor;
     processor = nullptr;
 
-    api->stop();
     delete api;
     api = nullptr;
 
-    return EXIT_SUCCESS;
+    const double latency(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shutdownStart).count());
+
+    LOG_FMT_INF("shutdown finished in %.3f ms; drained messages: %" PRIu64 "; persisted messages: %" PRIu64 "; spooled messages: %" PRIu64 "; lost messages: %" PRIu64,
+                latency, drained, persisted, backlog.diskMessages, backlog.memoryMessages);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void Application::stop(void)
+void Application::evictIdle(void)
 {
-    LOG_MSG_INF("stopping main loop");
-    runApplication = false;
+    std::vector<uint32_t> evicted;
+    LivenessTracker::tick(evicted);
+
+    if (evicted.empty())
+    {
+        return;
+    }
+
+    // distinct counter keeps no state per device id
+    HistoryStore::remove(evicted);
+    WindowStore::remove(evicted);
+    HeavyHitters::remove(evicted);
+    RuleEngine::remove(evicted);
+    NameDictionary::recycle(evicted);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Application::checkpoint(const bool force)
+{
+    const Configuration::CheckpointSettings &settings(Configuration::get().getCheckpointSettings());
+    const std::chrono::steady_clock::time_point now(std::chrono::steady_clock::now());
+
+    if (!settings.enabled || (!force && (now - lastCheckpoint < std::chrono::seconds(settings.interval))))
+    {
+        return;
+    }
+
+    lastCheckpoint = now;
+    uint64_t epoch(0);
+
+    // log segments are deleted only once checkpoint containing them is durable
+    if (DataStorage::checkpoint(settings.file, epoch))
+    {
+        WriteAheadLog::truncate(epoch);
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 Application::Application()
 {
+    stopEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (stopEvent < 0)
+    {
+        LOG_FMT_FTL("failed to create stop event; %s", strerror(errno));
+    }
+
     try
     {
         // TODO: we use only one API in this example; we should use much smarter solution
-        api = new RestAPI("./etc/communication_schema/communication_schema_v1.json");
+        api = new RestAPI(Configuration::get().getSchemaSettings().file);
         processor = new MessageProcessor(api);
     }
     catch (const std::exception &e)
@@ -82,4 +213,9 @@ Application::~Application()
         delete api;
         api = nullptr;
     }
+
+    if (stopEvent >= 0)
+    {
+        close(stopEvent);
+    }
 }
\ No newline at end of file
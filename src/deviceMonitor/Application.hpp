@@ -2,10 +2,21 @@
 #define APPLICATION_HPP
 
 #include "apis/AbstractAPI.hpp"
+#include "apis/CaptureTap.hpp"
 #include "apis/RestAPI.hpp"
 #include "middleware/MessageProcessor.hpp"
+#include "middleware/RuleEngine.hpp"
 #include "storage/DataStorage.hpp"
+#include "storage/HeavyHitters.hpp"
+#include "storage/HistoryStore.hpp"
+#include "storage/LivenessTracker.hpp"
+#include "storage/NameDictionary.hpp"
+#include "storage/QueryEngine.hpp"
+#include "storage/WindowStore.hpp"
+#include "storage/WriteAheadLog.hpp"
 #include "Logger.hpp"
+#include <atomic>
+#include <chrono>
 #include <thread>
 
 class Application final
@@ -22,18 +33,44 @@ public:
     static Application &get(void);
 
     /**
-     * @brief
+     * @brief run application until termination signal arrives or stop is requested;
+     * on shutdown API stops accepting messages, queued messages are applied within
+     * drain timeout and messages left in memory are persisted to disk spool
      *
+     * @param signalFd signal descriptor delivering termination signals
+     * @param startTime process start; API reports its startup latency from it
+     * @return int EXIT_SUCCESS or EXIT_FAILURE
      */
-    int run(void);
+    int run(const int signalFd, const std::chrono::steady_clock::time_point &startTime);
 
     /**
-     * @brief
+     * @brief request main loop to stop; safe to call from any thread
      *
      */
     void stop(void);
 
 private:
+    /**
+     * @brief stop API, drain message queue, persist remaining messages and report shutdown latency
+     *
+     */
+    void shutdown(void);
+
+    /**
+     * @brief advance liveness tracker and drop devices it evicted from every store keyed by device id,
+     * then recycle their ids for new device names
+     *
+     */
+    void evictIdle(void);
+
+    /**
+     * @brief write storage checkpoint if enabled and interval elapsed since the last one,
+     * then drop write-ahead log segments it covers
+     *
+     * @param force write checkpoint regardless of interval
+     */
+    void checkpoint(const bool force);
+
     /**
      * @brief Construct a new Application object
      *
@@ -50,7 +87,14 @@ private:
     AbstractAPI *api = nullptr;
     MessageProcessor *processor = nullptr;
     DataStorage storage;
-    bool runApplication = true;
+    // milliseconds between liveness ticks of idle main loop
+    static const int livenessPeriod = 1000;
+
+    std::chrono::steady_clock::time_point lastCheckpoint = std::chrono::steady_clock::now();
+
+    std::atomic<bool> runApplication{true};
+    // wakes main loop when stop is requested
+    int stopEvent = -1;
 };
 
 #endif
\ No newline at end of file
@@ -1,19 +1,46 @@
 #include "AbstractAPI.hpp"
+#include "CaptureTap.hpp"
 #include "../middleware/MessageProcessor.hpp"
+#include "../runtime/MemoryArena.hpp"
+#include "../runtime/ThreadPlacement.hpp"
+
+const uint64_t AbstractAPI::spoolRetryDelay;
 
 ////////////////////////////////////////////////////////////////////////////////
-AbstractAPI::AbstractAPI(const std::string &schema) : jsonSchema(schema)
+AbstractAPI::AbstractAPI(const std::string &schema) : jsonSchema(schema),
+                                                      queueSettings(Configuration::get().getQueueSettings()),
+                                                      spool(queueSettings.spillDirectory, queueSettings.segmentSize)
 {
     loadJSONSchema();
+
+    if (!queueSettings.spillEnabled || !spool.open())
+    {
+        return;
+    }
+
+    try
+    {
+        // segments left from previous run are read back before any new message
+        publishSpool();
+        spoolRunning = true;
+        spooler = std::thread(spoolerBody, this);
+        spoolReady = true;
+    }
+    catch (const std::exception &ex)
+    {
+        LOG_FMT_ERR("unable to start spool writer; spilling disabled; error %s", ex.what());
+        spoolRunning = false;
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 AbstractAPI::~AbstractAPI(void)
 {
+    stopSpooler();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool AbstractAPI::start(void)
+bool AbstractAPI::start(const std::chrono::steady_clock::time_point &processStart)
 {
     if (!validatorInitialized)
     {
@@ -21,6 +48,8 @@ bool AbstractAPI::start(void)
         return false;
     }
 
+    startTime = processStart;
+
     if (!setupApi())
     {
         LOG_MSG_FTL("failed to setup API");
@@ -61,17 +90,109 @@ void AbstractAPI::stop(void)
 AbstractAPI::pJsonMessage_t AbstractAPI::getNextMessage(void)
 {
     std::lock_guard<std::mutex> lock(queueLock);
+    std::queue<QueuedMessage> &source(messageQueue.empty() ? replayQueue : messageQueue);
 
-    if (messageQueue.empty())
+    if (source.empty())
     {
         return pJsonMessage_t(nullptr);
     }
 
-    pJsonMessage_t messageToGet(messageQueue.front());
-    messageQueue.pop();
+    pJsonMessage_t messageToGet(source.front().message);
+    memoryBytes -= source.front().size;
+    MemoryArena::discharge(MemoryArena::subsystemQueue, source.front().size);
+    source.pop();
+
+    // spool writer reads next messages from disk while the rest of replay queue is processed
+    if ((&source == &replayQueue) && (replayQueue.size() < replayBatch / 2) && (diskMessages != 0))
+    {
+        spoolSignal.notify_one();
+    }
+
     return messageToGet;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool AbstractAPI::isDrained(void)
+{
+    std::lock_guard<std::mutex> lock(queueLock);
+    return messageQueue.empty() && replayQueue.empty() && (spillCount == 0) && (diskMessages == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AbstractAPI::BacklogStatus AbstractAPI::getBacklogStatus(void)
+{
+    std::lock_guard<std::mutex> lock(queueLock);
+
+    BacklogStatus status;
+    status.memoryMessages = messageQueue.size() + replayQueue.size() + spillQueue.size();
+    status.memoryBytes = memoryBytes;
+    status.diskMessages = diskMessages;
+    status.diskBytes = diskBytes;
+    status.diskSegments = diskSegments;
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t AbstractAPI::persistBacklog(void)
+try
+{
+    // spool writer writes what was handed to it; spool is used by this thread from here on
+    stopSpooler();
+
+    std::lock_guard<std::mutex> lock(queueLock);
+    std::string record;
+    uint64_t persisted(0);
+
+    if (!spoolReady)
+    {
+        return 0;
+    }
+
+    // messages are appended behind already spooled ones; storage counters do not depend on order
+    for (std::queue<QueuedMessage> *source : {&replayQueue, &messageQueue})
+    {
+        while (!source->empty())
+        {
+            spillQueue.push_back(source->front());
+            source->pop();
+        }
+    }
+
+    for (const QueuedMessage &queued : spillQueue)
+    {
+        record.clear();
+        MessageCodec::encode(*queued.message, record);
+        spool.append(record);
+    }
+
+    if (!spool.flush())
+    {
+        LOG_MSG_ERR("unable to persist message backlog to disk");
+    }
+    else
+    {
+        persisted = spillQueue.size();
+
+        for (const QueuedMessage &queued : spillQueue)
+        {
+            memoryBytes -= queued.size;
+            MemoryArena::discharge(MemoryArena::subsystemQueue, queued.size);
+        }
+
+        spillQueue.clear();
+        spillCount = 0;
+        spillBytes = 0;
+    }
+
+    publishSpool();
+    return persisted;
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to persist message backlog; error %s", ex.what());
+    return 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool AbstractAPI::isValidJSON(rapidjson::Document &document)
 {
@@ -88,8 +209,51 @@ bool AbstractAPI::isValidJSON(rapidjson::Document &document)
 bool AbstractAPI::pushNewMessage(pJsonMessage_t newMessage)
 try
 {
-    std::lock_guard<std::mutex> lock(queueLock);
-    messageQueue.push(newMessage);
+    const uint64_t size(estimateMessageSize(newMessage));
+
+    {
+        std::lock_guard<std::mutex> lock(queueLock);
+
+        // once spilling started all new messages go to disk until spool is drained to keep ordering
+        if (spoolReady && ((spillCount != 0) || (diskMessages != 0) || !replayQueue.empty() ||
+                           (memoryBytes + size > queueSettings.memoryLimit)))
+        {
+            // messages the spool writer did not write yet are limited too, e.g. while disk fails
+            if (spillBytes + size > queueSettings.memoryLimit)
+            {
+                LOG_MSG_ERR("unable to spill message to disk; spool writer falls behind");
+                return false;
+            }
+
+            // encoding and disk I/O are left to spool writer, so queue lock is never held over I/O
+            spillQueue.push_back(QueuedMessage{newMessage, size});
+            spillCount++;
+            spillBytes += size;
+
+            if (spillQueue.size() == 1)
+            {
+                spoolSignal.notify_one();
+            }
+        }
+        else
+        {
+            messageQueue.push(QueuedMessage{newMessage, size});
+        }
+
+        memoryBytes += size;
+        MemoryArena::charge(MemoryArena::subsystemQueue, size);
+    }
+
+    if (CaptureTap::isOpen())
+    {
+        // encoded outside the queue lock; buffer is reused by every API thread
+        thread_local std::string captured;
+        captured.clear();
+        MessageCodec::encode(*newMessage, captured);
+        CaptureTap::record(captured);
+    }
+
+    // processor takes process lock before queue lock; notify only after queue lock is released
     MessageProcessor::notify();
     return true;
 }
@@ -99,6 +263,19 @@ catch (std::exception &ex)
     return false;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void AbstractAPI::reportReady(void)
+{
+    LOG_FMT_INF("API accepting connections %.3f ms after start",
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t AbstractAPI::estimateMessageSize(const pJsonMessage_t &message)
+{
+    return sizeof(rapidjson::Document) + message->GetAllocator().Size();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void AbstractAPI::loadJSONSchema(void)
 try
@@ -128,9 +305,145 @@ catch (const std::exception &ex)
     validatorInitialized = false;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void AbstractAPI::spoolerBody(AbstractAPI *thisApi)
+{
+    std::deque<QueuedMessage> writing;
+    std::vector<QueuedMessage> replayed;
+    std::string record;
+    uint64_t discarded(0);
+    std::unique_lock<std::mutex> lock(thisApi->queueLock);
+
+    while (true)
+    {
+        thisApi->spoolSignal.wait(lock, [thisApi]
+                                  { return !thisApi->spillQueue.empty() || !thisApi->spoolRunning ||
+                                           ((thisApi->replayQueue.size() < replayBatch / 2) && (thisApi->diskMessages != 0)); });
+
+        if (!thisApi->spillQueue.empty())
+        {
+            writing.swap(thisApi->spillQueue);
+            lock.unlock();
+
+            for (const QueuedMessage &queued : writing)
+            {
+                record.clear();
+                MessageCodec::encode(*queued.message, record);
+                thisApi->spool.append(record);
+            }
+
+            const bool written(thisApi->spool.flush());
+            lock.lock();
+
+            if (!written)
+            {
+                // accepted messages stay in memory and are written again; new ones are refused once
+                // spill queue is full, so clients see disk failure instead of messages being lost
+                thisApi->spillQueue.insert(thisApi->spillQueue.begin(), writing.begin(), writing.end());
+                writing.clear();
+
+                if (!thisApi->spoolRunning)
+                {
+                    // left to persistBacklog, which reports them as lost if disk still fails
+                    break;
+                }
+
+                thisApi->spoolSignal.wait_for(lock, std::chrono::milliseconds(spoolRetryDelay), [thisApi]
+                                              { return !thisApi->spoolRunning; });
+                continue;
+            }
+
+            for (const QueuedMessage &queued : writing)
+            {
+                thisApi->memoryBytes -= queued.size;
+                thisApi->spillBytes -= queued.size;
+                MemoryArena::discharge(MemoryArena::subsystemQueue, queued.size);
+            }
+
+            thisApi->spillCount -= writing.size();
+            writing.clear();
+            thisApi->publishSpool();
+            continue;
+        }
+
+        if (!thisApi->spoolRunning)
+        {
+            break;
+        }
+
+        // replay queue runs low; next spooled messages are read and decoded without queue lock
+        lock.unlock();
+
+        while ((replayed.size() < replayBatch) && thisApi->spool.readNext(record))
+        {
+            pJsonMessage_t message(std::make_shared<rapidjson::Document>());
+
+            if (!MessageCodec::decode(record.data(), record.size(), *message))
+            {
+                discarded++;
+                continue;
+            }
+
+            replayed.push_back(QueuedMessage{message, estimateMessageSize(message)});
+        }
+
+        if (discarded != 0)
+        {
+            LOG_FMT_ERR("unable to decode %" PRIu64 " spooled messages; messages discarded", discarded);
+            discarded = 0;
+        }
+
+        lock.lock();
+
+        for (const QueuedMessage &queued : replayed)
+        {
+            thisApi->replayQueue.push(queued);
+            thisApi->memoryBytes += queued.size;
+            MemoryArena::charge(MemoryArena::subsystemQueue, queued.size);
+        }
+
+        replayed.clear();
+        thisApi->publishSpool();
+
+        // processor takes process lock before queue lock
+        lock.unlock();
+        MessageProcessor::notify();
+        lock.lock();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AbstractAPI::stopSpooler(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueLock);
+
+        if (!spoolRunning)
+        {
+            return;
+        }
+
+        spoolRunning = false;
+    }
+
+    spoolSignal.notify_all();
+    spooler.join();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AbstractAPI::publishSpool(void)
+{
+    diskMessages = spool.getRecordCount();
+    diskBytes = spool.getByteCount();
+    diskSegments = spool.getSegmentCount();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void AbstractAPI::threadBody(AbstractAPI *thisApi)
 {
+    // placement is inherited by threads spawned by API implementation
+    ThreadPlacement::apply(ThreadPlacement::roleApi);
+
     while (thisApi->getRunFlag())
     {
         thisApi->run();
@@ -2,7 +2,13 @@
 #ifndef ABSTRACTAPI_HPP
 #define ABSTRACTAPI_HPP
 
+#include "../config/Configuration.hpp"
 #include "Logger.hpp"
+#include "MessageCodec.hpp"
+#include "SegmentSpool.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <memory>
 #include <mutex>
@@ -21,6 +27,15 @@ class AbstractAPI
 public:
     typedef std::shared_ptr<rapidjson::Document> pJsonMessage_t;
 
+    struct BacklogStatus
+    {
+        uint64_t memoryMessages;
+        uint64_t memoryBytes;
+        uint64_t diskMessages;
+        uint64_t diskBytes;
+        uint64_t diskSegments;
+    };
+
     /**
      * @brief Construct a new Abstract API object
      *
@@ -37,10 +52,11 @@ public:
     /**
      * @brief common implementation of API start procedure
      *
+     * @param processStart process start; time from it until API accepts connections is logged
      * @return true API started successfully
      * @return false if API did not start
      */
-    bool start(void);
+    bool start(const std::chrono::steady_clock::time_point &processStart);
 
     /**
      * @brief stop API and deallocate resources
@@ -55,6 +71,29 @@ public:
      */
     pJsonMessage_t getNextMessage(void);
 
+    /**
+     * @brief check if no message waits in memory or in spool
+     *
+     * @return true if every queued message was taken
+     * @return false if some messages wait, e.g. until spool writer reads them from disk
+     */
+    bool isDrained(void);
+
+    /**
+     * @brief Get the sizes of in-memory and on-disk message backlog
+     *
+     * @return BacklogStatus
+     */
+    BacklogStatus getBacklogStatus(void);
+
+    /**
+     * @brief move messages left in memory to disk spool so they are replayed on next start;
+     * call only after API and message processor are stopped
+     *
+     * @return uint64_t number of messages written to spool
+     */
+    uint64_t persistBacklog(void);
+
 protected:
     /**
      * @brief checks if json document/message is valid by give JSON schema
@@ -66,7 +105,9 @@ protected:
     bool isValidJSON(rapidjson::Document &document);
 
     /**
-     * @brief add newly received message to queue
+     * @brief add newly received message to queue; when in-memory backlog is over
+     * configured limit message is handed to spool writer thread, which writes it to
+     * disk and reads it back later in order
      *
      * @param newMessage newly received message
      * @return true if pushed successfully
@@ -74,6 +115,13 @@ protected:
      */
     bool pushNewMessage(pJsonMessage_t newMessage);
 
+    /**
+     * @brief log time from process start until API accepts connections; derived APIs call it
+     * once they listen, so it covers checkpoint restore, log replay and API startup
+     *
+     */
+    void reportReady(void);
+
     /**
      * @brief deviced APIs will implement setup procedures
      *
@@ -97,12 +145,51 @@ protected:
     virtual void run(void) = 0;
 
 private:
+    // spooled messages read back from disk at once
+    static const size_t replayBatch = 256;
+    // failed spool write is retried after this many milliseconds
+    static const uint64_t spoolRetryDelay = 1000;
+
+    struct QueuedMessage
+    {
+        pJsonMessage_t message;
+        uint64_t size;
+    };
+
+    /**
+     * @brief estimate memory occupied by parsed message
+     *
+     * @param message parsed message
+     * @return uint64_t size in bytes
+     */
+    static uint64_t estimateMessageSize(const pJsonMessage_t &message);
+
     /**
      * @brief loads json schema for validation on given API
      *
      */
     void loadJSONSchema(void);
 
+    /**
+     * @brief body of spool writer thread; encodes and writes spilled messages and reads
+     * spooled ones back, all without queue lock
+     *
+     * @param thisApi
+     */
+    static void spoolerBody(AbstractAPI *thisApi);
+
+    /**
+     * @brief write messages waiting for spool writer and stop its thread
+     *
+     */
+    void stopSpooler(void);
+
+    /**
+     * @brief copy spool counters for readers of queue state; queue lock must be held
+     *
+     */
+    void publishSpool(void);
+
     /**
      * @brief thread body representation - a simple loop with no delay
      *
@@ -131,10 +218,33 @@ private:
     std::unique_ptr<rapidjson::SchemaValidator> pSchemaValidator;
 
     std::mutex queueLock;
-    std::queue<pJsonMessage_t> messageQueue;
+    std::queue<QueuedMessage> messageQueue;
+    // messages read back from spool; they are taken after message queue
+    std::queue<QueuedMessage> replayQueue;
+    // messages waiting for spool writer; they follow messages on disk
+    std::deque<QueuedMessage> spillQueue;
+    // bytes of all three queues
+    uint64_t memoryBytes = 0;
+    // messages and bytes handed to spool writer and not written yet, including those being written
+    uint64_t spillCount = 0;
+    uint64_t spillBytes = 0;
+    // spool counters as of the last write or read of spool writer
+    uint64_t diskMessages = 0;
+    uint64_t diskBytes = 0;
+    uint64_t diskSegments = 0;
+    // wakes spool writer when spill queue is started, replay queue runs low or stop is requested
+    std::condition_variable spoolSignal;
+    bool spoolRunning = false;
+
+    const Configuration::QueueSettings queueSettings;
+    // owned by spool writer thread while it runs
+    SegmentSpool spool;
+    bool spoolReady = false;
+    std::thread spooler;
 
     std::mutex runFlagLock;
     bool runFlag = false;
+    std::chrono::steady_clock::time_point startTime;
     std::thread *apiThread;
 };
 
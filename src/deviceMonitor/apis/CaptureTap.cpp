@@ -0,0 +1,287 @@
+#include "CaptureTap.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::mutex CaptureTap::captureLock;
+std::condition_variable CaptureTap::writeSignal;
+std::string CaptureTap::pending;
+std::chrono::steady_clock::time_point CaptureTap::pendingStart;
+std::chrono::steady_clock::time_point CaptureTap::lastArrival;
+uint64_t CaptureTap::acceptedBytes(0);
+bool CaptureTap::running(false);
+bool CaptureTap::full(false);
+bool CaptureTap::opened(false);
+int CaptureTap::descriptor(-1);
+std::string CaptureTap::path;
+uint64_t CaptureTap::bufferBytes(0);
+std::chrono::milliseconds CaptureTap::flushDelay(0);
+uint64_t CaptureTap::maxBytes(0);
+std::thread CaptureTap::writer;
+uint64_t CaptureTap::recordCount(0);
+uint64_t CaptureTap::droppedCount(0);
+uint64_t CaptureTap::writeCount(0);
+bool CaptureTap::failed(false);
+
+namespace
+{
+    // file starts with magic and format version followed by capture start time
+    const char CAPTURE_MAGIC[8] = {'D', 'M', 'C', 'A', 'P', 0, 0, 1};
+
+    ////////////////////////////////////////////////////////////////////////////
+    void writeLength(uint64_t length, std::string &output)
+    {
+        while (length >= 0x80)
+        {
+            output.push_back(static_cast<char>((length & 0x7f) | 0x80));
+            length >>= 7;
+        }
+
+        output.push_back(static_cast<char>(length));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    bool createDirectories(const std::string &path)
+    {
+        for (size_t position(path.find('/', 1)); ; position = path.find('/', position + 1))
+        {
+            const std::string partial(path.substr(0, position));
+
+            if (!partial.empty() && (mkdir(partial.c_str(), 0750) != 0) && (errno != EEXIST))
+            {
+                return false;
+            }
+
+            if (position == std::string::npos)
+            {
+                return true;
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CaptureTap::open(const std::string &path, const uint64_t bufferBytes, const uint64_t flushDelay, const uint64_t maxBytes)
+try
+{
+    const size_t separator(path.rfind('/'));
+
+    if ((separator != std::string::npos) && (separator != 0) && !createDirectories(path.substr(0, separator)))
+    {
+        LOG_FMT_ERR("unable to create capture directory of %s; %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    descriptor = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0640);
+
+    if (descriptor < 0)
+    {
+        LOG_FMT_ERR("unable to create capture file %s; %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    CaptureTap::path = path;
+    CaptureTap::bufferBytes = bufferBytes;
+    CaptureTap::flushDelay = std::chrono::milliseconds(flushDelay);
+    CaptureTap::maxBytes = maxBytes;
+
+    // arrivals are measured by steady clock; wall clock only anchors the capture
+    lastArrival = std::chrono::steady_clock::now();
+    const int64_t startTime(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    std::string header(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    header.append(reinterpret_cast<const char *>(&startTime), sizeof(startTime));
+
+    if (!writeBuffer(header))
+    {
+        LOG_FMT_ERR("unable to write capture file %s; %s", path.c_str(), strerror(errno));
+        ::close(descriptor);
+        descriptor = -1;
+        return false;
+    }
+
+    acceptedBytes = header.size();
+    pending.reserve(bufferBytes);
+    running = true;
+    writer = std::thread(writerBody);
+    opened = true;
+
+    LOG_FMT_INF("capturing accepted messages to %s; buffer %" PRIu64 " bytes; limit %" PRIu64 " bytes",
+                path.c_str(), bufferBytes, maxBytes);
+    return true;
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to start capture writer: %s", ex.what());
+    running = false;
+    ::close(descriptor);
+    descriptor = -1;
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CaptureTap::isOpen(void)
+{
+    return opened;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CaptureTap::record(const std::string &message)
+try
+{
+    if (!opened)
+    {
+        return;
+    }
+
+    const std::chrono::steady_clock::time_point arrival(std::chrono::steady_clock::now());
+    std::lock_guard<std::mutex> lock(captureLock);
+
+    if (full || failed)
+    {
+        return;
+    }
+
+    // record header takes at most 10 bytes of delta and 5 bytes of length
+    const uint64_t size(message.size() + 15);
+
+    if ((maxBytes != 0) && (acceptedBytes + size > maxBytes))
+    {
+        LOG_FMT_WRN("capture file %s reached %" PRIu64 " bytes; capture stopped", path.c_str(), acceptedBytes);
+        full = true;
+        return;
+    }
+
+    // writer that falls behind costs records, never ingest latency
+    if (pending.size() + size > bufferBytes)
+    {
+        droppedCount++;
+        return;
+    }
+
+    if (pending.empty())
+    {
+        pendingStart = arrival;
+        writeSignal.notify_one();
+    }
+
+    // arrivals of concurrent threads may be taken in other order than the lock; last arrival moves by
+    // whole recorded microseconds, so truncated remainders do not add up to drift over long captures
+    uint64_t delta(0);
+
+    if (arrival > lastArrival)
+    {
+        const std::chrono::microseconds elapsed(std::chrono::duration_cast<std::chrono::microseconds>(arrival - lastArrival));
+        delta = static_cast<uint64_t>(elapsed.count());
+        lastArrival += elapsed;
+    }
+
+    const size_t previous(pending.size());
+    writeLength(delta, pending);
+    writeLength(message.size(), pending);
+    pending.append(message);
+    acceptedBytes += pending.size() - previous;
+    recordCount++;
+
+    // writer is woken once per buffer, not by every record after it is half full
+    if ((previous < bufferBytes / 2) && (pending.size() >= bufferBytes / 2))
+    {
+        writeSignal.notify_one();
+    }
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to capture message: %s", ex.what());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CaptureTap::close(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(captureLock);
+
+        if (!running)
+        {
+            return;
+        }
+
+        running = false;
+    }
+
+    writeSignal.notify_all();
+    writer.join();
+
+    opened = false;
+    ::close(descriptor);
+    descriptor = -1;
+
+    LOG_FMT_INF("capture %s closed; records: %" PRIu64 "; bytes: %" PRIu64 "; dropped records: %" PRIu64 "; writes: %" PRIu64,
+                path.c_str(), recordCount, acceptedBytes, droppedCount, writeCount);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CaptureTap::writeBuffer(const std::string &buffer)
+{
+    size_t written(0);
+
+    while (written < buffer.size())
+    {
+        const ssize_t result(::write(descriptor, buffer.data() + written, buffer.size() - written));
+
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        written += static_cast<size_t>(result);
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CaptureTap::writerBody(void)
+{
+    std::string buffer;
+    buffer.reserve(bufferBytes);
+    std::unique_lock<std::mutex> lock(captureLock);
+
+    while (true)
+    {
+        writeSignal.wait(lock, []
+                         { return !pending.empty() || !running; });
+
+        if (pending.empty())
+        {
+            // stop was requested and everything is written
+            break;
+        }
+
+        writeSignal.wait_until(lock, pendingStart + flushDelay, []
+                               { return (pending.size() >= bufferBytes / 2) || !running; });
+
+        // buffers are swapped, so neither of them is reallocated once both have grown
+        buffer.swap(pending);
+        pending.clear();
+
+        lock.unlock();
+        const bool written(writeBuffer(buffer));
+        const int error(errno);
+        lock.lock();
+
+        writeCount++;
+
+        if (!written)
+        {
+            // records after partially written one could not be read back, so capture stops
+            LOG_FMT_ERR("unable to write capture file %s; capture stopped; %s", path.c_str(), strerror(error));
+            failed = true;
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef CAPTURETAP_HPP
+#define CAPTURETAP_HPP
+
+#include "Logger.hpp"
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @brief capture of accepted messages with their arrival times for later replay
+ *
+ * File starts with magic and format version followed by wall clock time of
+ * capture start in microseconds since Unix epoch (host byte order). Every record
+ * is LEB128 encoded microseconds since the previous record (since capture start
+ * for the first one), LEB128 encoded message length and the message in
+ * MessageCodec form, so a capture holds exactly what the API accepted and is
+ * replayed at recorded pace by tools without JSON text in between.
+ * API threads only append records to an in-memory buffer; dedicated writer
+ * thread writes it with one write() once it grows over half of its size or
+ * flush delay passes. Capture never slows ingest down: when the writer falls
+ * behind and the buffer is full records are dropped and counted, and capture
+ * stops once the file reaches its size limit.
+ */
+class CaptureTap final
+{
+public:
+    CaptureTap() = delete;
+
+    /**
+     * @brief create capture file and start writer thread; existing file is replaced
+     *
+     * @param path capture file; missing directories are created
+     * @param bufferBytes records are dropped while this many bytes wait for writer
+     * @param flushDelay buffer is written at least this often in milliseconds
+     * @param maxBytes capture stops once file grows over this size in bytes; 0 is unlimited
+     * @return true on success
+     * @return false on failure
+     */
+    static bool open(const std::string &path, const uint64_t bufferBytes, const uint64_t flushDelay, const uint64_t maxBytes);
+
+    /**
+     * @brief check if capture is open; messages need to be encoded only then
+     *
+     * @return true if records are accepted
+     * @return false otherwise
+     */
+    static bool isOpen(void);
+
+    /**
+     * @brief append message with current time as its arrival; does nothing if capture is not open.
+     * May be called from several threads at once.
+     *
+     * @param message message in MessageCodec form
+     */
+    static void record(const std::string &message);
+
+    /**
+     * @brief write remaining records, stop writer thread and close file
+     *
+     */
+    static void close(void);
+
+private:
+    /**
+     * @brief write whole buffer to capture file
+     *
+     * @param buffer encoded records
+     * @return true on success
+     * @return false on I/O error
+     */
+    static bool writeBuffer(const std::string &buffer);
+
+    /**
+     * @brief body of writer thread
+     *
+     */
+    static void writerBody(void);
+
+    static std::mutex captureLock;
+    // wakes writer thread when buffer is started or half full
+    static std::condition_variable writeSignal;
+    static std::string pending;
+    static std::chrono::steady_clock::time_point pendingStart;
+    // arrival of the last accepted record; deltas of records are taken from it
+    static std::chrono::steady_clock::time_point lastArrival;
+    // bytes accepted into file including pending ones
+    static uint64_t acceptedBytes;
+    static bool running;
+    static bool full;
+
+    // set by open() before API starts and cleared by close() after it stops
+    static bool opened;
+    // capture file; owned by writer thread while it runs
+    static int descriptor;
+    static std::string path;
+    static uint64_t bufferBytes;
+    static std::chrono::milliseconds flushDelay;
+    static uint64_t maxBytes;
+    static std::thread writer;
+
+    static uint64_t recordCount;
+    static uint64_t droppedCount;
+    static uint64_t writeCount;
+    static bool failed;
+};
+
+#endif
@@ -0,0 +1,283 @@
+#include "MessageCodec.hpp"
+#include <cstring>
+
+namespace
+{
+    enum Tag : uint8_t
+    {
+        tagNull = 0,
+        tagFalse,
+        tagTrue,
+        tagInt64,
+        tagUint64,
+        tagDouble,
+        tagString,
+        tagObject,
+        tagArray,
+    };
+
+    // nesting limit protects decoder stack against corrupted input
+    const unsigned MAX_DEPTH(64);
+
+    ////////////////////////////////////////////////////////////////////////////
+    void writeLength(uint64_t length, std::string &output)
+    {
+        while (length >= 0x80)
+        {
+            output.push_back(static_cast<char>((length & 0x7f) | 0x80));
+            length >>= 7;
+        }
+
+        output.push_back(static_cast<char>(length));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    template <typename T>
+    void writeRaw(const T &value, std::string &output)
+    {
+        output.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    void writeString(const char *data, const rapidjson::SizeType length, std::string &output)
+    {
+        writeLength(length, output);
+        output.append(data, length);
+    }
+
+    /**
+     * @brief generator for rapidjson::Document::Populate replaying encoded values as SAX events
+     *
+     */
+    class Decoder
+    {
+    public:
+        Decoder(const char *data, const size_t size) : data(data), size(size), position(0), succeeded(false) {}
+
+        template <typename Handler>
+        bool operator()(Handler &handler)
+        {
+            succeeded = readValue(handler, 0) && (position == size);
+            return succeeded;
+        }
+
+        bool hasSucceeded(void) const
+        {
+            return succeeded;
+        }
+
+    private:
+        bool readLength(rapidjson::SizeType &length)
+        {
+            uint64_t value(0);
+
+            for (unsigned shift(0); shift < 35; shift += 7)
+            {
+                if (position >= size)
+                {
+                    return false;
+                }
+
+                const uint8_t byte(static_cast<uint8_t>(data[position++]));
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+                if ((byte & 0x80) == 0)
+                {
+                    if (value > UINT32_MAX)
+                    {
+                        return false;
+                    }
+
+                    length = static_cast<rapidjson::SizeType>(value);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        template <typename T>
+        bool readRaw(T &value)
+        {
+            if (size - position < sizeof(value))
+            {
+                return false;
+            }
+
+            memcpy(&value, data + position, sizeof(value));
+            position += sizeof(value);
+            return true;
+        }
+
+        bool readString(const char *&string, rapidjson::SizeType &length)
+        {
+            if (!readLength(length) || (size - position < length))
+            {
+                return false;
+            }
+
+            string = data + position;
+            position += length;
+            return true;
+        }
+
+        template <typename Handler>
+        bool readValue(Handler &handler, const unsigned depth)
+        {
+            if ((depth > MAX_DEPTH) || (position >= size))
+            {
+                return false;
+            }
+
+            const uint8_t tag(static_cast<uint8_t>(data[position++]));
+            rapidjson::SizeType length(0);
+            const char *string(nullptr);
+
+            switch (tag)
+            {
+            case tagNull:
+                return handler.Null();
+
+            case tagFalse:
+                return handler.Bool(false);
+
+            case tagTrue:
+                return handler.Bool(true);
+
+            case tagInt64:
+            {
+                int64_t value;
+                return readRaw(value) && handler.Int64(value);
+            }
+
+            case tagUint64:
+            {
+                uint64_t value;
+                return readRaw(value) && handler.Uint64(value);
+            }
+
+            case tagDouble:
+            {
+                double value;
+                return readRaw(value) && handler.Double(value);
+            }
+
+            case tagString:
+                return readString(string, length) && handler.String(string, length, true);
+
+            case tagObject:
+                if (!readLength(length) || !handler.StartObject())
+                {
+                    return false;
+                }
+
+                for (rapidjson::SizeType i(0); i < length; ++i)
+                {
+                    rapidjson::SizeType keyLength(0);
+
+                    if (!readString(string, keyLength) || !handler.Key(string, keyLength, true) || !readValue(handler, depth + 1))
+                    {
+                        return false;
+                    }
+                }
+
+                return handler.EndObject(length);
+
+            case tagArray:
+                if (!readLength(length) || !handler.StartArray())
+                {
+                    return false;
+                }
+
+                for (rapidjson::SizeType i(0); i < length; ++i)
+                {
+                    if (!readValue(handler, depth + 1))
+                    {
+                        return false;
+                    }
+                }
+
+                return handler.EndArray(length);
+
+            default:
+                return false;
+            }
+        }
+
+        const char *data;
+        const size_t size;
+        size_t position;
+        bool succeeded;
+    };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MessageCodec::encode(const rapidjson::Value &value, std::string &output)
+{
+    switch (value.GetType())
+    {
+    case rapidjson::kNullType:
+        output.push_back(static_cast<char>(tagNull));
+        break;
+
+    case rapidjson::kFalseType:
+        output.push_back(static_cast<char>(tagFalse));
+        break;
+
+    case rapidjson::kTrueType:
+        output.push_back(static_cast<char>(tagTrue));
+        break;
+
+    case rapidjson::kNumberType:
+        if (value.IsDouble())
+        {
+            output.push_back(static_cast<char>(tagDouble));
+            writeRaw(value.GetDouble(), output);
+        }
+        else if (value.IsUint64())
+        {
+            output.push_back(static_cast<char>(tagUint64));
+            writeRaw(value.GetUint64(), output);
+        }
+        else
+        {
+            output.push_back(static_cast<char>(tagInt64));
+            writeRaw(value.GetInt64(), output);
+        }
+        break;
+
+    case rapidjson::kStringType:
+        output.push_back(static_cast<char>(tagString));
+        writeString(value.GetString(), value.GetStringLength(), output);
+        break;
+
+    case rapidjson::kObjectType:
+        output.push_back(static_cast<char>(tagObject));
+        writeLength(value.MemberCount(), output);
+
+        for (auto member(value.MemberBegin()); member != value.MemberEnd(); ++member)
+        {
+            writeString(member->name.GetString(), member->name.GetStringLength(), output);
+            encode(member->value, output);
+        }
+        break;
+
+    case rapidjson::kArrayType:
+        output.push_back(static_cast<char>(tagArray));
+        writeLength(value.Size(), output);
+
+        for (auto element(value.Begin()); element != value.End(); ++element)
+        {
+            encode(*element, output);
+        }
+        break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool MessageCodec::decode(const char *data, const size_t size, rapidjson::Document &document)
+{
+    Decoder decoder(data, size);
+    document.Populate(decoder);
+    return decoder.hasSucceeded();
+}
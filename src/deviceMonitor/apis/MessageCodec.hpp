@@ -0,0 +1,42 @@
+#ifndef MESSAGECODEC_HPP
+#define MESSAGECODEC_HPP
+
+#include <cinttypes>
+#include <rapidjson/document.h>
+#include <string>
+
+/**
+ * @brief compact binary representation of JSON messages
+ *
+ * Every value is written as one type tag byte followed by its payload. Numbers
+ * are stored in host byte order as 8 byte integers/doubles, strings, object
+ * member counts and array sizes are prefixed with LEB128 encoded length. The
+ * encoding avoids JSON text formatting and number parsing when messages are
+ * written to and read back from disk.
+ */
+class MessageCodec final
+{
+public:
+    MessageCodec() = delete;
+
+    /**
+     * @brief append binary representation of JSON value to output buffer
+     *
+     * @param value JSON value to encode
+     * @param output buffer where encoded data are appended
+     */
+    static void encode(const rapidjson::Value &value, std::string &output);
+
+    /**
+     * @brief rebuild JSON document from its binary representation
+     *
+     * @param data encoded data
+     * @param size size of encoded data
+     * @param document output document
+     * @return true on success
+     * @return false if data are truncated or corrupted
+     */
+    static bool decode(const char *data, const size_t size, rapidjson::Document &document);
+};
+
+#endif
@@ -1,6 +1,22 @@
 #include "RestAPI.hpp"
+#include "../middleware/RuleEngine.hpp"
+#include "../runtime/MemoryArena.hpp"
+#include "../runtime/ThreadPlacement.hpp"
+#include "../storage/ColumnarExport.hpp"
 #include "../storage/DataStorage.hpp"
+#include "../storage/DistinctCounter.hpp"
+#include "../storage/HeavyHitters.hpp"
+#include "../storage/HistoryStore.hpp"
+#include "../storage/LivenessTracker.hpp"
+#include "../storage/MeasurementCatalog.hpp"
+#include "../storage/QueryEngine.hpp"
+#include "../storage/WindowStore.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
 
+const uint64_t RestAPI::maxPageLimit;
 RestAPI *RestAPI::thisApi;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -8,7 +24,23 @@ RestAPI::RestAPI(const std::string &schema, const uint16_t port) : AbstractAPI(s
                                                                    port(port),
                                                                    settings(std::make_shared<restbed::Settings>()),
                                                                    resourcePost(std::make_shared<restbed::Resource>()),
-                                                                   resourceGet(std::make_shared<restbed::Resource>())
+                                                                   resourceGet(std::make_shared<restbed::Resource>()),
+                                                                   resourceQueue(std::make_shared<restbed::Resource>()),
+                                                                   resourceRules(std::make_shared<restbed::Resource>()),
+                                                                   resourceThreads(std::make_shared<restbed::Resource>()),
+                                                                   resourceMemory(std::make_shared<restbed::Resource>()),
+                                                                   resourceQuantiles(std::make_shared<restbed::Resource>()),
+                                                                   resourceRollup(std::make_shared<restbed::Resource>()),
+                                                                   resourceHistory(std::make_shared<restbed::Resource>()),
+                                                                   resourceHistoryStatus(std::make_shared<restbed::Resource>()),
+                                                                   resourceRates(std::make_shared<restbed::Resource>()),
+                                                                   resourceAggregate(std::make_shared<restbed::Resource>()),
+                                                                   resourceOffline(std::make_shared<restbed::Resource>()),
+                                                                   resourceDistinct(std::make_shared<restbed::Resource>()),
+                                                                   resourceTop(std::make_shared<restbed::Resource>()),
+                                                                   resourceExport(std::make_shared<restbed::Resource>()),
+                                                                   resourceDevice(std::make_shared<restbed::Resource>()),
+                                                                   resourceDevices(std::make_shared<restbed::Resource>())
 {
     thisApi = this;
 }
@@ -27,8 +59,74 @@ try
     resourceGet->set_path("/device/results");
     resourceGet->set_method_handler("GET", getHandler);
 
+    resourceQueue->set_path("/monitor/queue");
+    resourceQueue->set_method_handler("GET", queueHandler);
+
+    resourceRules->set_path("/rules/matches");
+    resourceRules->set_method_handler("GET", rulesHandler);
+
+    resourceThreads->set_path("/monitor/threads");
+    resourceThreads->set_method_handler("GET", threadsHandler);
+
+    resourceMemory->set_path("/monitor/memory");
+    resourceMemory->set_method_handler("GET", memoryHandler);
+
+    resourceQuantiles->set_path("/device/quantiles");
+    resourceQuantiles->set_method_handler("GET", quantilesHandler);
+
+    resourceRollup->set_path("/device/rollup");
+    resourceRollup->set_method_handler("GET", rollupHandler);
+
+    resourceHistory->set_path("/device/history");
+    resourceHistory->set_method_handler("GET", historyHandler);
+
+    resourceHistoryStatus->set_path("/monitor/history");
+    resourceHistoryStatus->set_method_handler("GET", historyStatusHandler);
+
+    resourceRates->set_path("/device/rates");
+    resourceRates->set_method_handler("GET", ratesHandler);
+
+    resourceAggregate->set_path("/device/aggregate");
+    resourceAggregate->set_method_handler("GET", aggregateHandler);
+
+    resourceOffline->set_path("/device/offline");
+    resourceOffline->set_method_handler("GET", offlineHandler);
+
+    resourceDistinct->set_path("/device/distinct");
+    resourceDistinct->set_method_handler("GET", distinctHandler);
+
+    resourceTop->set_path("/device/top");
+    resourceTop->set_method_handler("GET", topHandler);
+
+    resourceExport->set_path("/device/export");
+    resourceExport->set_method_handler("GET", exportHandler);
+
+    // routes are matched in path order, so fixed paths under /device take precedence over device names
+    resourceDevice->set_path("/device/{name: .+}");
+    resourceDevice->set_method_handler("GET", deviceHandler);
+
+    resourceDevices->set_path("/devices");
+    resourceDevices->set_method_handler("GET", devicesHandler);
+
     service.publish(resourcePost);
     service.publish(resourceGet);
+    service.publish(resourceQueue);
+    service.publish(resourceRules);
+    service.publish(resourceThreads);
+    service.publish(resourceMemory);
+    service.publish(resourceQuantiles);
+    service.publish(resourceRollup);
+    service.publish(resourceHistory);
+    service.publish(resourceHistoryStatus);
+    service.publish(resourceRates);
+    service.publish(resourceAggregate);
+    service.publish(resourceOffline);
+    service.publish(resourceDistinct);
+    service.publish(resourceTop);
+    service.publish(resourceExport);
+    service.publish(resourceDevice);
+    service.publish(resourceDevices);
+    service.set_ready_handler(readyHandler);
 
     return true;
 }
@@ -111,4 +209,376 @@ void RestAPI::getHandler(const std::shared_ptr<restbed::Session> session)
 {
     const std::string &results(DataStorage::getResults());
     session->close(restbed::OK, results);
-}
\ No newline at end of file
+}
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::queueHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const BacklogStatus status(thisApi->getBacklogStatus());
+    std::stringstream ss;
+
+    ss << "memoryMessages: " << status.memoryMessages << "; "
+       << "memoryBytes: " << status.memoryBytes << "; "
+       << "diskMessages: " << status.diskMessages << "; "
+       << "diskBytes: " << status.diskBytes << "; "
+       << "diskSegments: " << status.diskSegments << "; " << std::endl;
+
+    session->close(restbed::OK, ss.str());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::rulesHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const std::string &matches(RuleEngine::getMatches());
+    session->close(restbed::OK, matches);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::threadsHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const std::string &report(ThreadPlacement::getThreadReport());
+    session->close(restbed::OK, report);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::memoryHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const std::string &status(MemoryArena::getStatus());
+    session->close(restbed::OK, status);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::quantilesHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const std::string &quantiles(DataStorage::getQuantiles());
+    session->close(restbed::OK, quantiles);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::rollupHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const std::string prefix(session->get_request()->get_query_parameter("prefix", ""));
+
+    if (prefix.empty())
+    {
+        session->close(restbed::BAD_REQUEST);
+        return;
+    }
+
+    std::string rollup;
+
+    if (!DataStorage::getRollup(prefix, rollup))
+    {
+        session->close(restbed::NOT_FOUND);
+        return;
+    }
+
+    session->close(restbed::OK, rollup);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::historyHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const auto request = session->get_request();
+    const std::string name(request->get_query_parameter("name", ""));
+    const std::string measurement(request->get_query_parameter("measurement", ""));
+    unsigned kind(0);
+    const bool known(MeasurementCatalog::find(measurement, kind));
+
+    int64_t from(std::numeric_limits<int64_t>::min());
+    int64_t to(std::numeric_limits<int64_t>::max());
+    uint64_t limit(defaultHistoryLimit);
+
+    if (name.empty() || !known ||
+        !parseNumber(request->get_query_parameter("from", ""), from) ||
+        !parseNumber(request->get_query_parameter("to", ""), to) ||
+        !parseNumber(request->get_query_parameter("limit", ""), limit))
+    {
+        session->close(restbed::BAD_REQUEST);
+        return;
+    }
+
+    std::string samples;
+
+    if (!HistoryStore::query(name, kind, from, to, limit, samples))
+    {
+        session->close(restbed::NOT_FOUND);
+        return;
+    }
+
+    session->close(restbed::OK, samples);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::historyStatusHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const std::string &status(HistoryStore::getStatus());
+    session->close(restbed::OK, status);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::ratesHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const auto request = session->get_request();
+    const std::string name(request->get_query_parameter("name", ""));
+    const std::string resolutionKey(request->get_query_parameter("resolution", "minute"));
+    unsigned resolution(0);
+
+    while ((resolution < WindowStore::resolutionCount) && (resolutionKey != WindowStore::resolutionKeys[resolution]))
+    {
+        resolution++;
+    }
+
+    uint64_t windowCount(defaultRateWindows);
+
+    if (name.empty() || (resolution == WindowStore::resolutionCount) ||
+        !parseNumber(request->get_query_parameter("count", ""), windowCount))
+    {
+        session->close(restbed::BAD_REQUEST);
+        return;
+    }
+
+    std::string rates;
+
+    if (!WindowStore::query(name, static_cast<WindowStore::Resolution>(resolution),
+                            static_cast<uint32_t>(std::min<uint64_t>(windowCount, UINT32_MAX)), rates))
+    {
+        session->close(restbed::NOT_FOUND);
+        return;
+    }
+
+    session->close(restbed::OK, rates);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::aggregateHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const auto request = session->get_request();
+    const std::string prefix(request->get_query_parameter("prefix", ""));
+    const std::string measurement(request->get_query_parameter("measurement", ""));
+    unsigned kind(0);
+    const bool known(MeasurementCatalog::find(measurement, kind));
+
+    int64_t from(std::numeric_limits<int64_t>::min());
+    int64_t to(std::numeric_limits<int64_t>::max());
+
+    if (!known ||
+        !parseNumber(request->get_query_parameter("from", ""), from) ||
+        !parseNumber(request->get_query_parameter("to", ""), to))
+    {
+        session->close(restbed::BAD_REQUEST);
+        return;
+    }
+
+    std::string result;
+
+    if (!QueryEngine::aggregate(prefix, kind, from, to, result))
+    {
+        session->close(restbed::NOT_FOUND);
+        return;
+    }
+
+    session->close(restbed::OK, result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::offlineHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const std::string &offline(LivenessTracker::getOffline());
+    session->close(restbed::OK, offline);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::distinctHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const auto request = session->get_request();
+    std::string estimate;
+
+    if (!request->has_query_parameter("resolution"))
+    {
+        std::string part;
+
+        if (!DistinctCounter::query(DistinctCounter::resolutionMinute, 5, part))
+        {
+            session->close(restbed::NOT_FOUND);
+            return;
+        }
+
+        estimate = part;
+        DistinctCounter::query(DistinctCounter::resolutionMinute, 60, part);
+        estimate += part;
+        DistinctCounter::query(DistinctCounter::resolutionHour, 24, part);
+        estimate += part;
+        session->close(restbed::OK, estimate);
+        return;
+    }
+
+    const std::string resolutionKey(request->get_query_parameter("resolution", ""));
+    unsigned resolution(0);
+
+    while ((resolution < DistinctCounter::resolutionCount) && (resolutionKey != DistinctCounter::resolutionKeys[resolution]))
+    {
+        resolution++;
+    }
+
+    uint64_t windowCount(1);
+
+    if ((resolution == DistinctCounter::resolutionCount) || !parseNumber(request->get_query_parameter("count", ""), windowCount))
+    {
+        session->close(restbed::BAD_REQUEST);
+        return;
+    }
+
+    if (!DistinctCounter::query(static_cast<DistinctCounter::Resolution>(resolution),
+                                static_cast<uint32_t>(std::min<uint64_t>(windowCount, UINT32_MAX)), estimate))
+    {
+        session->close(restbed::NOT_FOUND);
+        return;
+    }
+
+    session->close(restbed::OK, estimate);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::topHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const auto request = session->get_request();
+    const std::string scopeKey(request->get_query_parameter("scope", HeavyHitters::scopeKeys[HeavyHitters::scopeTotal]));
+    unsigned scope(0);
+
+    while ((scope < HeavyHitters::scopeCount) && (scopeKey != HeavyHitters::scopeKeys[scope]))
+    {
+        scope++;
+    }
+
+    uint64_t limit(defaultTopLimit);
+
+    if ((scope == HeavyHitters::scopeCount) || !parseNumber(request->get_query_parameter("limit", ""), limit))
+    {
+        session->close(restbed::BAD_REQUEST);
+        return;
+    }
+
+    std::string top;
+
+    if (!HeavyHitters::query(static_cast<HeavyHitters::Scope>(scope), static_cast<uint32_t>(std::min<uint64_t>(limit, UINT32_MAX)), top))
+    {
+        session->close(restbed::NOT_FOUND);
+        return;
+    }
+
+    session->close(restbed::OK, top);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::exportHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const std::string table(session->get_request()->get_query_parameter("table", "counters"));
+    std::string file;
+
+    if (table == "counters")
+    {
+        ColumnarExport::exportCounters(file);
+    }
+    else if (table != "history")
+    {
+        session->close(restbed::BAD_REQUEST);
+        return;
+    }
+    else if (!ColumnarExport::exportHistory(file))
+    {
+        session->close(restbed::NOT_FOUND);
+        return;
+    }
+
+    const std::string length(std::to_string(file.size()));
+    session->close(restbed::OK, file, {{"Content-Type", "application/vnd.apache.arrow.file"}, {"Content-Length", length}});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::deviceHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const std::string name(session->get_request()->get_path_parameter("name", ""));
+    std::string device;
+
+    if (!DataStorage::getDevice(name, device))
+    {
+        session->close(restbed::NOT_FOUND);
+        return;
+    }
+
+    session->close(restbed::OK, device);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::devicesHandler(const std::shared_ptr<restbed::Session> session)
+{
+    const auto request = session->get_request();
+    uint64_t limit(defaultPageLimit);
+
+    if (!parseNumber(request->get_query_parameter("limit", ""), limit) || (limit == 0))
+    {
+        session->close(restbed::BAD_REQUEST);
+        return;
+    }
+
+    std::string page;
+
+    if (!DataStorage::listDevices(request->get_query_parameter("prefix", ""), request->get_query_parameter("from", ""),
+                                  request->get_query_parameter("to", ""), request->get_query_parameter("cursor", ""),
+                                  static_cast<size_t>(std::min(limit, maxPageLimit)), page))
+    {
+        session->close(restbed::BAD_REQUEST);
+        return;
+    }
+
+    session->close(restbed::OK, page);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestAPI::readyHandler(restbed::Service &)
+{
+    // checkpoint restore and log replay run before API start, so this covers the whole startup
+    thisApi->reportReady();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool RestAPI::parseNumber(const std::string &text, int64_t &target)
+{
+    if (text.empty())
+    {
+        return true;
+    }
+
+    char *end(nullptr);
+    errno = 0;
+    const long long value(std::strtoll(text.c_str(), &end, 10));
+
+    if ((errno != 0) || (*end != '\0'))
+    {
+        return false;
+    }
+
+    target = static_cast<int64_t>(value);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool RestAPI::parseNumber(const std::string &text, uint64_t &target)
+{
+    if (text.empty())
+    {
+        return true;
+    }
+
+    char *end(nullptr);
+    errno = 0;
+    const unsigned long long value(std::strtoull(text.c_str(), &end, 10));
+
+    if ((errno != 0) || (*end != '\0') || (text[0] == '-'))
+    {
+        return false;
+    }
+
+    target = static_cast<uint64_t>(value);
+    return true;
+}
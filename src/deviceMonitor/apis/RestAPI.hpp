@@ -61,11 +61,176 @@ protected:
      */
     static void getHandler(const std::shared_ptr<restbed::Session> session);
 
+    /**
+     * @brief HTTP GET handler reporting in-memory and on-disk message backlog
+     *
+     * @param session
+     */
+    static void queueHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler reporting rule matches per rule and device
+     *
+     * @param session
+     */
+    static void rulesHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler reporting CPU time and placement of application threads
+     *
+     * @param session
+     */
+    static void threadsHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler reporting live and peak memory per subsystem and memory budget
+     *
+     * @param session
+     */
+    static void memoryHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler reporting value percentiles per device and over all devices
+     *
+     * @param session
+     */
+    static void quantilesHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler returning counters summed over all devices of a name prefix;
+     * query parameter: prefix (name prefix of configured rollup level)
+     *
+     * @param session
+     */
+    static void rollupHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler returning history samples of one device measurement;
+     * query parameters: name, measurement, optional from/to (milliseconds since Unix epoch) and limit
+     *
+     * @param session
+     */
+    static void historyHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler reporting size and compression of history store
+     *
+     * @param session
+     */
+    static void historyStatusHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler returning message and measurement counts of last event-time windows of device;
+     * query parameters: name, optional resolution (second, minute, hour) and count
+     *
+     * @param session
+     */
+    static void ratesHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler returning count, sum, avg, min and max of history samples per device and in total;
+     * query parameters: measurement, optional prefix (device name prefix) and from/to (milliseconds since Unix epoch)
+     *
+     * @param session
+     */
+    static void aggregateHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler returning estimated number of distinct devices in last windows with error bounds;
+     * optional query parameters: resolution (minute, hour) and count; without them last 5 minutes, hour and day are reported
+     *
+     * @param session
+     */
+    static void distinctHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler returning devices sending the most messages with their error bounds;
+     * optional query parameters: scope (total, minute, hour) and limit
+     *
+     * @param session
+     */
+    static void topHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler listing offline devices with seconds since their last message
+     *
+     * @param session
+     */
+    static void offlineHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler returning snapshot counters or history samples of all devices as Arrow IPC file;
+     * optional query parameter: table (counters, history)
+     *
+     * @param session
+     */
+    static void exportHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler returning current counters of one device found by its name in path
+     *
+     * @param session
+     */
+    static void deviceHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief HTTP GET handler listing current counters of devices in name order, one page at a time;
+     * optional query parameters: prefix, from/to (name range), cursor (next of previous page) and limit
+     *
+     * @param session
+     */
+    static void devicesHandler(const std::shared_ptr<restbed::Session> session);
+
+    /**
+     * @brief service handler called once service listens on its port
+     *
+     * @param service
+     */
+    static void readyHandler(restbed::Service &service);
+
 private:
+    // number of history samples returned when request has no limit
+    static const uint64_t defaultHistoryLimit = 10000;
+    // number of windows returned when request has no count
+    static const uint64_t defaultRateWindows = 60;
+    // number of devices returned when request has no limit
+    static const uint64_t defaultTopLimit = 10;
+    // number of devices in page when request has no limit
+    static const uint64_t defaultPageLimit = 100;
+    // largest page of device listing
+    static const uint64_t maxPageLimit = 10000;
+
+    /**
+     * @brief parse decimal query parameter; empty text keeps target unchanged
+     *
+     * @param text parameter value
+     * @param target parsed value
+     * @return true if text is empty or valid number
+     * @return false if text is not valid number
+     */
+    static bool parseNumber(const std::string &text, int64_t &target);
+    static bool parseNumber(const std::string &text, uint64_t &target);
+
     const uint16_t port;
     std::shared_ptr<restbed::Settings> settings;
     std::shared_ptr<restbed::Resource> resourcePost;
     std::shared_ptr<restbed::Resource> resourceGet;
+    std::shared_ptr<restbed::Resource> resourceQueue;
+    std::shared_ptr<restbed::Resource> resourceRules;
+    std::shared_ptr<restbed::Resource> resourceThreads;
+    std::shared_ptr<restbed::Resource> resourceMemory;
+    std::shared_ptr<restbed::Resource> resourceQuantiles;
+    std::shared_ptr<restbed::Resource> resourceRollup;
+    std::shared_ptr<restbed::Resource> resourceHistory;
+    std::shared_ptr<restbed::Resource> resourceHistoryStatus;
+    std::shared_ptr<restbed::Resource> resourceRates;
+    std::shared_ptr<restbed::Resource> resourceAggregate;
+    std::shared_ptr<restbed::Resource> resourceOffline;
+    std::shared_ptr<restbed::Resource> resourceDistinct;
+    std::shared_ptr<restbed::Resource> resourceTop;
+    std::shared_ptr<restbed::Resource> resourceExport;
+    std::shared_ptr<restbed::Resource> resourceDevice;
+    std::shared_ptr<restbed::Resource> resourceDevices;
     restbed::Service service;
 
     // WARNING: hack - quick solution how to access public interface from static context
@@ -0,0 +1,341 @@
+#include "SegmentSpool.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char SEGMENT_PREFIX[] = "segment-";
+    const char SEGMENT_SUFFIX[] = ".spool";
+
+    ////////////////////////////////////////////////////////////////////////////
+    bool createDirectories(const std::string &path)
+    {
+        for (size_t position(path.find('/', 1)); ; position = path.find('/', position + 1))
+        {
+            const std::string partial(path.substr(0, position));
+
+            if (!partial.empty() && (mkdir(partial.c_str(), 0750) != 0) && (errno != EEXIST))
+            {
+                return false;
+            }
+
+            if (position == std::string::npos)
+            {
+                return true;
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SegmentSpool::SegmentSpool(const std::string &directory, const uint64_t segmentSize) : directory(directory),
+                                                                                      segmentSize(segmentSize)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SegmentSpool::~SegmentSpool()
+{
+    flush();
+    closeWriter();
+
+    if (readerOpen)
+    {
+        reader.close();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SegmentSpool::open(void)
+{
+    if (!createDirectories(directory))
+    {
+        LOG_FMT_ERR("unable to create spool directory %s; %s", directory.c_str(), strerror(errno));
+        return false;
+    }
+
+    DIR *dir(opendir(directory.c_str()));
+
+    if (dir == nullptr)
+    {
+        LOG_FMT_ERR("unable to open spool directory %s; %s", directory.c_str(), strerror(errno));
+        return false;
+    }
+
+    std::deque<uint64_t> found;
+    const size_t prefixLength(sizeof(SEGMENT_PREFIX) - 1);
+    const size_t suffixLength(sizeof(SEGMENT_SUFFIX) - 1);
+
+    for (struct dirent *entry(readdir(dir)); entry != nullptr; entry = readdir(dir))
+    {
+        const std::string fileName(entry->d_name);
+
+        if ((fileName.size() <= prefixLength + suffixLength) ||
+            (fileName.compare(0, prefixLength, SEGMENT_PREFIX) != 0) ||
+            (fileName.compare(fileName.size() - suffixLength, suffixLength, SEGMENT_SUFFIX) != 0))
+        {
+            continue;
+        }
+
+        const std::string number(fileName.substr(prefixLength, fileName.size() - prefixLength - suffixLength));
+
+        if (number.find_first_not_of("0123456789") == std::string::npos)
+        {
+            found.push_back(std::stoull(number));
+        }
+    }
+
+    closedir(dir);
+
+    std::sort(found.begin(), found.end());
+
+    for (const uint64_t sequence : found)
+    {
+        uint64_t records(0);
+        uint64_t bytes(0);
+        scanSegment(sequence, records, bytes);
+        nextSequence = sequence + 1;
+
+        if (records == 0)
+        {
+            unlink(segmentPath(sequence).c_str());
+            continue;
+        }
+
+        segments.push_back(sequence);
+        recordCount += records;
+        byteCount += bytes;
+    }
+
+    if (!segments.empty())
+    {
+        LOG_FMT_WRN("recovered %" PRIu64 " spooled messages in %zu segments from %s", recordCount, segments.size(), directory.c_str());
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SegmentSpool::append(const std::string &record)
+{
+    const uint32_t length(static_cast<uint32_t>(record.size()));
+    writeBuffer.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    writeBuffer.append(record);
+    bufferedRecords++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SegmentSpool::flush(void)
+{
+    if (writeBuffer.empty())
+    {
+        return true;
+    }
+
+    if (writer < 0)
+    {
+        const uint64_t sequence(nextSequence++);
+        writer = ::open(segmentPath(sequence).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0640);
+
+        if (writer < 0)
+        {
+            LOG_FMT_ERR("unable to create spool segment %s; %s", segmentPath(sequence).c_str(), strerror(errno));
+            writeBuffer.clear();
+            bufferedRecords = 0;
+            return false;
+        }
+
+        segments.push_back(sequence);
+        writerSize = 0;
+    }
+
+    size_t written(0);
+
+    while (written < writeBuffer.size())
+    {
+        const ssize_t result(::write(writer, writeBuffer.data() + written, writeBuffer.size() - written));
+
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            LOG_FMT_ERR("unable to write to spool segment %s; %s", segmentPath(segments.back()).c_str(), strerror(errno));
+
+            // partially written record would be misread by reader; segment keeps only complete records
+            if (ftruncate(writer, static_cast<off_t>(writerSize)) != 0)
+            {
+                LOG_FMT_ERR("unable to truncate spool segment %s; %s", segmentPath(segments.back()).c_str(), strerror(errno));
+            }
+
+            closeWriter();
+            writeBuffer.clear();
+            bufferedRecords = 0;
+            return false;
+        }
+
+        written += static_cast<size_t>(result);
+    }
+
+    writerSize += writeBuffer.size();
+    byteCount += writeBuffer.size();
+    recordCount += bufferedRecords;
+    writeBuffer.clear();
+    bufferedRecords = 0;
+
+    if (writerSize >= segmentSize)
+    {
+        closeWriter();
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SegmentSpool::readNext(std::string &record)
+{
+    while (!segments.empty())
+    {
+        if (!readerOpen)
+        {
+            // segment must be complete on disk before reading it; new records go to next segment
+            if ((writer >= 0) && (segments.front() == segments.back()))
+            {
+                closeWriter();
+            }
+
+            reader.open(segmentPath(segments.front()), std::ios::binary | std::ios::in);
+
+            if (!reader.is_open())
+            {
+                LOG_FMT_ERR("unable to open spool segment %s; segment skipped", segmentPath(segments.front()).c_str());
+                segments.pop_front();
+                continue;
+            }
+
+            readerOpen = true;
+        }
+
+        uint32_t length(0);
+
+        if (reader.read(reinterpret_cast<char *>(&length), sizeof(length)))
+        {
+            record.resize(length);
+
+            if (reader.read(&record[0], static_cast<std::streamsize>(length)))
+            {
+                recordCount--;
+                byteCount -= sizeof(length) + length;
+                return true;
+            }
+
+            LOG_FMT_ERR("truncated record in spool segment %s", segmentPath(segments.front()).c_str());
+        }
+
+        releaseReader();
+    }
+
+    // counters may drift only if segments were damaged externally
+    recordCount = 0;
+    byteCount = 0;
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SegmentSpool::empty(void) const
+{
+    return recordCount == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t SegmentSpool::getRecordCount(void) const
+{
+    return recordCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t SegmentSpool::getByteCount(void) const
+{
+    return byteCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t SegmentSpool::getSegmentCount(void) const
+{
+    return segments.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string SegmentSpool::segmentPath(const uint64_t sequence) const
+{
+    char fileName[64];
+    snprintf(fileName, sizeof(fileName), "%s%020" PRIu64 "%s", SEGMENT_PREFIX, sequence, SEGMENT_SUFFIX);
+    return directory + '/' + fileName;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SegmentSpool::scanSegment(const uint64_t sequence, uint64_t &records, uint64_t &bytes) const
+{
+    struct stat status;
+
+    if (stat(segmentPath(sequence).c_str(), &status) != 0)
+    {
+        return;
+    }
+
+    const uint64_t fileSize(static_cast<uint64_t>(status.st_size));
+    std::ifstream segment(segmentPath(sequence), std::ios::binary | std::ios::in);
+    uint64_t position(0);
+    uint32_t length(0);
+
+    // only complete records are counted; truncated tail is detected again during read
+    while (segment.read(reinterpret_cast<char *>(&length), sizeof(length)) &&
+           (position + sizeof(length) + length <= fileSize))
+    {
+        position += sizeof(length) + length;
+        records++;
+        bytes += sizeof(length) + length;
+
+        if (!segment.seekg(static_cast<std::streamoff>(position)))
+        {
+            break;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SegmentSpool::closeWriter(void)
+{
+    if (writer >= 0)
+    {
+        ::close(writer);
+        writer = -1;
+        writerSize = 0;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SegmentSpool::releaseReader(void)
+{
+    if (readerOpen)
+    {
+        reader.close();
+        reader.clear();
+        readerOpen = false;
+    }
+
+    if (unlink(segmentPath(segments.front()).c_str()) != 0)
+    {
+        LOG_FMT_WRN("unable to remove spool segment %s; %s", segmentPath(segments.front()).c_str(), strerror(errno));
+    }
+
+    segments.pop_front();
+}
@@ -0,0 +1,152 @@
+#ifndef SEGMENTSPOOL_HPP
+#define SEGMENTSPOOL_HPP
+
+#include "Logger.hpp"
+#include <cinttypes>
+#include <deque>
+#include <fstream>
+#include <string>
+
+/**
+ * @brief FIFO of binary records stored in sequentially written segment files
+ *
+ * Records are appended to the newest segment and read from the oldest one.
+ * Each record is stored as 32-bit length (host byte order) followed by payload.
+ * Appended records are buffered and written by flush() with one write(); a
+ * failed write is cut off, so a segment always ends with a complete record.
+ * Segment is rotated when it grows over configured size and deleted when it
+ * is completely read. Segments left from previous run are picked up on open
+ * and replayed from their beginning, so partially read segment may deliver
+ * some records twice but no record is lost.
+ * Class is not thread safe; caller is responsible for locking.
+ */
+class SegmentSpool final
+{
+public:
+    /**
+     * @brief Construct a new Segment Spool object
+     *
+     * @param directory directory where segment files are stored
+     * @param segmentSize segment is rotated when it grows over this size in bytes
+     */
+    SegmentSpool(const std::string &directory, const uint64_t segmentSize);
+
+    /**
+     * @brief Destroy the Segment Spool object; unread segments are kept on disk
+     *
+     */
+    ~SegmentSpool();
+
+    /**
+     * @brief create spool directory and register segments left from previous run
+     *
+     * @return true on success
+     * @return false if directory is not accessible
+     */
+    bool open(void);
+
+    /**
+     * @brief append record to write buffer; it is stored by the next flush()
+     *
+     * @param record record payload
+     */
+    void append(const std::string &record);
+
+    /**
+     * @brief write buffered records to the newest segment
+     *
+     * @return true on success
+     * @return false on I/O error; buffered records are discarded, segment is cut back
+     * to its last complete record and next flush starts a new segment
+     */
+    bool flush(void);
+
+    /**
+     * @brief read and remove the oldest record
+     *
+     * @param record output buffer for record payload
+     * @return true if record was read
+     * @return false if spool is empty
+     */
+    bool readNext(std::string &record);
+
+    /**
+     * @brief check if there are any records stored
+     *
+     * @return true no records are stored
+     * @return false some records are stored
+     */
+    bool empty(void) const;
+
+    /**
+     * @brief Get number of stored records
+     *
+     * @return uint64_t
+     */
+    uint64_t getRecordCount(void) const;
+
+    /**
+     * @brief Get number of bytes stored in segments
+     *
+     * @return uint64_t
+     */
+    uint64_t getByteCount(void) const;
+
+    /**
+     * @brief Get number of segment files
+     *
+     * @return uint64_t
+     */
+    uint64_t getSegmentCount(void) const;
+
+private:
+    /**
+     * @brief build segment file path from its sequence number
+     *
+     * @param sequence segment sequence number
+     * @return std::string
+     */
+    std::string segmentPath(const uint64_t sequence) const;
+
+    /**
+     * @brief count records in segment found on disk during open
+     *
+     * @param sequence segment sequence number
+     * @param records output number of complete records
+     * @param bytes output size of complete records
+     */
+    void scanSegment(const uint64_t sequence, uint64_t &records, uint64_t &bytes) const;
+
+    /**
+     * @brief close segment that is being written
+     *
+     */
+    void closeWriter(void);
+
+    /**
+     * @brief close and delete segment that was completely read
+     *
+     */
+    void releaseReader(void);
+
+    const std::string directory;
+    const uint64_t segmentSize;
+
+    // sequence numbers of segments on disk; front is read, back is written
+    std::deque<uint64_t> segments;
+    uint64_t nextSequence = 0;
+
+    // descriptor of segment being written or -1; its size covers complete records only
+    int writer = -1;
+    uint64_t writerSize = 0;
+    std::string writeBuffer;
+    uint64_t bufferedRecords = 0;
+
+    std::ifstream reader;
+    bool readerOpen = false;
+
+    uint64_t recordCount = 0;
+    uint64_t byteCount = 0;
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include "Benchmark.hpp"
+#include "Logger.hpp"
+#include "../runtime/MemoryArena.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <random>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+// cases run in this order; checkpoint restore needs data storage still empty
+const Benchmark::Case Benchmark::cases[] = {
+    {"checkpoint", restoreCheckpoint},
+    {"history-scan", scanHistory},
+    {"device-table", updateDevices},
+    {"device-table-concurrent", updateDevicesConcurrently},
+    {"results-snapshot", readSnapshots},
+    {"write-ahead-log", appendLog},
+    {"arrow-export", exportArrow},
+};
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::run(const std::vector<std::string> &names)
+{
+    for (const auto &name : names)
+    {
+        bool known(false);
+
+        for (const auto &benchmarkCase : cases)
+        {
+            known = known || (name == benchmarkCase.name);
+        }
+
+        if (!known)
+        {
+            LOG_FMT_ERR("unknown benchmark %s", name.c_str());
+            return false;
+        }
+    }
+
+    for (const auto &benchmarkCase : cases)
+    {
+        bool selected(names.empty());
+
+        for (const auto &name : names)
+        {
+            selected = selected || (name == benchmarkCase.name);
+        }
+
+        if (selected && !benchmarkCase.body())
+        {
+            LOG_FMT_ERR("benchmark %s failed", benchmarkCase.name);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::fillBatch(RecordBatch &batch, const uint64_t firstDevice, const uint32_t deviceCount, const int64_t timestamp,
+                          const double value)
+{
+    std::vector<uint64_t> devices(deviceCount);
+
+    for (uint32_t device(0); device < deviceCount; ++device)
+    {
+        devices[device] = firstDevice + device;
+    }
+
+    return fillBatch(batch, devices, timestamp, value);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::fillBatch(RecordBatch &batch, const std::vector<uint64_t> &devices, const int64_t timestamp, const double value)
+{
+    uint8_t measured[MeasurementCatalog::maxKinds];
+    double measuredValues[MeasurementCatalog::maxKinds];
+    uint8_t measuredFaults[MeasurementCatalog::maxKinds];
+    char name[32];
+
+    batch.clear();
+
+    for (const uint64_t number : devices)
+    {
+        const int length(snprintf(name, sizeof(name), "device-%" PRIu64, number));
+
+        for (unsigned kind(0); kind < MeasurementCatalog::maxKinds; ++kind)
+        {
+            measured[kind] = (kind < MeasurementCatalog::size()) ? 1 : 0;
+            measuredValues[kind] = value + static_cast<double>((number * 7 + kind) % 64) * 0.1;
+            measuredFaults[kind] = MeasurementCatalog::noFault;
+        }
+
+        if (!batch.append(name, static_cast<uint32_t>(length), timestamp, measured, measuredValues, measuredFaults))
+        {
+            return false;
+        }
+    }
+
+    batch.aggregate();
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::prepareBatches(std::vector<RecordBatch> &batches, const uint32_t batchCount, const uint32_t batchSize,
+                               const uint64_t firstDevice, const uint32_t deviceCount, const uint64_t seed)
+{
+    std::mt19937_64 random(seed);
+    std::uniform_int_distribution<uint64_t> pick(firstDevice, firstDevice + deviceCount - 1);
+    std::vector<uint64_t> devices(batchSize);
+
+    batches.clear();
+
+    for (uint32_t index(0); index < batchCount; ++index)
+    {
+        batches.emplace_back(batchSize);
+
+        for (auto &device : devices)
+        {
+            device = pick(random);
+        }
+
+        if (!fillBatch(batches.back(), devices, 1700000000000000 + index, 230.0 + index * 0.1))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Benchmark::report(const std::string &name, const uint64_t operations, const char *unit,
+                       const std::chrono::steady_clock::time_point &start, const unsigned threads)
+{
+    const double seconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    const double rate(static_cast<double>(operations) / seconds);
+
+    printf("benchmark: %s; %s: %" PRIu64 "; threads: %u; seconds: %.6f; %s/s: %.0f; %s/s/thread: %.0f; \n",
+           name.c_str(), unit, operations, threads, seconds, unit, rate, unit, rate / threads);
+    fflush(stdout);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t Benchmark::getCounter(const std::string &text, const std::string &key)
+{
+    const size_t position(text.find(key + ": "));
+    return (position == std::string::npos) ? 0 : strtoull(text.c_str() + position + key.size() + 2, nullptr, 10);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t Benchmark::getDeviceMemory(void)
+{
+    const std::string status(MemoryArena::getStatus());
+    const size_t position(status.find("subsystem: devices; "));
+    return (position == std::string::npos) ? 0 : getCounter(status.substr(position), "live");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::makeDirectory(std::string &directory)
+{
+    const char *temporary(getenv("TMPDIR"));
+    std::string path(((temporary != nullptr) && (*temporary != '\0')) ? temporary : "/tmp");
+    path += "/device-monitor-benchmark-XXXXXX";
+
+    if (mkdtemp(&path[0]) == nullptr)
+    {
+        LOG_FMT_ERR("unable to create benchmark directory %s; %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    directory = path;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t Benchmark::removeFiles(const std::string &directory, const bool keepDirectory)
+{
+    uint64_t size(0);
+    DIR *dir(opendir(directory.c_str()));
+
+    if (dir == nullptr)
+    {
+        return 0;
+    }
+
+    for (struct dirent *entry(readdir(dir)); entry != nullptr; entry = readdir(dir))
+    {
+        const std::string path(directory + "/" + entry->d_name);
+        struct stat status;
+
+        if ((stat(path.c_str(), &status) == 0) && S_ISREG(status.st_mode))
+        {
+            size += static_cast<uint64_t>(status.st_size);
+            unlink(path.c_str());
+        }
+    }
+
+    closedir(dir);
+
+    if (!keepDirectory)
+    {
+        rmdir(directory.c_str());
+    }
+
+    return size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned Benchmark::getThreads(void)
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
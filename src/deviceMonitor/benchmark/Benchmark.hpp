@@ -0,0 +1,217 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include "../storage/RecordBatch.hpp"
+#include <chrono>
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+/**
+ * @brief micro benchmarks of storage hot paths
+ *
+ * Every case fills the store it measures with synthetic devices named
+ * "device-<n>" and prints one "key: value; " line per measurement with total
+ * rate and rate per thread taking part. Cases run in one process one after
+ * another, so stores filled by earlier cases stay filled; each case uses its
+ * own device name range. Cases writing files use a temporary directory under
+ * $TMPDIR (/tmp by default) and remove it when done.
+ */
+class Benchmark final
+{
+public:
+    Benchmark() = delete;
+
+    /**
+     * @brief run selected cases
+     *
+     * @param names names of cases to run; empty runs all cases
+     * @return true on success
+     * @return false if case is unknown or failed
+     */
+    static bool run(const std::vector<std::string> &names);
+
+private:
+    struct Case
+    {
+        const char *name;
+        bool (*body)(void);
+    };
+
+    /**
+     * @brief append one reading of every measurement kind for each of consecutive devices
+     *
+     * @param batch batch to append to; it is cleared first
+     * @param firstDevice number of first device
+     * @param deviceCount number of devices
+     * @param timestamp timestamp in microseconds since Unix epoch
+     * @param value base of measured values; devices get values spread around it
+     * @return true on success
+     * @return false if device did not fit in memory budget
+     */
+    static bool fillBatch(RecordBatch &batch, const uint64_t firstDevice, const uint32_t deviceCount, const int64_t timestamp,
+                          const double value);
+
+    /**
+     * @brief append one reading of every measurement kind for each of given devices
+     *
+     * @param batch batch to append to; it is cleared first
+     * @param devices numbers of devices; may repeat
+     * @param timestamp timestamp in microseconds since Unix epoch
+     * @param value base of measured values; devices get values spread around it
+     * @return true on success
+     * @return false if device did not fit in memory budget
+     */
+    static bool fillBatch(RecordBatch &batch, const std::vector<uint64_t> &devices, const int64_t timestamp, const double value);
+
+    /**
+     * @brief fill batches with readings of devices picked at random from consecutive devices
+     *
+     * @param batches output batches; previous batches are removed
+     * @param batchCount number of batches
+     * @param batchSize number of records of every batch
+     * @param firstDevice number of first device
+     * @param deviceCount number of devices
+     * @param seed seed of random device choice
+     * @return true on success
+     * @return false if device did not fit in memory budget
+     */
+    static bool prepareBatches(std::vector<RecordBatch> &batches, const uint32_t batchCount, const uint32_t batchSize,
+                               const uint64_t firstDevice, const uint32_t deviceCount, const uint64_t seed);
+
+    /**
+     * @brief print measurement
+     *
+     * @param name case and measurement name
+     * @param operations number of measured operations
+     * @param unit unit of operation
+     * @param start start of measured interval; interval ends now
+     * @param threads number of threads taking part
+     */
+    static void report(const std::string &name, const uint64_t operations, const char *unit,
+                       const std::chrono::steady_clock::time_point &start, const unsigned threads);
+
+    /**
+     * @brief Get counter printed as "key: value; "
+     *
+     * @param text text to search
+     * @param key counter key
+     * @return uint64_t first value of key or zero if key is missing
+     */
+    static uint64_t getCounter(const std::string &text, const std::string &key);
+
+    /**
+     * @brief Get bytes of devices subsystem mapped or taken from heap
+     *
+     * @return uint64_t
+     */
+    static uint64_t getDeviceMemory(void);
+
+    /**
+     * @brief create empty directory for files of a case under $TMPDIR or /tmp
+     *
+     * @param directory output path of created directory
+     * @return true on success
+     * @return false on failure
+     */
+    static bool makeDirectory(std::string &directory);
+
+    /**
+     * @brief remove files of directory and, if requested, the directory itself
+     *
+     * @param directory directory created by makeDirectory()
+     * @param keepDirectory only files are removed
+     * @return uint64_t total size of removed files in bytes
+     */
+    static uint64_t removeFiles(const std::string &directory, const bool keepDirectory);
+
+    /**
+     * @brief Get number of hardware threads; at least one
+     *
+     * @return unsigned
+     */
+    static unsigned getThreads(void);
+
+    /**
+     * @brief aggregate history ranges answered from block summaries and from decoded boundary blocks
+     *
+     * @return true on success
+     * @return false on failure
+     */
+    static bool scanHistory(void);
+
+    /**
+     * @brief add one message of every device to data storage
+     *
+     * @param firstDevice number of first device
+     * @param deviceCount number of devices
+     * @return true on success
+     * @return false if device did not fit in memory budget
+     */
+    static bool insertDevices(const uint64_t firstDevice, const uint32_t deviceCount);
+
+    /**
+     * @brief write checkpoint of data storage filled by child process and restore it into empty storage;
+     * runs before any other case adds to data storage
+     *
+     * @return true on success
+     * @return false on failure or if restored results differ
+     */
+    static bool restoreCheckpoint(void);
+
+    /**
+     * @brief insert devices into data storage and update random known devices from one writer;
+     * every table size runs in its own child process, so its memory is returned before the next one
+     *
+     * @return true on success
+     * @return false on failure
+     */
+    static bool updateDevices(void);
+
+    /**
+     * @brief insert given number of devices and update random ones; stops early when available
+     * memory runs low and reports the size as skipped
+     *
+     * @param deviceCount number of devices
+     * @return true on success or if the size does not fit in available memory
+     * @return false on failure
+     */
+    static bool updateTable(const uint32_t deviceCount);
+
+    /**
+     * @brief update random known devices of data storage from several writers at once
+     *
+     * @return true on success
+     * @return false on failure
+     */
+    static bool updateDevicesConcurrently(void);
+
+    /**
+     * @brief measure latency of batches of one writer while another thread keeps reading results snapshots
+     *
+     * @return true on success
+     * @return false on failure
+     */
+    static bool readSnapshots(void);
+
+    /**
+     * @brief append batches to write-ahead log with every durability from one and several writers,
+     * then replay the log into data storage
+     *
+     * @return true on success
+     * @return false on failure
+     */
+    static bool appendLog(void);
+
+    /**
+     * @brief export counters and history of every device as Arrow IPC files
+     *
+     * @return true on success
+     * @return false on failure
+     */
+    static bool exportArrow(void);
+
+    static const Case cases[];
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "Benchmark.hpp"
+#include "../storage/DataStorage.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    const uint64_t checkpointFirstDevice = 50000000;
+    const uint32_t checkpointDevices = 100000;
+    const uint32_t checkpointBatchSize = 256;
+    const uint32_t checkpointBatches = 64;
+    // random updates give devices different counters and sketches
+    const uint32_t checkpointUpdates = 1000000;
+
+    ////////////////////////////////////////////////////////////////////////////////
+    std::string getSortedResults(void)
+    {
+        // devices are listed in table order, which depends on ids given by the process
+        std::stringstream results(DataStorage::getResults());
+        std::vector<std::string> lines;
+
+        for (std::string line; std::getline(results, line);)
+        {
+            lines.push_back(line);
+        }
+
+        std::sort(lines.begin(), lines.end());
+        std::string sorted;
+
+        for (const auto &line : lines)
+        {
+            sorted += line + "\n";
+        }
+
+        return sorted;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    uint64_t getFileSize(const std::string &file)
+    {
+        struct stat status;
+        return (stat(file.c_str(), &status) == 0) ? static_cast<uint64_t>(status.st_size) : 0;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::restoreCheckpoint(void)
+{
+    if (DataStorage::forEachSnapshot([](const DeviceTable::DeviceRecord &) {}) != 0)
+    {
+        LOG_MSG_ERR("checkpoint benchmark needs empty storage");
+        return false;
+    }
+
+    std::string directory;
+
+    if (!makeDirectory(directory))
+    {
+        return false;
+    }
+
+    const std::string file(directory + "/checkpoint");
+    const std::string resultsFile(directory + "/results");
+    const pid_t child(fork());
+
+    if (child < 0)
+    {
+        LOG_FMT_ERR("unable to start checkpoint writer; %s", strerror(errno));
+        removeFiles(directory, false);
+        return false;
+    }
+
+    if (child == 0)
+    {
+        // storage of the child is filled and checkpointed, storage of the parent stays empty for restore
+        std::vector<RecordBatch> batches;
+        uint64_t epoch(0);
+        bool written(insertDevices(checkpointFirstDevice, checkpointDevices) &&
+                     prepareBatches(batches, checkpointBatches, checkpointBatchSize, checkpointFirstDevice, checkpointDevices, 0));
+
+        for (uint32_t index(0); written && (index < checkpointUpdates / checkpointBatchSize); ++index)
+        {
+            DataStorage::addBatch(batches[index % batches.size()]);
+        }
+
+        const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+        written = written && DataStorage::checkpoint(file, epoch);
+        report("checkpoint write", checkpointDevices, "devices", start, 1);
+        printf("benchmark: checkpoint size; devices: %u; bytes/device: %.0f; \n", checkpointDevices,
+               static_cast<double>(getFileSize(file)) / checkpointDevices);
+
+        std::ofstream results(resultsFile, std::ios::binary);
+        results << getSortedResults();
+        results.close();
+        fflush(stdout);
+        _exit((written && results) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    int status(0);
+
+    if ((waitpid(child, &status, 0) != child) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS))
+    {
+        LOG_MSG_ERR("checkpoint writer failed");
+        removeFiles(directory, false);
+        return false;
+    }
+
+    uint64_t nextEpoch(0);
+    const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+    const bool restored(DataStorage::restore(file, nextEpoch));
+    report("checkpoint restore", checkpointDevices, "devices", start, 1);
+
+    std::ifstream results(resultsFile, std::ios::binary);
+    const std::string expected((std::istreambuf_iterator<char>(results)), std::istreambuf_iterator<char>());
+    removeFiles(directory, false);
+
+    return restored && (getSortedResults() == expected);
+}
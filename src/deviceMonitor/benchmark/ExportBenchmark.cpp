@@ -0,0 +1,68 @@
+#include "Benchmark.hpp"
+#include "../storage/ColumnarExport.hpp"
+#include "../storage/DataStorage.hpp"
+#include "../storage/HistoryStore.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    const uint64_t exportFirstDevice = 60000000;
+    const uint32_t exportDevices = 100000;
+    const uint32_t exportSamples = 16;
+    const uint32_t exportBatchSize = 256;
+    // milliseconds since Unix epoch of the first sample; samples are one second apart
+    const int64_t exportStart = 1700000000000;
+    const uint64_t exportRetention = 10ull * 365 * 24 * 3600 * 1000;
+
+    ////////////////////////////////////////////////////////////////////////////////
+    bool isArrowFile(const std::string &file)
+    {
+        // IPC file starts and ends with magic
+        const std::string magic("ARROW1");
+        return (file.size() > 2 * magic.size()) && (file.compare(0, magic.size(), magic) == 0) &&
+               (file.compare(file.size() - magic.size(), magic.size(), magic) == 0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::exportArrow(void)
+{
+    HistoryStore::configure(true, exportRetention, std::numeric_limits<uint64_t>::max());
+    RecordBatch batch(exportBatchSize);
+
+    for (uint32_t sample(0); sample < exportSamples; ++sample)
+    {
+        for (uint32_t device(0); device < exportDevices; device += exportBatchSize)
+        {
+            if (!fillBatch(batch, exportFirstDevice + device, std::min(exportBatchSize, exportDevices - device),
+                           (exportStart + sample * 1000ll) * 1000, 230.0 + (sample % 50) * 0.1))
+            {
+                return false;
+            }
+
+            DataStorage::addBatch(batch);
+            HistoryStore::append(batch);
+        }
+    }
+
+    // stores may hold devices of earlier cases as well; rates are bytes of the whole export. First export
+    // folds counters pending since the last snapshot and grows the result, so the second one is measured
+    std::string result;
+    ColumnarExport::exportCounters(result);
+    std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+    ColumnarExport::exportCounters(result);
+    report("arrow-export counters", result.size(), "bytes", start, 1);
+
+    if (!isArrowFile(result))
+    {
+        return false;
+    }
+
+    ColumnarExport::exportHistory(result);
+    start = std::chrono::steady_clock::now();
+    const bool exported(ColumnarExport::exportHistory(result));
+    report("arrow-export history", result.size(), "bytes", start, 1);
+
+    return exported && isArrowFile(result);
+}
@@ -0,0 +1,107 @@
+#include "Benchmark.hpp"
+#include "../storage/DataStorage.hpp"
+#include "../storage/WriteAheadLog.hpp"
+#include <functional>
+#include <thread>
+
+namespace
+{
+    const uint64_t logFirstDevice = 40000000;
+    const uint32_t logDevices = 100000;
+    const uint32_t logBatchSize = 256;
+    const uint32_t logBatches = 64;
+    const uint32_t logRecords = 512 * 1024;
+    // defaults of "wal" configuration
+    const uint64_t logGroupBytes = 1024 * 1024;
+    const uint64_t logGroupDelay = 10;
+    const uint64_t logSegmentSize = 64 * 1024 * 1024;
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void appendBatches(const std::vector<RecordBatch> &batches, const uint32_t count)
+    {
+        for (uint32_t index(0); index < count; ++index)
+        {
+            WriteAheadLog::append(batches[index % batches.size()], 1);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    uint64_t getTotal(void)
+    {
+        return DataStorage::forEachSnapshot([](const DeviceTable::DeviceRecord &) {});
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::appendLog(void)
+{
+    std::string directory;
+
+    if (!makeDirectory(directory))
+    {
+        return false;
+    }
+
+    std::vector<unsigned> threadCounts = {1, 4};
+    std::vector<std::vector<RecordBatch>> batches(threadCounts.back());
+
+    for (unsigned thread(0); thread < threadCounts.back(); ++thread)
+    {
+        if (!prepareBatches(batches[thread], logBatches, logBatchSize, logFirstDevice, logDevices, thread))
+        {
+            removeFiles(directory, false);
+            return false;
+        }
+    }
+
+    // group durability runs last, so its log is left for replay
+    const WriteAheadLog::Durability durabilities[] = {WriteAheadLog::durabilityWrite, WriteAheadLog::durabilitySync,
+                                                      WriteAheadLog::durabilityGroup};
+    uint64_t appended(0);
+
+    for (const auto durability : durabilities)
+    {
+        for (const unsigned threads : threadCounts)
+        {
+            // every run starts with an empty log; the log of the last run is kept for replay
+            removeFiles(directory, true);
+
+            if (!WriteAheadLog::open(directory, durability, logGroupBytes, logGroupDelay, logSegmentSize))
+            {
+                removeFiles(directory, false);
+                return false;
+            }
+
+            const uint32_t count(logRecords / logBatchSize / threads);
+            std::vector<std::thread> writers;
+
+            const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+
+            for (unsigned thread(0); thread < threads; ++thread)
+            {
+                writers.emplace_back(appendBatches, std::cref(batches[thread]), count);
+            }
+
+            for (auto &writer : writers)
+            {
+                writer.join();
+            }
+
+            // remaining group is written and synced by close
+            WriteAheadLog::close();
+            appended = static_cast<uint64_t>(count) * logBatchSize * threads;
+            report(std::string("write-ahead-log append ") + WriteAheadLog::durabilityKeys[durability], appended, "records", start, threads);
+        }
+    }
+
+    const uint64_t firstTotal(getTotal());
+    const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+    const bool replayed(WriteAheadLog::replay(directory, logBatchSize, 0));
+    report("write-ahead-log replay", appended, "records", start, 1);
+
+    const uint64_t bytes(removeFiles(directory, false));
+    printf("benchmark: write-ahead-log size; records: %" PRIu64 "; bytes/record: %.1f; \n", appended,
+           static_cast<double>(bytes) / static_cast<double>(appended));
+
+    return replayed && ((getTotal() - firstTotal) == appended);
+}
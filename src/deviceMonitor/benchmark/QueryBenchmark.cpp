@@ -0,0 +1,72 @@
+#include "Benchmark.hpp"
+#include "../storage/HistoryStore.hpp"
+#include "../storage/QueryEngine.hpp"
+#include <limits>
+
+namespace
+{
+    const uint64_t historyFirstDevice = 0;
+    const uint32_t historyDevices = 2048;
+    // four blocks per series
+    const uint32_t historySamples = 4 * GorillaBlock::maxSamples;
+    // milliseconds since Unix epoch of the first sample; samples are one second apart
+    const int64_t historyStart = 1700000000000;
+    const uint64_t historyRetention = 10ull * 365 * 24 * 3600 * 1000;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::scanHistory(void)
+{
+    HistoryStore::configure(true, historyRetention, std::numeric_limits<uint64_t>::max());
+    RecordBatch batch(historyDevices);
+
+    std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+
+    for (uint32_t sample(0); sample < historySamples; ++sample)
+    {
+        if (!fillBatch(batch, historyFirstDevice, historyDevices, (historyStart + sample * 1000ll) * 1000, 230.0 + (sample % 50) * 0.1))
+        {
+            return false;
+        }
+
+        HistoryStore::append(batch);
+    }
+
+    report("history-scan append", static_cast<uint64_t>(historyDevices) * historySamples * MeasurementCatalog::size(), "samples", start, 1);
+
+    const int64_t last(historyStart + (historySamples - 1) * 1000ll);
+    std::string result;
+    std::vector<unsigned> threadCounts(1, 1);
+
+    if (getThreads() > 1)
+    {
+        threadCounts.push_back(getThreads());
+    }
+
+    for (const unsigned threads : threadCounts)
+    {
+        if (!QueryEngine::start(threads - 1))
+        {
+            return false;
+        }
+
+        // every block is answered from its summary
+        start = std::chrono::steady_clock::now();
+        const bool summarized(QueryEngine::aggregate("", 0, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max(), result));
+        report("history-scan summarized range", getCounter(result, "total: count"), "samples", start, threads);
+
+        // first and last block of every series are copied and decoded
+        start = std::chrono::steady_clock::now();
+        const bool decoded(QueryEngine::aggregate("", 0, historyStart + 500, last - 500, result));
+        report("history-scan boundary range", getCounter(result, "decodedSamples"), "samples", start, threads);
+
+        QueryEngine::stop();
+
+        if (!summarized || !decoded)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
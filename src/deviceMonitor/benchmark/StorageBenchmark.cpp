@@ -0,0 +1,303 @@
+#include "Benchmark.hpp"
+#include "../storage/DataStorage.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    // device table is measured at every size, each in a child process starting from the same storage
+    const uint32_t tableSizes[] = {10000, 1000000, 10000000};
+    const uint64_t tableFirstDevice = 100000000;
+    // devices are inserted in steps; insertion gives up once less memory than the reserve is available
+    const uint32_t tableInsertStep = 65536;
+    const uint64_t tableMemoryReserve = 512 * 1024 * 1024;
+    const uint32_t tableDevices = 100000;
+    const uint32_t tableUpdates = 4000000;
+    const uint32_t tableBatchSize = 256;
+    // batches are prepared up front and applied in turn, so names are not interned while measured
+    const uint32_t tableBatches = 64;
+    // updates of a table size spread over this many batches, so they do not stay in cache
+    const uint32_t tableUpdateBatches = 1024;
+    const uint64_t concurrentFirstDevice = 20000000;
+    const uint32_t snapshotDevices = 200000;
+    const uint32_t snapshotBatches = 8000;
+    const uint64_t snapshotFirstDevice = 30000000;
+
+    ////////////////////////////////////////////////////////////////////////////////
+    uint64_t getTotal(void)
+    {
+        return DataStorage::forEachSnapshot([](const DeviceTable::DeviceRecord &) {});
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void applyBatches(const std::vector<RecordBatch> &batches, const uint32_t count)
+    {
+        for (uint32_t index(0); index < count; ++index)
+        {
+            DataStorage::addBatch(batches[index % batches.size()]);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    uint64_t getAvailableMemory(void)
+    {
+        std::ifstream meminfo("/proc/meminfo");
+
+        for (std::string key; meminfo >> key;)
+        {
+            uint64_t kilobytes(0);
+
+            if ((key == "MemAvailable:") && (meminfo >> kilobytes))
+            {
+                return kilobytes * 1024;
+            }
+
+            meminfo.ignore(256, '\n');
+        }
+
+        return UINT64_MAX;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    double getPercentile(const std::vector<double> &sorted, const double percentile)
+    {
+        const size_t position(static_cast<size_t>(percentile * static_cast<double>(sorted.size())));
+        return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, position)];
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void reportLatency(const std::string &name, std::vector<double> &microseconds)
+    {
+        std::sort(microseconds.begin(), microseconds.end());
+        printf("benchmark: %s; samples: %zu; p50us: %.0f; p99us: %.0f; p999us: %.0f; maxus: %.0f; \n", name.c_str(),
+               microseconds.size(), getPercentile(microseconds, 0.5), getPercentile(microseconds, 0.99),
+               getPercentile(microseconds, 0.999), microseconds.empty() ? 0.0 : microseconds.back());
+        fflush(stdout);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::insertDevices(const uint64_t firstDevice, const uint32_t deviceCount)
+{
+    RecordBatch batch(tableBatchSize);
+
+    for (uint32_t device(0); device < deviceCount; device += tableBatchSize)
+    {
+        if (!fillBatch(batch, firstDevice + device, std::min(tableBatchSize, deviceCount - device), 1700000000000000, 230.0))
+        {
+            return false;
+        }
+
+        DataStorage::addBatch(batch);
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::updateDevices(void)
+{
+    for (const uint32_t devices : tableSizes)
+    {
+        // buffered output would be printed by the child again
+        fflush(stdout);
+        const pid_t child(fork());
+
+        if (child < 0)
+        {
+            LOG_FMT_ERR("unable to start device table benchmark; %s", strerror(errno));
+            return false;
+        }
+
+        if (child == 0)
+        {
+            const bool updated(updateTable(devices));
+            fflush(stdout);
+            _exit(updated ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
+        int status(0);
+
+        if ((waitpid(child, &status, 0) != child) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS))
+        {
+            LOG_FMT_ERR("device table benchmark with %u devices failed", devices);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::updateTable(const uint32_t deviceCount)
+{
+    const uint64_t firstTotal(getTotal());
+    const uint64_t firstMemory(getDeviceMemory());
+
+    std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+
+    for (uint32_t inserted(0); inserted < deviceCount;)
+    {
+        const uint32_t step(std::min(tableInsertStep, deviceCount - inserted));
+
+        if (!insertDevices(tableFirstDevice + inserted, step))
+        {
+            return false;
+        }
+
+        inserted += step;
+
+        if (getAvailableMemory() < tableMemoryReserve)
+        {
+            printf("benchmark: device-table skipped; devices: %u; inserted: %u; bytes/device: %.0f; \n", deviceCount, inserted,
+                   static_cast<double>(getDeviceMemory() - firstMemory) / inserted);
+            return true;
+        }
+    }
+
+    report("device-table insert", deviceCount, "devices", start, 1);
+    printf("benchmark: device-table memory; devices: %u; bytes/device: %.0f; \n", deviceCount,
+           static_cast<double>(getDeviceMemory() - firstMemory) / deviceCount);
+
+    std::vector<RecordBatch> batches;
+
+    if (!prepareBatches(batches, tableUpdateBatches, tableBatchSize, tableFirstDevice, deviceCount, deviceCount))
+    {
+        return false;
+    }
+
+    const std::string size("; devices: " + std::to_string(deviceCount));
+    std::vector<double> latencies;
+    latencies.reserve(tableUpdates / tableBatchSize);
+    start = std::chrono::steady_clock::now();
+
+    for (uint32_t index(0); index < tableUpdates / tableBatchSize; ++index)
+    {
+        const std::chrono::steady_clock::time_point batchStart(std::chrono::steady_clock::now());
+        DataStorage::addBatch(batches[index % batches.size()]);
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - batchStart).count());
+    }
+
+    report("device-table update" + size, tableUpdates, "records", start, 1);
+    reportLatency("device-table update batch" + size, latencies);
+
+    // every record is one message
+    return (getTotal() - firstTotal) == (deviceCount + tableUpdates);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::updateDevicesConcurrently(void)
+{
+    if (!insertDevices(concurrentFirstDevice, tableDevices))
+    {
+        return false;
+    }
+
+    // writers contend even on one core, so more writers than hardware threads are measured as well
+    std::vector<unsigned> threadCounts = {1, 2, 4, 8, 16, 32};
+
+    if (getThreads() > threadCounts.back())
+    {
+        threadCounts.push_back(getThreads());
+    }
+
+    for (const unsigned threads : threadCounts)
+    {
+        std::vector<std::vector<RecordBatch>> batches(threads);
+
+        for (unsigned thread(0); thread < threads; ++thread)
+        {
+            if (!prepareBatches(batches[thread], tableBatches, tableBatchSize, concurrentFirstDevice, tableDevices, thread))
+            {
+                return false;
+            }
+        }
+
+        const uint32_t count(tableUpdates / tableBatchSize / threads);
+        const uint64_t firstTotal(getTotal());
+        std::vector<std::thread> writers;
+
+        const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+
+        for (unsigned thread(0); thread < threads; ++thread)
+        {
+            writers.emplace_back(applyBatches, std::cref(batches[thread]), count);
+        }
+
+        for (auto &writer : writers)
+        {
+            writer.join();
+        }
+
+        report("device-table-concurrent update", static_cast<uint64_t>(count) * tableBatchSize * threads, "records", start, threads);
+
+        if ((getTotal() - firstTotal) != static_cast<uint64_t>(count) * tableBatchSize * threads)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Benchmark::readSnapshots(void)
+{
+    if (!insertDevices(snapshotFirstDevice, snapshotDevices))
+    {
+        return false;
+    }
+
+    std::vector<RecordBatch> batches;
+
+    if (!prepareBatches(batches, tableBatches, tableBatchSize, snapshotFirstDevice, snapshotDevices, snapshotDevices))
+    {
+        return false;
+    }
+
+    for (const bool polled : {false, true})
+    {
+        std::atomic<bool> polling(polled);
+        std::vector<double> readerLatencies;
+        std::thread poller([&polling, &readerLatencies](void)
+                           {
+                               while (polling.load())
+                               {
+                                   const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+                                   const std::string results(DataStorage::getResults());
+                                   readerLatencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+                               } });
+
+        std::vector<double> writerLatencies;
+        writerLatencies.reserve(snapshotBatches);
+
+        for (uint32_t index(0); index < snapshotBatches; ++index)
+        {
+            const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+            DataStorage::addBatch(batches[index % batches.size()]);
+            writerLatencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        polling = false;
+        poller.join();
+
+        const std::string suffix(polled ? " with poller" : " without poller");
+        reportLatency("results-snapshot writer batch" + suffix, writerLatencies);
+
+        if (polled)
+        {
+            reportLatency("results-snapshot reader", readerLatencies);
+        }
+    }
+
+    return true;
+}
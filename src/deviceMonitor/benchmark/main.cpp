@@ -0,0 +1,56 @@
+#include "Logger.hpp"
+#include "Benchmark.hpp"
+#include "../runtime/MemoryArena.hpp"
+#include "../storage/MeasurementCatalog.hpp"
+#include <cstdlib>
+#include <iostream>
+
+/**
+ * @brief
+ *
+ */
+void exitProcedure(void)
+{
+    logger::logDestroy_f();
+}
+
+/**
+ * @brief run storage benchmarks; usage: device-monitor-benchmark <schema file> [benchmark...]
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main(int argc, char *argv[])
+try
+{
+    if (atexit(exitProcedure) != 0)
+    {
+        std::cerr << "failed to register exit procedure" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    logger::logInitialize_f(nullptr, logger::logWrn_e);
+
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <schema file> [benchmark...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // stores are sized to the catalog, as in device monitor
+    MemoryArena::configure(0, false);
+
+    if (!MeasurementCatalog::load(argv[1]))
+    {
+        LOG_MSG_FTL("unable to load measurement catalog from message schema");
+        return EXIT_FAILURE;
+    }
+
+    return Benchmark::run(std::vector<std::string>(argv + 2, argv + argc)) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+catch (const std::exception &e)
+{
+    std::cerr << "unexpected exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,342 @@
+#include "Configuration.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+Configuration &Configuration::get(void)
+{
+    static Configuration configuration;
+    return configuration;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Configuration::load(const std::string &path)
+try
+{
+    std::ifstream inputFileStream(path);
+
+    if (!inputFileStream.is_open())
+    {
+        LOG_FMT_WRN("configuration file %s not found; using default values", path.c_str());
+        return true;
+    }
+
+    rapidjson::IStreamWrapper inputStreamWrapper(inputFileStream);
+    rapidjson::Document jsonDocument;
+
+    if (jsonDocument.ParseStream(inputStreamWrapper).HasParseError() || !jsonDocument.IsObject())
+    {
+        LOG_FMT_FTL("invalid configuration file %s; error %d; offset: %d", path.c_str(), jsonDocument.GetParseError(), jsonDocument.GetErrorOffset());
+        return false;
+    }
+
+    if (jsonDocument.HasMember("schema") && jsonDocument["schema"].IsObject())
+    {
+        readValue(jsonDocument["schema"], "file", schemaSettings.file);
+    }
+
+    if (jsonDocument.HasMember("queue") && jsonDocument["queue"].IsObject())
+    {
+        const rapidjson::Value &queue(jsonDocument["queue"]);
+        readValue(queue, "spillEnabled", queueSettings.spillEnabled);
+        readValue(queue, "memoryLimit", queueSettings.memoryLimit);
+        readValue(queue, "spillDirectory", queueSettings.spillDirectory);
+        readValue(queue, "segmentSize", queueSettings.segmentSize);
+    }
+
+    if (jsonDocument.HasMember("capture") && jsonDocument["capture"].IsObject())
+    {
+        const rapidjson::Value &capture(jsonDocument["capture"]);
+        readValue(capture, "enabled", captureSettings.enabled);
+        readValue(capture, "file", captureSettings.file);
+        readValue(capture, "bufferBytes", captureSettings.bufferBytes);
+        readValue(capture, "flushDelay", captureSettings.flushDelay);
+        readValue(capture, "maxBytes", captureSettings.maxBytes);
+    }
+
+    if (jsonDocument.HasMember("processor") && jsonDocument["processor"].IsObject())
+    {
+        const rapidjson::Value &processor(jsonDocument["processor"]);
+        readValue(processor, "batchSize", processorSettings.batchSize);
+        readValue(processor, "threads", processorSettings.threads);
+        readValue(processor, "drainTimeout", processorSettings.drainTimeout);
+    }
+
+    if (jsonDocument.HasMember("memory") && jsonDocument["memory"].IsObject())
+    {
+        const rapidjson::Value &memory(jsonDocument["memory"]);
+        readValue(memory, "budget", memorySettings.budget);
+        readValue(memory, "hugePages", memorySettings.hugePages);
+    }
+
+    if (jsonDocument.HasMember("sketches") && jsonDocument["sketches"].IsObject())
+    {
+        const rapidjson::Value &sketches(jsonDocument["sketches"]);
+        readValue(sketches, "relativeAccuracy", sketchSettings.relativeAccuracy);
+    }
+
+    if (jsonDocument.HasMember("rollups") && jsonDocument["rollups"].IsObject())
+    {
+        const rapidjson::Value &rollups(jsonDocument["rollups"]);
+        readValue(rollups, "enabled", rollupSettings.enabled);
+        readValue(rollups, "delimiter", rollupSettings.delimiter);
+        readValue(rollups, "levels", rollupSettings.levels);
+    }
+
+    if (jsonDocument.HasMember("history") && jsonDocument["history"].IsObject())
+    {
+        const rapidjson::Value &history(jsonDocument["history"]);
+        readValue(history, "enabled", historySettings.enabled);
+        readValue(history, "retention", historySettings.retention);
+        readValue(history, "memoryLimit", historySettings.memoryLimit);
+    }
+
+    if (jsonDocument.HasMember("windows") && jsonDocument["windows"].IsObject())
+    {
+        const rapidjson::Value &windows(jsonDocument["windows"]);
+        readValue(windows, "enabled", windowSettings.enabled);
+        readValue(windows, "lateness", windowSettings.lateness);
+    }
+
+    if (jsonDocument.HasMember("distinct") && jsonDocument["distinct"].IsObject())
+    {
+        const rapidjson::Value &distinct(jsonDocument["distinct"]);
+        readValue(distinct, "enabled", distinctSettings.enabled);
+        readValue(distinct, "precision", distinctSettings.precision);
+    }
+
+    if (jsonDocument.HasMember("heavyHitters") && jsonDocument["heavyHitters"].IsObject())
+    {
+        const rapidjson::Value &heavyHitters(jsonDocument["heavyHitters"]);
+        readValue(heavyHitters, "enabled", heavyHitterSettings.enabled);
+        readValue(heavyHitters, "capacity", heavyHitterSettings.capacity);
+    }
+
+    if (jsonDocument.HasMember("liveness") && jsonDocument["liveness"].IsObject())
+    {
+        const rapidjson::Value &liveness(jsonDocument["liveness"]);
+        readValue(liveness, "enabled", livenessSettings.enabled);
+        readValue(liveness, "offlineTimeout", livenessSettings.offlineTimeout);
+        readValue(liveness, "evict", livenessSettings.evict);
+        readValue(liveness, "retention", livenessSettings.retention);
+        readValue(liveness, "archiveFile", livenessSettings.archiveFile);
+    }
+
+    if (jsonDocument.HasMember("wal") && jsonDocument["wal"].IsObject())
+    {
+        const rapidjson::Value &wal(jsonDocument["wal"]);
+        readValue(wal, "enabled", walSettings.enabled);
+        readValue(wal, "directory", walSettings.directory);
+        readValue(wal, "durability", walSettings.durability);
+        readValue(wal, "groupBytes", walSettings.groupBytes);
+        readValue(wal, "groupDelay", walSettings.groupDelay);
+        readValue(wal, "segmentSize", walSettings.segmentSize);
+    }
+
+    if (jsonDocument.HasMember("checkpoint") && jsonDocument["checkpoint"].IsObject())
+    {
+        const rapidjson::Value &checkpoint(jsonDocument["checkpoint"]);
+        readValue(checkpoint, "enabled", checkpointSettings.enabled);
+        readValue(checkpoint, "file", checkpointSettings.file);
+        readValue(checkpoint, "interval", checkpointSettings.interval);
+    }
+
+    if (jsonDocument.HasMember("query") && jsonDocument["query"].IsObject())
+    {
+        const rapidjson::Value &query(jsonDocument["query"]);
+        readValue(query, "threads", querySettings.threads);
+    }
+
+    if (jsonDocument.HasMember("rules") && jsonDocument["rules"].IsObject())
+    {
+        const rapidjson::Value &rules(jsonDocument["rules"]);
+        readValue(rules, "rulesFile", ruleSettings.rulesFile);
+    }
+
+    if (jsonDocument.HasMember("threads") && jsonDocument["threads"].IsObject())
+    {
+        const rapidjson::Value &threads(jsonDocument["threads"]);
+        readValue(threads, "main", threadSettings.main);
+        readValue(threads, "api", threadSettings.api);
+        readValue(threads, "processor", threadSettings.processor);
+        readValue(threads, "logger", threadSettings.logger);
+    }
+
+    if (processorSettings.batchSize == 0)
+    {
+        processorSettings.batchSize = 1;
+    }
+
+    if (processorSettings.threads == 0)
+    {
+        processorSettings.threads = 1;
+    }
+
+    LOG_FMT_INF("configuration loaded from %s", path.c_str());
+    return true;
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_FTL("unable to load configuration; %s", ex.what());
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::SchemaSettings &Configuration::getSchemaSettings(void) const
+{
+    return schemaSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::QueueSettings &Configuration::getQueueSettings(void) const
+{
+    return queueSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::CaptureSettings &Configuration::getCaptureSettings(void) const
+{
+    return captureSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::ProcessorSettings &Configuration::getProcessorSettings(void) const
+{
+    return processorSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::MemorySettings &Configuration::getMemorySettings(void) const
+{
+    return memorySettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::SketchSettings &Configuration::getSketchSettings(void) const
+{
+    return sketchSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::RollupSettings &Configuration::getRollupSettings(void) const
+{
+    return rollupSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::HistorySettings &Configuration::getHistorySettings(void) const
+{
+    return historySettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::WindowSettings &Configuration::getWindowSettings(void) const
+{
+    return windowSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::DistinctSettings &Configuration::getDistinctSettings(void) const
+{
+    return distinctSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::HeavyHitterSettings &Configuration::getHeavyHitterSettings(void) const
+{
+    return heavyHitterSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::LivenessSettings &Configuration::getLivenessSettings(void) const
+{
+    return livenessSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::WalSettings &Configuration::getWalSettings(void) const
+{
+    return walSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::CheckpointSettings &Configuration::getCheckpointSettings(void) const
+{
+    return checkpointSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::QuerySettings &Configuration::getQuerySettings(void) const
+{
+    return querySettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::RuleSettings &Configuration::getRuleSettings(void) const
+{
+    return ruleSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::ThreadSettings &Configuration::getThreadSettings(void) const
+{
+    return threadSettings;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Configuration::Configuration()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Configuration::readValue(const rapidjson::Value &object, const char *key, bool &target)
+{
+    if (object.HasMember(key) && object[key].IsBool())
+    {
+        target = object[key].GetBool();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Configuration::readValue(const rapidjson::Value &object, const char *key, uint64_t &target)
+{
+    if (object.HasMember(key) && object[key].IsUint64())
+    {
+        target = object[key].GetUint64();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Configuration::readValue(const rapidjson::Value &object, const char *key, int64_t &target)
+{
+    if (object.HasMember(key) && object[key].IsInt64())
+    {
+        target = object[key].GetInt64();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Configuration::readValue(const rapidjson::Value &object, const char *key, double &target)
+{
+    if (object.HasMember(key) && object[key].IsNumber())
+    {
+        target = object[key].GetDouble();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Configuration::readValue(const rapidjson::Value &object, const char *key, std::string &target)
+{
+    if (object.HasMember(key) && object[key].IsString())
+    {
+        target = object[key].GetString();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Configuration::readValue(const rapidjson::Value &object, const char *key, PlacementSettings &target)
+{
+    if (object.HasMember(key) && object[key].IsObject())
+    {
+        readValue(object[key], "cpus", target.cpus);
+        readValue(object[key], "memoryNode", target.memoryNode);
+    }
+}
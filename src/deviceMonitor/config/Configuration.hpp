@@ -0,0 +1,360 @@
+#ifndef CONFIGURATION_HPP
+#define CONFIGURATION_HPP
+
+#include "Logger.hpp"
+#include <cinttypes>
+#include <fstream>
+#include <rapidjson/document.h>
+#include <rapidjson/istreamwrapper.h>
+#include <string>
+
+class Configuration final
+{
+public:
+    Configuration(const Configuration &) = delete;
+    Configuration &operator=(const Configuration &) = delete;
+
+    struct SchemaSettings
+    {
+        // JSON schema of messages; its measurements form the measurement catalog
+        std::string file = "./etc/communication_schema/communication_schema_v1.json";
+    };
+
+    struct QueueSettings
+    {
+        // spill messages to disk when in-memory backlog exceeds memory limit
+        bool spillEnabled = true;
+        // in-memory backlog limit in bytes
+        uint64_t memoryLimit = 64ULL * 1024ULL * 1024ULL;
+        // directory for spill segment files
+        std::string spillDirectory = "./var/spool";
+        // segment file is rotated when it grows over this size in bytes
+        uint64_t segmentSize = 16ULL * 1024ULL * 1024ULL;
+    };
+
+    struct CaptureSettings
+    {
+        // write accepted messages with their arrival times to capture file for replay
+        bool enabled = false;
+        // capture file; replaced on every start
+        std::string file = "./var/capture/device_monitor.capture";
+        // records are dropped while this many bytes wait for the writer
+        uint64_t bufferBytes = 4ULL * 1024ULL * 1024ULL;
+        // buffered records are written at least this often in milliseconds
+        uint64_t flushDelay = 100;
+        // capture stops once file grows over this size in bytes; 0 is unlimited
+        uint64_t maxBytes = 1024ULL * 1024ULL * 1024ULL;
+    };
+
+    struct ProcessorSettings
+    {
+        // maximum number of messages applied to storage at once
+        uint64_t batchSize = 256;
+        // number of processor threads applying batches to storage concurrently
+        uint64_t threads = 1;
+        // time in milliseconds to apply queued messages on shutdown before remaining are persisted
+        uint64_t drainTimeout = 5000;
+    };
+
+    struct MemorySettings
+    {
+        // limit in bytes of memory held by device records and names; new devices are refused over it; 0 is unlimited
+        uint64_t budget = 0;
+        // back device records and names by 2 MB huge pages (explicit if reserved by the system, else transparent)
+        bool hugePages = false;
+    };
+
+    struct SketchSettings
+    {
+        // relative accuracy of reported percentiles; 0.02 means within 2% of true value
+        double relativeAccuracy = 0.02;
+    };
+
+    struct RollupSettings
+    {
+        // roll device counters up into prefixes of structured device names
+        bool enabled = false;
+        // single character separating levels of device name
+        std::string delimiter = "-";
+        // number of prefix levels, e.g. 2 for site and rack of "site-rack-unit"
+        uint64_t levels = 2;
+    };
+
+    struct HistorySettings
+    {
+        // keep compressed history of individual readings
+        bool enabled = false;
+        // retention of samples in seconds
+        uint64_t retention = 86400;
+        // memory limit of history blocks in bytes; oldest blocks are evicted over it
+        uint64_t memoryLimit = 256ULL * 1024ULL * 1024ULL;
+    };
+
+    struct WindowSettings
+    {
+        // count messages into event-time second, minute and hour windows per device
+        bool enabled = false;
+        // seconds a message may arrive late before it is dropped; at most 60
+        uint64_t lateness = 5;
+    };
+
+    struct DistinctSettings
+    {
+        // estimate number of distinct devices per minute and hour windows
+        bool enabled = false;
+        // HyperLogLog precision; sketch has 2^precision registers, standard error is 1.04 / sqrt(2^precision)
+        uint64_t precision = 14;
+    };
+
+    struct HeavyHitterSettings
+    {
+        // track devices sending the most messages since start and per minute and hour
+        bool enabled = false;
+        // number of devices tracked per summary; devices over 1/capacity of messages are always reported
+        uint64_t capacity = 1000;
+    };
+
+    struct LivenessSettings
+    {
+        // track last message time per device and report silent devices as offline
+        bool enabled = false;
+        // seconds without message after which device is offline
+        uint64_t offlineTimeout = 300;
+        // remove devices idle beyond retention from storage
+        bool evict = false;
+        // seconds without message after which device is evicted
+        uint64_t retention = 86400;
+        // file receiving final counters of evicted devices; empty drops them
+        std::string archiveFile;
+    };
+
+    struct WalSettings
+    {
+        // append processed records to write-ahead log and replay it into storage on start
+        bool enabled = false;
+        // directory of log segments
+        std::string directory = "./var/wal";
+        // "write" (no fdatasync), "group" (fdatasync per group) or "sync" (processors wait for fdatasync)
+        std::string durability = "group";
+        // group is written once it grows over this size in bytes
+        uint64_t groupBytes = 1024ULL * 1024ULL;
+        // or once it is this many milliseconds old
+        uint64_t groupDelay = 10;
+        // segment is rotated once it grows over this size in bytes
+        uint64_t segmentSize = 64ULL * 1024ULL * 1024ULL;
+    };
+
+    struct CheckpointSettings
+    {
+        // write storage checkpoints periodically and on shutdown and restore the last one on start
+        bool enabled = false;
+        // checkpoint file
+        std::string file = "./var/checkpoint/device_monitor.checkpoint";
+        // seconds between checkpoints
+        uint64_t interval = 300;
+    };
+
+    struct QuerySettings
+    {
+        // number of pool threads aggregating history in addition to requesting thread
+        uint64_t threads = 2;
+    };
+
+    struct RuleSettings
+    {
+        // JSON file with threshold and rate rules
+        std::string rulesFile = "./etc/configuration/rules.json";
+    };
+
+    struct PlacementSettings
+    {
+        // CPU list in "0-3,8" format; empty with memoryNode set pins to all CPUs of that node
+        std::string cpus;
+        // preferred NUMA node for memory allocated by thread; -1 keeps default policy
+        int64_t memoryNode = -1;
+    };
+
+    struct ThreadSettings
+    {
+        PlacementSettings main;
+        PlacementSettings api;
+        PlacementSettings processor;
+        PlacementSettings logger;
+    };
+
+    /**
+     * @brief get singleton instance
+     *
+     * @return Configuration&
+     */
+    static Configuration &get(void);
+
+    /**
+     * @brief load configuration file; values not present in file keep their defaults
+     *
+     * @param path path to JSON configuration file
+     * @return true if file was loaded or does not exist
+     * @return false if file exists but is not valid
+     */
+    bool load(const std::string &path);
+
+    /**
+     * @brief Get the message schema settings
+     *
+     * @return const SchemaSettings&
+     */
+    const SchemaSettings &getSchemaSettings(void) const;
+
+    /**
+     * @brief Get the ingest queue settings
+     *
+     * @return const QueueSettings&
+     */
+    const QueueSettings &getQueueSettings(void) const;
+
+    /**
+     * @brief Get the ingress capture settings
+     *
+     * @return const CaptureSettings&
+     */
+    const CaptureSettings &getCaptureSettings(void) const;
+
+    /**
+     * @brief Get the message processor settings
+     *
+     * @return const ProcessorSettings&
+     */
+    const ProcessorSettings &getProcessorSettings(void) const;
+
+    /**
+     * @brief Get the memory arena settings
+     *
+     * @return const MemorySettings&
+     */
+    const MemorySettings &getMemorySettings(void) const;
+
+    /**
+     * @brief Get the quantile sketch settings
+     *
+     * @return const SketchSettings&
+     */
+    const SketchSettings &getSketchSettings(void) const;
+
+    /**
+     * @brief Get the name prefix rollup settings
+     *
+     * @return const RollupSettings&
+     */
+    const RollupSettings &getRollupSettings(void) const;
+
+    /**
+     * @brief Get the history store settings
+     *
+     * @return const HistorySettings&
+     */
+    const HistorySettings &getHistorySettings(void) const;
+
+    /**
+     * @brief Get the event-time window settings
+     *
+     * @return const WindowSettings&
+     */
+    const WindowSettings &getWindowSettings(void) const;
+
+    /**
+     * @brief Get the distinct device counting settings
+     *
+     * @return const DistinctSettings&
+     */
+    const DistinctSettings &getDistinctSettings(void) const;
+
+    /**
+     * @brief Get the heavy hitter tracking settings
+     *
+     * @return const HeavyHitterSettings&
+     */
+    const HeavyHitterSettings &getHeavyHitterSettings(void) const;
+
+    /**
+     * @brief Get the device liveness settings
+     *
+     * @return const LivenessSettings&
+     */
+    const LivenessSettings &getLivenessSettings(void) const;
+
+    /**
+     * @brief Get the write-ahead log settings
+     *
+     * @return const WalSettings&
+     */
+    const WalSettings &getWalSettings(void) const;
+
+    /**
+     * @brief Get the storage checkpoint settings
+     *
+     * @return const CheckpointSettings&
+     */
+    const CheckpointSettings &getCheckpointSettings(void) const;
+
+    /**
+     * @brief Get the history query settings
+     *
+     * @return const QuerySettings&
+     */
+    const QuerySettings &getQuerySettings(void) const;
+
+    /**
+     * @brief Get the rule engine settings
+     *
+     * @return const RuleSettings&
+     */
+    const RuleSettings &getRuleSettings(void) const;
+
+    /**
+     * @brief Get the thread placement settings
+     *
+     * @return const ThreadSettings&
+     */
+    const ThreadSettings &getThreadSettings(void) const;
+
+private:
+    /**
+     * @brief Construct a new Configuration object with default values
+     *
+     */
+    Configuration();
+
+    /**
+     * @brief read value of given key into target if present and of correct type
+     *
+     * @param object JSON object to read from
+     * @param key JSON key
+     * @param target value to update
+     */
+    static void readValue(const rapidjson::Value &object, const char *key, bool &target);
+    static void readValue(const rapidjson::Value &object, const char *key, uint64_t &target);
+    static void readValue(const rapidjson::Value &object, const char *key, int64_t &target);
+    static void readValue(const rapidjson::Value &object, const char *key, double &target);
+    static void readValue(const rapidjson::Value &object, const char *key, std::string &target);
+    static void readValue(const rapidjson::Value &object, const char *key, PlacementSettings &target);
+
+    SchemaSettings schemaSettings;
+    QueueSettings queueSettings;
+    CaptureSettings captureSettings;
+    ProcessorSettings processorSettings;
+    MemorySettings memorySettings;
+    SketchSettings sketchSettings;
+    RollupSettings rollupSettings;
+    HistorySettings historySettings;
+    WindowSettings windowSettings;
+    DistinctSettings distinctSettings;
+    HeavyHitterSettings heavyHitterSettings;
+    LivenessSettings livenessSettings;
+    WalSettings walSettings;
+    CheckpointSettings checkpointSettings;
+    QuerySettings querySettings;
+    RuleSettings ruleSettings;
+    ThreadSettings threadSettings;
+};
+
+#endif
@@ -1,20 +1,30 @@
 #include "Logger.hpp"
+#include "apis/CaptureTap.hpp"
 #include "apis/RestAPI.hpp"
 #include "SignalHandler.hpp"
 #include "Application.hpp"
+#include "config/Configuration.hpp"
+#include "middleware/RuleEngine.hpp"
+#include "runtime/MemoryArena.hpp"
+#include "runtime/ThreadPlacement.hpp"
+#include "storage/DataStorage.hpp"
+#include "storage/DistinctCounter.hpp"
+#include "storage/HeavyHitters.hpp"
+#include "storage/HistoryStore.hpp"
+#include "storage/LivenessTracker.hpp"
+#include "storage/MeasurementCatalog.hpp"
+#include "storage/QuantileSketch.hpp"
+#include "storage/WindowStore.hpp"
+#include "storage/WriteAheadLog.hpp"
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <iostream>
 
-/**
- * @brief
- *
- * @param signum
- */
-void signalHandler(const int signum)
-{
-    LOG_FMT_INF("received termination signal %d", signum);
-    Application::get().stop();
-}
+// descriptor delivering termination signals to application main loop
+int signalFd(-1);
+// restore, replay and API start are measured from here
+std::chrono::steady_clock::time_point startTime;
 
 /**
  * @brief
@@ -32,11 +42,137 @@ void exitProcedure(void)
  */
 int initProcedure(void)
 {
+    startTime = std::chrono::steady_clock::now();
+
+    // termination signals are blocked before logger thread is created, so every thread inherits the mask
+    // and signals are read synchronously by main loop instead of interrupting arbitrary thread
+    signalFd = sighandler::SignalHandler::get().createSignalFd({SIGHUP, SIGINT, SIGQUIT, SIGTERM, SIGUSR1, SIGUSR2, SIGALRM});
+
     logger::logInitialize_f(nullptr, logger::logDbg_e);
 
-    if (sighandler::SignalHandler::get().setAllHandlers(signalHandler) != 0)
+    if (signalFd < 0)
+    {
+        LOG_MSG_FTL("unable to create termination signal descriptor");
+        return EXIT_FAILURE;
+    }
+
+    if (!Configuration::get().load("./etc/configuration/device_monitor.json"))
+    {
+        LOG_MSG_FTL("unable to load application configuration");
+        return EXIT_FAILURE;
+    }
+
+    // arenas take devices and names from the first one on, so budget is set before any store is filled
+    const Configuration::MemorySettings &memory(Configuration::get().getMemorySettings());
+    MemoryArena::configure(memory.budget, memory.hugePages);
+
+    // every store is sized to the catalog, so it is loaded before any of them is configured
+    if (!MeasurementCatalog::load(Configuration::get().getSchemaSettings().file))
+    {
+        LOG_MSG_FTL("unable to load measurement catalog from message schema");
+        return EXIT_FAILURE;
+    }
+
+    if (!QuantileSketch::setRelativeAccuracy(Configuration::get().getSketchSettings().relativeAccuracy))
+    {
+        LOG_MSG_FTL("quantile sketch relative accuracy must be in (0, 1)");
+        return EXIT_FAILURE;
+    }
+
+    const Configuration::RollupSettings &rollups(Configuration::get().getRollupSettings());
+
+    if (rollups.enabled && ((rollups.delimiter.size() != 1) || (rollups.levels == 0) || (rollups.levels > DeviceTable::maxRollupLevels)))
+    {
+        LOG_FMT_FTL("rollup delimiter must be one character and levels between 1 and %u", DeviceTable::maxRollupLevels);
+        return EXIT_FAILURE;
+    }
+
+    DataStorage::configureRollups(rollups.enabled ? static_cast<unsigned>(rollups.levels) : 0,
+                                  rollups.enabled ? rollups.delimiter[0] : '-');
+
+    const Configuration::HistorySettings &history(Configuration::get().getHistorySettings());
+    HistoryStore::configure(history.enabled, history.retention * 1000, history.memoryLimit);
+
+    const Configuration::WindowSettings &windows(Configuration::get().getWindowSettings());
+    WindowStore::configure(windows.enabled, windows.lateness);
+
+    const Configuration::DistinctSettings &distinct(Configuration::get().getDistinctSettings());
+
+    if (!DistinctCounter::configure(distinct.enabled, static_cast<unsigned>(std::min<uint64_t>(distinct.precision, UINT32_MAX))))
+    {
+        LOG_MSG_FTL("distinct device counting precision must be between 4 and 18");
+        return EXIT_FAILURE;
+    }
+
+    const Configuration::HeavyHitterSettings &heavyHitters(Configuration::get().getHeavyHitterSettings());
+
+    if (!HeavyHitters::configure(heavyHitters.enabled, static_cast<uint32_t>(std::min<uint64_t>(heavyHitters.capacity, 1u << 24))))
+    {
+        LOG_MSG_FTL("heavy hitter capacity must be at least 1");
+        return EXIT_FAILURE;
+    }
+
+    const Configuration::LivenessSettings &liveness(Configuration::get().getLivenessSettings());
+    LivenessTracker::configure(liveness.enabled, liveness.offlineTimeout, liveness.evict, liveness.retention, liveness.archiveFile);
+
+    const Configuration::WalSettings &wal(Configuration::get().getWalSettings());
+    WriteAheadLog::Durability durability(WriteAheadLog::durabilityGroup);
+
+    if (wal.enabled && !WriteAheadLog::parseDurability(wal.durability, durability))
+    {
+        LOG_FMT_FTL("unknown write-ahead log durability %s", wal.durability.c_str());
+        return EXIT_FAILURE;
+    }
+
+    // storage is rebuilt from the checkpoint and the log after it before the log accepts new records
+    const Configuration::CheckpointSettings &checkpoint(Configuration::get().getCheckpointSettings());
+    uint64_t firstEpoch(0);
+
+    if (checkpoint.enabled && !DataStorage::restore(checkpoint.file, firstEpoch))
+    {
+        LOG_MSG_FTL("unable to restore storage checkpoint");
+        return EXIT_FAILURE;
+    }
+
+    if (wal.enabled && (!WriteAheadLog::replay(wal.directory, Configuration::get().getProcessorSettings().batchSize, firstEpoch) ||
+                        !WriteAheadLog::open(wal.directory, durability, wal.groupBytes, wal.groupDelay, wal.segmentSize)))
+    {
+        LOG_MSG_FTL("unable to open write-ahead log");
+        return EXIT_FAILURE;
+    }
+
+    if (checkpoint.enabled || wal.enabled)
+    {
+        LOG_FMT_INF("storage ready %.3f ms after start",
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+    }
+
+    ThreadPlacement::apply(ThreadPlacement::roleMain);
+
+    pthread_t loggerThread;
+
+    if (logger::logGetThread_f(&loggerThread) == LOG_EXIT_SUCCESS)
+    {
+        ThreadPlacement::apply(loggerThread, ThreadPlacement::roleLogger);
+    }
+
+    if (!RuleEngine::load(Configuration::get().getRuleSettings().rulesFile))
+    {
+        LOG_MSG_FTL("unable to load rules");
+        return EXIT_FAILURE;
+    }
+
+    const Configuration::CaptureSettings &capture(Configuration::get().getCaptureSettings());
+
+    if (capture.enabled && !CaptureTap::open(capture.file, capture.bufferBytes, capture.flushDelay, capture.maxBytes))
+    {
+        LOG_MSG_FTL("unable to open capture file");
+        return EXIT_FAILURE;
+    }
+
+    if (sighandler::SignalHandler::get().pushHandler(SIGPIPE, SIG_IGN) != 0)
     {
-        LOG_MSG_FTL("unable to register application termination handler");
+        LOG_MSG_FTL("unable to set action for Broken pipe signal");
         return EXIT_FAILURE;
     }
 
@@ -63,7 +199,7 @@ try
         return EXIT_FAILURE;
     }
 
-    return Application::get().run();
+    return Application::get().run(signalFd, startTime);
 }
 catch (const std::exception &e)
 {
@@ -1,12 +1,25 @@
 #include "MessageProcessor.hpp"
 #include "../storage/DataStorage.hpp"
+#include "../storage/HistoryStore.hpp"
+#include "../storage/DistinctCounter.hpp"
+#include "../storage/HeavyHitters.hpp"
+#include "../storage/NameDictionary.hpp"
+#include "../storage/WindowStore.hpp"
+#include "../runtime/ThreadPlacement.hpp"
+#include "RuleEngine.hpp"
 
 std::mutex MessageProcessor::processLock;
 std::condition_variable MessageProcessor::processCondition;
 
 ////////////////////////////////////////////////////////////////////////////////
-MessageProcessor::MessageProcessor(AbstractAPI *api) : api(api)
+MessageProcessor::MessageProcessor(AbstractAPI *api) : api(api),
+                                                        batchSize(Configuration::get().getProcessorSettings().batchSize),
+                                                        drainTimeout(Configuration::get().getProcessorSettings().drainTimeout)
 {
+    for (uint64_t worker(0); worker < Configuration::get().getProcessorSettings().threads; ++worker)
+    {
+        batches.emplace_back(batchSize);
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -15,12 +28,16 @@ bool MessageProcessor::start(void)
     try
     {
         setRunFlag(true);
-        processorThread = new std::thread(threadBody, this);
+
+        for (size_t worker(0); worker < batches.size(); ++worker)
+        {
+            processorThreads.emplace_back(threadBody, this, worker);
+        }
     }
     catch (const std::exception &e)
     {
-        setRunFlag(false);
         LOG_FMT_FTL("failed to allocate thread memory: %s", e.what());
+        stop();
         return false;
     }
 
@@ -28,18 +45,21 @@ bool MessageProcessor::start(void)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void MessageProcessor::stop(void)
+uint64_t MessageProcessor::stop(void)
 {
+    // deadline is published before run flag is cleared, so processor thread always sees it
+    drainDeadline = std::chrono::steady_clock::now() + drainTimeout;
     setRunFlag(false);
 
     notify();
 
-    if (processorThread != nullptr)
+    for (auto &processorThread : processorThreads)
     {
-        processorThread->join();
-        delete processorThread;
-        processorThread = nullptr;
+        processorThread.join();
     }
+
+    processorThreads.clear();
+    return drainedCount.load();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -50,36 +70,83 @@ void MessageProcessor::notify()
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void MessageProcessor::threadBody(MessageProcessor *thisProcessor)
+void MessageProcessor::threadBody(MessageProcessor *thisProcessor, const size_t worker)
 {
     AbstractAPI::pJsonMessage_t message;
+    RecordBatch &batch(thisProcessor->batches[worker]);
 
-    while (thisProcessor->getRunFlag())
+    // storage records are allocated by this thread, so they land on its memory node
+    ThreadPlacement::apply(ThreadPlacement::roleProcessor);
+
+    while (true)
     {
+        const bool draining(!thisProcessor->getRunFlag());
+
+        if (draining && (std::chrono::steady_clock::now() >= thisProcessor->drainDeadline))
+        {
+            break;
+        }
+
         {
             std::unique_lock<std::mutex> lock(processLock);
             message = thisProcessor->api->getNextMessage();
             if (message == nullptr)
             {
-                processCondition.wait(lock);
+                if (thisProcessor->getRunFlag())
+                {
+                    processCondition.wait(lock);
+                    continue;
+                }
+
+                // stop is requested and queue is drained, including messages spool writer still reads from disk
+                if (thisProcessor->api->isDrained())
+                {
+                    break;
+                }
+
+                processCondition.wait_until(lock, thisProcessor->drainDeadline);
                 continue;
             }
         }
 
-        DataStorage::addRecord(message);
+        {
+            // ids interned for the batch are not recycled before it is applied to every store
+            NameDictionary::Guard names;
+
+            // collect messages that are already waiting and apply them at once
+            do
+            {
+                batch.append(*message);
+            } while ((batch.size() < thisProcessor->batchSize) &&
+                     ((message = thisProcessor->api->getNextMessage()) != nullptr));
+
+            // storage logs records in the write epoch they are applied in
+            batch.aggregate();
+            DataStorage::addBatch(batch);
+            HistoryStore::append(batch);
+            WindowStore::count(batch);
+            DistinctCounter::count(batch);
+            HeavyHitters::count(batch);
+            RuleEngine::evaluate(batch);
+
+            if (draining)
+            {
+                thisProcessor->drainedCount += batch.size();
+            }
+
+            batch.clear();
+        }
     }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 bool MessageProcessor::getRunFlag()
 {
-    std::lock_guard<std::mutex> lock(runFlagLock);
-    return runFlag;
+    return runFlag.load();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void MessageProcessor::setRunFlag(const bool value)
 {
-    std::lock_guard<std::mutex> lock(runFlagLock);
-    runFlag = value;
+    runFlag.store(value);
 }
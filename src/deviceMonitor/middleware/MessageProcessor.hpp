@@ -2,12 +2,18 @@
 #define MESSAGEPROCESSOR_HPP
 
 #include "../apis/AbstractAPI.hpp"
+#include "../config/Configuration.hpp"
+#include "../storage/RecordBatch.hpp"
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <iostream>
 #include <mutex>
 #include <rapidjson/document.h>
 #include <rapidjson/ostreamwrapper.h>
 #include <rapidjson/writer.h>
+#include <thread>
+#include <vector>
 
 class MessageProcessor
 {
@@ -28,10 +34,12 @@ public:
     bool start(void);
 
     /**
-     * @brief stop message processor
+     * @brief stop message processor; messages already queued are applied until
+     * queue is empty or configured drain timeout expires
      *
+     * @return uint64_t number of messages applied after stop was requested
      */
-    void stop(void);
+    uint64_t stop(void);
 
     /**
      * @brief static method for API to notify message processor that new data are available
@@ -44,8 +52,9 @@ private:
      * @brief thread body implementation
      *
      * @param thisProcessor
+     * @param worker index of worker thread and its batch
      */
-    static void threadBody(MessageProcessor *thisProcessor);
+    static void threadBody(MessageProcessor *thisProcessor, const size_t worker);
 
     /**
      * @brief get flag that indicates
@@ -63,13 +72,18 @@ private:
     void setRunFlag(const bool value);
 
     AbstractAPI *api;
-    
+    const size_t batchSize;
+    const std::chrono::milliseconds drainTimeout;
+    // one batch per worker thread
+    std::vector<RecordBatch> batches;
+    std::chrono::steady_clock::time_point drainDeadline;
+    std::atomic<uint64_t> drainedCount{0};
+
     static std::mutex processLock;
     static std::condition_variable processCondition;
 
-    std::mutex runFlagLock;
-    bool runFlag = false;
-    std::thread *processorThread;
+    std::atomic<bool> runFlag{false};
+    std::vector<std::thread> processorThreads;
 };
 
 #endif
\ No newline at end of file
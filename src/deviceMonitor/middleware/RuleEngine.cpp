@@ -0,0 +1,375 @@
+#include "RuleEngine.hpp"
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+std::mutex RuleEngine::engineLock;
+std::vector<RuleEngine::Rule> RuleEngine::rules;
+std::vector<std::string> RuleEngine::groupPrefixes;
+std::vector<RuleEngine::ThresholdEntry> RuleEngine::thresholdTables[MeasurementCatalog::maxKinds][RuleEngine::opCount];
+std::vector<RuleEngine::RateRule> RuleEngine::rateRules;
+std::vector<RuleEngine::DeviceState> RuleEngine::devices;
+FlatHashMap<uint32_t> RuleEngine::deviceIndex;
+std::vector<uint32_t> RuleEngine::freeDevices;
+FlatHashMap<uint64_t> RuleEngine::matchCounts;
+
+namespace
+{
+    const char *const OPERATOR_NAMES[] = {">", ">=", "<", "<="};
+
+    ////////////////////////////////////////////////////////////////////////////
+    inline bool compare(const unsigned op, const double value, const double threshold)
+    {
+        switch (op)
+        {
+        case 0:
+            return value > threshold;
+        case 1:
+            return value >= threshold;
+        case 2:
+            return value < threshold;
+        default:
+            return value <= threshold;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool RuleEngine::load(const std::string &path)
+try
+{
+    std::lock_guard<std::mutex> lock(engineLock);
+    std::ifstream inputFileStream(path);
+
+    if (!inputFileStream.is_open())
+    {
+        LOG_FMT_INF("rule file %s not found; rule evaluation disabled", path.c_str());
+        return true;
+    }
+
+    rapidjson::IStreamWrapper inputStreamWrapper(inputFileStream);
+    rapidjson::Document jsonDocument;
+
+    if (jsonDocument.ParseStream(inputStreamWrapper).HasParseError() || !jsonDocument.IsObject() ||
+        !jsonDocument.HasMember("rules") || !jsonDocument["rules"].IsArray())
+    {
+        LOG_FMT_FTL("invalid rule file %s; error %d; offset: %d", path.c_str(), jsonDocument.GetParseError(), jsonDocument.GetErrorOffset());
+        return false;
+    }
+
+    // group 0 contains all devices
+    getGroup("");
+
+    for (auto definition(jsonDocument["rules"].Begin()); definition != jsonDocument["rules"].End(); ++definition)
+    {
+        if (!compileRule(*definition))
+        {
+            LOG_FMT_FTL("invalid rule #%zu in %s", rules.size() + 1, path.c_str());
+            return false;
+        }
+    }
+
+    // rules matched by a value form a prefix of each table
+    for (auto &kindTables : thresholdTables)
+    {
+        for (unsigned op(0); op < opCount; ++op)
+        {
+            std::stable_sort(kindTables[op].begin(), kindTables[op].end(), [op](const ThresholdEntry &left, const ThresholdEntry &right)
+                             { return ((op == opGreater) || (op == opGreaterEqual)) ? (left.threshold < right.threshold) : (left.threshold > right.threshold); });
+        }
+    }
+
+    LOG_FMT_INF("loaded %zu rules in %zu device groups from %s", rules.size(), groupPrefixes.size(), path.c_str());
+    return true;
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_FTL("unable to load rules; %s", ex.what());
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RuleEngine::evaluate(const RecordBatch &batch)
+{
+    if (rules.empty())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(engineLock);
+    const std::chrono::steady_clock::time_point now(std::chrono::steady_clock::now());
+    const std::vector<uint32_t> &order(batch.getOrder());
+    uint32_t runStart(0);
+
+    for (const auto &delta : batch.getDeltas())
+    {
+        const uint32_t device(resolveDevice(batch, delta));
+        DeviceState &state(devices[device]);
+        const uint32_t runEnd(runStart + delta.messageCount);
+
+        for (uint32_t position(runStart); position < runEnd; ++position)
+        {
+            const uint32_t record(order[position]);
+
+            for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+            {
+                if (!batch.isPresent(kind, record))
+                {
+                    continue;
+                }
+
+                const double value(batch.getValue(kind, record));
+
+                for (unsigned op(0); op < opCount; ++op)
+                {
+                    const std::vector<ThresholdEntry> &table(thresholdTables[kind][op]);
+                    auto matchedEnd(std::partition_point(table.begin(), table.end(), [op, value](const ThresholdEntry &entry)
+                                                         { return compare(op, value, entry.threshold); }));
+
+                    for (auto entry(table.begin()); entry != matchedEnd; ++entry)
+                    {
+                        if (isMember(state, entry->group))
+                        {
+                            countMatch(entry->rule, device);
+                        }
+                    }
+                }
+            }
+
+            for (size_t index(0); index < rateRules.size(); ++index)
+            {
+                const RateRule &rateRule(rateRules[index]);
+
+                if (!isMember(state, rateRule.group) ||
+                    ((rateRule.kind != allMessages) && !batch.isPresent(rateRule.kind, record)))
+                {
+                    continue;
+                }
+
+                RateWindow &window(state.rateWindows[index]);
+
+                if (now - window.start >= rateRule.window)
+                {
+                    window.start = now;
+                    window.count = 0;
+                }
+
+                // rule matches once per window when limit is exceeded
+                if (++window.count == rateRule.limit + 1)
+                {
+                    countMatch(rateRule.rule, device);
+                }
+            }
+        }
+
+        runStart = runEnd;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RuleEngine::remove(const std::vector<uint32_t> &deviceIds)
+{
+    std::lock_guard<std::mutex> lock(engineLock);
+
+    for (const uint32_t deviceId : deviceIds)
+    {
+        const uint32_t *device(deviceIndex.find(deviceId));
+
+        if (device == nullptr)
+        {
+            continue;
+        }
+
+        const uint32_t slot(*device);
+
+        for (uint64_t rule(0); rule < rules.size(); ++rule)
+        {
+            matchCounts.erase((rule << 32) | slot);
+        }
+
+        devices[slot] = DeviceState();
+        freeDevices.push_back(slot);
+        deviceIndex.erase(deviceId);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string RuleEngine::getMatches(void)
+{
+    std::lock_guard<std::mutex> lock(engineLock);
+    std::vector<std::map<std::string, uint64_t>> perRule(rules.size());
+
+    matchCounts.forEach([&perRule](const uint64_t key, const uint64_t count)
+                        { perRule[key >> 32][devices[key & 0xffffffffULL].name] = count; });
+
+    std::stringstream ss;
+
+    for (size_t rule(0); rule < rules.size(); ++rule)
+    {
+        ss << rules[rule].name << ':' << " matches: " << rules[rule].matchCount << "; ";
+
+        for (auto &device : perRule[rule])
+        {
+            ss << device.first << ": " << device.second << "; ";
+        }
+
+        ss << std::endl;
+    }
+
+    return ss.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool RuleEngine::compileRule(const rapidjson::Value &definition)
+{
+    if (!definition.IsObject() || !definition.HasMember("name") || !definition["name"].IsString() ||
+        !definition.HasMember("type") || !definition["type"].IsString())
+    {
+        return false;
+    }
+
+    const std::string type(definition["type"].GetString());
+    unsigned kind(allMessages);
+
+    if (definition.HasMember("measurement"))
+    {
+        if (!definition["measurement"].IsString() || !MeasurementCatalog::find(definition["measurement"].GetString(), kind))
+        {
+            return false;
+        }
+    }
+
+    std::string prefix;
+
+    if (definition.HasMember("group"))
+    {
+        if (!definition["group"].IsString())
+        {
+            return false;
+        }
+
+        prefix = definition["group"].GetString();
+    }
+
+    Rule rule;
+    rule.name = definition["name"].GetString();
+    rule.group = getGroup(prefix);
+    rule.matchCount = 0;
+    const uint32_t ruleIndex(static_cast<uint32_t>(rules.size()));
+
+    if (type == "threshold")
+    {
+        if ((kind == allMessages) || !definition.HasMember("operator") || !definition["operator"].IsString() ||
+            !definition.HasMember("value") || !definition["value"].IsNumber())
+        {
+            return false;
+        }
+
+        unsigned op(0);
+
+        while ((op < opCount) && (strcmp(definition["operator"].GetString(), OPERATOR_NAMES[op]) != 0))
+        {
+            op++;
+        }
+
+        if (op == opCount)
+        {
+            return false;
+        }
+
+        ThresholdEntry entry;
+        entry.threshold = definition["value"].GetDouble();
+        entry.rule = ruleIndex;
+        entry.group = rule.group;
+        thresholdTables[kind][op].push_back(entry);
+    }
+    else if (type == "rate")
+    {
+        if (!definition.HasMember("limit") || !definition["limit"].IsUint64() ||
+            !definition.HasMember("window") || !definition["window"].IsNumber() || !(definition["window"].GetDouble() > 0.0))
+        {
+            return false;
+        }
+
+        RateRule rateRule;
+        rateRule.rule = ruleIndex;
+        rateRule.group = rule.group;
+        rateRule.kind = kind;
+        rateRule.limit = definition["limit"].GetUint64();
+        rateRule.window = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(definition["window"].GetDouble()));
+        rateRules.push_back(rateRule);
+    }
+    else
+    {
+        return false;
+    }
+
+    rules.push_back(rule);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t RuleEngine::getGroup(const std::string &prefix)
+{
+    for (size_t group(0); group < groupPrefixes.size(); ++group)
+    {
+        if (groupPrefixes[group] == prefix)
+        {
+            return static_cast<uint32_t>(group);
+        }
+    }
+
+    groupPrefixes.push_back(prefix);
+    return static_cast<uint32_t>(groupPrefixes.size() - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t RuleEngine::resolveDevice(const RecordBatch &batch, const RecordBatch::DeviceDelta &delta)
+{
+    bool inserted(false);
+    const uint32_t slot(freeDevices.empty() ? static_cast<uint32_t>(devices.size()) : freeDevices.back());
+    const uint32_t device(deviceIndex.findOrInsert(delta.deviceId, slot, inserted));
+
+    if (inserted)
+    {
+        DeviceState state;
+        state.name = batch.getName(delta.firstRecord);
+        state.groups.assign((groupPrefixes.size() + 63) / 64, 0);
+
+        for (size_t group(0); group < groupPrefixes.size(); ++group)
+        {
+            if (state.name.compare(0, groupPrefixes[group].size(), groupPrefixes[group]) == 0)
+            {
+                state.groups[group / 64] |= 1ULL << (group % 64);
+            }
+        }
+
+        state.rateWindows.assign(rateRules.size(), RateWindow{std::chrono::steady_clock::time_point(), 0});
+
+        if (device == devices.size())
+        {
+            devices.push_back(std::move(state));
+        }
+        else
+        {
+            devices[device] = std::move(state);
+            freeDevices.pop_back();
+        }
+    }
+
+    return device;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool RuleEngine::isMember(const DeviceState &device, const uint32_t group)
+{
+    return (device.groups[group / 64] & (1ULL << (group % 64))) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RuleEngine::countMatch(const uint32_t rule, const uint32_t device)
+{
+    bool inserted(false);
+    rules[rule].matchCount++;
+    matchCounts.findOrInsert((static_cast<uint64_t>(rule) << 32) | device, 0, inserted)++;
+}
@@ -0,0 +1,171 @@
+#ifndef RULEENGINE_HPP
+#define RULEENGINE_HPP
+
+#include "../storage/FlatHashMap.hpp"
+#include "../storage/RecordBatch.hpp"
+#include "Logger.hpp"
+#include <chrono>
+#include <cinttypes>
+#include <fstream>
+#include <mutex>
+#include <rapidjson/document.h>
+#include <rapidjson/istreamwrapper.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief evaluates threshold and rate rules loaded from configuration file
+ *
+ * Rules are compiled into decision tables: threshold rules of every measurement
+ * and comparison operator are sorted by threshold, so all rules matched by a
+ * value form a prefix found by single binary search. Device group (name prefix)
+ * membership is resolved once when device is seen for the first time and kept
+ * as a bit set. Evaluation therefore uses no strings and allocates memory only
+ * when previously unseen device or rule/device pair appears. State and match
+ * counts of evicted devices are dropped by remove(); totals of rules stay.
+ */
+class RuleEngine final
+{
+public:
+    RuleEngine() = delete;
+
+    /**
+     * @brief load and compile rules
+     *
+     * @param path path to JSON rule file
+     * @return true on success or if file does not exist
+     * @return false on invalid rule file
+     */
+    static bool load(const std::string &path);
+
+    /**
+     * @brief evaluate all rules against aggregated batch
+     *
+     * @param batch batch after RecordBatch::aggregate()
+     */
+    static void evaluate(const RecordBatch &batch);
+
+    /**
+     * @brief drop state and per device match counts of evicted devices, so their ids can be recycled
+     *
+     * @param deviceIds ids of evicted devices; unknown ids are ignored
+     */
+    static void remove(const std::vector<uint32_t> &deviceIds);
+
+    /**
+     * @brief Get number of matches per rule and device
+     *
+     * @return std::string
+     */
+    static std::string getMatches(void);
+
+private:
+    enum Operator : uint8_t
+    {
+        opGreater = 0,
+        opGreaterEqual,
+        opLess,
+        opLessEqual,
+        opCount
+    };
+
+    // kind of rate rule without measurement
+    static const unsigned allMessages = MeasurementCatalog::maxKinds;
+
+    struct Rule
+    {
+        std::string name;
+        uint32_t group;
+        uint64_t matchCount;
+    };
+
+    // one row of compiled threshold table
+    struct ThresholdEntry
+    {
+        double threshold;
+        uint32_t rule;
+        uint32_t group;
+    };
+
+    struct RateRule
+    {
+        uint32_t rule;
+        uint32_t group;
+        // measurement kind counted by rule; allMessages counts all messages
+        uint32_t kind;
+        uint64_t limit;
+        std::chrono::steady_clock::duration window;
+    };
+
+    struct RateWindow
+    {
+        std::chrono::steady_clock::time_point start;
+        uint64_t count;
+    };
+
+    struct DeviceState
+    {
+        std::string name;
+        std::vector<uint64_t> groups;
+        std::vector<RateWindow> rateWindows;
+    };
+
+    /**
+     * @brief compile one rule definition
+     *
+     * @param definition JSON rule definition
+     * @return true on success
+     * @return false on invalid rule
+     */
+    static bool compileRule(const rapidjson::Value &definition);
+
+    /**
+     * @brief get index of device group, group is created if it does not exist
+     *
+     * @param prefix device name prefix; empty prefix matches all devices
+     * @return uint32_t
+     */
+    static uint32_t getGroup(const std::string &prefix);
+
+    /**
+     * @brief find device state; new state is created and its groups resolved on first occurrence
+     *
+     * @param batch batch containing device
+     * @param delta aggregated device delta
+     * @return uint32_t device index
+     */
+    static uint32_t resolveDevice(const RecordBatch &batch, const RecordBatch::DeviceDelta &delta);
+
+    /**
+     * @brief check if device is member of group
+     *
+     * @param device device state
+     * @param group group index
+     * @return true if device is member
+     * @return false if device is not member
+     */
+    static bool isMember(const DeviceState &device, const uint32_t group);
+
+    /**
+     * @brief count rule match for device
+     *
+     * @param rule rule index
+     * @param device device index
+     */
+    static void countMatch(const uint32_t rule, const uint32_t device);
+
+    static std::mutex engineLock;
+    static std::vector<Rule> rules;
+    static std::vector<std::string> groupPrefixes;
+    static std::vector<ThresholdEntry> thresholdTables[MeasurementCatalog::maxKinds][opCount];
+    static std::vector<RateRule> rateRules;
+    static std::vector<DeviceState> devices;
+    static FlatHashMap<uint32_t> deviceIndex;
+    // slots of removed devices
+    static std::vector<uint32_t> freeDevices;
+    // key is (rule << 32 | device index)
+    static FlatHashMap<uint64_t> matchCounts;
+};
+
+#endif
@@ -0,0 +1,246 @@
+#include "MemoryArena.hpp"
+#include "Logger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+const char *const MemoryArena::subsystemKeys[MemoryArena::subsystemCount] = {"devices", "names", "queue"};
+
+std::mutex MemoryArena::arenaLock;
+uint64_t MemoryArena::budget(0);
+bool MemoryArena::hugePages(false);
+uint64_t MemoryArena::hugeBlocks(0);
+uint64_t MemoryArena::transparentBlocks(0);
+MemoryArena::Arena MemoryArena::arenas[MemoryArena::subsystemCount];
+
+namespace
+{
+    // arena block is one huge page
+    const size_t blockSize(2 * 1024 * 1024);
+    // records of different devices never share a cache line
+    const size_t alignment(64);
+
+    ////////////////////////////////////////////////////////////////////////////
+    size_t roundUp(const size_t value, const size_t multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MemoryArena::configure(const uint64_t budget, const bool hugePages)
+{
+    std::lock_guard<std::mutex> lock(arenaLock);
+    MemoryArena::budget = budget;
+    MemoryArena::hugePages = hugePages;
+
+    if ((budget != 0) || hugePages)
+    {
+        LOG_FMT_INF("memory budget of devices and names: %" PRIu64 " bytes (0 unlimited); huge pages %s", budget,
+                    hugePages ? "enabled" : "disabled");
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void *MemoryArena::allocate(const Subsystem subsystem, const size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(arenaLock);
+    Arena &arena(arenas[subsystem]);
+    const size_t size(roundUp(bytes, alignment));
+
+    if (size > arena.left)
+    {
+        // large allocations get mapping of their own, so the current block keeps its free part
+        const bool own(size > blockSize / 2);
+        const size_t mappingSize(own ? roundUp(size, hugePages ? blockSize : static_cast<size_t>(sysconf(_SC_PAGESIZE))) : blockSize);
+
+        if (isOverBudget(subsystem, mappingSize))
+        {
+            return nullptr;
+        }
+
+        char *mapping(static_cast<char *>(map(mappingSize)));
+
+        if (mapping == nullptr)
+        {
+            arena.refused.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        arena.mapped.fetch_add(mappingSize, std::memory_order_relaxed);
+        arena.allocated.fetch_add(size, std::memory_order_relaxed);
+        updatePeak(arena);
+
+        if (own)
+        {
+            return mapping;
+        }
+
+        // rest of previous block is left unused
+        arena.next = mapping + size;
+        arena.left = blockSize - size;
+        return mapping;
+    }
+
+    char *memory(arena.next);
+    arena.next += size;
+    arena.left -= size;
+    arena.allocated.fetch_add(size, std::memory_order_relaxed);
+    return memory;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool MemoryArena::charge(const Subsystem subsystem, const uint64_t bytes, const bool limited)
+{
+    // queue is charged per message; only budgeted subsystems take the lock
+    if (limited && (subsystem != subsystemQueue))
+    {
+        std::lock_guard<std::mutex> lock(arenaLock);
+
+        if (isOverBudget(subsystem, bytes))
+        {
+            return false;
+        }
+    }
+
+    arenas[subsystem].heap.fetch_add(bytes, std::memory_order_relaxed);
+    updatePeak(arenas[subsystem]);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MemoryArena::discharge(const Subsystem subsystem, const uint64_t bytes)
+{
+    arenas[subsystem].heap.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string MemoryArena::getStatus(void)
+{
+    std::stringstream ss;
+
+    {
+        std::lock_guard<std::mutex> lock(arenaLock);
+        ss << "budget: " << budget << "; "
+           << "budgeted: " << getBudgeted() << "; "
+           << "hugePages: " << hugePages << "; "
+           << "hugeBlocks: " << hugeBlocks << "; "
+           << "transparentBlocks: " << transparentBlocks << "; " << std::endl;
+    }
+
+    for (unsigned subsystem(0); subsystem < subsystemCount; ++subsystem)
+    {
+        const Arena &arena(arenas[subsystem]);
+        const uint64_t mapped(arena.mapped.load(std::memory_order_relaxed));
+        const uint64_t heap(arena.heap.load(std::memory_order_relaxed));
+
+        ss << "subsystem: " << subsystemKeys[subsystem] << "; "
+           << "live: " << mapped + heap << "; "
+           << "peak: " << arena.peak.load(std::memory_order_relaxed) << "; "
+           << "arena: " << mapped << "; "
+           << "allocated: " << arena.allocated.load(std::memory_order_relaxed) << "; "
+           << "heap: " << heap << "; "
+           << "refused: " << arena.refused.load(std::memory_order_relaxed) << "; " << std::endl;
+    }
+
+    size_t live(0);
+    size_t peak(0);
+
+    if (logger::logGetMemoryUsage_f(&live, &peak) == LOG_EXIT_SUCCESS)
+    {
+        ss << "subsystem: logger; "
+           << "live: " << live << "; "
+           << "peak: " << peak << "; " << std::endl;
+    }
+
+    return ss.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void *MemoryArena::map(const size_t bytes)
+{
+    void *mapping(MAP_FAILED);
+
+    if (hugePages)
+    {
+        // explicit huge pages exist only if the system reserved them
+        mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (mapping != MAP_FAILED)
+        {
+            hugeBlocks += bytes / blockSize;
+            return mapping;
+        }
+
+        // transparent huge pages need range aligned to huge page; unaligned head and tail are unmapped
+        char *raw(static_cast<char *>(mmap(nullptr, bytes + blockSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)));
+
+        if (raw == MAP_FAILED)
+        {
+            LOG_FMT_ERR("unable to map %zu bytes of memory; %s", bytes, strerror(errno));
+            return nullptr;
+        }
+
+        char *aligned(reinterpret_cast<char *>(roundUp(reinterpret_cast<uintptr_t>(raw), blockSize)));
+
+        if (aligned != raw)
+        {
+            munmap(raw, static_cast<size_t>(aligned - raw));
+        }
+
+        munmap(aligned + bytes, static_cast<size_t>(raw + blockSize - aligned));
+        madvise(aligned, bytes, MADV_HUGEPAGE);
+        transparentBlocks += bytes / blockSize;
+        return aligned;
+    }
+
+    mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (mapping == MAP_FAILED)
+    {
+        LOG_FMT_ERR("unable to map %zu bytes of memory; %s", bytes, strerror(errno));
+        return nullptr;
+    }
+
+    return mapping;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool MemoryArena::isOverBudget(const Subsystem subsystem, const uint64_t bytes)
+{
+    if ((budget == 0) || (subsystem == subsystemQueue) || (getBudgeted() + bytes <= budget))
+    {
+        return false;
+    }
+
+    Arena &arena(arenas[subsystem]);
+    arena.refused.fetch_add(1, std::memory_order_relaxed);
+
+    if (!arena.warned)
+    {
+        LOG_FMT_WRN("memory budget of %" PRIu64 " bytes reached; new %s are refused", budget, subsystemKeys[subsystem]);
+        arena.warned = true;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MemoryArena::updatePeak(Arena &arena)
+{
+    const uint64_t live(arena.mapped.load(std::memory_order_relaxed) + arena.heap.load(std::memory_order_relaxed));
+    uint64_t peak(arena.peak.load(std::memory_order_relaxed));
+
+    while ((live > peak) && !arena.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t MemoryArena::getBudgeted(void)
+{
+    return arenas[subsystemDevices].mapped.load(std::memory_order_relaxed) + arenas[subsystemDevices].heap.load(std::memory_order_relaxed) +
+           arenas[subsystemNames].mapped.load(std::memory_order_relaxed) + arenas[subsystemNames].heap.load(std::memory_order_relaxed);
+}
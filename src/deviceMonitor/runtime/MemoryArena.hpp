@@ -0,0 +1,141 @@
+#ifndef MEMORYARENA_HPP
+#define MEMORYARENA_HPP
+
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief arenas of long lived storage and memory accounting per subsystem
+ *
+ * Device records (with their counters and sketches) and interned names are
+ * never freed one by one: records are recycled by their table and names by
+ * the dictionary once their device is evicted. They are carved from 2 MB blocks mapped directly
+ * from the system, one bump allocated arena per subsystem, instead of taken
+ * from the heap, so they carry no allocator headers, device churn does not
+ * fragment the heap and blocks can be backed by huge pages. Subsystems report
+ * heap memory they take besides (indexes, queued messages) by charge() and
+ * discharge(); the logger counts its message nodes itself. Live and peak bytes
+ * of every subsystem are reported by getStatus().
+ *
+ * Optional budget limits memory of devices and names. Arena allocation that
+ * would exceed it fails and its caller refuses the new device or name, so
+ * memory stays bounded under any number of devices instead of the process
+ * being killed when the system runs out of it.
+ */
+class MemoryArena final
+{
+public:
+    enum Subsystem
+    {
+        subsystemDevices = 0,
+        subsystemNames,
+        subsystemQueue,
+        subsystemCount
+    };
+
+    MemoryArena() = delete;
+
+    /**
+     * @brief set budget and huge page backing; call before first allocation
+     *
+     * @param budget limit of device and name memory in bytes; 0 is unlimited
+     * @param hugePages back arena blocks by huge pages
+     */
+    static void configure(const uint64_t budget, const bool hugePages);
+
+    /**
+     * @brief allocate zeroed, cache line aligned memory that is never freed
+     *
+     * @param subsystem subsystem the memory is accounted to
+     * @param bytes size of memory
+     * @return void* memory or nullptr if budget would be exceeded or system has no memory
+     */
+    static void *allocate(const Subsystem subsystem, const size_t bytes);
+
+    /**
+     * @brief account heap memory taken by subsystem
+     *
+     * @param subsystem subsystem
+     * @param bytes size of memory
+     * @param limited false charges memory even over budget, e.g. replacement of memory that is released soon
+     * @return true on success
+     * @return false if budget would be exceeded; nothing is charged and caller must not take the memory
+     */
+    static bool charge(const Subsystem subsystem, const uint64_t bytes, const bool limited = true);
+
+    /**
+     * @brief account heap memory released by subsystem
+     *
+     * @param subsystem subsystem
+     * @param bytes size of memory passed to charge() before
+     */
+    static void discharge(const Subsystem subsystem, const uint64_t bytes);
+
+    /**
+     * @brief Get live and peak bytes of every subsystem, budget and huge page usage
+     *
+     * @return std::string
+     */
+    static std::string getStatus(void);
+
+private:
+    struct Arena
+    {
+        // free part of current block; guarded by arena lock
+        char *next;
+        size_t left;
+        // bytes mapped for arena, carved from it and taken from heap
+        std::atomic<uint64_t> mapped;
+        std::atomic<uint64_t> allocated;
+        std::atomic<uint64_t> heap;
+        std::atomic<uint64_t> peak;
+        // allocations refused over budget; only the first one is logged, flag guarded by arena lock
+        std::atomic<uint64_t> refused;
+        bool warned;
+    };
+
+    /**
+     * @brief map memory from the system, with huge pages if configured; arena lock must be held
+     *
+     * @param bytes size of mapping, multiple of block size with huge pages
+     * @return void* mapping or nullptr on failure
+     */
+    static void *map(const size_t bytes);
+
+    /**
+     * @brief check budget before memory of subsystem grows; counts and logs refusal. Arena lock must be held
+     *
+     * @param subsystem subsystem
+     * @param bytes size of new memory
+     * @return true if subsystem is limited by budget and new memory would exceed it
+     */
+    static bool isOverBudget(const Subsystem subsystem, const uint64_t bytes);
+
+    /**
+     * @brief raise peak of arena to its live bytes
+     *
+     * @param arena arena
+     */
+    static void updatePeak(Arena &arena);
+
+    /**
+     * @brief Get live bytes of subsystems limited by budget
+     *
+     * @return uint64_t
+     */
+    static uint64_t getBudgeted(void);
+
+    static const char *const subsystemKeys[subsystemCount];
+
+    static std::mutex arenaLock;
+    static uint64_t budget;
+    static bool hugePages;
+    static uint64_t hugeBlocks;
+    static uint64_t transparentBlocks;
+    static Arena arenas[subsystemCount];
+};
+
+#endif
@@ -0,0 +1,270 @@
+#include "ThreadPlacement.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <sstream>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+const char *const ThreadPlacement::roleNames[ThreadPlacement::roleCount] = {"device-monitor", "dm-api", "dm-processor", "dm-logger"};
+
+namespace
+{
+    ////////////////////////////////////////////////////////////////////////////
+    std::string formatCpuList(const cpu_set_t &cpus)
+    {
+        std::stringstream ss;
+        bool inRange(false);
+        size_t first(0);
+
+        for (size_t cpu(0); cpu <= CPU_SETSIZE; ++cpu)
+        {
+            const bool isSet((cpu < CPU_SETSIZE) && CPU_ISSET(cpu, &cpus));
+
+            if (isSet && !inRange)
+            {
+                first = cpu;
+                inRange = true;
+            }
+            else if (!isSet && inRange)
+            {
+                ss << (ss.tellp() > 0 ? "," : "") << first;
+
+                if (cpu - 1 > first)
+                {
+                    ss << '-' << (cpu - 1);
+                }
+
+                inRange = false;
+            }
+        }
+
+        return ss.str();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    bool setPreferredNode(const int64_t node)
+    {
+        const unsigned long bitsPerWord(8 * sizeof(unsigned long));
+
+        if ((node < 0) || (node >= 1024))
+        {
+            return false;
+        }
+
+        std::vector<unsigned long> nodeMask(1024 / bitsPerWord, 0);
+        nodeMask[static_cast<size_t>(node) / bitsPerWord] |= 1UL << (static_cast<unsigned long>(node) % bitsPerWord);
+
+        return syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodeMask.data(), 1024UL) == 0;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ThreadPlacement::apply(const Role role)
+{
+    const Configuration::PlacementSettings &settings(getSettings(role));
+    bool result(apply(pthread_self(), role));
+
+    if (settings.memoryNode >= 0)
+    {
+        if (setPreferredNode(settings.memoryNode))
+        {
+            LOG_FMT_INF("thread %s allocates memory on NUMA node %" PRId64, roleNames[role], settings.memoryNode);
+        }
+        else
+        {
+            LOG_FMT_ERR("unable to set memory policy of thread %s; %s", roleNames[role], strerror(errno));
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ThreadPlacement::apply(const pthread_t thread, const Role role)
+{
+    pthread_setname_np(thread, roleNames[role]);
+
+    cpu_set_t cpus;
+
+    if (!resolveCpus(getSettings(role), cpus))
+    {
+        return true;
+    }
+
+    const int rc(pthread_setaffinity_np(thread, sizeof(cpus), &cpus));
+
+    if (rc != 0)
+    {
+        LOG_FMT_ERR("unable to set CPU affinity of thread %s; %s", roleNames[role], strerror(rc));
+        return false;
+    }
+
+    LOG_FMT_INF("thread %s pinned to CPUs %s", roleNames[role], formatCpuList(cpus).c_str());
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string ThreadPlacement::getThreadReport(void)
+{
+    std::stringstream ss;
+    DIR *dir(opendir("/proc/self/task"));
+
+    if (dir == nullptr)
+    {
+        return ss.str();
+    }
+
+    const double ticksPerSecond(static_cast<double>(sysconf(_SC_CLK_TCK)));
+
+    for (struct dirent *entry(readdir(dir)); entry != nullptr; entry = readdir(dir))
+    {
+        if (entry->d_name[0] == '.')
+        {
+            continue;
+        }
+
+        std::ifstream statFile(std::string("/proc/self/task/") + entry->d_name + "/stat");
+        std::string stat;
+
+        if (!std::getline(statFile, stat))
+        {
+            continue;
+        }
+
+        // thread name is enclosed in parentheses and may contain spaces
+        const size_t nameStart(stat.find('('));
+        const size_t nameEnd(stat.rfind(')'));
+
+        if ((nameStart == std::string::npos) || (nameEnd == std::string::npos) || (nameEnd < nameStart))
+        {
+            continue;
+        }
+
+        // fields after name start with state (field 3); utime, stime are fields 14, 15 and processor is field 39
+        std::istringstream fields(stat.substr(nameEnd + 2));
+        std::string field;
+        unsigned long utime(0);
+        unsigned long stime(0);
+        long processor(-1);
+
+        for (unsigned index(3); (index <= 39) && (fields >> field); ++index)
+        {
+            if (index == 14)
+            {
+                utime = std::stoul(field);
+            }
+            else if (index == 15)
+            {
+                stime = std::stoul(field);
+            }
+            else if (index == 39)
+            {
+                processor = std::stol(field);
+            }
+        }
+
+        const pid_t tid(static_cast<pid_t>(atoi(entry->d_name)));
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        sched_getaffinity(tid, sizeof(cpus), &cpus);
+
+        ss << "tid: " << tid << "; "
+           << "name: " << stat.substr(nameStart + 1, nameEnd - nameStart - 1) << "; "
+           << "cpuTime: " << static_cast<double>(utime + stime) / ticksPerSecond << "; "
+           << "lastCpu: " << processor << "; "
+           << "affinity: " << formatCpuList(cpus) << "; " << std::endl;
+    }
+
+    closedir(dir);
+    return ss.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ThreadPlacement::parseCpuList(const std::string &list, cpu_set_t &cpus)
+{
+    CPU_ZERO(&cpus);
+    std::istringstream ranges(list);
+    std::string range;
+    bool any(false);
+
+    while (std::getline(ranges, range, ','))
+    {
+        if (range.empty() || (range.find_first_not_of("0123456789-") != std::string::npos))
+        {
+            return false;
+        }
+
+        const size_t dash(range.find('-'));
+        const unsigned long first(std::stoul(range.substr(0, dash)));
+        const unsigned long last((dash == std::string::npos) ? first : std::stoul(range.substr(dash + 1)));
+
+        if ((last < first) || (last >= CPU_SETSIZE))
+        {
+            return false;
+        }
+
+        for (unsigned long cpu(first); cpu <= last; ++cpu)
+        {
+            CPU_SET(cpu, &cpus);
+        }
+
+        any = true;
+    }
+
+    return any;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ThreadPlacement::resolveCpus(const Configuration::PlacementSettings &settings, cpu_set_t &cpus)
+try
+{
+    std::string list(settings.cpus);
+
+    if (list.empty() && (settings.memoryNode >= 0))
+    {
+        std::ifstream nodeCpus("/sys/devices/system/node/node" + std::to_string(settings.memoryNode) + "/cpulist");
+        std::getline(nodeCpus, list);
+    }
+
+    if (list.empty())
+    {
+        return false;
+    }
+
+    if (!parseCpuList(list, cpus))
+    {
+        LOG_FMT_ERR("invalid CPU list '%s'; thread not pinned", list.c_str());
+        return false;
+    }
+
+    return true;
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("invalid CPU list; %s", ex.what());
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Configuration::PlacementSettings &ThreadPlacement::getSettings(const Role role)
+{
+    const Configuration::ThreadSettings &settings(Configuration::get().getThreadSettings());
+
+    switch (role)
+    {
+    case roleApi:
+        return settings.api;
+    case roleProcessor:
+        return settings.processor;
+    case roleLogger:
+        return settings.logger;
+    default:
+        return settings.main;
+    }
+}
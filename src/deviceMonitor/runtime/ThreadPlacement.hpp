@@ -0,0 +1,93 @@
+#ifndef THREADPLACEMENT_HPP
+#define THREADPLACEMENT_HPP
+
+#include "../config/Configuration.hpp"
+#include "Logger.hpp"
+#include <cinttypes>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+
+/**
+ * @brief pins application threads to configured CPU sets and NUMA nodes
+ *
+ * Every thread role gets its own name (visible in top/ps and thread report),
+ * CPU affinity and preferred memory node. Threads created later by a placed
+ * thread (i.e. restbed workers) inherit all three. Memory policy is applied
+ * to the calling thread only, so the queue and storage are allocated on the
+ * node of the thread that allocates them - the API thread for queued messages
+ * and the processor thread for storage records.
+ */
+class ThreadPlacement final
+{
+public:
+    enum Role
+    {
+        roleMain = 0,
+        roleApi,
+        roleProcessor,
+        roleLogger,
+        roleCount
+    };
+
+    ThreadPlacement() = delete;
+
+    /**
+     * @brief apply name, CPU affinity and memory policy of given role to calling thread
+     *
+     * @param role thread role
+     * @return true on success or if nothing is configured
+     * @return false if configured placement could not be applied
+     */
+    static bool apply(const Role role);
+
+    /**
+     * @brief apply name and CPU affinity of given role to other thread
+     *
+     * @param thread thread identifier
+     * @param role thread role
+     * @return true on success or if nothing is configured
+     * @return false if configured placement could not be applied
+     */
+    static bool apply(const pthread_t thread, const Role role);
+
+    /**
+     * @brief Get CPU time, last used CPU and affinity of every thread of the process
+     *
+     * @return std::string
+     */
+    static std::string getThreadReport(void);
+
+    /**
+     * @brief parse CPU list in "0-3,8,10-11" format
+     *
+     * @param list CPU list
+     * @param cpus output CPU set
+     * @return true on success
+     * @return false on invalid list
+     */
+    static bool parseCpuList(const std::string &list, cpu_set_t &cpus);
+
+private:
+    /**
+     * @brief resolve CPU set of role from configured CPU list or memory node
+     *
+     * @param settings role placement
+     * @param cpus output CPU set
+     * @return true if CPU set is configured
+     * @return false if thread should not be pinned
+     */
+    static bool resolveCpus(const Configuration::PlacementSettings &settings, cpu_set_t &cpus);
+
+    /**
+     * @brief Get the placement settings of given role
+     *
+     * @param role thread role
+     * @return const Configuration::PlacementSettings&
+     */
+    static const Configuration::PlacementSettings &getSettings(const Role role);
+
+    static const char *const roleNames[roleCount];
+};
+
+#endif
@@ -0,0 +1,435 @@
+#include "ArrowWriter.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // body buffers and message bodies are aligned to 64 bytes as the format recommends
+    const uint64_t bodyAlignment(64);
+
+    // enumerations of Arrow metadata (format/Schema.fbs, format/Message.fbs)
+    const int16_t metadataVersion5(4);
+    const uint8_t headerSchema(1);
+    const uint8_t headerDictionaryBatch(2);
+    const uint8_t headerRecordBatch(3);
+    const uint8_t typeIdInt(2);
+    const uint8_t typeIdFloatingPoint(3);
+    const uint8_t typeIdUtf8(5);
+    const uint8_t typeIdTimestamp(10);
+    const int16_t precisionDouble(2);
+    const int16_t timeUnitMillisecond(1);
+
+    ////////////////////////////////////////////////////////////////////////////
+    uint64_t roundUp(const uint64_t value, const uint64_t multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+}
+
+/**
+ * @brief flatbuffer builder writing from back to front like generated builders do
+ *
+ * Objects are referenced by their distance from the end of the buffer, which
+ * does not change as the buffer grows to the front, so child objects are built
+ * first and parents refer forward to them as the format requires. Only tables
+ * of scalars and references, strings and vectors of structs and references are
+ * supported; every object is aligned to its own size.
+ */
+class ArrowWriter::FlatBuilder final
+{
+public:
+    FlatBuilder() : buffer(1024), head(1024), tableStart(0) {}
+
+    ////////////////////////////////////////////////////////////////////////////
+    uint32_t getSize(void) const
+    {
+        return static_cast<uint32_t>(buffer.size() - head);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    const uint8_t *getData(void) const
+    {
+        return &buffer[head];
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    uint32_t addString(const std::string &text)
+    {
+        // terminating zero is required by flatbuffer verifiers
+        align(text.size() + 1 + sizeof(uint32_t), sizeof(uint32_t));
+        push<uint8_t>(0);
+        pushBytes(text.data(), text.size());
+        push<uint32_t>(static_cast<uint32_t>(text.size()));
+        return getSize();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    uint32_t addStructs(const void *structs, const size_t count, const size_t size)
+    {
+        // elements are aligned to 8 bytes; the length before them to 4
+        align(count * size, sizeof(uint64_t));
+        pushBytes(structs, count * size);
+        push<uint32_t>(static_cast<uint32_t>(count));
+        return getSize();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    uint32_t addReferences(const std::vector<uint32_t> &objects)
+    {
+        align((objects.size() + 1) * sizeof(uint32_t), sizeof(uint32_t));
+
+        for (auto object(objects.rbegin()); object != objects.rend(); ++object)
+        {
+            push<uint32_t>(getSize() + static_cast<uint32_t>(sizeof(uint32_t)) - *object);
+        }
+
+        push<uint32_t>(static_cast<uint32_t>(objects.size()));
+        return getSize();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    void startTable(void)
+    {
+        fields.clear();
+        tableStart = getSize();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    template <typename T>
+    void addField(const uint16_t id, const T value)
+    {
+        align(sizeof(T), sizeof(T));
+        push<T>(value);
+        fields.push_back(std::make_pair(id, getSize()));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    void addReference(const uint16_t id, const uint32_t object)
+    {
+        align(sizeof(uint32_t), sizeof(uint32_t));
+        push<uint32_t>(getSize() + static_cast<uint32_t>(sizeof(uint32_t)) - object);
+        fields.push_back(std::make_pair(id, getSize()));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    uint32_t endTable(void)
+    {
+        align(sizeof(int32_t), sizeof(int32_t));
+        push<int32_t>(0);
+        const uint32_t table(getSize());
+        uint16_t fieldCount(0);
+
+        for (const auto &field : fields)
+        {
+            fieldCount = std::max<uint16_t>(fieldCount, static_cast<uint16_t>(field.first + 1));
+        }
+
+        // vtable precedes its table: field positions relative to table start, table size and vtable size
+        std::vector<uint16_t> positions(fieldCount, 0);
+
+        for (const auto &field : fields)
+        {
+            positions[field.first] = static_cast<uint16_t>(table - field.second);
+        }
+
+        for (auto position(positions.rbegin()); position != positions.rend(); ++position)
+        {
+            push<uint16_t>(*position);
+        }
+
+        push<uint16_t>(static_cast<uint16_t>(table - tableStart));
+        push<uint16_t>(static_cast<uint16_t>((fieldCount + 2) * sizeof(uint16_t)));
+        const int32_t vtable(static_cast<int32_t>(getSize() - table));
+        memcpy(&buffer[buffer.size() - table], &vtable, sizeof(vtable));
+        return table;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    void finish(const uint32_t root)
+    {
+        // whole buffer is multiple of 8 bytes, so aligned distance from its end is aligned position
+        align(sizeof(uint32_t), sizeof(uint64_t));
+        push<uint32_t>(getSize() + static_cast<uint32_t>(sizeof(uint32_t)) - root);
+    }
+
+private:
+    ////////////////////////////////////////////////////////////////////////////
+    template <typename T>
+    void push(const T value)
+    {
+        pushBytes(&value, sizeof(T));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    void pushBytes(const void *data, const size_t length)
+    {
+        if (head < length)
+        {
+            // data keeps its distance from the end
+            std::vector<uint8_t> grown(2 * buffer.size() + length);
+            memcpy(&grown[grown.size() - getSize()], &buffer[head], getSize());
+            head += grown.size() - buffer.size();
+            buffer.swap(grown);
+        }
+
+        head -= length;
+
+        if (length != 0)
+        {
+            memcpy(&buffer[head], data, length);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    void align(const size_t size, const size_t alignment)
+    {
+        while ((getSize() + size) % alignment != 0)
+        {
+            push<uint8_t>(0);
+        }
+    }
+
+    std::vector<uint8_t> buffer;
+    size_t head;
+    uint32_t tableStart;
+    // field ids and positions of table being built
+    std::vector<std::pair<uint16_t, uint32_t>> fields;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+ArrowWriter::ArrowWriter(std::string &output, const std::vector<Column> &columns,
+                         const std::vector<std::pair<std::string, std::string>> &metadata) : output(output),
+                                                                                             columns(columns),
+                                                                                             metadata(metadata)
+{
+    // magic is padded to 8 bytes
+    output.assign("ARROW1\0\0", 8);
+
+    FlatBuilder builder;
+    const uint32_t schema(buildSchema(builder));
+    writeMessage(builder, headerSchema, schema, std::vector<BodyBuffer>(), nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ArrowWriter::writeDictionary(const int64_t id, const std::vector<int32_t> &offsets, const std::string &values)
+{
+    // dictionary is record batch of single string column without nulls
+    const uint64_t count(offsets.size() - 1);
+    const std::vector<BodyBuffer> buffers{{nullptr, 0}, {offsets.data(), offsets.size() * sizeof(int32_t)}, {values.data(), values.size()}};
+    const std::vector<int64_t> nodes{static_cast<int64_t>(count), 0};
+
+    FlatBuilder builder;
+    const uint32_t data(buildRecordBatch(builder, count, nodes, buffers));
+    builder.startTable();
+    builder.addField<int64_t>(0, id);
+    builder.addReference(1, data);
+    const uint32_t dictionary(builder.endTable());
+    writeMessage(builder, headerDictionaryBatch, dictionary, buffers, &dictionaryBlocks);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ArrowWriter::writeBatch(const uint64_t rows, const std::vector<ColumnData> &data)
+{
+    std::vector<BodyBuffer> buffers;
+    std::vector<int64_t> nodes;
+
+    // every column has validity bitmap, empty without nulls, and values
+    for (size_t column(0); column < columns.size(); ++column)
+    {
+        const bool hasNulls((data[column].validity != nullptr) && (data[column].nullCount != 0));
+        nodes.push_back(static_cast<int64_t>(rows));
+        nodes.push_back(hasNulls ? static_cast<int64_t>(data[column].nullCount) : 0);
+        buffers.push_back(BodyBuffer{hasNulls ? data[column].validity : nullptr, hasNulls ? (rows + 7) / 8 : 0});
+        buffers.push_back(BodyBuffer{data[column].values, rows * columns[column].bitWidth / 8});
+    }
+
+    FlatBuilder builder;
+    const uint32_t batch(buildRecordBatch(builder, rows, nodes, buffers));
+    writeMessage(builder, headerRecordBatch, batch, buffers, &batchBlocks);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ArrowWriter::finish(void)
+{
+    // end of stream marker lets the file body be read as stream too
+    const uint32_t endOfStream[2] = {UINT32_MAX, 0};
+    output.append(reinterpret_cast<const char *>(endOfStream), sizeof(endOfStream));
+
+    FlatBuilder builder;
+    const uint32_t schema(buildSchema(builder));
+    const uint32_t dictionaries(builder.addStructs(dictionaryBlocks.data(), dictionaryBlocks.size(), sizeof(Block)));
+    const uint32_t batches(builder.addStructs(batchBlocks.data(), batchBlocks.size(), sizeof(Block)));
+    builder.startTable();
+    builder.addField<int16_t>(0, metadataVersion5);
+    builder.addReference(1, schema);
+    builder.addReference(2, dictionaries);
+    builder.addReference(3, batches);
+    builder.finish(builder.endTable());
+
+    const int32_t footerLength(static_cast<int32_t>(builder.getSize()));
+    output.append(reinterpret_cast<const char *>(builder.getData()), builder.getSize());
+    output.append(reinterpret_cast<const char *>(&footerLength), sizeof(footerLength));
+    output.append("ARROW1", 6);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t ArrowWriter::buildSchema(FlatBuilder &builder) const
+{
+    std::vector<uint32_t> fields;
+
+    for (const auto &column : columns)
+    {
+        const uint32_t name(builder.addString(column.name));
+        const uint32_t timezone((column.type == typeTimestamp) ? builder.addString("UTC") : 0);
+        const uint32_t children(builder.addReferences(std::vector<uint32_t>()));
+
+        // integer type is also the index type of dictionary encoded column
+        builder.startTable();
+
+        if (column.type == typeFloat)
+        {
+            builder.addField<int16_t>(0, precisionDouble);
+        }
+        else if (column.type == typeTimestamp)
+        {
+            builder.addField<int16_t>(0, timeUnitMillisecond);
+            builder.addReference(1, timezone);
+        }
+        else
+        {
+            builder.addField<int32_t>(0, column.bitWidth);
+            builder.addField<uint8_t>(1, column.isSigned ? 1 : 0);
+        }
+
+        const uint32_t type(builder.endTable());
+        uint32_t dictionary(0);
+        uint32_t valueType(0);
+
+        if (column.dictionary >= 0)
+        {
+            builder.startTable();
+            builder.addField<int64_t>(0, column.dictionary);
+            builder.addReference(1, type);
+            dictionary = builder.endTable();
+
+            // values of dictionary are strings; utf8 type has no fields
+            builder.startTable();
+            valueType = builder.endTable();
+        }
+
+        builder.startTable();
+        builder.addReference(0, name);
+        builder.addField<uint8_t>(1, column.nullable ? 1 : 0);
+
+        if (column.dictionary >= 0)
+        {
+            builder.addField<uint8_t>(2, typeIdUtf8);
+            builder.addReference(3, valueType);
+            builder.addReference(4, dictionary);
+        }
+        else
+        {
+            builder.addField<uint8_t>(2, (column.type == typeFloat) ? typeIdFloatingPoint : ((column.type == typeTimestamp) ? typeIdTimestamp : typeIdInt));
+            builder.addReference(3, type);
+        }
+
+        builder.addReference(5, children);
+        fields.push_back(builder.endTable());
+    }
+
+    std::vector<uint32_t> pairs;
+
+    for (const auto &pair : metadata)
+    {
+        const uint32_t key(builder.addString(pair.first));
+        const uint32_t value(builder.addString(pair.second));
+        builder.startTable();
+        builder.addReference(0, key);
+        builder.addReference(1, value);
+        pairs.push_back(builder.endTable());
+    }
+
+    const uint32_t fieldVector(builder.addReferences(fields));
+    const uint32_t pairVector(builder.addReferences(pairs));
+
+    // little endian is the default of the endianness field
+    builder.startTable();
+    builder.addReference(1, fieldVector);
+    builder.addReference(2, pairVector);
+    return builder.endTable();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t ArrowWriter::buildRecordBatch(FlatBuilder &builder, const uint64_t rows, const std::vector<int64_t> &nodes,
+                                       const std::vector<BodyBuffer> &buffers)
+{
+    // buffer locations are (offset, length) pairs within message body
+    std::vector<int64_t> locations;
+    uint64_t offset(0);
+
+    for (const auto &buffer : buffers)
+    {
+        locations.push_back(static_cast<int64_t>(offset));
+        locations.push_back(static_cast<int64_t>(buffer.length));
+        offset += roundUp(buffer.length, bodyAlignment);
+    }
+
+    const uint32_t nodeVector(builder.addStructs(nodes.data(), nodes.size() / 2, 2 * sizeof(int64_t)));
+    const uint32_t bufferVector(builder.addStructs(locations.data(), buffers.size(), 2 * sizeof(int64_t)));
+    builder.startTable();
+    builder.addField<int64_t>(0, static_cast<int64_t>(rows));
+    builder.addReference(1, nodeVector);
+    builder.addReference(2, bufferVector);
+    return builder.endTable();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ArrowWriter::writeMessage(FlatBuilder &builder, const uint8_t headerType, const uint32_t header,
+                               const std::vector<BodyBuffer> &buffers, std::vector<Block> *blocks)
+{
+    const uint64_t bodyLength(getBodyLength(buffers));
+    builder.startTable();
+    builder.addField<int16_t>(0, metadataVersion5);
+    builder.addField<uint8_t>(1, headerType);
+    builder.addReference(2, header);
+    builder.addField<int64_t>(3, static_cast<int64_t>(bodyLength));
+    builder.finish(builder.endTable());
+
+    // metadata is padded so that body starts aligned; its length counts the padding
+    const uint64_t start(output.size());
+    const uint64_t metadataEnd(roundUp(start + 2 * sizeof(uint32_t) + builder.getSize(), bodyAlignment));
+    const uint32_t prefix[2] = {UINT32_MAX, static_cast<uint32_t>(metadataEnd - start - 2 * sizeof(uint32_t))};
+
+    output.reserve(metadataEnd + bodyLength);
+    output.append(reinterpret_cast<const char *>(prefix), sizeof(prefix));
+    output.append(reinterpret_cast<const char *>(builder.getData()), builder.getSize());
+    output.resize(metadataEnd, '\0');
+
+    for (const auto &buffer : buffers)
+    {
+        if (buffer.length != 0)
+        {
+            output.append(static_cast<const char *>(buffer.data), buffer.length);
+        }
+
+        output.resize(roundUp(output.size(), bodyAlignment), '\0');
+    }
+
+    if (blocks != nullptr)
+    {
+        blocks->push_back(Block{static_cast<int64_t>(start), static_cast<int32_t>(metadataEnd - start), 0, static_cast<int64_t>(bodyLength)});
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t ArrowWriter::getBodyLength(const std::vector<BodyBuffer> &buffers)
+{
+    uint64_t length(0);
+
+    for (const auto &buffer : buffers)
+    {
+        length += roundUp(buffer.length, bodyAlignment);
+    }
+
+    return length;
+}
@@ -0,0 +1,154 @@
+#ifndef ARROWWRITER_HPP
+#define ARROWWRITER_HPP
+
+#include <cinttypes>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief writer of Apache Arrow IPC file format (columnar format version 5)
+ *
+ * File is magic, schema message, dictionary batches, record batches, end of
+ * stream marker and footer locating all batches, so it can be memory mapped
+ * and read without copying by any Arrow implementation. Columns are fixed
+ * width little endian integers, doubles or millisecond timestamps, optionally
+ * with validity bitmap; string columns are dictionary encoded. Message metadata
+ * are flatbuffers built by the writer itself, so no Arrow library is needed.
+ * Every body buffer starts at 64-byte boundary of the file as the format
+ * recommends for vectorized readers.
+ */
+class ArrowWriter final
+{
+public:
+    enum Type
+    {
+        typeInt = 0,
+        typeFloat,
+        typeTimestamp
+    };
+
+    // column of schema
+    struct Column
+    {
+        std::string name;
+        // type of values; indexes of dictionary encoded column are typeInt
+        Type type;
+        // width of values in bits; 64 for doubles and timestamps
+        uint8_t bitWidth;
+        bool isSigned;
+        // id of string dictionary of the column or -1 for plain column
+        int64_t dictionary;
+        bool nullable;
+    };
+
+    // values of one column in record batch; validity bitmap (least significant bit first) or nullptr without nulls
+    struct ColumnData
+    {
+        const void *values;
+        const uint8_t *validity;
+        uint64_t nullCount;
+    };
+
+    /**
+     * @brief Construct a new Arrow Writer object and write file header and schema
+     *
+     * @param output output file contents; cleared first
+     * @param columns columns of schema
+     * @param metadata key value pairs attached to schema
+     */
+    ArrowWriter(std::string &output, const std::vector<Column> &columns, const std::vector<std::pair<std::string, std::string>> &metadata);
+
+    ArrowWriter(const ArrowWriter &) = delete;
+    ArrowWriter &operator=(const ArrowWriter &) = delete;
+
+    /**
+     * @brief write dictionary of strings; must precede first record batch
+     *
+     * @param id dictionary id used by columns
+     * @param offsets offsets of strings in values, number of strings plus one
+     * @param values concatenated strings
+     */
+    void writeDictionary(const int64_t id, const std::vector<int32_t> &offsets, const std::string &values);
+
+    /**
+     * @brief write record batch
+     *
+     * @param rows number of rows
+     * @param data values of every column of schema
+     */
+    void writeBatch(const uint64_t rows, const std::vector<ColumnData> &data);
+
+    /**
+     * @brief write end of stream marker and footer; file is complete afterwards
+     *
+     */
+    void finish(void);
+
+private:
+    class FlatBuilder;
+
+    // location of message in file as recorded in footer
+    struct Block
+    {
+        int64_t offset;
+        int32_t metadataLength;
+        int32_t padding;
+        int64_t bodyLength;
+    };
+
+    // buffer of message body
+    struct BodyBuffer
+    {
+        const void *data;
+        uint64_t length;
+    };
+
+    /**
+     * @brief build schema table
+     *
+     * @param builder builder
+     * @return uint32_t schema table reference
+     */
+    uint32_t buildSchema(FlatBuilder &builder) const;
+
+    /**
+     * @brief build record batch table of body buffers
+     *
+     * @param builder builder
+     * @param rows number of rows
+     * @param nodes length and null count of every column, one after another
+     * @param buffers body buffers
+     * @return uint32_t record batch table reference
+     */
+    static uint32_t buildRecordBatch(FlatBuilder &builder, const uint64_t rows, const std::vector<int64_t> &nodes,
+                                     const std::vector<BodyBuffer> &buffers);
+
+    /**
+     * @brief write message with metadata and body
+     *
+     * @param builder builder of message header
+     * @param headerType type of header
+     * @param header header table reference
+     * @param buffers body buffers
+     * @param blocks list of footer receiving the message or nullptr
+     */
+    void writeMessage(FlatBuilder &builder, const uint8_t headerType, const uint32_t header, const std::vector<BodyBuffer> &buffers,
+                      std::vector<Block> *blocks);
+
+    /**
+     * @brief Get size of message body with every buffer padded to alignment
+     *
+     * @param buffers body buffers
+     * @return uint64_t
+     */
+    static uint64_t getBodyLength(const std::vector<BodyBuffer> &buffers);
+
+    std::string &output;
+    const std::vector<Column> columns;
+    const std::vector<std::pair<std::string, std::string>> metadata;
+    std::vector<Block> dictionaryBlocks;
+    std::vector<Block> batchBlocks;
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "ColumnarExport.hpp"
+#include "ArrowWriter.hpp"
+#include "DataStorage.hpp"
+#include "HistoryStore.hpp"
+#include "MeasurementCatalog.hpp"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace
+{
+    ////////////////////////////////////////////////////////////////////////////
+    void appendName(std::vector<int32_t> &offsets, std::string &values, const char *name, const size_t length)
+    {
+        values.append(name, length);
+        offsets.push_back(static_cast<int32_t>(values.size()));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ColumnarExport::exportCounters(std::string &result)
+{
+    const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+    const unsigned kindCount(MeasurementCatalog::size());
+    const unsigned faultCount(MeasurementCatalog::getFaultCount());
+
+    // columns are filled row by row while snapshot is taken; statistics of a kind share its validity bitmap
+    std::vector<int32_t> nameOffsets(1, 0);
+    std::string names;
+    std::vector<int32_t> nameIndexes;
+    std::vector<uint64_t> messages;
+    std::vector<std::vector<uint64_t>> counts(kindCount);
+    std::vector<std::vector<double>> statistics(kindCount * statisticCount);
+    std::vector<std::vector<uint8_t>> validity(kindCount);
+    std::vector<uint64_t> nullCounts(kindCount, 0);
+    std::vector<std::vector<uint64_t>> faults(faultCount);
+
+    const uint64_t total(DataStorage::forEachSnapshot([&nameIndexes, &nameOffsets, &names, &messages, &counts, &validity, &nullCounts,
+                                                       &statistics, &faults, kindCount, faultCount](const DeviceTable::DeviceRecord &device)
+                                                      {
+                                                          const DeviceTable::Counters &counters(*device.snapshot);
+                                                          const size_t row(messages.size());
+                                                          nameIndexes.push_back(static_cast<int32_t>(row));
+                                                          appendName(nameOffsets, names, device.name, device.nameLength);
+                                                          messages.push_back(counters.deviceMessageCount);
+
+                                                          for (unsigned kind(0); kind < kindCount; ++kind)
+                                                          {
+                                                              const MeasurementStats &stats(counters.getMeasurements()[kind]);
+                                                              counts[kind].push_back(stats.count);
+
+                                                              if (row % 8 == 0)
+                                                              {
+                                                                  validity[kind].push_back(0);
+                                                              }
+
+                                                              if (stats.count != 0)
+                                                              {
+                                                                  validity[kind].back() |= static_cast<uint8_t>(1 << (row % 8));
+                                                              }
+                                                              else
+                                                              {
+                                                                  nullCounts[kind]++;
+                                                              }
+
+                                                              statistics[kind * statisticCount].push_back(stats.minimum);
+                                                              statistics[kind * statisticCount + 1].push_back(stats.maximum);
+                                                              statistics[kind * statisticCount + 2].push_back(stats.mean);
+                                                              statistics[kind * statisticCount + 3].push_back(stats.getVariance());
+                                                              statistics[kind * statisticCount + 4].push_back(stats.last);
+                                                          }
+
+                                                          for (unsigned fault(0); fault < faultCount; ++fault)
+                                                          {
+                                                              faults[fault].push_back(counters.getFaultCounts()[fault]);
+                                                          }
+                                                      }));
+
+    static const char *const statisticKeys[statisticCount] = {"min", "max", "mean", "variance", "last"};
+    std::vector<ArrowWriter::Column> columns{{"name", ArrowWriter::typeInt, 32, true, 0, false},
+                                             {"messages", ArrowWriter::typeInt, 64, false, -1, false}};
+    std::vector<ArrowWriter::ColumnData> data{{nameIndexes.data(), nullptr, 0}, {messages.data(), nullptr, 0}};
+
+    for (unsigned kind(0); kind < kindCount; ++kind)
+    {
+        const std::string key(MeasurementCatalog::getKey(kind));
+        columns.push_back(ArrowWriter::Column{key + ".count", ArrowWriter::typeInt, 64, false, -1, false});
+        data.push_back(ArrowWriter::ColumnData{counts[kind].data(), nullptr, 0});
+
+        for (unsigned statistic(0); statistic < statisticCount; ++statistic)
+        {
+            columns.push_back(ArrowWriter::Column{key + "." + statisticKeys[statistic], ArrowWriter::typeFloat, 64, true, -1, true});
+            data.push_back(ArrowWriter::ColumnData{statistics[kind * statisticCount + statistic].data(), validity[kind].data(), nullCounts[kind]});
+        }
+    }
+
+    // fault keys may repeat across measurements, so columns are named by both
+    for (unsigned fault(0); fault < faultCount; ++fault)
+    {
+        columns.push_back(ArrowWriter::Column{std::string(MeasurementCatalog::getKey(MeasurementCatalog::getFaultKind(fault))) + "." +
+                                                  MeasurementCatalog::getFaultKey(fault),
+                                              ArrowWriter::typeInt, 64, false, -1, false});
+        data.push_back(ArrowWriter::ColumnData{faults[fault].data(), nullptr, 0});
+    }
+
+    ArrowWriter writer(result, columns, {{"grandTotal", std::to_string(total)}});
+    writer.writeDictionary(0, nameOffsets, names);
+    writer.writeBatch(messages.size(), data);
+    writer.finish();
+
+    const double elapsed(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    LOG_FMT_DBG("exported counters of %zu devices, %zu bytes in %.3f ms", messages.size(), result.size(), elapsed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ColumnarExport::exportHistory(std::string &result)
+{
+    const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+    std::vector<std::string> devices;
+    std::vector<std::vector<GorillaBlock>> blocks;
+
+    if (!HistoryStore::copyBlocks(devices, blocks))
+    {
+        return false;
+    }
+
+    const unsigned kindCount(MeasurementCatalog::size());
+    std::vector<int32_t> nameOffsets(1, 0);
+    std::string names;
+    std::vector<int32_t> kindOffsets(1, 0);
+    std::string kinds;
+
+    for (const auto &device : devices)
+    {
+        appendName(nameOffsets, names, device.data(), device.size());
+    }
+
+    for (unsigned kind(0); kind < kindCount; ++kind)
+    {
+        const std::string key(MeasurementCatalog::getKey(kind));
+        appendName(kindOffsets, kinds, key.data(), key.size());
+    }
+
+    const std::vector<ArrowWriter::Column> columns{{"name", ArrowWriter::typeInt, 32, true, 0, false},
+                                                   {"measurement", ArrowWriter::typeInt, 8, true, 1, false},
+                                                   {"timestamp", ArrowWriter::typeTimestamp, 64, true, -1, false},
+                                                   {"value", ArrowWriter::typeFloat, 64, true, -1, false}};
+    ArrowWriter writer(result, columns, {});
+    writer.writeDictionary(0, nameOffsets, names);
+    writer.writeDictionary(1, kindOffsets, kinds);
+
+    // whole blocks are decoded into batch columns; batch is written once next block would not fit
+    std::vector<int32_t> nameIndexes(historyBatchRows);
+    std::vector<int8_t> kindIndexes(historyBatchRows);
+    std::vector<int64_t> timestamps(historyBatchRows);
+    std::vector<double> values(historyBatchRows);
+    const std::vector<ArrowWriter::ColumnData> data{{nameIndexes.data(), nullptr, 0}, {kindIndexes.data(), nullptr, 0},
+                                                    {timestamps.data(), nullptr, 0}, {values.data(), nullptr, 0}};
+    uint64_t rows(0);
+    uint64_t samples(0);
+
+    for (size_t series(0); series < blocks.size(); ++series)
+    {
+        for (const auto &block : blocks[series])
+        {
+            if (rows + block.getCount() > historyBatchRows)
+            {
+                writer.writeBatch(rows, data);
+                rows = 0;
+            }
+
+            block.decode(&timestamps[rows], &values[rows]);
+            std::fill(&nameIndexes[rows], &nameIndexes[rows] + block.getCount(), static_cast<int32_t>(series / kindCount));
+            std::fill(&kindIndexes[rows], &kindIndexes[rows] + block.getCount(), static_cast<int8_t>(series % kindCount));
+            rows += block.getCount();
+            samples += block.getCount();
+        }
+    }
+
+    if ((rows != 0) || (samples == 0))
+    {
+        writer.writeBatch(rows, data);
+    }
+
+    writer.finish();
+
+    const double elapsed(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    LOG_FMT_DBG("exported %" PRIu64 " history samples, %zu bytes in %.3f ms", samples, result.size(), elapsed);
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef COLUMNAREXPORT_HPP
+#define COLUMNAREXPORT_HPP
+
+#include <cinttypes>
+#include <string>
+
+/**
+ * @brief bulk export of device counters and history as Arrow IPC files
+ *
+ * Counters and statistics come from storage snapshot, so export never blocks
+ * writers; history blocks are copied under the history lock and decoded after
+ * it is released. Columns follow the measurement catalog; device names and
+ * measurement keys are string dictionaries referenced by integer indexes, so
+ * rows stay fixed width. Files are read by analytics tools without parsing, e.g.
+ * pyarrow.ipc.open_file(pyarrow.memory_map(file)).read_all() maps columns of
+ * a saved export without copying them.
+ */
+class ColumnarExport final
+{
+public:
+    ColumnarExport() = delete;
+
+    /**
+     * @brief export snapshot counters of every device: name, messages, count, min, max, mean, variance
+     * and last value of every measurement (null if never measured) and fault counts
+     *
+     * @param result output Arrow IPC file; schema metadata "grandTotal" holds total message count
+     */
+    static void exportCounters(std::string &result);
+
+    /**
+     * @brief export every sample of history store as rows of name, measurement, timestamp and value
+     *
+     * @param result output Arrow IPC file
+     * @return true on success
+     * @return false if history is disabled
+     */
+    static bool exportHistory(std::string &result);
+
+private:
+    // statistics of measurement exported besides its count
+    static const unsigned statisticCount = 5;
+    // largest record batch of history export in rows; columns of one batch are decoded at once
+    static const uint64_t historyBatchRows = 1 << 16;
+};
+
+#endif
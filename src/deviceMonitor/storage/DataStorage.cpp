@@ -1,88 +1,1108 @@
 #include "DataStorage.hpp"
+#include "LivenessTracker.hpp"
+#include "NameDictionary.hpp"
+#include "WriteAheadLog.hpp"
+#include "fnv.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
 
-std::mutex DataStorage::dataStoreLock;
-std::map<DataStorage::deviceId, DataStorage::DeviceRecord> DataStorage::dataStore;
+DeviceTable DataStorage::dataStore;
+NameIndex DataStorage::nameIndex;
+WriteEpoch DataStorage::writeEpoch;
+std::mutex DataStorage::snapshotLock;
+std::atomic<uint64_t> DataStorage::pendingTotal[2];
 uint64_t DataStorage::totalCount(0);
-const std::string DataStorage::key_name("name");
-const std::string DataStorage::key_current("current");
-const std::string DataStorage::key_voltage("voltage");
-const std::string DataStorage::key_temperature("temperature");
-const DataStorage::valueId DataStorage::id_current(fnv::Fnv64a(key_current));
-const DataStorage::valueId DataStorage::id_voltage(fnv::Fnv64a(key_voltage));
-const DataStorage::valueId DataStorage::id_temperature(fnv::Fnv64a(key_temperature));
+DeviceTable DataStorage::rollupStore(false);
+unsigned DataStorage::rollupLevels(0);
+char DataStorage::rollupDelimiter('-');
+std::mutex DataStorage::overflowLock;
+std::vector<DataStorage::SketchOverflow> DataStorage::sketchOverflows[2];
+
+namespace
+{
+    // checkpoint starts with magic and format version
+    const char CHECKPOINT_MAGIC[8] = {'D', 'M', 'C', 'K', 'P', 0, 0, 2};
+
+    // kinds of checkpoint entries
+    const uint32_t entryDevice(0);
+    const uint32_t entryRollup(1);
+
+    static_assert(std::is_trivially_copyable<MeasurementStats>::value, "counters are copied to checkpoint as they are");
+    static_assert(std::is_trivially_copyable<QuantileSketch>::value, "sketches are copied to checkpoint as they are");
+
+    ////////////////////////////////////////////////////////////////////////////
+    bool writeAll(const int descriptor, const char *data, const size_t size)
+    {
+        size_t written(0);
+
+        while (written < size)
+        {
+            const ssize_t result(write(descriptor, data + written, size - written));
+
+            if (result < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                return false;
+            }
+
+            written += static_cast<size_t>(result);
+        }
+
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    bool createParentDirectories(const std::string &path)
+    {
+        for (size_t position(path.find('/', 1)); position != std::string::npos; position = path.find('/', position + 1))
+        {
+            if ((mkdir(path.substr(0, position).c_str(), 0750) != 0) && (errno != EEXIST))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    std::string encodeCursor(const char *name, const uint32_t length)
+    {
+        // cursor is hex of the last listed name, so any name is safe in query string
+        static const char digits[] = "0123456789abcdef";
+        std::string cursor;
+        cursor.reserve(length * 2);
+
+        for (uint32_t position(0); position < length; ++position)
+        {
+            const uint8_t byte(static_cast<uint8_t>(name[position]));
+            cursor.push_back(digits[byte >> 4]);
+            cursor.push_back(digits[byte & 0x0f]);
+        }
+
+        return cursor;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    bool decodeCursor(const std::string &cursor, std::string &name)
+    {
+        if (cursor.size() % 2 != 0)
+        {
+            return false;
+        }
+
+        name.clear();
+
+        for (size_t position(0); position < cursor.size(); position += 2)
+        {
+            uint8_t byte(0);
+
+            for (size_t digit(position); digit < position + 2; ++digit)
+            {
+                const char character(cursor[digit]);
+                byte = static_cast<uint8_t>(byte << 4);
+
+                if ((character >= '0') && (character <= '9'))
+                {
+                    byte = static_cast<uint8_t>(byte | (character - '0'));
+                }
+                else if ((character >= 'a') && (character <= 'f'))
+                {
+                    byte = static_cast<uint8_t>(byte | (character - 'a' + 10));
+                }
+                else
+                {
+                    return false;
+                }
+            }
+
+            name.push_back(static_cast<char>(byte));
+        }
+
+        return true;
+    }
+}
 
 ////////////////////////////////////////////////////////////////////////////////
-void DataStorage::addRecord(AbstractAPI::pJsonMessage_t newRecord)
+void DataStorage::configureRollups(const unsigned levels, const char delimiter)
+{
+    rollupLevels = std::min(levels, DeviceTable::maxRollupLevels);
+    rollupDelimiter = delimiter;
+
+    if (rollupLevels != 0)
+    {
+        LOG_FMT_INF("device counters rolled up into %u name prefix levels delimited by '%c'", rollupLevels, rollupDelimiter);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DataStorage::addBatch(const RecordBatch &batch)
 try
 {
-    std::lock_guard<std::mutex> lock(dataStoreLock);
-    totalCount++;
+    if (batch.empty())
+    {
+        return;
+    }
 
-    // get name and hash from device name
-    std::string name(newRecord->GetObject()[key_name.c_str()].GetString());
-    deviceId idDevice(fnv::Fnv64a(name));
+    // whole batch goes to pending counters of one epoch, so snapshot contains either all of it or nothing
+    const std::vector<RecordBatch::DeviceDelta> &deltas(batch.getDeltas());
+    const std::vector<uint32_t> &order(batch.getOrder());
+    uint32_t runStart(0);
+    const int64_t now(LivenessTracker::getTime());
+    // deltas of devices sharing a prefix are merged first, so every rollup is updated once per batch
+    thread_local FlatHashMap<uint32_t> rollupSlots;
+    thread_local std::vector<DeviceTable::DeviceRecord *> rollupRecords;
+    // counter blocks of rollupRecords
+    thread_local std::vector<uint64_t> rollupWords;
+    const size_t words(DeviceTable::Counters::getWords());
+    rollupSlots.clear();
+    rollupRecords.clear();
+    rollupWords.clear();
+    const WriteEpoch::Guard epochGuard(writeEpoch);
+    const unsigned parity(epochGuard.getParity());
+    // frame is tagged with the epoch, so replay after checkpoint skips exactly the batches it contains
+    WriteAheadLog::append(batch, epochGuard.getEpoch());
+    pendingTotal[parity].fetch_add(batch.size(), std::memory_order_relaxed);
 
-    // check if we have device registered if not create new record
-    auto device(dataStore.find(idDevice));
-    if (device == dataStore.end())
+    for (const auto &delta : deltas)
     {
-        device = dataStore.insert(std::make_pair(idDevice, DeviceRecord(name))).first;
+        // check if we have device registered if not create new record
+        DeviceTable::DeviceRecord *device(dataStore.find(delta.deviceId));
+        bool inserted(false);
+        if (device == nullptr)
+        {
+            device = dataStore.insert(delta.deviceId, NameDictionary::getName(delta.deviceId),
+                                      NameDictionary::getLength(delta.deviceId), inserted);
+        }
+
+        // memory budget is reached; new device is refused and its messages are not counted per device
+        if (device == nullptr)
+        {
+            runStart += delta.messageCount;
+            continue;
+        }
+
+        // single store per device and batch; timeouts are checked by liveness tracker
+        device->lastSeen.store(now, std::memory_order_relaxed);
+
+        if (inserted)
+        {
+            LivenessTracker::track(delta.deviceId, *device);
+            nameIndex.insert(delta.deviceId);
+        }
+
+        addDelta(*device->pending[parity], batch, delta);
+
+        DeviceTable::DeviceRecord *resolved[DeviceTable::maxRollupLevels];
+        DeviceTable::DeviceRecord *const *rollups(device->rollups);
+        uint8_t rollupCount(0);
+
+        if (rollupLevels != 0)
+        {
+            if (device->rollupState.load(std::memory_order_acquire) == DeviceTable::rollupsResolved)
+            {
+                rollupCount = device->rollupCount;
+            }
+            else
+            {
+                rollupCount = resolveRollups(*device, resolved);
+                rollups = resolved;
+            }
+        }
+
+        for (unsigned level(0); level < rollupCount; ++level)
+        {
+            bool inserted(false);
+            const uint32_t slot(rollupSlots.findOrInsert(reinterpret_cast<uintptr_t>(rollups[level]),
+                                                         static_cast<uint32_t>(rollupRecords.size()), inserted));
+
+            if (inserted)
+            {
+                rollupRecords.push_back(rollups[level]);
+                rollupWords.resize(rollupWords.size() + words, 0);
+            }
+
+            addDelta(*reinterpret_cast<DeviceTable::Counters *>(&rollupWords[slot * words]), batch, delta);
+        }
+
+        // sketches need every value; records of the device form contiguous run of order
+        const uint32_t runEnd(runStart + delta.messageCount);
+        const MeasurementStats *stats(batch.getStats(delta));
+
+        for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+        {
+            if (stats[kind].count == 0)
+            {
+                continue;
+            }
+
+            QuantileSketch::Pending &sketch(device->pendingSketches[parity][kind]);
+
+            for (uint32_t position(runStart); position < runEnd; ++position)
+            {
+                int32_t key(0);
+                uint32_t count(0);
+
+                if (batch.isPresent(kind, order[position]) && !sketch.add(batch.getValue(kind, order[position]), key, count))
+                {
+                    std::lock_guard<std::mutex> lock(overflowLock);
+                    sketchOverflows[parity].push_back(SketchOverflow{&device->sketches[kind], key, count});
+                }
+            }
+        }
+
+        runStart = runEnd;
     }
-    else
+
+    for (size_t slot(0); slot < rollupRecords.size(); ++slot)
     {
-        device->second.deviceMessageCount++;
+        mergeCounters(*rollupRecords[slot]->pending[parity], *reinterpret_cast<const DeviceTable::Counters *>(&rollupWords[slot * words]));
     }
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to add new records to storage: %s", ex.what());
+}
 
-    addMeasurementRecord(newRecord, device, key_current, id_current);
-    addMeasurementRecord(newRecord, device, key_voltage, id_voltage);
-    addMeasurementRecord(newRecord, device, key_temperature, id_temperature);
+////////////////////////////////////////////////////////////////////////////////
+std::string DataStorage::getResults()
+{
+    std::stringstream ss;
+    const uint64_t total(forEachSnapshot([&ss](const DeviceTable::DeviceRecord &device)
+                                         { writeSnapshot(ss, device); }));
+
+    ss << "grandTotal: " << total << std::endl;
+
+    return ss.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DataStorage::evict(const std::vector<uint32_t> &deviceIds, std::ostream *archive)
+try
+{
+    std::lock_guard<std::mutex> lock(snapshotLock);
+    std::vector<std::pair<uint32_t, DeviceTable::DeviceRecord *>> removed;
+
+    for (const uint32_t deviceId : deviceIds)
+    {
+        // name goes first; writer inserting the device again after its removal adds the name back
+        nameIndex.remove(deviceId);
+        DeviceTable::DeviceRecord *device(dataStore.remove(deviceId));
+
+        if (device != nullptr)
+        {
+            removed.emplace_back(deviceId, device);
+        }
+    }
+
+    dataStore.beginReclaim();
+
+    // every writer that found removed record or used replaced index is inside the closed epoch,
+    // since writers of the epoch before were waited for by the previous flip
+    const unsigned parity(closeEpoch());
+
+    // closed epoch is folded completely, so the next snapshot still contains whole epochs only
+    dataStore.forEach([parity](DeviceTable::DeviceRecord &device)
+                      { foldPending(device, parity); });
+
+    // rollups keep counters of evicted devices
+    rollupStore.forEach([parity](DeviceTable::DeviceRecord &rollup)
+                        { foldPending(rollup, parity); });
+
+    dataStore.finishReclaim();
+
+    for (const auto &entry : removed)
+    {
+        DeviceTable::DeviceRecord &device(*entry.second);
+        foldPending(device, parity);
+
+        if (archive != nullptr)
+        {
+            writeSnapshot(*archive, device);
+        }
+
+        dataStore.release(entry.first, device);
+    }
 }
 catch (const std::exception &ex)
 {
-    LOG_FMT_ERR("unable to add new record to storage: %s", ex.what());
+    LOG_FMT_ERR("unable to evict devices from storage: %s", ex.what());
 }
+
 ////////////////////////////////////////////////////////////////////////////////
-void DataStorage::addMeasurementRecord(
-    AbstractAPI::pJsonMessage_t newRecord,
-    std::map<DataStorage::deviceId, DataStorage::DeviceRecord>::iterator device,
-    const std::string &key,
-    const valueId &id)
+bool DataStorage::checkpoint(const std::string &file, uint64_t &epoch)
+try
 {
-    // check if new message has measured value present
-    if (newRecord->HasMember(key.c_str()))
+    const std::chrono::steady_clock::time_point checkpointStart(std::chrono::steady_clock::now());
+
+    if (!createParentDirectories(file))
+    {
+        LOG_FMT_ERR("unable to create directory of checkpoint %s; %s", file.c_str(), strerror(errno));
+        return false;
+    }
+
+    const std::string temporary(file + ".tmp");
+    const int descriptor(open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640));
+
+    if (descriptor < 0)
     {
-        // check if measured value is already registered
-        auto value(device->second.measurements.find(id));
-        if (value == device->second.measurements.end())
+        LOG_FMT_ERR("unable to create checkpoint %s; %s", temporary.c_str(), strerror(errno));
+        return false;
+    }
+
+    // entries are written in chunks while devices are visited, so memory does not grow with device count
+    const size_t chunkEntries(256);
+    const size_t countersSize(DeviceTable::Counters::getSize());
+    const size_t sketchesSize(MeasurementCatalog::size() * sizeof(QuantileSketch));
+    const size_t entrySize(getEntrySize());
+    std::vector<char> entries;
+    entries.reserve(chunkEntries * entrySize);
+    std::string names;
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    bool written(writeAll(descriptor, reinterpret_cast<const char *>(&header), sizeof(header)));
+    int error(errno);
+
+    const auto flush = [descriptor, entrySize, &entries, &header, &written, &error](void)
+    {
+        if (written && !writeAll(descriptor, entries.data(), entries.size()))
         {
-            device->second.measurements.insert(std::make_pair(id, Value(key)));
+            written = false;
+            error = errno;
         }
-        else
+
+        header.entryCount += entries.size() / entrySize;
+        entries.clear();
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(snapshotLock);
+
+        // writers of later epochs add values to pending sketches only, so folded sketches are as of the epoch
+        epoch = writeEpoch.getCurrent();
+        const unsigned parity(closeEpoch());
+
+        dataStore.forEach([parity, countersSize, sketchesSize, entrySize, &entries, &names, &flush](DeviceTable::DeviceRecord &device)
+                          {
+                              foldPending(device, parity);
+
+                              if (device.snapshot->deviceMessageCount == 0)
+                              {
+                                  return;
+                              }
+
+                              char *entry(appendEntry(entries, names, device, entryDevice));
+                              memcpy(entry + sizeof(CheckpointEntry) + countersSize, device.sketches, sketchesSize);
+
+                              if (entries.size() == chunkEntries * entrySize)
+                              {
+                                  flush();
+                              }
+                          });
+
+        // rollups have no sketches; their counters are cut at the same epoch as device counters
+        rollupStore.forEach([parity, entrySize, &entries, &names, &flush](DeviceTable::DeviceRecord &rollup)
+                            {
+                                foldPending(rollup, parity);
+
+                                if (rollup.snapshot->deviceMessageCount == 0)
+                                {
+                                    return;
+                                }
+
+                                appendEntry(entries, names, rollup, entryRollup);
+
+                                if (entries.size() == chunkEntries * entrySize)
+                                {
+                                    flush();
+                                }
+                            });
+
+        flush();
+        header.totalCount = totalCount;
+    }
+
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.epoch = epoch;
+    header.entrySize = entrySize;
+    header.catalogFingerprint = MeasurementCatalog::getFingerprint();
+    header.relativeAccuracy = QuantileSketch::getRelativeAccuracy();
+    header.namesOffset = sizeof(header) + header.entryCount * entrySize;
+    header.namesSize = names.size();
+
+    // old checkpoint is replaced only by complete and durable new one
+    if (written && (!writeAll(descriptor, names.data(), names.size()) ||
+                    (pwrite(descriptor, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) ||
+                    (fdatasync(descriptor) != 0)))
+    {
+        written = false;
+        error = errno;
+    }
+
+    close(descriptor);
+
+    if (!written || (rename(temporary.c_str(), file.c_str()) != 0))
+    {
+        LOG_FMT_ERR("unable to write checkpoint %s; %s", file.c_str(), strerror(written ? errno : error));
+        unlink(temporary.c_str());
+        return false;
+    }
+
+    const size_t separator(file.rfind('/'));
+    const std::string directory((separator == std::string::npos) ? std::string(".") : file.substr(0, std::max<size_t>(separator, 1)));
+    const int directoryDescriptor(open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+
+    if ((directoryDescriptor < 0) || (fsync(directoryDescriptor) != 0))
+    {
+        LOG_FMT_ERR("unable to sync directory of checkpoint %s; %s", file.c_str(), strerror(errno));
+
+        if (directoryDescriptor >= 0)
         {
-            value->second.measurementCount++;
+            close(directoryDescriptor);
         }
+
+        return false;
     }
+
+    close(directoryDescriptor);
+
+    const double elapsed(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - checkpointStart).count());
+    LOG_FMT_INF("checkpoint of epoch %" PRIu64 " with %" PRIu64 " devices and rollups written to %s in %.3f ms",
+                epoch, header.entryCount, file.c_str(), elapsed);
+    return true;
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to write checkpoint: %s", ex.what());
+    return false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-std::string DataStorage::getResults()
+bool DataStorage::restore(const std::string &file, uint64_t &nextEpoch)
+try
+{
+    const std::chrono::steady_clock::time_point restoreStart(std::chrono::steady_clock::now());
+    nextEpoch = 0;
+    const int descriptor(open(file.c_str(), O_RDONLY | O_CLOEXEC));
+
+    if (descriptor < 0)
+    {
+        if (errno == ENOENT)
+        {
+            return true;
+        }
+
+        LOG_FMT_ERR("unable to open checkpoint %s; %s", file.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct stat status;
+
+    if ((fstat(descriptor, &status) != 0) || (static_cast<uint64_t>(status.st_size) < sizeof(CheckpointHeader)))
+    {
+        LOG_FMT_ERR("checkpoint %s is too short", file.c_str());
+        close(descriptor);
+        return false;
+    }
+
+    const size_t fileSize(static_cast<size_t>(status.st_size));
+    void *mapping(mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, descriptor, 0));
+    close(descriptor);
+
+    if (mapping == MAP_FAILED)
+    {
+        LOG_FMT_ERR("unable to map checkpoint %s; %s", file.c_str(), strerror(errno));
+        return false;
+    }
+
+    const char *data(static_cast<const char *>(mapping));
+    const size_t entrySize(getEntrySize());
+    CheckpointHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    // counters are stored by measurement index; other catalog would assign them to wrong measurements
+    if ((memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) == 0) && (header.catalogFingerprint != MeasurementCatalog::getFingerprint()))
+    {
+        LOG_FMT_ERR("checkpoint %s was written with different measurement catalog", file.c_str());
+        munmap(mapping, fileSize);
+        return false;
+    }
+
+    if ((memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0) || (header.entrySize != entrySize) ||
+        (header.namesOffset != sizeof(header) + header.entryCount * entrySize) ||
+        (header.namesOffset + header.namesSize != fileSize))
+    {
+        LOG_FMT_ERR("file %s is not a checkpoint of this build", file.c_str());
+        munmap(mapping, fileSize);
+        return false;
+    }
+
+    // sketch buckets are keyed by accuracy; mixing accuracies would corrupt quantiles
+    if (std::fabs(header.relativeAccuracy - QuantileSketch::getRelativeAccuracy()) > 1e-12)
+    {
+        LOG_FMT_ERR("checkpoint %s was written with sketch accuracy %g", file.c_str(), header.relativeAccuracy);
+        munmap(mapping, fileSize);
+        return false;
+    }
+
+    const char *names(data + header.namesOffset);
+    bool valid(true);
+    bool fits(true);
+    // restored names are indexed at once, which costs a fraction of inserting them one by one
+    std::vector<uint32_t> restoredIds;
+    restoredIds.reserve(header.entryCount);
+
+    for (uint64_t position(0); position < header.entryCount; ++position)
+    {
+        // entries are packed after header; copying avoids relying on alignment of the mapping
+        const char *entryData(data + sizeof(header) + position * entrySize);
+        const CheckpointEntry *entry(reinterpret_cast<const CheckpointEntry *>(entryData));
+        const char *counters(entryData + sizeof(CheckpointEntry));
+        uint64_t nameOffset;
+        uint32_t nameLength;
+        uint32_t kind;
+        memcpy(&nameOffset, &entry->nameOffset, sizeof(nameOffset));
+        memcpy(&nameLength, &entry->nameLength, sizeof(nameLength));
+        memcpy(&kind, &entry->kind, sizeof(kind));
+
+        if ((nameOffset > header.namesSize) || (nameLength > header.namesSize - nameOffset))
+        {
+            valid = false;
+            break;
+        }
+
+        const char *name(names + nameOffset);
+        const uint32_t deviceId(NameDictionary::intern(name, nameLength, fnv::Fnv64a(name, nameLength)));
+        DeviceTable::DeviceRecord *device(nullptr);
+        bool inserted(false);
+
+        if ((deviceId != NameDictionary::noId) && ((kind != entryRollup) || NameDictionary::pin(deviceId)))
+        {
+            device = ((kind == entryRollup) ? rollupStore : dataStore).insert(deviceId, NameDictionary::getName(deviceId),
+                                                                              NameDictionary::getLength(deviceId), inserted);
+        }
+
+        if (device == nullptr)
+        {
+            fits = false;
+            break;
+        }
+
+        memcpy(static_cast<void *>(device->snapshot), counters, DeviceTable::Counters::getSize());
+
+        // devices find their rollups again when they are resolved by first batch after restart
+        if (kind == entryRollup)
+        {
+            continue;
+        }
+
+        memcpy(device->sketches, counters + DeviceTable::Counters::getSize(), MeasurementCatalog::size() * sizeof(QuantileSketch));
+        device->lastSeen.store(LivenessTracker::getTime(), std::memory_order_relaxed);
+
+        if (inserted)
+        {
+            LivenessTracker::track(deviceId, *device);
+            restoredIds.push_back(deviceId);
+        }
+    }
+
+    munmap(mapping, fileSize);
+    nameIndex.insert(restoredIds);
+
+    if (!valid)
+    {
+        LOG_FMT_ERR("checkpoint %s contains name outside of its names", file.c_str());
+        return false;
+    }
+
+    if (!fits)
+    {
+        LOG_FMT_ERR("devices of checkpoint %s do not fit in memory budget", file.c_str());
+        return false;
+    }
+
+    nextEpoch = header.epoch + 1;
+    totalCount = header.totalCount;
+    resumeEpoch(header.epoch);
+
+    const double elapsed(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - restoreStart).count());
+    LOG_FMT_INF("restored %" PRIu64 " devices and rollups of epoch %" PRIu64 " from checkpoint %s in %.3f ms",
+                header.entryCount, header.epoch, file.c_str(), elapsed);
+    return true;
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to restore checkpoint: %s", ex.what());
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DataStorage::resumeEpoch(const uint64_t epoch)
+{
+    writeEpoch.resume(epoch);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string DataStorage::getQuantiles()
 {
-    std::lock_guard<std::mutex> lock(dataStoreLock);
     std::stringstream ss;
+    std::vector<QuantileSketch::merged_t> fleet(MeasurementCatalog::size());
 
-    for (auto &device : dataStore)
+    // writers add values to pending sketches only, so sketches are read once the open epoch is folded
+    forEachSnapshot([&ss, &fleet](const DeviceTable::DeviceRecord &device)
+                    {
+                        bool reported(false);
+
+                        for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+                        {
+                            const QuantileSketch &sketch(device.sketches[kind]);
+
+                            if (sketch.getCount() == 0)
+                            {
+                                continue;
+                            }
+
+                            if (!reported)
+                            {
+                                ss.write(device.name, device.nameLength);
+                                ss << ':' << ' ';
+                                reported = true;
+                            }
+
+                            writeQuantiles(ss, MeasurementCatalog::getKey(kind), sketch.getQuantile(0.5),
+                                           sketch.getQuantile(0.95), sketch.getQuantile(0.99));
+                            sketch.mergeInto(fleet[kind]);
+                        }
+
+                        if (reported)
+                        {
+                            ss << std::endl;
+                        }
+                    });
+
+    ss << "fleet: ";
+
+    for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
     {
-        ss << device.second.name << ':' << " deviceTotal: " << device.second.deviceMessageCount << "; ";
+        if (!fleet[kind].empty())
+        {
+            writeQuantiles(ss, MeasurementCatalog::getKey(kind), QuantileSketch::getQuantile(fleet[kind], 0.5),
+                           QuantileSketch::getQuantile(fleet[kind], 0.95), QuantileSketch::getQuantile(fleet[kind], 0.99));
+        }
+    }
 
-        for (auto &i : device.second.measurements)
+    ss << std::endl;
+
+    return ss.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool DataStorage::getRollup(const std::string &prefix, std::string &result)
+{
+    NameDictionary::Guard names;
+    uint32_t prefixId(0);
+
+    if (!NameDictionary::find(prefix.data(), static_cast<uint32_t>(prefix.size()), fnv::Fnv64a(prefix.data(), prefix.size()), prefixId))
+    {
+        return false;
+    }
+
+    DeviceTable::DeviceRecord *rollup(rollupStore.find(prefixId));
+
+    if (rollup == nullptr)
+    {
+        return false;
+    }
+
+    DeviceTable::CountersBuffer buffer;
+    DeviceTable::Counters &counters(buffer.get());
+
+    {
+        std::lock_guard<std::mutex> lock(snapshotLock);
+        readCurrent(*rollup, counters);
+    }
+
+    std::stringstream ss;
+    ss << prefix << ':' << " total: " << counters.deviceMessageCount << "; ";
+    writeMeasurements(ss, counters);
+    ss << std::endl;
+    result = ss.str();
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool DataStorage::getDevice(const std::string &name, std::string &result)
+{
+    NameDictionary::Guard names;
+    uint32_t deviceId(0);
+
+    if (!NameDictionary::find(name.data(), static_cast<uint32_t>(name.size()), fnv::Fnv64a(name.data(), name.size()), deviceId))
+    {
+        return false;
+    }
+
+    DeviceTable::CountersBuffer buffer;
+    DeviceTable::Counters &counters(buffer.get());
+
+    {
+        // evicted record is not released while snapshot lock is held
+        std::lock_guard<std::mutex> lock(snapshotLock);
+        DeviceTable::DeviceRecord *device(dataStore.find(deviceId));
+
+        if (device == nullptr)
+        {
+            return false;
+        }
+
+        readCurrent(*device, counters);
+    }
+
+    std::stringstream ss;
+    ss << name << ':' << " deviceTotal: " << counters.deviceMessageCount << "; ";
+    writeMeasurements(ss, counters);
+    ss << std::endl;
+    result = ss.str();
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool DataStorage::listDevices(const std::string &prefix, const std::string &from, const std::string &to,
+                              const std::string &cursor, const size_t limit, std::string &result)
+{
+    // listing starts at the greatest of its lower bounds; only the cursor itself was listed already
+    std::string lower(std::max(prefix, from));
+    bool exclusive(false);
+    std::string after;
+
+    if (!decodeCursor(cursor, after))
+    {
+        return false;
+    }
+
+    if (!cursor.empty() && (after >= lower))
+    {
+        lower.swap(after);
+        exclusive = true;
+    }
+
+    std::vector<uint32_t> deviceIds;
+    deviceIds.reserve(limit);
+    DeviceTable::CountersBuffer buffer;
+    DeviceTable::Counters &counters(buffer.get());
+    std::stringstream ss;
+    size_t listed(0);
+
+    {
+        // index lock is released before counters are read; evicted records stay until snapshot lock is released
+        std::lock_guard<std::mutex> lock(snapshotLock);
+        const bool more(nameIndex.list(lower, exclusive, prefix, to, limit, deviceIds));
+
+        for (const uint32_t deviceId : deviceIds)
+        {
+            DeviceTable::DeviceRecord *device(dataStore.find(deviceId));
+
+            if (device == nullptr)
+            {
+                continue;
+            }
+
+            readCurrent(*device, counters);
+            ss.write(device->name, device->nameLength);
+            ss << ':' << " deviceTotal: " << counters.deviceMessageCount << "; ";
+            writeMeasurements(ss, counters);
+            ss << std::endl;
+            listed++;
+        }
+
+        ss << "devices: " << listed << "; ";
+
+        if (more && !deviceIds.empty())
         {
-            ss << i.second.name << ": " << i.second.measurementCount << "; ";
+            const uint32_t last(deviceIds.back());
+            ss << "next: " << encodeCursor(NameDictionary::getName(last), NameDictionary::getLength(last)) << "; ";
         }
 
         ss << std::endl;
     }
 
-    ss << "grandTotal: " << totalCount << std::endl;
+    result = ss.str();
+    return true;
+}
 
-    return ss.str();
+////////////////////////////////////////////////////////////////////////////////
+void DataStorage::writeSnapshot(std::ostream &out, const DeviceTable::DeviceRecord &device)
+{
+    const DeviceTable::Counters &snapshot(*device.snapshot);
+
+    // devices inserted after the snapshot was taken are not reported
+    if (snapshot.deviceMessageCount == 0)
+    {
+        return;
+    }
+
+    out.write(device.name, device.nameLength);
+    out << ':' << " deviceTotal: " << snapshot.deviceMessageCount << "; ";
+    writeMeasurements(out, snapshot);
+    out << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DataStorage::readCurrent(DeviceTable::DeviceRecord &record, DeviceTable::Counters &counters)
+{
+    // pending counters are read word by word while writers update them
+    counters.copy(*record.snapshot);
+    mergeCounters(counters, *record.pending[0]);
+    mergeCounters(counters, *record.pending[1]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DataStorage::writeMeasurements(std::ostream &out, const DeviceTable::Counters &counters)
+{
+    // measurements never received are not reported
+    for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+    {
+        const MeasurementStats &stats(counters.getMeasurements()[kind]);
+
+        if (stats.count == 0)
+        {
+            continue;
+        }
+
+        const char *key(MeasurementCatalog::getKey(kind));
+        out << key << ": " << stats.count << "; "
+            << key << ".min: " << stats.minimum << "; "
+            << key << ".max: " << stats.maximum << "; "
+            << key << ".mean: " << stats.mean << "; "
+            << key << ".variance: " << stats.getVariance() << "; "
+            << key << ".last: " << stats.last << "; ";
+
+        for (unsigned fault(0); fault < MeasurementCatalog::getFaultCount(); ++fault)
+        {
+            if (MeasurementCatalog::getFaultKind(fault) == kind)
+            {
+                out << MeasurementCatalog::getFaultKey(fault) << ": " << counters.getFaultCounts()[fault] << "; ";
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DataStorage::writeQuantiles(std::ostream &out, const char *key, const double p50, const double p95, const double p99)
+{
+    out << key << ".p50: " << p50 << "; "
+        << key << ".p95: " << p95 << "; "
+        << key << ".p99: " << p99 << "; ";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DataStorage::foldPending(DeviceTable::DeviceRecord &device, const unsigned parity)
+{
+    // no writer uses closed epoch until next flip, so pending counters are read and reset at once
+    DeviceTable::PendingCounters &pending(*device.pending[parity]);
+
+    if (pending.deviceMessageCount.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+
+    // pending sketch of a kind holds values only if its statistics do
+    for (unsigned kind(0); (device.sketches != nullptr) && (kind < MeasurementCatalog::size()); ++kind)
+    {
+        if (pending.getMeasurements()[kind].count.load(std::memory_order_relaxed) != 0)
+        {
+            device.pendingSketches[parity][kind].mergeInto(device.sketches[kind]);
+        }
+    }
+
+    mergeCounters(*device.snapshot, pending);
+    pending.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned DataStorage::closeEpoch(void)
+{
+    const unsigned parity(writeEpoch.flip());
+    totalCount += pendingTotal[parity].exchange(0, std::memory_order_relaxed);
+
+    // sketches of evicted records are still valid, since records are released only after this
+    std::vector<SketchOverflow> overflows;
+
+    {
+        std::lock_guard<std::mutex> lock(overflowLock);
+        overflows.swap(sketchOverflows[parity]);
+    }
+
+    for (const auto &overflow : overflows)
+    {
+        overflow.sketch->addKey(overflow.key, overflow.count);
+    }
+
+    return parity;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DataStorage::addDelta(DeviceTable::Counters &counters, const RecordBatch &batch, const RecordBatch::DeviceDelta &delta)
+{
+    const MeasurementStats *stats(batch.getStats(delta));
+    const uint32_t *faultCounts(batch.getFaultCounts(delta));
+    MeasurementStats *measurements(counters.getMeasurements());
+    uint64_t *faults(counters.getFaultCounts());
+    counters.deviceMessageCount += delta.messageCount;
+
+    for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+    {
+        measurements[kind].merge(stats[kind]);
+    }
+
+    for (unsigned fault(0); fault < MeasurementCatalog::getFaultCount(); ++fault)
+    {
+        faults[fault] += faultCounts[fault];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DataStorage::addDelta(DeviceTable::PendingCounters &pending, const RecordBatch &batch, const RecordBatch::DeviceDelta &delta)
+{
+    const MeasurementStats *stats(batch.getStats(delta));
+    const uint32_t *faultCounts(batch.getFaultCounts(delta));
+    AtomicMeasurementStats *measurements(pending.getMeasurements());
+    std::atomic<uint64_t> *faults(pending.getFaultCounts());
+    pending.deviceMessageCount.fetch_add(delta.messageCount, std::memory_order_relaxed);
+
+    for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+    {
+        measurements[kind].add(stats[kind]);
+    }
+
+    // faults are rare; zero counts are not written, so they do not contend
+    for (unsigned fault(0); fault < MeasurementCatalog::getFaultCount(); ++fault)
+    {
+        if (faultCounts[fault] != 0)
+        {
+            faults[fault].fetch_add(faultCounts[fault], std::memory_order_relaxed);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DataStorage::mergeCounters(DeviceTable::PendingCounters &target, const DeviceTable::Counters &source)
+{
+    AtomicMeasurementStats *measurements(target.getMeasurements());
+    std::atomic<uint64_t> *faults(target.getFaultCounts());
+    target.deviceMessageCount.fetch_add(source.deviceMessageCount, std::memory_order_relaxed);
+
+    for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+    {
+        measurements[kind].add(source.getMeasurements()[kind]);
+    }
+
+    for (unsigned fault(0); fault < MeasurementCatalog::getFaultCount(); ++fault)
+    {
+        if (source.getFaultCounts()[fault] != 0)
+        {
+            faults[fault].fetch_add(source.getFaultCounts()[fault], std::memory_order_relaxed);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DataStorage::mergeCounters(DeviceTable::Counters &target, const DeviceTable::PendingCounters &source)
+{
+    MeasurementStats *measurements(target.getMeasurements());
+    uint64_t *faults(target.getFaultCounts());
+    MeasurementStats stats;
+    target.deviceMessageCount += source.deviceMessageCount.load(std::memory_order_relaxed);
+
+    for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+    {
+        source.getMeasurements()[kind].get(stats);
+        measurements[kind].merge(stats);
+    }
+
+    for (unsigned fault(0); fault < MeasurementCatalog::getFaultCount(); ++fault)
+    {
+        faults[fault] += source.getFaultCounts()[fault].load(std::memory_order_relaxed);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint8_t DataStorage::resolveRollups(DeviceTable::DeviceRecord &device, DeviceTable::DeviceRecord *rollups[])
+{
+    // every delimiter ends one prefix level; the full name is never a rollup of itself
+    uint8_t rollupCount(0);
+
+    for (uint32_t length(0); (length < device.nameLength) && (rollupCount < rollupLevels); ++length)
+    {
+        if ((device.name[length] != rollupDelimiter) || (length == 0))
+        {
+            continue;
+        }
+
+        const uint32_t prefixId(NameDictionary::intern(device.name, length, fnv::Fnv64a(device.name, length)));
+        DeviceTable::DeviceRecord *rollup(rollupStore.find(prefixId));
+
+        // rollup keeps its prefix id even when device of the same name is evicted; id of such device
+        // being retired right now is refused and prefix gets a new id next batch
+        if ((rollup == nullptr) && (prefixId != NameDictionary::noId) && NameDictionary::pin(prefixId))
+        {
+            bool inserted(false);
+            rollup = rollupStore.insert(prefixId, NameDictionary::getName(prefixId), NameDictionary::getLength(prefixId), inserted);
+        }
+
+        // prefix refused by memory budget; levels found so far are used and resolution is repeated by next batch
+        if (rollup == nullptr)
+        {
+            return rollupCount;
+        }
+
+        rollups[rollupCount++] = rollup;
+    }
+
+    // writers resolving the device at once find the same records; only one of them publishes them
+    uint8_t state(DeviceTable::rollupsUnresolved);
+
+    if (device.rollupState.compare_exchange_strong(state, DeviceTable::rollupsPublishing, std::memory_order_relaxed))
+    {
+        std::copy(rollups, rollups + rollupCount, device.rollups);
+        device.rollupCount = rollupCount;
+        device.rollupState.store(DeviceTable::rollupsResolved, std::memory_order_release);
+    }
+
+    return rollupCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t DataStorage::getEntrySize(void)
+{
+    return sizeof(CheckpointEntry) + DeviceTable::Counters::getSize() + MeasurementCatalog::size() * sizeof(QuantileSketch);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+char *DataStorage::appendEntry(std::vector<char> &entries, std::string &names, const DeviceTable::DeviceRecord &record, const uint32_t kind)
+{
+    // rollups leave sketches zero
+    const size_t position(entries.size());
+    entries.resize(position + getEntrySize(), 0);
+    char *entryData(&entries[position]);
+    CheckpointEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.nameOffset = names.size();
+    entry.nameLength = record.nameLength;
+    entry.kind = kind;
+    memcpy(entryData, &entry, sizeof(entry));
+    memcpy(entryData + sizeof(entry), record.snapshot, DeviceTable::Counters::getSize());
+    names.append(record.name, record.nameLength);
+    return entryData;
 }
@@ -2,80 +2,337 @@
 #define DATASTORAGE_HPP
 
 #include "../apis/AbstractAPI.hpp"
-#include "fnv.hpp"
+#include "DeviceTable.hpp"
+#include "FlatHashMap.hpp"
+#include "NameIndex.hpp"
+#include "RecordBatch.hpp"
+#include "WriteEpoch.hpp"
 #include "Logger.hpp"
 #include <cinttypes>
 #include <iostream>
-#include <map>
 #include <memory>
+#include <mutex>
 #include <rapidjson/document.h>
 #include <rapidjson/ostreamwrapper.h>
 #include <rapidjson/writer.h>
+#include <atomic>
 #include <sstream>
-#include <mutex>
+#include <string>
+#include <vector>
 
 class DataStorage
 {
 public:
-    // we use fast non-cryptographic hash for instead if string for device/measured value identification
-    typedef fnv::fnv64_t deviceId;
-    typedef fnv::fnv64_t valueId;
+    // devices are identified by dense id of their interned name (NameDictionary)
+    typedef uint32_t deviceId;
+
+    /**
+     * @brief roll counters of every device up into prefixes of its name; must be called
+     * before any batch is added
+     *
+     * @param levels number of prefix levels (at most DeviceTable::maxRollupLevels); zero disables rollups
+     * @param delimiter character separating levels of device name, e.g. '-' in "site-rack-unit"
+     */
+    static void configureRollups(const unsigned levels, const char delimiter);
+
+    /**
+     * @brief add batch of records to the datastore; every device is updated once per batch;
+     * may be called from several threads at once, known devices are updated without locking
+     *
+     * @param batch records collected by message processor after RecordBatch::aggregate()
+     */
+    static void addBatch(const RecordBatch &batch);
+
+    /**
+     * @brief Get the Results object; results are consistent point in time snapshot
+     * taken without blocking writers
+     *
+     * @return std::string
+     */
+    static std::string getResults();
 
-    struct Value
+    /**
+     * @brief fold pending counters of closed write epoch and call function with snapshot of every
+     * device; snapshot is consistent point in time view taken without blocking writers
+     *
+     * @param function callable accepting (const DeviceTable::DeviceRecord &device); counters are in device.snapshot
+     * @return uint64_t total message count of snapshot
+     */
+    template <typename F>
+    static uint64_t forEachSnapshot(F function)
     {
-        Value(const std::string &name) : name(name), measurementCount(1) {}
-        std::string name;
-        uint64_t measurementCount;
+        std::lock_guard<std::mutex> lock(snapshotLock);
+
+        // writers continue in new epoch while counters of the closed one are folded into snapshot
+        const unsigned parity(closeEpoch());
+
+        dataStore.forEach([&function, parity](DeviceTable::DeviceRecord &device)
+                          {
+                              foldPending(device, parity);
+                              function(static_cast<const DeviceTable::DeviceRecord &>(device));
+                          });
+
+        rollupStore.forEach([parity](DeviceTable::DeviceRecord &rollup)
+                            { foldPending(rollup, parity); });
+
+        return totalCount;
+    }
+
+    /**
+     * @brief Get median, 95th and 99th percentile of every measurement per device and
+     * over all devices as of new snapshot; values are within configured relative accuracy
+     *
+     * @return std::string
+     */
+    static std::string getQuantiles();
+
+    /**
+     * @brief Get current counters summed over all devices rolled up into given name prefix;
+     * cost does not depend on number of devices
+     *
+     * @param prefix name prefix of configured level, e.g. "site" or "site-rack"
+     * @param result output counters in results format
+     * @return true on success
+     * @return false if no device was rolled up into prefix
+     */
+    static bool getRollup(const std::string &prefix, std::string &result);
+
+    /**
+     * @brief Get current counters of one device; device is found by name hash, so cost does not
+     * depend on number of devices
+     *
+     * @param name device name
+     * @param result output counters in results format
+     * @return true on success
+     * @return false if device is not stored
+     */
+    static bool getDevice(const std::string &name, std::string &result);
+
+    /**
+     * @brief list current counters of devices in name order, one page at a time; cost depends
+     * on page size, not on number of devices
+     *
+     * @param prefix only devices whose name starts with prefix; empty lists all
+     * @param from first listed name; empty starts at the first name
+     * @param to names from this one on are not listed; empty is unlimited
+     * @param cursor "next" value of previous page; listing continues after its last device
+     * @param limit maximum number of devices in page
+     * @param result output counters in results format followed by device count and "next" cursor
+     * if more devices follow
+     * @return true on success
+     * @return false if cursor is malformed
+     */
+    static bool listDevices(const std::string &prefix, const std::string &from, const std::string &to,
+                            const std::string &cursor, const size_t limit, std::string &result);
+
+    /**
+     * @brief remove devices and recycle their records; waits until writers that may still
+     * update them leave their epoch. Final counters are folded and optionally archived.
+     *
+     * @param deviceIds ids of removed devices; unknown ids are ignored
+     * @param archive stream receiving final counters of removed devices in results format or nullptr
+     */
+    static void evict(const std::vector<uint32_t> &deviceIds, std::ostream *archive);
+
+    /**
+     * @brief write counters and sketches of all devices as of the end of one write epoch
+     * to checkpoint file; writers are not blocked while sketches are collected
+     *
+     * The file is a flat array of entries (counter block and sketches copied as they are
+     * in memory) followed by device names, so restore copies entries straight from the
+     * mapped file. Entry size follows from the measurement catalog, whose fingerprint is
+     * recorded in the header. It is written under temporary name, synced and renamed.
+     *
+     * @param file checkpoint file; missing directories are created
+     * @param epoch output last write epoch contained in checkpoint
+     * @return true on success
+     * @return false on I/O error; previous checkpoint is kept
+     */
+    static bool checkpoint(const std::string &file, uint64_t &epoch);
+
+    /**
+     * @brief load checkpoint into empty storage; must be called before any batch is added
+     *
+     * @param file checkpoint file; missing file leaves storage empty
+     * @param nextEpoch output first write epoch not contained in checkpoint; zero without checkpoint
+     * @return true on success
+     * @return false if file can not be read or was written with different sketch accuracy or measurement catalog
+     */
+    static bool restore(const std::string &file, uint64_t &nextEpoch);
+
+    /**
+     * @brief continue write epochs after given one, so batches added from now on are ordered
+     * after everything replayed; must be called before writers start
+     *
+     * @param epoch latest epoch found in checkpoint or write-ahead log
+     */
+    static void resumeEpoch(const uint64_t epoch);
+
+private:
+    struct CheckpointHeader
+    {
+        char magic[8];
+        uint64_t epoch;
+        uint64_t totalCount;
+        uint64_t entryCount;
+        // layout checks; checkpoint is read only by build with the same structures and accuracy
+        uint64_t entrySize;
+        uint64_t catalogFingerprint;
+        double relativeAccuracy;
+        uint64_t namesOffset;
+        uint64_t namesSize;
     };
 
-    struct DeviceRecord
+    // entry header; followed by snapshot counter block and sketch of every measurement kind
+    struct CheckpointEntry
     {
-        DeviceRecord(const std::string &name) : name(name), deviceMessageCount(1) {}
-        std::string name;
-        uint64_t deviceMessageCount;
-        std::map<valueId, Value> measurements;
+        // name position in names blob
+        uint64_t nameOffset;
+        uint32_t nameLength;
+        // entryDevice or entryRollup
+        uint32_t kind;
     };
 
     /**
-     * @brief add new record to the datastore
+     * @brief write snapshot counters of device as one line of results; devices without
+     * messages in snapshot are skipped
      *
-     * @param newRecord
+     * @param out output stream
+     * @param device device record
      */
-    static void addRecord(AbstractAPI::pJsonMessage_t newRecord);
+    static void writeSnapshot(std::ostream &out, const DeviceTable::DeviceRecord &device);
 
     /**
-     * @brief Get the Results object
+     * @brief copy current counters of device or rollup: snapshot and counters of open epochs;
+     * snapshot lock must be held, so counters are not folded meanwhile
      *
-     * @return std::string
+     * @param record device or rollup record
+     * @param counters output counters
      */
-    static std::string getResults();
+    static void readCurrent(DeviceTable::DeviceRecord &record, DeviceTable::Counters &counters);
+
+    /**
+     * @brief write statistics and fault counters of measurements present in counters
+     *
+     * @param out output stream
+     * @param counters device or rollup counters
+     */
+    static void writeMeasurements(std::ostream &out, const DeviceTable::Counters &counters);
+
+    /**
+     * @brief write percentiles of one measurement in "key.pNN: value; " format
+     *
+     * @param out output stream
+     * @param key measurement key
+     * @param p50 median
+     * @param p95 95th percentile
+     * @param p99 99th percentile
+     */
+    static void writeQuantiles(std::ostream &out, const char *key, const double p50, const double p95, const double p99);
+
+    // values a pending sketch handed back to the writer; added to the sketch when their epoch is folded
+    struct SketchOverflow
+    {
+        QuantileSketch *sketch;
+        int32_t key;
+        uint32_t count;
+    };
+
+    /**
+     * @brief start new write epoch, wait for writers of the closed one and add its sketch overflows;
+     * snapshot lock must be held
+     *
+     * @return unsigned parity of closed epoch, whose pending counters are to be folded
+     */
+    static unsigned closeEpoch(void);
 
-private:
     /**
-     * @brief add measurement record to the database
-     *
-     * @param newRecord message that was read from API
-     * @param device iterator for device whose measurements should be updated
-     * @param key JSON key
-     * @param id hash of JSON key
-     */
-    static void addMeasurementRecord(
-        AbstractAPI::pJsonMessage_t newRecord,
-        std::map<DataStorage::deviceId, DataStorage::DeviceRecord>::iterator device,
-        const std::string &key,
-        const valueId &id);
-
-    static const std::string key_name;
-    static const std::string key_current;
-    static const std::string key_voltage;
-    static const std::string key_temperature;
-    static const valueId id_current;
-    static const valueId id_voltage;
-    static const valueId id_temperature;
-
-    static std::mutex dataStoreLock;
-    static std::map<deviceId, DeviceRecord> dataStore;
+     * @brief fold counters and sketch values written in closed epoch into device snapshot
+     *
+     * @param device device record
+     * @param parity parity of closed epoch
+     */
+    static void foldPending(DeviceTable::DeviceRecord &device, const unsigned parity);
+
+    /**
+     * @brief add counters of one device delta
+     *
+     * @param counters target counters
+     * @param batch aggregated batch of delta
+     * @param delta merged update of device
+     */
+    static void addDelta(DeviceTable::Counters &counters, const RecordBatch &batch, const RecordBatch::DeviceDelta &delta);
+
+    /**
+     * @brief add counters of one device delta to pending counters; safe to call concurrently
+     *
+     * @param pending target pending counters
+     * @param batch aggregated batch of delta
+     * @param delta merged update of device
+     */
+    static void addDelta(DeviceTable::PendingCounters &pending, const RecordBatch &batch, const RecordBatch::DeviceDelta &delta);
+
+    /**
+     * @brief add counters to pending counters; safe to call concurrently
+     *
+     * @param target target pending counters
+     * @param source added counters
+     */
+    static void mergeCounters(DeviceTable::PendingCounters &target, const DeviceTable::Counters &source);
+
+    /**
+     * @brief add pending counters that came after counters of target
+     *
+     * @param target target counters
+     * @param source added pending counters
+     */
+    static void mergeCounters(DeviceTable::Counters &target, const DeviceTable::PendingCounters &source);
+
+    /**
+     * @brief find or create rollup records of name prefixes of device; complete resolution is cached
+     * in device record by the first writer that finishes it, so concurrent writers never wait
+     *
+     * @param device device record
+     * @param rollups output rollup records, shortest prefix first
+     * @return uint8_t number of rollup records
+     */
+    static uint8_t resolveRollups(DeviceTable::DeviceRecord &device, DeviceTable::DeviceRecord *rollups[]);
+
+    /**
+     * @brief Get size of checkpoint entry including counter block and sketches
+     *
+     * @return size_t
+     */
+    static size_t getEntrySize(void);
+
+    /**
+     * @brief append checkpoint entry with snapshot counters of record and zero sketches
+     *
+     * @param entries entries buffer
+     * @param names names blob receiving record name
+     * @param record device or rollup record
+     * @param kind entryDevice or entryRollup
+     * @return char* appended entry; valid until entries buffer grows
+     */
+    static char *appendEntry(std::vector<char> &entries, std::string &names, const DeviceTable::DeviceRecord &record, const uint32_t kind);
+
+    static DeviceTable dataStore;
+    // names of stored devices in order for listing; rollups are not included
+    static NameIndex nameIndex;
+    static WriteEpoch writeEpoch;
+    // serializes snapshot readers; writers never take it
+    static std::mutex snapshotLock;
+    static std::atomic<uint64_t> pendingTotal[2];
     static uint64_t totalCount;
+
+    // rollups of name prefixes keyed by interned prefix; counters are split by epoch like device counters
+    static DeviceTable rollupStore;
+    static unsigned rollupLevels;
+    static char rollupDelimiter;
+
+    // overflows of even and odd epochs; rare, so a lock does not slow writers down
+    static std::mutex overflowLock;
+    static std::vector<SketchOverflow> sketchOverflows[2];
 };
 
 #endif
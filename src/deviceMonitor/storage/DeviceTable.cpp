@@ -0,0 +1,379 @@
+#include "DeviceTable.hpp"
+#include "../runtime/MemoryArena.hpp"
+#include <cstring>
+#include <new>
+
+const unsigned DeviceTable::maxRollupLevels;
+const uint8_t DeviceTable::rollupsUnresolved;
+const uint8_t DeviceTable::rollupsPublishing;
+const uint8_t DeviceTable::rollupsResolved;
+DeviceTable::DeviceRecord DeviceTable::removed;
+
+////////////////////////////////////////////////////////////////////////////////
+size_t DeviceTable::Counters::getWords(void)
+{
+    static_assert(sizeof(MeasurementStats) % sizeof(uint64_t) == 0, "counter block is array of 64-bit words");
+    return 1 + MeasurementCatalog::size() * sizeof(MeasurementStats) / sizeof(uint64_t) + MeasurementCatalog::getFaultCount();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t DeviceTable::Counters::getSize(void)
+{
+    return getWords() * sizeof(uint64_t);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DeviceTable::Counters::clear(void)
+{
+    memset(static_cast<void *>(this), 0, getSize());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DeviceTable::Counters::copy(const Counters &source)
+{
+    memcpy(static_cast<void *>(this), &source, getSize());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t DeviceTable::PendingCounters::getWords(void)
+{
+    static_assert((sizeof(AtomicMeasurementStats) % sizeof(uint64_t) == 0) && (sizeof(std::atomic<uint64_t>) == sizeof(uint64_t)),
+                  "pending counter block is array of 64-bit words");
+    return 1 + MeasurementCatalog::size() * sizeof(AtomicMeasurementStats) / sizeof(uint64_t) + MeasurementCatalog::getFaultCount();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DeviceTable::PendingCounters::clear(void)
+{
+    deviceMessageCount.store(0, std::memory_order_relaxed);
+
+    for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+    {
+        getMeasurements()[kind].clear();
+    }
+
+    for (unsigned fault(0); fault < MeasurementCatalog::getFaultCount(); ++fault)
+    {
+        getFaultCounts()[fault].store(0, std::memory_order_relaxed);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+DeviceTable::DeviceTable(const bool sketches) : hasSketches(sketches)
+{
+    for (auto &stripe : stripes)
+    {
+        stripe.generations.emplace_back(new Index(16));
+        MemoryArena::charge(MemoryArena::subsystemDevices, getIndexSize(16), false);
+        stripe.index.store(stripe.generations.back().get(), std::memory_order_release);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+DeviceTable::DeviceRecord *DeviceTable::find(const uint64_t deviceId)
+{
+    return lookup(*getStripe(deviceId).index.load(std::memory_order_acquire), deviceId);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+DeviceTable::DeviceRecord *DeviceTable::insert(const uint64_t deviceId, const char *name, const uint32_t nameLength, bool &inserted)
+{
+    Stripe &stripe(getStripe(deviceId));
+    std::lock_guard<std::mutex> lock(stripe.lock);
+    inserted = false;
+
+    // device might have been inserted by other writer since lock-free lookup failed
+    DeviceRecord *record(lookup(*stripe.index.load(std::memory_order_relaxed), deviceId));
+
+    if (record != nullptr)
+    {
+        return record;
+    }
+
+    // tombstones lengthen probe sequences as much as live devices do; they are dropped only by rebuild,
+    // since reusing slot in place could pair its new device id with record read by concurrent lookup
+    if (4 * (stripe.live + stripe.tombstones + 1) > 3 * (stripe.index.load(std::memory_order_relaxed)->mask + 1))
+    {
+        if (!rebuild(stripe))
+        {
+            return nullptr;
+        }
+    }
+
+    if (!stripe.freeRecords.empty())
+    {
+        record = stripe.freeRecords.back();
+        stripe.freeRecords.pop_back();
+    }
+    else
+    {
+        if ((stripe.count % chunkSize == 0) && !allocateChunk(stripe))
+        {
+            return nullptr;
+        }
+
+        record = reinterpret_cast<DeviceRecord *>(&stripe.chunks.back()[(stripe.count % chunkSize) * getRecordWords()]);
+        stripe.count++;
+    }
+
+    record->name = name;
+    record->nameLength = nameLength;
+
+    publish(*stripe.index.load(std::memory_order_relaxed), deviceId, record);
+    stripe.live++;
+    inserted = true;
+    return record;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+DeviceTable::DeviceRecord *DeviceTable::remove(const uint64_t deviceId)
+{
+    Stripe &stripe(getStripe(deviceId));
+    std::lock_guard<std::mutex> lock(stripe.lock);
+    const Index &index(*stripe.index.load(std::memory_order_relaxed));
+
+    for (size_t slot(hashMix(deviceId) & index.mask);; slot = (slot + 1) & index.mask)
+    {
+        DeviceRecord *record(index.slots[slot].record.load(std::memory_order_relaxed));
+
+        if (record == nullptr)
+        {
+            return nullptr;
+        }
+
+        if ((record != &removed) && (index.slots[slot].deviceId.load(std::memory_order_relaxed) == deviceId))
+        {
+            // slot keeps device id and stays occupied, so probe sequences passing through it stay intact
+            index.slots[slot].record.store(&removed, std::memory_order_release);
+            stripe.live--;
+            stripe.tombstones++;
+            return record;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DeviceTable::release(const uint64_t deviceId, DeviceRecord &record)
+{
+    Stripe &stripe(getStripe(deviceId));
+    std::lock_guard<std::mutex> lock(stripe.lock);
+
+    record.pending[0]->clear();
+    record.pending[1]->clear();
+    record.snapshot->clear();
+
+    for (unsigned kind(0); hasSketches && (kind < MeasurementCatalog::size()); ++kind)
+    {
+        // pending sketches were merged by the fold before release, which left only their windows set
+        record.sketches[kind] = QuantileSketch();
+        new (&record.pendingSketches[0][kind]) QuantileSketch::Pending();
+        new (&record.pendingSketches[1][kind]) QuantileSketch::Pending();
+    }
+
+    record.rollupCount = 0;
+    record.rollupState.store(rollupsUnresolved, std::memory_order_relaxed);
+    record.lastSeen.store(0, std::memory_order_relaxed);
+    record.name = nullptr;
+    record.nameLength = 0;
+    stripe.freeRecords.push_back(&record);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DeviceTable::beginReclaim(void)
+{
+    for (auto &stripe : stripes)
+    {
+        std::lock_guard<std::mutex> lock(stripe.lock);
+        stripe.reclaimable = stripe.generations.size() - 1;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DeviceTable::finishReclaim(void)
+{
+    for (auto &stripe : stripes)
+    {
+        std::lock_guard<std::mutex> lock(stripe.lock);
+
+        // generations are only appended, so marked ones are still the first
+        for (size_t generation(0); generation < stripe.reclaimable; ++generation)
+        {
+            MemoryArena::discharge(MemoryArena::subsystemDevices, getIndexSize(stripe.generations[generation]->mask + 1));
+        }
+
+        stripe.generations.erase(stripe.generations.begin(), stripe.generations.begin() + static_cast<std::ptrdiff_t>(stripe.reclaimable));
+        stripe.reclaimable = 0;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t DeviceTable::size(void)
+{
+    size_t count(0);
+
+    for (auto &stripe : stripes)
+    {
+        std::lock_guard<std::mutex> lock(stripe.lock);
+        count += stripe.live;
+    }
+
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t DeviceTable::memoryUsage(void)
+{
+    size_t bytes(sizeof(stripes));
+
+    for (auto &stripe : stripes)
+    {
+        std::lock_guard<std::mutex> lock(stripe.lock);
+
+        for (const auto &generation : stripe.generations)
+        {
+            bytes += (generation->mask + 1) * sizeof(Slot);
+        }
+
+        bytes += stripe.chunks.size() * chunkSize * getRecordWords() * sizeof(uint64_t);
+    }
+
+    return bytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+DeviceTable::DeviceRecord *DeviceTable::lookup(const Index &index, const uint64_t deviceId)
+{
+    for (size_t slot(hashMix(deviceId) & index.mask);; slot = (slot + 1) & index.mask)
+    {
+        // acquire pairs with release in publish(), so device id and record contents are visible
+        DeviceRecord *record(index.slots[slot].record.load(std::memory_order_acquire));
+
+        if (record == nullptr)
+        {
+            return nullptr;
+        }
+
+        if ((record != &removed) && (index.slots[slot].deviceId.load(std::memory_order_relaxed) == deviceId))
+        {
+            return record;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DeviceTable::publish(Index &index, const uint64_t deviceId, DeviceRecord *record)
+{
+    size_t slot(hashMix(deviceId) & index.mask);
+
+    while (index.slots[slot].record.load(std::memory_order_relaxed) != nullptr)
+    {
+        slot = (slot + 1) & index.mask;
+    }
+
+    index.slots[slot].deviceId.store(deviceId, std::memory_order_relaxed);
+    index.slots[slot].record.store(record, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool DeviceTable::rebuild(Stripe &stripe)
+{
+    const Index &previous(*stripe.index.load(std::memory_order_relaxed));
+    size_t capacity(16);
+
+    // at most half full after rebuild, so it is not repeated before the index grows or tombstones accumulate
+    while (capacity < 2 * (stripe.live + 1))
+    {
+        capacity *= 2;
+    }
+
+    // index that only drops tombstones replaces one at least as large, which is freed by next reclamation
+    if (!MemoryArena::charge(MemoryArena::subsystemDevices, getIndexSize(capacity), capacity > previous.mask + 1))
+    {
+        return false;
+    }
+
+    std::unique_ptr<Index> index(new Index(capacity));
+
+    for (size_t slot(0); slot <= previous.mask; ++slot)
+    {
+        DeviceRecord *record(previous.slots[slot].record.load(std::memory_order_relaxed));
+
+        if ((record != nullptr) && (record != &removed))
+        {
+            publish(*index, previous.slots[slot].deviceId.load(std::memory_order_relaxed), record);
+        }
+    }
+
+    stripe.index.store(index.get(), std::memory_order_release);
+    stripe.generations.push_back(std::move(index));
+    stripe.tombstones = 0;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool DeviceTable::allocateChunk(Stripe &stripe)
+{
+    const size_t recordWords(getRecordWords());
+    const size_t pendingWords(PendingCounters::getWords());
+    const size_t words(Counters::getWords());
+    const unsigned kindCount(MeasurementCatalog::size());
+    const size_t sketchWords(kindCount * sizeof(QuantileSketch) / sizeof(uint64_t));
+    const size_t pendingSketchWords(kindCount * sizeof(QuantileSketch::Pending) / sizeof(uint64_t));
+    // arena memory is zeroed; records, counter blocks and sketches are trivially destructible
+    uint64_t *chunk(static_cast<uint64_t *>(MemoryArena::allocate(MemoryArena::subsystemDevices, chunkSize * recordWords * sizeof(uint64_t))));
+
+    if (chunk == nullptr)
+    {
+        return false;
+    }
+
+    for (size_t index(0); index < chunkSize; ++index)
+    {
+        uint64_t *record(&chunk[index * recordWords]);
+        uint64_t *counters(record + (sizeof(DeviceRecord) + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        uint64_t *sketches(counters + 2 * pendingWords + words);
+        DeviceRecord &device(*new (record) DeviceRecord());
+        device.pending[0] = new (counters) PendingCounters();
+        device.pending[1] = new (counters + pendingWords) PendingCounters();
+        device.pending[0]->clear();
+        device.pending[1]->clear();
+        device.snapshot = new (counters + 2 * pendingWords) Counters();
+        device.sketches = hasSketches ? reinterpret_cast<QuantileSketch *>(sketches) : nullptr;
+        device.pendingSketches[0] = hasSketches ? reinterpret_cast<QuantileSketch::Pending *>(sketches + sketchWords) : nullptr;
+        device.pendingSketches[1] = hasSketches ? reinterpret_cast<QuantileSketch::Pending *>(sketches + sketchWords + pendingSketchWords) : nullptr;
+
+        for (unsigned kind(0); hasSketches && (kind < kindCount); ++kind)
+        {
+            new (&device.sketches[kind]) QuantileSketch();
+            new (&device.pendingSketches[0][kind]) QuantileSketch::Pending();
+            new (&device.pendingSketches[1][kind]) QuantileSketch::Pending();
+        }
+    }
+
+    stripe.chunks.push_back(chunk);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t DeviceTable::getIndexSize(const size_t capacity)
+{
+    return sizeof(Index) + capacity * sizeof(Slot);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t DeviceTable::getRecordWords(void) const
+{
+    static_assert(alignof(DeviceRecord) <= alignof(uint64_t) && alignof(QuantileSketch) <= alignof(uint64_t) &&
+                      alignof(QuantileSketch::Pending) <= alignof(uint64_t) && (sizeof(QuantileSketch) % sizeof(uint64_t) == 0) &&
+                      (sizeof(QuantileSketch::Pending) % sizeof(uint64_t) == 0),
+                  "records, counters and sketches are laid out in 64-bit words");
+    return (sizeof(DeviceRecord) + sizeof(uint64_t) - 1) / sizeof(uint64_t) + 2 * PendingCounters::getWords() + Counters::getWords() +
+           (hasSketches ? MeasurementCatalog::size() * (sizeof(QuantileSketch) + 2 * sizeof(QuantileSketch::Pending)) / sizeof(uint64_t) : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+DeviceTable::Stripe &DeviceTable::getStripe(const uint64_t deviceId)
+{
+    // index uses low bits of mixed id, stripe uses the top ones
+    return stripes[hashMix(deviceId) >> (64 - stripeBits)];
+}
@@ -0,0 +1,370 @@
+#ifndef DEVICETABLE_HPP
+#define DEVICETABLE_HPP
+
+#include "FlatHashMap.hpp"
+#include "MeasurementCatalog.hpp"
+#include "MeasurementStats.hpp"
+#include "QuantileSketch.hpp"
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief concurrent table of device records with lock-free updates of known devices
+ *
+ * Devices are split into stripes by device id. Every stripe has its own lock,
+ * open addressing index of (device id, record pointer) slots and records
+ * allocated in chunks that never move. Lookup takes no lock - index is published
+ * by atomic pointer and every slot by release store of its record pointer - so
+ * stripe lock is taken only when new device is inserted or removed. Rebuilt
+ * index replaces the old one, which is kept until the owner of the table
+ * confirms by beginReclaim() / finishReclaim() that no lookup started before
+ * the replacement is still running. Removed device leaves tombstone slot until
+ * the index is rebuilt; its record is recycled by release() once no writer can
+ * hold it anymore. Names point into NameDictionary and never move while their
+ * device is stored, so records including their names can be read by forEach()
+ * without any lock as well.
+ * Writers update pending counters and pending sketches of a record with atomic
+ * operations, so two writers updating the same device never wait for each other;
+ * snapshot counters and sketches are written only when a closed epoch is folded.
+ * Counter blocks and sketches are sized to MeasurementCatalog and placed right
+ * after their record in its chunk. Chunks come from MemoryArena, so insertion
+ * of a new device fails once the memory budget is reached.
+ */
+class DeviceTable final
+{
+public:
+    // maximum number of name prefix levels a device is rolled up into
+    static const unsigned maxRollupLevels = 4;
+
+    /**
+     * @brief header of counter block sized to measurement catalog
+     *
+     * Block is the header followed by statistics of every measurement kind and
+     * count of every fault, so a device pays only for measurements the catalog
+     * defines. Blocks are allocated by the table (or by CountersBuffer) and copied
+     * and cleared as a whole by copy() and clear(); the header alone is never copied.
+     */
+    struct Counters
+    {
+        uint64_t deviceMessageCount;
+
+        Counters() = default;
+        Counters(const Counters &) = delete;
+        Counters &operator=(const Counters &) = delete;
+
+        MeasurementStats *getMeasurements(void) { return reinterpret_cast<MeasurementStats *>(this + 1); }
+        const MeasurementStats *getMeasurements(void) const { return reinterpret_cast<const MeasurementStats *>(this + 1); }
+        uint64_t *getFaultCounts(void) { return reinterpret_cast<uint64_t *>(getMeasurements() + MeasurementCatalog::size()); }
+        const uint64_t *getFaultCounts(void) const { return reinterpret_cast<const uint64_t *>(getMeasurements() + MeasurementCatalog::size()); }
+
+        /**
+         * @brief Get size of whole block in 64-bit words
+         *
+         * @return size_t
+         */
+        static size_t getWords(void);
+
+        /**
+         * @brief Get size of whole block in bytes
+         *
+         * @return size_t
+         */
+        static size_t getSize(void);
+
+        /**
+         * @brief zero whole block
+         *
+         */
+        void clear(void);
+
+        /**
+         * @brief copy whole block
+         *
+         * @param source source block
+         */
+        void copy(const Counters &source);
+    };
+
+    /**
+     * @brief header of pending counter block, laid out like Counters with atomic words
+     *
+     * Writers of one epoch add to the block concurrently; the snapshot reader folds
+     * it into Counters once the epoch is closed and clears it. The block must be
+     * cleared before first use.
+     */
+    struct PendingCounters
+    {
+        std::atomic<uint64_t> deviceMessageCount;
+
+        PendingCounters() = default;
+        PendingCounters(const PendingCounters &) = delete;
+        PendingCounters &operator=(const PendingCounters &) = delete;
+
+        AtomicMeasurementStats *getMeasurements(void) { return reinterpret_cast<AtomicMeasurementStats *>(this + 1); }
+        const AtomicMeasurementStats *getMeasurements(void) const { return reinterpret_cast<const AtomicMeasurementStats *>(this + 1); }
+        std::atomic<uint64_t> *getFaultCounts(void) { return reinterpret_cast<std::atomic<uint64_t> *>(getMeasurements() + MeasurementCatalog::size()); }
+        const std::atomic<uint64_t> *getFaultCounts(void) const { return reinterpret_cast<const std::atomic<uint64_t> *>(getMeasurements() + MeasurementCatalog::size()); }
+
+        /**
+         * @brief Get size of whole block in 64-bit words
+         *
+         * @return size_t
+         */
+        static size_t getWords(void);
+
+        /**
+         * @brief reset whole block to no counts; no writer may use it meanwhile
+         *
+         */
+        void clear(void);
+    };
+
+    // counter block of its own, e.g. scratch copy of device counters
+    class CountersBuffer final
+    {
+    public:
+        CountersBuffer() : words(Counters::getWords(), 0) {}
+
+        Counters &get(void) { return *reinterpret_cast<Counters *>(words.data()); }
+        const Counters &get(void) const { return *reinterpret_cast<const Counters *>(words.data()); }
+
+    private:
+        std::vector<uint64_t> words;
+    };
+
+    // states of DeviceRecord::rollupState
+    static const uint8_t rollupsUnresolved = 0;
+    static const uint8_t rollupsPublishing = 1;
+    static const uint8_t rollupsResolved = 2;
+
+    struct DeviceRecord
+    {
+        // counter blocks not yet folded into snapshot, written by writers of even and odd epochs
+        PendingCounters *pending[2];
+        // counter block as of last snapshot; owned by snapshot reader
+        Counters *snapshot;
+        // value distributions as of last snapshot indexed by measurement kind; owned by snapshot reader.
+        // nullptr in table without sketches
+        QuantileSketch *sketches;
+        // values of even and odd epochs not yet merged into sketches, indexed like sketches
+        QuantileSketch::Pending *pendingSketches[2];
+        // records of name prefixes the device is rolled up into, shortest first; read only once
+        // rollupState is rollupsResolved, written by the single writer that moved it to rollupsPublishing
+        DeviceRecord *rollups[maxRollupLevels];
+        uint8_t rollupCount;
+        std::atomic<uint8_t> rollupState;
+        // steady clock milliseconds of last batch of device
+        std::atomic<int64_t> lastSeen;
+        // interned name; immutable while record is published
+        const char *name;
+        uint32_t nameLength;
+    };
+
+    /**
+     * @brief Construct a new empty Device Table object; measurement catalog must be loaded
+     * before first device is inserted
+     *
+     * @param sketches false if records keep counters only
+     */
+    DeviceTable(const bool sketches = true);
+
+    DeviceTable(const DeviceTable &) = delete;
+    DeviceTable &operator=(const DeviceTable &) = delete;
+
+    /**
+     * @brief find device record without locking
+     *
+     * @param deviceId device id
+     * @return DeviceRecord* record or nullptr if device is not present
+     */
+    DeviceRecord *find(const uint64_t deviceId);
+
+    /**
+     * @brief find device record or insert new one with zero counters; locks device stripe
+     *
+     * @param deviceId device id
+     * @param name device name referenced by new record; must outlive the record
+     * @param nameLength name length
+     * @param inserted set to true if new record was inserted by this call
+     * @return DeviceRecord* record that stays at the same address until it is released or
+     * nullptr if memory budget does not allow new record
+     */
+    DeviceRecord *insert(const uint64_t deviceId, const char *name, const uint32_t nameLength, bool &inserted);
+
+    /**
+     * @brief remove device from index; locks device stripe. Record stays valid for lookups
+     * already holding it and must be passed to release() once none of them can be running.
+     *
+     * @param deviceId device id
+     * @return DeviceRecord* removed record or nullptr if device is not present
+     */
+    DeviceRecord *remove(const uint64_t deviceId);
+
+    /**
+     * @brief reset removed record and keep it for reuse by next insert to the same stripe
+     *
+     * @param deviceId id the record was removed with
+     * @param record record returned by remove()
+     */
+    void release(const uint64_t deviceId, DeviceRecord &record);
+
+    /**
+     * @brief mark all index generations replaced so far for reclamation
+     *
+     */
+    void beginReclaim(void);
+
+    /**
+     * @brief free generations marked by last beginReclaim(); caller guarantees that no
+     * lookup or forEach() started before beginReclaim() is still running
+     *
+     */
+    void finishReclaim(void);
+
+    /**
+     * @brief call function for every device without locking; all devices inserted before
+     * the call are visited, devices inserted concurrently may or may not be visited
+     *
+     * @param function callable accepting (DeviceRecord &record)
+     */
+    template <typename F>
+    void forEach(F function)
+    {
+        for (auto &stripe : stripes)
+        {
+            const Index &index(*stripe.index.load(std::memory_order_acquire));
+
+            for (size_t slot(0); slot <= index.mask; ++slot)
+            {
+                DeviceRecord *record(index.slots[slot].record.load(std::memory_order_acquire));
+
+                if ((record != nullptr) && (record != &removed))
+                {
+                    function(*record);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Get number of devices
+     *
+     * @return size_t
+     */
+    size_t size(void);
+
+    /**
+     * @brief Get memory occupied by indexes and records in bytes
+     *
+     * @return size_t
+     */
+    size_t memoryUsage(void);
+
+private:
+    static const size_t stripeBits = 6;
+    static const size_t stripeCount = 1 << stripeBits;
+    static const size_t chunkSize = 256;
+
+    struct Slot
+    {
+        std::atomic<uint64_t> deviceId;
+        // nullptr marks empty slot, &removed marks tombstone
+        std::atomic<DeviceRecord *> record;
+    };
+
+    struct Index
+    {
+        Index(const size_t capacity) : mask(capacity - 1), slots(new Slot[capacity]()) {}
+        size_t mask;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    // stripes are cache line aligned so that locks of neighbouring stripes do not share a line
+    struct alignas(64) Stripe
+    {
+        std::mutex lock;
+        std::atomic<Index *> index;
+        // current index is the last one, older ones wait for reclamation
+        std::vector<std::unique_ptr<Index>> generations;
+        // number of older generations marked by beginReclaim()
+        size_t reclaimable = 0;
+        // records each directly followed by its counter blocks (three per record) and sketches, so a
+        // writer finds counters of a device next to its record; allocated from MemoryArena, never freed
+        std::vector<uint64_t *> chunks;
+        // records taken from chunks, published devices and tombstone slots of current index
+        size_t count = 0;
+        size_t live = 0;
+        size_t tombstones = 0;
+        std::vector<DeviceRecord *> freeRecords;
+    };
+
+    /**
+     * @brief find record in given index
+     *
+     * @param index stripe index
+     * @param deviceId device id
+     * @return DeviceRecord* record or nullptr if device is not present
+     */
+    static DeviceRecord *lookup(const Index &index, const uint64_t deviceId);
+
+    /**
+     * @brief publish record in index; stripe lock must be held
+     *
+     * @param index stripe index with at least one free slot
+     * @param deviceId device id
+     * @param record record to publish
+     */
+    static void publish(Index &index, const uint64_t deviceId, DeviceRecord *record);
+
+    /**
+     * @brief publish index without tombstones sized for live devices of stripe; stripe lock must be held
+     *
+     * @param stripe rebuilt stripe
+     * @return true on success
+     * @return false if memory budget does not allow larger index
+     */
+    static bool rebuild(Stripe &stripe);
+
+    /**
+     * @brief allocate chunk of records and attach counter blocks and sketches to them; stripe lock must be held
+     *
+     * @param stripe stripe receiving the chunk
+     * @return true on success
+     * @return false if memory budget does not allow the chunk
+     */
+    bool allocateChunk(Stripe &stripe);
+
+    /**
+     * @brief Get memory of index with given capacity in bytes
+     *
+     * @param capacity number of slots
+     * @return size_t
+     */
+    static size_t getIndexSize(const size_t capacity);
+
+    /**
+     * @brief Get size of record with its counter blocks and sketches in 64-bit words
+     *
+     * @return size_t
+     */
+    size_t getRecordWords(void) const;
+
+    /**
+     * @brief Get stripe of device
+     *
+     * @param deviceId device id
+     * @return Stripe&
+     */
+    Stripe &getStripe(const uint64_t deviceId);
+
+    // target of tombstone slots; never read or written
+    static DeviceRecord removed;
+
+    bool hasSketches;
+    Stripe stripes[stripeCount];
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include "DistinctCounter.hpp"
+#include "FlatHashMap.hpp"
+#include "NameDictionary.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+const char *const DistinctCounter::resolutionKeys[DistinctCounter::resolutionCount] = {"minute", "hour"};
+const uint32_t DistinctCounter::ringSizes[DistinctCounter::resolutionCount] = {60, 24};
+
+std::mutex DistinctCounter::counterLock;
+bool DistinctCounter::enabled(false);
+unsigned DistinctCounter::precision(14);
+std::vector<DistinctCounter::Window> DistinctCounter::rings[DistinctCounter::resolutionCount];
+
+namespace
+{
+    // length of window in seconds indexed by Resolution
+    const uint64_t resolutionSeconds[] = {60, 3600};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool DistinctCounter::configure(const bool enabled, const unsigned precision)
+{
+    if ((precision < 4) || (precision > 18))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(counterLock);
+    DistinctCounter::enabled = enabled;
+    DistinctCounter::precision = precision;
+
+    for (unsigned resolution(0); resolution < resolutionCount; ++resolution)
+    {
+        rings[resolution].assign(enabled ? ringSizes[resolution] : 0, Window());
+
+        for (auto &window : rings[resolution])
+        {
+            window.window = 0;
+            window.registers.assign(static_cast<size_t>(1) << precision, 0);
+        }
+    }
+
+    if (enabled)
+    {
+        LOG_FMT_INF("distinct device counting enabled; precision %u; standard error %.2f %%",
+                    precision, 104.0 / std::sqrt(static_cast<double>(1u << precision)));
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DistinctCounter::count(const RecordBatch &batch)
+try
+{
+    if (!enabled || batch.empty())
+    {
+        return;
+    }
+
+    const uint64_t now(getTime());
+    std::lock_guard<std::mutex> lock(counterLock);
+    std::vector<uint8_t> &minute(getWindow(resolutionMinute, now / resolutionSeconds[resolutionMinute]).registers);
+    std::vector<uint8_t> &hour(getWindow(resolutionHour, now / resolutionSeconds[resolutionHour]).registers);
+    const unsigned rankBits(64 - precision);
+
+    for (const auto &delta : batch.getDeltas())
+    {
+        // FNV of similar names differs mostly in low bits; mixing spreads them over register index and rank
+        const uint64_t hash(hashMix(NameDictionary::getHash(delta.deviceId)));
+        const size_t index(static_cast<size_t>(hash >> rankBits));
+        const uint64_t rest(hash << precision);
+        // position of first set bit of remaining bits; all zero bits give the maximum rank
+        const uint8_t rank(static_cast<uint8_t>((rest == 0) ? rankBits + 1 : static_cast<unsigned>(__builtin_clzll(rest)) + 1));
+
+        minute[index] = std::max(minute[index], rank);
+        hour[index] = std::max(hour[index], rank);
+    }
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to count distinct devices: %s", ex.what());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool DistinctCounter::query(const Resolution resolution, uint32_t windowCount, std::string &estimate)
+{
+    const uint64_t now(getTime());
+    std::lock_guard<std::mutex> lock(counterLock);
+
+    if (!enabled)
+    {
+        return false;
+    }
+
+    windowCount = std::max<uint32_t>(std::min(windowCount, ringSizes[resolution]), 1);
+    const uint64_t newestWindow(now / resolutionSeconds[resolution]);
+    std::vector<uint8_t> merged(static_cast<size_t>(1) << precision, 0);
+
+    // windows nobody reported in were never reset and still hold older windows
+    for (uint64_t window(newestWindow - windowCount + 1); window <= newestWindow; ++window)
+    {
+        const Window &slot(rings[resolution][window % ringSizes[resolution]]);
+
+        if (slot.window != window)
+        {
+            continue;
+        }
+
+        for (size_t index(0); index < merged.size(); ++index)
+        {
+            merged[index] = std::max(merged[index], slot.registers[index]);
+        }
+    }
+
+    const double count(estimateCount(merged));
+    const double standardError(1.04 / std::sqrt(static_cast<double>(merged.size())));
+
+    std::stringstream ss;
+    ss << "resolution: " << resolutionKeys[resolution] << "; "
+       << "windows: " << windowCount << "; "
+       << "from: " << (newestWindow - windowCount + 1) * resolutionSeconds[resolution] * 1000 << "; "
+       << "estimate: " << std::llround(count) << "; "
+       << "standardError: " << standardError * 100.0 << "%; "
+       << "bound95: " << std::llround(2.0 * standardError * count) << "; " << std::endl;
+    estimate = ss.str();
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t DistinctCounter::getTime(void)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+DistinctCounter::Window &DistinctCounter::getWindow(const Resolution resolution, const uint64_t window)
+{
+    Window &slot(rings[resolution][window % ringSizes[resolution]]);
+
+    if (slot.window != window)
+    {
+        slot.window = window;
+        std::fill(slot.registers.begin(), slot.registers.end(), 0);
+    }
+
+    return slot;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double DistinctCounter::estimateCount(const std::vector<uint8_t> &registers)
+{
+    const double size(static_cast<double>(registers.size()));
+    double sum(0.0);
+    size_t zeros(0);
+
+    for (const uint8_t rank : registers)
+    {
+        sum += std::ldexp(1.0, -static_cast<int>(rank));
+        zeros += (rank == 0) ? 1 : 0;
+    }
+
+    // bias correction constant for 2^precision >= 128; smaller sketches use rounded values of the paper
+    const double alpha((registers.size() >= 128) ? 0.7213 / (1.0 + 1.079 / size)
+                                                 : (registers.size() == 16) ? 0.673 : (registers.size() == 32) ? 0.697 : 0.709);
+    const double raw(alpha * size * size / sum);
+
+    // 64-bit hashes need no large range correction
+    if ((raw <= 2.5 * size) && (zeros != 0))
+    {
+        return size * std::log(size / static_cast<double>(zeros));
+    }
+
+    return raw;
+}
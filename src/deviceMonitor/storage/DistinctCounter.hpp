@@ -0,0 +1,106 @@
+#ifndef DISTINCTCOUNTER_HPP
+#define DISTINCTCOUNTER_HPP
+
+#include "RecordBatch.hpp"
+#include "Logger.hpp"
+#include <cinttypes>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief estimated number of distinct devices reporting per wall-clock window (HyperLogLog)
+ *
+ * Every minute and every hour has its own HyperLogLog sketch of 2^precision
+ * one byte registers kept in fixed rings. Every device of a batch is added to
+ * the sketch of the current minute and of the current hour by its name hash
+ * taken when the name was interned, so the cost per batch is one register
+ * update per distinct device and nothing depends on the number of devices
+ * in storage. Sketches merge by register maximum, so the count for the last
+ * N windows is estimated from the merge of their sketches with standard error
+ * of 1.04 / sqrt(2^precision).
+ */
+class DistinctCounter final
+{
+public:
+    enum Resolution : uint8_t
+    {
+        resolutionMinute = 0,
+        resolutionHour,
+        resolutionCount
+    };
+
+    // query names of resolutions indexed by Resolution
+    static const char *const resolutionKeys[resolutionCount];
+
+    // number of windows kept per resolution
+    static const uint32_t ringSizes[resolutionCount];
+
+    /**
+     * @brief enable counter; must be called before any batch is counted
+     *
+     * @param enabled false keeps counter disabled and count() returns immediately
+     * @param precision number of hash bits selecting register; 4 to 18
+     * @return true on success
+     * @return false if precision is out of range
+     */
+    static bool configure(const bool enabled, const unsigned precision);
+
+    /**
+     * @brief add devices of aggregated batch to sketches of current windows
+     *
+     * @param batch batch after RecordBatch::aggregate()
+     */
+    static void count(const RecordBatch &batch);
+
+    /**
+     * @brief Get estimated number of distinct devices in last windows with its error bound
+     *
+     * @param resolution window resolution
+     * @param windowCount number of windows ending with the current one
+     * @param estimate output text with estimate, standard error and 95% bound
+     * @return true on success
+     * @return false if counter is disabled
+     */
+    static bool query(const Resolution resolution, uint32_t windowCount, std::string &estimate);
+
+private:
+    // sketch of one window; window is start time in units of its resolution, zero marks empty slot
+    struct Window
+    {
+        uint64_t window;
+        std::vector<uint8_t> registers;
+    };
+
+    /**
+     * @brief Get current wall-clock time in seconds since Unix epoch
+     *
+     * @return uint64_t
+     */
+    static uint64_t getTime(void);
+
+    /**
+     * @brief Get sketch of window, resetting it if it holds older window
+     *
+     * @param resolution window resolution
+     * @param window window
+     * @return Window&
+     */
+    static Window &getWindow(const Resolution resolution, const uint64_t window);
+
+    /**
+     * @brief estimate cardinality of registers, using linear counting for small cardinalities
+     *
+     * @param registers sketch registers
+     * @return double
+     */
+    static double estimateCount(const std::vector<uint8_t> &registers);
+
+    static std::mutex counterLock;
+    static bool enabled;
+    static unsigned precision;
+    static std::vector<Window> rings[resolutionCount];
+};
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef FLATHASHMAP_HPP
+#define FLATHASHMAP_HPP
+
+#include <cinttypes>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief spread key bits so that also structured keys distribute well (murmur3 finalizer)
+ *
+ * @param key
+ * @return size_t
+ */
+inline size_t hashMix(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return static_cast<size_t>(key);
+}
+
+/**
+ * @brief open addressing hash map with 64-bit integer keys
+ *
+ * Keys and values are stored inline in one contiguous slot array and collisions
+ * are resolved by linear probing, so lookup usually touches a single cache line.
+ * Capacity is power of two and table grows when it is more than 3/4 full.
+ * Pointers/references to values are invalidated when table grows.
+ */
+template <typename T>
+class FlatHashMap
+{
+public:
+    /**
+     * @brief Construct a new Flat Hash Map object
+     *
+     * @param expectedSize number of elements that fit without growing
+     */
+    FlatHashMap(const size_t expectedSize = 8)
+    {
+        size_t capacity(16);
+
+        while (3 * capacity < 4 * expectedSize)
+        {
+            capacity <<= 1;
+        }
+
+        slots.resize(capacity);
+    }
+
+    /**
+     * @brief find value by key
+     *
+     * @param key
+     * @return T* pointer to value or nullptr if key is not present
+     */
+    T *find(const uint64_t key)
+    {
+        const size_t mask(slots.size() - 1);
+
+        for (size_t slot(hashMix(key) & mask);; slot = (slot + 1) & mask)
+        {
+            if (!slots[slot].used)
+            {
+                return nullptr;
+            }
+
+            if (slots[slot].key == key)
+            {
+                return &slots[slot].value;
+            }
+        }
+    }
+
+    /**
+     * @brief find value by key
+     *
+     * @param key
+     * @return const T* pointer to value or nullptr if key is not present
+     */
+    const T *find(const uint64_t key) const
+    {
+        return const_cast<FlatHashMap *>(this)->find(key);
+    }
+
+    /**
+     * @brief find value by key or insert new one
+     *
+     * @param key
+     * @param value value inserted if key is not present
+     * @param inserted set to true if new value was inserted
+     * @return T& reference to stored value
+     */
+    T &findOrInsert(const uint64_t key, const T &value, bool &inserted)
+    {
+        if (4 * (count + 1) > 3 * slots.size())
+        {
+            grow();
+        }
+
+        const size_t mask(slots.size() - 1);
+        size_t slot(hashMix(key) & mask);
+
+        while (slots[slot].used && (slots[slot].key != key))
+        {
+            slot = (slot + 1) & mask;
+        }
+
+        inserted = !slots[slot].used;
+
+        if (inserted)
+        {
+            slots[slot].used = true;
+            slots[slot].key = key;
+            slots[slot].value = value;
+            count++;
+        }
+
+        return slots[slot].value;
+    }
+
+    /**
+     * @brief remove element by key; following elements of its probe run are shifted back
+     * so that no tombstone is left
+     *
+     * @param key
+     * @return true if element was removed
+     * @return false if key is not present
+     */
+    bool erase(const uint64_t key)
+    {
+        const size_t mask(slots.size() - 1);
+        size_t hole(hashMix(key) & mask);
+
+        while (slots[hole].used && (slots[hole].key != key))
+        {
+            hole = (hole + 1) & mask;
+        }
+
+        if (!slots[hole].used)
+        {
+            return false;
+        }
+
+        for (size_t slot((hole + 1) & mask); slots[slot].used; slot = (slot + 1) & mask)
+        {
+            // element may fill the hole unless its home slot lies between the hole and its slot
+            if (((slot - (hashMix(slots[slot].key) & mask)) & mask) >= ((slot - hole) & mask))
+            {
+                slots[hole].key = slots[slot].key;
+                slots[hole].value = std::move(slots[slot].value);
+                hole = slot;
+            }
+        }
+
+        slots[hole].used = false;
+        slots[hole].value = T();
+        count--;
+        return true;
+    }
+
+    /**
+     * @brief remove all elements; capacity is kept
+     *
+     */
+    void clear(void)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        for (auto &slot : slots)
+        {
+            slot.used = false;
+        }
+
+        count = 0;
+    }
+
+    /**
+     * @brief call function for every stored key/value pair
+     *
+     * @param function callable accepting (uint64_t key, const T &value)
+     */
+    template <typename F>
+    void forEach(F function) const
+    {
+        for (const auto &slot : slots)
+        {
+            if (slot.used)
+            {
+                function(slot.key, slot.value);
+            }
+        }
+    }
+
+    /**
+     * @brief Get number of stored elements
+     *
+     * @return size_t
+     */
+    size_t size(void) const
+    {
+        return count;
+    }
+
+    /**
+     * @brief Get number of allocated slots
+     *
+     * @return size_t
+     */
+    size_t capacity(void) const
+    {
+        return slots.size();
+    }
+
+    /**
+     * @brief Get memory occupied by slot array in bytes
+     *
+     * @return size_t
+     */
+    size_t memoryUsage(void) const
+    {
+        return slots.capacity() * sizeof(Slot);
+    }
+
+private:
+    struct Slot
+    {
+        uint64_t key = 0;
+        bool used = false;
+        T value = T();
+    };
+
+    /**
+     * @brief double the capacity and reinsert all elements
+     *
+     */
+    void grow(void)
+    {
+        std::vector<Slot> previous(slots.size() * 2);
+        previous.swap(slots);
+        const size_t mask(slots.size() - 1);
+
+        for (auto &old : previous)
+        {
+            if (!old.used)
+            {
+                continue;
+            }
+
+            size_t slot(hashMix(old.key) & mask);
+
+            while (slots[slot].used)
+            {
+                slot = (slot + 1) & mask;
+            }
+
+            slots[slot].used = true;
+            slots[slot].key = old.key;
+            slots[slot].value = std::move(old.value);
+        }
+    }
+
+    std::vector<Slot> slots;
+    size_t count = 0;
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include "GorillaBlock.hpp"
+#include <algorithm>
+
+namespace
+{
+    // delta of delta ranges and their prefixes; zero is encoded as single '0' bit
+    struct DeltaBucket
+    {
+        uint64_t prefix;
+        uint32_t prefixLength;
+        uint32_t valueLength;
+    };
+
+    const DeltaBucket deltaBuckets[] = {{0x2, 2, 7}, {0x6, 3, 9}, {0xE, 4, 12}, {0xF, 4, 32}};
+
+    uint32_t countLeadingZeros(const uint64_t bits)
+    {
+        return static_cast<uint32_t>(__builtin_clzll(bits));
+    }
+
+    uint32_t countTrailingZeros(const uint64_t bits)
+    {
+        return static_cast<uint32_t>(__builtin_ctzll(bits));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+GorillaBlock::GorillaBlock() : bitCount(0),
+                               firstTimestamp(0),
+                               minTimestamp(0),
+                               maxTimestamp(0),
+                               minValue(0.0),
+                               maxValue(0.0),
+                               sum(0.0),
+                               lastTimestamp(0),
+                               lastDelta(0),
+                               lastValue(0),
+                               windowLeading(0),
+                               windowLength(0),
+                               count(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool GorillaBlock::append(const int64_t timestamp, const double value)
+{
+    const uint64_t bits(toBits(value));
+
+    if (count == 0)
+    {
+        // first sample: timestamp is kept in header, value is written in full
+        firstTimestamp = minTimestamp = maxTimestamp = lastTimestamp = timestamp;
+        minValue = maxValue = sum = value;
+        write(bits, 64);
+        lastValue = bits;
+        count = 1;
+        return true;
+    }
+
+    if (count >= maxSamples)
+    {
+        return false;
+    }
+
+    // deltas are computed in unsigned arithmetic so that far apart timestamps cannot overflow
+    const int64_t delta(static_cast<int64_t>(static_cast<uint64_t>(timestamp) - static_cast<uint64_t>(lastTimestamp)));
+    const int64_t deltaOfDelta(static_cast<int64_t>(static_cast<uint64_t>(delta) - static_cast<uint64_t>(lastDelta)));
+
+    const DeltaBucket *deltaBucket(nullptr);
+
+    for (const auto &bucket : deltaBuckets)
+    {
+        // values are stored shifted by one, zero has its own single bit code
+        const int64_t limit(int64_t(1) << (bucket.valueLength - 1));
+
+        if ((deltaOfDelta > -limit) && (deltaOfDelta <= limit))
+        {
+            deltaBucket = &bucket;
+            break;
+        }
+    }
+
+    if ((deltaOfDelta != 0) && (deltaBucket == nullptr))
+    {
+        return false;
+    }
+
+    if (deltaOfDelta == 0)
+    {
+        write(0, 1);
+    }
+    else
+    {
+        write(deltaBucket->prefix, deltaBucket->prefixLength);
+        write(static_cast<uint64_t>(deltaOfDelta - 1), deltaBucket->valueLength);
+    }
+
+    const uint64_t xored(bits ^ lastValue);
+
+    if (xored == 0)
+    {
+        write(0, 1);
+    }
+    else
+    {
+        const uint32_t leading(std::min(countLeadingZeros(xored), 31u));
+        const uint32_t trailing(countTrailingZeros(xored));
+
+        if ((windowLength != 0) && (leading >= windowLeading) && (trailing >= 64 - windowLeading - windowLength))
+        {
+            // meaningful bits fit into the previous window
+            write(0x2, 2);
+        }
+        else
+        {
+            windowLeading = leading;
+            windowLength = 64 - leading - trailing;
+            write(0x3, 2);
+            write(windowLeading, 5);
+            // length 64 is stored as 0
+            write(windowLength & 0x3F, 6);
+        }
+
+        write(xored >> (64 - windowLeading - windowLength), windowLength);
+    }
+
+    lastDelta = delta;
+    lastTimestamp = timestamp;
+    lastValue = bits;
+    minTimestamp = std::min(minTimestamp, timestamp);
+    maxTimestamp = std::max(maxTimestamp, timestamp);
+    minValue = std::min(minValue, value);
+    maxValue = std::max(maxValue, value);
+    sum += value;
+    count++;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void GorillaBlock::seal(void)
+{
+    words.shrink_to_fit();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void GorillaBlock::decode(int64_t *timestamps, double *values) const
+{
+    uint32_t sample(0);
+
+    forEach([timestamps, values, &sample](const int64_t timestamp, const double value)
+            {
+                timestamps[sample] = timestamp;
+                values[sample] = value;
+                sample++;
+            });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t GorillaBlock::getCount(void) const
+{
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int64_t GorillaBlock::getMinTimestamp(void) const
+{
+    return minTimestamp;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int64_t GorillaBlock::getMaxTimestamp(void) const
+{
+    return maxTimestamp;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double GorillaBlock::getMinValue(void) const
+{
+    return minValue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double GorillaBlock::getMaxValue(void) const
+{
+    return maxValue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double GorillaBlock::getSum(void) const
+{
+    return sum;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t GorillaBlock::memoryUsage(void) const
+{
+    return sizeof(GorillaBlock) + words.capacity() * sizeof(uint64_t);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void GorillaBlock::write(const uint64_t bits, const uint32_t length)
+{
+    const uint32_t offset(static_cast<uint32_t>(bitCount & 63));
+    const uint64_t value((length == 64) ? bits : (bits & ((uint64_t(1) << length) - 1)));
+
+    // bits are stored from the most significant bit of every word
+    if (offset == 0)
+    {
+        words.push_back(value << (64 - length));
+    }
+    else
+    {
+        words.back() |= (length + offset <= 64) ? (value << (64 - offset - length)) : (value >> (length + offset - 64));
+
+        if (length + offset > 64)
+        {
+            words.push_back(value << (128 - offset - length));
+        }
+    }
+
+    bitCount += length;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t GorillaBlock::read(uint64_t &position, const uint32_t length) const
+{
+    const size_t word(static_cast<size_t>(position >> 6));
+    const uint32_t offset(static_cast<uint32_t>(position & 63));
+    uint64_t value(words[word] << offset);
+
+    if (offset + length > 64)
+    {
+        value |= words[word + 1] >> (64 - offset);
+    }
+
+    position += length;
+    return value >> (64 - length);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int64_t GorillaBlock::readDeltaOfDelta(uint64_t &position) const
+{
+    if (read(position, 1) == 0)
+    {
+        return 0;
+    }
+
+    // number of leading ones selects the bucket; the longest prefix has no terminating zero
+    size_t ones(1);
+
+    while ((ones < sizeof(deltaBuckets) / sizeof(deltaBuckets[0])) && (read(position, 1) != 0))
+    {
+        ones++;
+    }
+
+    const DeltaBucket &bucket(deltaBuckets[ones - 1]);
+    const uint64_t raw(read(position, bucket.valueLength));
+    // sign extend and undo shift by one
+    const uint64_t sign(uint64_t(1) << (bucket.valueLength - 1));
+    return static_cast<int64_t>((raw ^ sign) - sign) + 1;
+}
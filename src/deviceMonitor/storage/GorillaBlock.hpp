@@ -0,0 +1,204 @@
+#ifndef GORILLABLOCK_HPP
+#define GORILLABLOCK_HPP
+
+#include <cinttypes>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief compressed block of (timestamp, value) samples of one series (Gorilla encoding)
+ *
+ * Timestamps are stored as delta of delta: sample arriving at the same interval
+ * as the previous one costs a single bit, small jitter 9 to 16 bits. Values are
+ * XORed with the previous value; unchanged value costs a single bit and changed
+ * one only its meaningful bits, reusing previous leading/trailing zero window
+ * when possible. Block accepts samples until it is full or until timestamp
+ * delta of delta does not fit into 32 bits; caller then starts a new block.
+ * Block also keeps summary of its values (min, max, sum), so queries can use
+ * blocks lying entirely within their time range without decoding them.
+ */
+class GorillaBlock final
+{
+public:
+    static const uint32_t maxSamples = 1024;
+
+    /**
+     * @brief Construct a new empty Gorilla Block object
+     *
+     */
+    GorillaBlock();
+
+    /**
+     * @brief append sample
+     *
+     * @param timestamp sample timestamp
+     * @param value sample value
+     * @return true if sample was appended
+     * @return false if block is full or timestamp cannot be encoded; block is unchanged
+     */
+    bool append(const int64_t timestamp, const double value);
+
+    /**
+     * @brief release unused capacity of bit stream once no more samples are appended
+     *
+     */
+    void seal(void);
+
+    /**
+     * @brief call function for every sample in append order
+     *
+     * @param function callable accepting (int64_t timestamp, double value)
+     */
+    template <typename F>
+    void forEach(F function) const
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        uint64_t position(0);
+        int64_t timestamp(firstTimestamp);
+        int64_t delta(0);
+        uint64_t value(read(position, 64));
+        uint32_t windowLeading(0);
+        uint32_t windowLength(64);
+
+        function(timestamp, toDouble(value));
+
+        for (uint32_t sample(1); sample < count; ++sample)
+        {
+            delta += readDeltaOfDelta(position);
+            timestamp += delta;
+
+            if (read(position, 1) != 0)
+            {
+                if (read(position, 1) != 0)
+                {
+                    windowLeading = static_cast<uint32_t>(read(position, 5));
+                    windowLength = static_cast<uint32_t>(read(position, 6));
+                    windowLength = (windowLength == 0) ? 64 : windowLength;
+                }
+
+                value ^= read(position, windowLength) << (64 - windowLeading - windowLength);
+            }
+
+            function(timestamp, toDouble(value));
+        }
+    }
+
+    /**
+     * @brief decode all samples into columns
+     *
+     * @param timestamps output timestamps; room for getCount() values
+     * @param values output values; room for getCount() values
+     */
+    void decode(int64_t *timestamps, double *values) const;
+
+    /**
+     * @brief Get number of samples
+     *
+     * @return uint32_t
+     */
+    uint32_t getCount(void) const;
+
+    /**
+     * @brief Get the smallest timestamp in block
+     *
+     * @return int64_t
+     */
+    int64_t getMinTimestamp(void) const;
+
+    /**
+     * @brief Get the largest timestamp in block
+     *
+     * @return int64_t
+     */
+    int64_t getMaxTimestamp(void) const;
+
+    /**
+     * @brief Get the smallest value in block
+     *
+     * @return double
+     */
+    double getMinValue(void) const;
+
+    /**
+     * @brief Get the largest value in block
+     *
+     * @return double
+     */
+    double getMaxValue(void) const;
+
+    /**
+     * @brief Get sum of values in block
+     *
+     * @return double
+     */
+    double getSum(void) const;
+
+    /**
+     * @brief Get memory occupied by block including its bit stream in bytes
+     *
+     * @return size_t
+     */
+    size_t memoryUsage(void) const;
+
+private:
+    /**
+     * @brief append lowest bits of value to bit stream
+     *
+     * @param bits value
+     * @param length number of bits (1 to 64)
+     */
+    void write(const uint64_t bits, const uint32_t length);
+
+    /**
+     * @brief read bits from bit stream
+     *
+     * @param position bit position; advanced by length
+     * @param length number of bits (1 to 64)
+     * @return uint64_t
+     */
+    uint64_t read(uint64_t &position, const uint32_t length) const;
+
+    /**
+     * @brief read timestamp delta of delta
+     *
+     * @param position bit position; advanced past encoded value
+     * @return int64_t
+     */
+    int64_t readDeltaOfDelta(uint64_t &position) const;
+
+    static uint64_t toBits(const double value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    static double toDouble(const uint64_t bits)
+    {
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    std::vector<uint64_t> words;
+    uint64_t bitCount;
+    int64_t firstTimestamp;
+    int64_t minTimestamp;
+    int64_t maxTimestamp;
+    double minValue;
+    double maxValue;
+    double sum;
+    // encoder state of the last appended sample
+    int64_t lastTimestamp;
+    int64_t lastDelta;
+    uint64_t lastValue;
+    uint32_t windowLeading;
+    uint32_t windowLength;
+    uint32_t count;
+};
+
+#endif
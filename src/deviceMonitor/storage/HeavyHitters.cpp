@@ -0,0 +1,175 @@
+#include "HeavyHitters.hpp"
+#include "NameDictionary.hpp"
+#include <chrono>
+#include <utility>
+
+const char *const HeavyHitters::scopeKeys[HeavyHitters::scopeCount] = {"total", "minute", "hour"};
+
+std::mutex HeavyHitters::hittersLock;
+bool HeavyHitters::enabled(false);
+std::unique_ptr<SpaceSaving> HeavyHitters::current[HeavyHitters::scopeCount];
+std::unique_ptr<SpaceSaving> HeavyHitters::previous[HeavyHitters::scopeCount];
+uint64_t HeavyHitters::windows[HeavyHitters::scopeCount];
+
+namespace
+{
+    // length of window in seconds indexed by Scope; total scope has a single window
+    const uint64_t scopeSeconds[] = {0, 60, 3600};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HeavyHitters::configure(const bool enabled, const uint32_t capacity)
+{
+    if (capacity == 0)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(hittersLock);
+    HeavyHitters::enabled = enabled;
+
+    for (unsigned scope(0); scope < scopeCount; ++scope)
+    {
+        current[scope].reset(enabled ? new SpaceSaving(capacity) : nullptr);
+        previous[scope].reset(enabled && (scope != scopeTotal) ? new SpaceSaving(capacity) : nullptr);
+        windows[scope] = 0;
+    }
+
+    if (enabled)
+    {
+        LOG_FMT_INF("heavy hitter tracking enabled; capacity %u devices", capacity);
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HeavyHitters::count(const RecordBatch &batch)
+try
+{
+    if (!enabled || batch.empty())
+    {
+        return;
+    }
+
+    const uint64_t now(getTime());
+    std::lock_guard<std::mutex> lock(hittersLock);
+    rotate(scopeMinute, now / scopeSeconds[scopeMinute]);
+    rotate(scopeHour, now / scopeSeconds[scopeHour]);
+
+    for (const auto &delta : batch.getDeltas())
+    {
+        for (unsigned scope(0); scope < scopeCount; ++scope)
+        {
+            current[scope]->add(delta.deviceId, delta.messageCount);
+        }
+    }
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to count heavy hitters: %s", ex.what());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HeavyHitters::remove(const std::vector<uint32_t> &deviceIds)
+{
+    std::lock_guard<std::mutex> lock(hittersLock);
+
+    if (!enabled)
+    {
+        return;
+    }
+
+    for (const uint32_t deviceId : deviceIds)
+    {
+        for (unsigned scope(0); scope < scopeCount; ++scope)
+        {
+            current[scope]->remove(deviceId);
+
+            // total scope has no previous window
+            if (previous[scope] != nullptr)
+            {
+                previous[scope]->remove(deviceId);
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HeavyHitters::query(const Scope scope, const uint32_t limit, std::string &top)
+{
+    const uint64_t now(getTime());
+    std::lock_guard<std::mutex> lock(hittersLock);
+
+    if (!enabled)
+    {
+        return false;
+    }
+
+    std::stringstream ss;
+
+    if (scope == scopeTotal)
+    {
+        ss << "scope: " << scopeKeys[scope] << "; ";
+        writeSummary(*current[scope], limit, ss);
+        top = ss.str();
+        return true;
+    }
+
+    // nobody may have reported since the window ended
+    rotate(scope, now / scopeSeconds[scope]);
+
+    for (uint64_t age(0); age < 2; ++age)
+    {
+        ss << "scope: " << scopeKeys[scope] << "; "
+           << "from: " << (windows[scope] - age) * scopeSeconds[scope] * 1000 << "; ";
+        writeSummary((age == 0) ? *current[scope] : *previous[scope], limit, ss);
+    }
+
+    top = ss.str();
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t HeavyHitters::getTime(void)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HeavyHitters::rotate(const Scope scope, const uint64_t window)
+{
+    if (window <= windows[scope])
+    {
+        return;
+    }
+
+    // previous window is kept only if it directly precedes the new one
+    std::swap(current[scope], previous[scope]);
+    current[scope]->clear();
+
+    if (window != windows[scope] + 1)
+    {
+        previous[scope]->clear();
+    }
+
+    windows[scope] = window;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HeavyHitters::writeSummary(const SpaceSaving &summary, const uint32_t limit, std::stringstream &ss)
+{
+    ss << "messages: " << summary.getTotal() << "; "
+       << "tracked: " << summary.size() << "; "
+       << "capacity: " << summary.getCapacity() << "; "
+       << "threshold: " << summary.getThreshold() << "; " << std::endl;
+
+    summary.forEachTop(limit, [&ss](const uint32_t key, const uint64_t count, const uint64_t error) {
+        ss << "name: ";
+        ss.write(NameDictionary::getName(key), NameDictionary::getLength(key));
+        ss << "; "
+           << "count: " << count << "; "
+           << "error: " << error << "; "
+           << "guaranteed: " << count - error << "; " << std::endl;
+    });
+}
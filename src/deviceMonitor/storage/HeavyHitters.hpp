@@ -0,0 +1,111 @@
+#ifndef HEAVYHITTERS_HPP
+#define HEAVYHITTERS_HPP
+
+#include "RecordBatch.hpp"
+#include "SpaceSaving.hpp"
+#include "Logger.hpp"
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief devices sending the most messages since start and per wall-clock minute and hour
+ *
+ * Every scope has a Space-Saving summary of fixed capacity (SpaceSaving);
+ * minute and hour scopes keep the summary of the current and of the previous
+ * window. Every device of a batch adds its message count to all summaries
+ * once, so the cost per batch does not depend on the number of devices and
+ * memory stays fixed however many devices report. Reported counts may be
+ * overestimated by at most their error; any device sending more than
+ * messages / capacity is guaranteed to be reported.
+ */
+class HeavyHitters final
+{
+public:
+    enum Scope : uint8_t
+    {
+        scopeTotal = 0,
+        scopeMinute,
+        scopeHour,
+        scopeCount
+    };
+
+    // query names of scopes indexed by Scope
+    static const char *const scopeKeys[scopeCount];
+
+    HeavyHitters() = delete;
+
+    /**
+     * @brief enable tracking; must be called before any batch is counted
+     *
+     * @param enabled false keeps tracking disabled and count() returns immediately
+     * @param capacity number of devices tracked per summary; at least 1
+     * @return true on success
+     * @return false if capacity is zero
+     */
+    static bool configure(const bool enabled, const uint32_t capacity);
+
+    /**
+     * @brief add message counts of devices of aggregated batch to all summaries
+     *
+     * @param batch batch after RecordBatch::aggregate()
+     */
+    static void count(const RecordBatch &batch);
+
+    /**
+     * @brief stop tracking evicted devices, so their ids can be recycled; their messages stay in totals
+     *
+     * @param deviceIds ids of evicted devices
+     */
+    static void remove(const std::vector<uint32_t> &deviceIds);
+
+    /**
+     * @brief Get devices with the highest message counts of scope with their error bounds;
+     * minute and hour scopes report the current and the previous window
+     *
+     * @param scope scope
+     * @param limit maximum number of devices per window
+     * @param top output text
+     * @return true on success
+     * @return false if tracking is disabled
+     */
+    static bool query(const Scope scope, const uint32_t limit, std::string &top);
+
+private:
+    /**
+     * @brief Get current wall-clock time in seconds since Unix epoch
+     *
+     * @return uint64_t
+     */
+    static uint64_t getTime(void);
+
+    /**
+     * @brief start new window of scope if time has moved past the current one
+     *
+     * @param scope minute or hour scope
+     * @param window window of current time in units of scope
+     */
+    static void rotate(const Scope scope, const uint64_t window);
+
+    /**
+     * @brief write devices of one summary
+     *
+     * @param summary summary
+     * @param limit maximum number of devices
+     * @param ss output stream
+     */
+    static void writeSummary(const SpaceSaving &summary, const uint32_t limit, std::stringstream &ss);
+
+    static std::mutex hittersLock;
+    static bool enabled;
+    // summaries indexed by Scope; total scope uses only current
+    static std::unique_ptr<SpaceSaving> current[scopeCount];
+    static std::unique_ptr<SpaceSaving> previous[scopeCount];
+    // window of current summaries in units of scope
+    static uint64_t windows[scopeCount];
+};
+
+#endif
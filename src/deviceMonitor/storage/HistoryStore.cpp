@@ -0,0 +1,463 @@
+#include "HistoryStore.hpp"
+#include "NameDictionary.hpp"
+#include "fnv.hpp"
+#include <algorithm>
+
+std::mutex HistoryStore::historyLock;
+bool HistoryStore::enabled(false);
+int64_t HistoryStore::retention(0);
+uint64_t HistoryStore::memoryLimit(0);
+std::vector<HistoryStore::DeviceHistory> HistoryStore::devices;
+FlatHashMap<uint32_t> HistoryStore::deviceIndex;
+std::vector<uint32_t> HistoryStore::freeDevices;
+std::deque<HistoryStore::BlockEntry> HistoryStore::blockOrder;
+uint64_t HistoryStore::blockCount(0);
+uint64_t HistoryStore::nextSequence(0);
+int64_t HistoryStore::newestTimestamp(0);
+size_t HistoryStore::sweepPosition(0);
+uint64_t HistoryStore::memoryBytes(0);
+uint64_t HistoryStore::sampleCount(0);
+uint64_t HistoryStore::expiredBlocks(0);
+uint64_t HistoryStore::evictedBlocks(0);
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryStore::configure(const bool enabled, const uint64_t retention, const uint64_t memoryLimit)
+{
+    std::lock_guard<std::mutex> lock(historyLock);
+    HistoryStore::enabled = enabled;
+    HistoryStore::retention = static_cast<int64_t>(retention);
+    HistoryStore::memoryLimit = memoryLimit;
+
+    if (enabled)
+    {
+        LOG_FMT_INF("history enabled; retention %" PRIu64 " ms; memory limit %" PRIu64 " bytes", retention, memoryLimit);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryStore::append(const RecordBatch &batch)
+try
+{
+    if (!enabled || batch.empty())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(historyLock);
+    const std::vector<uint32_t> &order(batch.getOrder());
+    uint32_t runStart(0);
+
+    for (const auto &delta : batch.getDeltas())
+    {
+        bool inserted(false);
+        const uint32_t slot(freeDevices.empty() ? static_cast<uint32_t>(devices.size()) : freeDevices.back());
+        const uint32_t device(deviceIndex.findOrInsert(delta.deviceId, slot, inserted));
+
+        if (inserted)
+        {
+            if (slot == devices.size())
+            {
+                devices.emplace_back();
+            }
+            else
+            {
+                freeDevices.pop_back();
+            }
+
+            DeviceHistory &history(devices[device]);
+            history.id = delta.deviceId;
+            history.name = batch.getName(delta.firstRecord);
+            history.series.resize(MeasurementCatalog::size());
+            memoryBytes += sizeof(DeviceHistory) + history.name.capacity() + history.series.capacity() * sizeof(Series);
+        }
+
+        // records of the device form contiguous run of order, so samples keep arrival order
+        const uint32_t runEnd(runStart + delta.messageCount);
+
+        for (uint32_t position(runStart); position < runEnd; ++position)
+        {
+            const uint32_t record(order[position]);
+            const int64_t timestamp(batch.getTimestamp(record) / 1000);
+
+            if (timestamp == 0)
+            {
+                continue;
+            }
+
+            newestTimestamp = std::max(newestTimestamp, timestamp);
+
+            for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+            {
+                if (batch.isPresent(kind, record))
+                {
+                    appendSample(device, kind, timestamp, batch.getValue(kind, record));
+                }
+            }
+        }
+
+        runStart = runEnd;
+    }
+
+    trim();
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to append records to history: %s", ex.what());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryStore::sweep(const int64_t now)
+try
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(historyLock);
+    // timestamp far ahead of current time would expire every series
+    const int64_t horizon(std::min(newestTimestamp, now) - retention);
+    const size_t end(std::min(devices.size(), sweepPosition + sweepDevices));
+
+    for (; sweepPosition < end; ++sweepPosition)
+    {
+        if (devices[sweepPosition].series.empty())
+        {
+            continue;
+        }
+
+        for (Series &series : devices[sweepPosition].series)
+        {
+            expire(series, horizon);
+        }
+
+        if (!hasBlocks(static_cast<uint32_t>(sweepPosition)))
+        {
+            releaseDevice(static_cast<uint32_t>(sweepPosition));
+        }
+    }
+
+    if (sweepPosition == devices.size())
+    {
+        sweepPosition = 0;
+    }
+
+    trim();
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to expire history: %s", ex.what());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryStore::remove(const std::vector<uint32_t> &deviceIds)
+{
+    std::lock_guard<std::mutex> lock(historyLock);
+
+    for (const uint32_t deviceId : deviceIds)
+    {
+        const uint32_t *device(deviceIndex.find(deviceId));
+
+        if (device != nullptr)
+        {
+            releaseDevice(*device);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryStore::query(const std::string &name, const unsigned kind, const int64_t from, const int64_t to,
+                         const uint64_t limit, std::string &samples)
+{
+    NameDictionary::Guard names;
+    std::lock_guard<std::mutex> lock(historyLock);
+    uint32_t deviceId(0);
+    const uint32_t *device(NameDictionary::find(name.data(), static_cast<uint32_t>(name.size()),
+                                             fnv::Fnv64a(name.data(), name.size()), deviceId)
+                                ? deviceIndex.find(deviceId)
+                                : nullptr);
+
+    if (!enabled || (device == nullptr))
+    {
+        return false;
+    }
+
+    const Series &series(devices[*device].series[kind]);
+    std::stringstream ss;
+    uint64_t count(0);
+
+    auto collect([&ss, &count, from, to, limit](const GorillaBlock &block)
+                 {
+                     // blocks are skipped by their time range without decoding
+                     if ((count >= limit) || (block.getCount() == 0) ||
+                         (block.getMaxTimestamp() < from) || (block.getMinTimestamp() > to))
+                     {
+                         return;
+                     }
+
+                     block.forEach([&ss, &count, from, to, limit](const int64_t timestamp, const double value)
+                                   {
+                                       if ((count < limit) && (timestamp >= from) && (timestamp <= to))
+                                       {
+                                           ss << timestamp << ": " << value << "; " << std::endl;
+                                           count++;
+                                       }
+                                   });
+                 });
+
+    for (const auto &sealed : series.sealed)
+    {
+        collect(sealed.block);
+    }
+
+    collect(series.open);
+    ss << "samples: " << count << "; " << std::endl;
+    samples = ss.str();
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryStore::copyBlocks(std::vector<std::string> &names, std::vector<std::vector<GorillaBlock>> &blocks)
+{
+    std::lock_guard<std::mutex> lock(historyLock);
+
+    if (!enabled)
+    {
+        return false;
+    }
+
+    names.clear();
+    blocks.clear();
+    names.reserve(devices.size());
+    blocks.reserve(devices.size() * MeasurementCatalog::size());
+
+    for (const auto &device : devices)
+    {
+        if (device.series.empty())
+        {
+            continue;
+        }
+
+        names.push_back(device.name);
+
+        for (const auto &series : device.series)
+        {
+            blocks.emplace_back();
+            blocks.back().reserve(series.sealed.size() + 1);
+
+            for (const auto &sealed : series.sealed)
+            {
+                blocks.back().push_back(sealed.block);
+            }
+
+            if (series.open.getCount() != 0)
+            {
+                blocks.back().push_back(series.open);
+            }
+        }
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string HistoryStore::getStatus(void)
+{
+    std::lock_guard<std::mutex> lock(historyLock);
+    std::stringstream ss;
+
+    ss << "enabled: " << enabled << "; "
+       << "devices: " << devices.size() - freeDevices.size() << "; "
+       << "blocks: " << blockCount << "; "
+       << "samples: " << sampleCount << "; "
+       << "memoryBytes: " << memoryBytes << "; "
+       << "bytesPerSample: " << ((sampleCount == 0) ? 0.0 : static_cast<double>(memoryBytes) / static_cast<double>(sampleCount)) << "; "
+       << "expiredBlocks: " << expiredBlocks << "; "
+       << "evictedBlocks: " << evictedBlocks << "; " << std::endl;
+
+    return ss.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryStore::appendSample(const uint32_t device, const uint32_t kind, const int64_t timestamp, const double value)
+{
+    Series &series(devices[device].series[kind]);
+    size_t before(series.open.memoryUsage());
+
+    if (series.open.getCount() == 0)
+    {
+        // block enters eviction order with its first sample, so open blocks count against the limit
+        series.openSequence = nextSequence++;
+        blockOrder.push_back(BlockEntry{device, kind, series.openSequence});
+        blockCount++;
+    }
+
+    if (!series.open.append(timestamp, value))
+    {
+        series.open.seal();
+        memoryBytes = memoryBytes - before + series.open.memoryUsage();
+        series.sealed.push_back(SealedBlock{series.openSequence, std::move(series.open)});
+
+        series.open = GorillaBlock();
+        before = series.open.memoryUsage();
+        memoryBytes += before;
+        series.open.append(timestamp, value);
+        series.openSequence = nextSequence++;
+        blockOrder.push_back(BlockEntry{device, kind, series.openSequence});
+        blockCount++;
+        expire(series, timestamp - retention);
+    }
+
+    memoryBytes += series.open.memoryUsage() - before;
+    sampleCount++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryStore::expire(Series &series, const int64_t horizon)
+{
+    auto expired(series.sealed.begin());
+
+    while ((expired != series.sealed.end()) && (expired->block.getMaxTimestamp() < horizon))
+    {
+        memoryBytes -= expired->block.memoryUsage();
+        sampleCount -= expired->block.getCount();
+        expiredBlocks++;
+        blockCount--;
+        ++expired;
+    }
+
+    series.sealed.erase(series.sealed.begin(), expired);
+
+    if ((series.open.getCount() != 0) && (series.open.getMaxTimestamp() < horizon))
+    {
+        dropOpen(series);
+        expiredBlocks++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryStore::dropOpen(Series &series)
+{
+    memoryBytes -= series.open.memoryUsage();
+    sampleCount -= series.open.getCount();
+    blockCount--;
+    series.open = GorillaBlock();
+    memoryBytes += series.open.memoryUsage();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryStore::hasBlocks(const uint32_t device)
+{
+    for (const Series &series : devices[device].series)
+    {
+        if (!series.sealed.empty() || (series.open.getCount() != 0))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryStore::releaseDevice(const uint32_t device)
+{
+    DeviceHistory &history(devices[device]);
+
+    for (Series &series : history.series)
+    {
+        for (const SealedBlock &sealed : series.sealed)
+        {
+            memoryBytes -= sealed.block.memoryUsage();
+            sampleCount -= sealed.block.getCount();
+            blockCount--;
+        }
+
+        if (series.open.getCount() != 0)
+        {
+            dropOpen(series);
+        }
+    }
+
+    // order entries of dropped blocks stay until trimmed or compacted; sequences are never reused
+    memoryBytes -= sizeof(DeviceHistory) + history.name.capacity() + history.series.capacity() * sizeof(Series);
+    deviceIndex.erase(history.id);
+    std::vector<Series>().swap(history.series);
+    std::string().swap(history.name);
+    freeDevices.push_back(device);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryStore::isStored(const BlockEntry &entry)
+{
+    if (entry.kind >= devices[entry.device].series.size())
+    {
+        // device slot was released
+        return false;
+    }
+
+    const Series &series(devices[entry.device].series[entry.kind]);
+
+    if ((series.open.getCount() != 0) && (series.openSequence == entry.sequence))
+    {
+        return true;
+    }
+
+    // sealed blocks are ordered by sequence
+    const auto found(std::lower_bound(series.sealed.begin(), series.sealed.end(), entry.sequence, [](const SealedBlock &sealed, const uint64_t sequence)
+                                      { return sealed.sequence < sequence; }));
+    return (found != series.sealed.end()) && (found->sequence == entry.sequence);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryStore::trim(void)
+{
+    // entries of blocks already dropped by retention are skipped; oldest block of a series is
+    // always its first sealed block or its open block
+    while (!blockOrder.empty())
+    {
+        const BlockEntry entry(blockOrder.front());
+
+        if (!isStored(entry))
+        {
+            blockOrder.pop_front();
+            continue;
+        }
+
+        if (memoryBytes <= memoryLimit)
+        {
+            break;
+        }
+
+        Series &series(devices[entry.device].series[entry.kind]);
+
+        if (!series.sealed.empty() && (series.sealed.front().sequence == entry.sequence))
+        {
+            memoryBytes -= series.sealed.front().block.memoryUsage();
+            sampleCount -= series.sealed.front().block.getCount();
+            series.sealed.erase(series.sealed.begin());
+            blockCount--;
+        }
+        else
+        {
+            dropOpen(series);
+        }
+
+        evictedBlocks++;
+        blockOrder.pop_front();
+
+        // name and series of device count against the limit as well
+        if (!hasBlocks(entry.device))
+        {
+            releaseDevice(entry.device);
+        }
+    }
+
+    // entries of blocks expired behind a live front entry are removed once they outnumber blocks
+    if (blockOrder.size() > 2 * blockCount + compactSlack)
+    {
+        blockOrder.erase(std::remove_if(blockOrder.begin(), blockOrder.end(), [](const BlockEntry &entry)
+                                        { return !isStored(entry); }),
+                         blockOrder.end());
+    }
+}
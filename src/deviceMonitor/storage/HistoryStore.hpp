@@ -0,0 +1,269 @@
+#ifndef HISTORYSTORE_HPP
+#define HISTORYSTORE_HPP
+
+#include "FlatHashMap.hpp"
+#include "GorillaBlock.hpp"
+#include "RecordBatch.hpp"
+#include "Logger.hpp"
+#include <cinttypes>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief optional in-memory history of individual readings per device and measurement
+ *
+ * Every series (device, measurement) appends (timestamp, value) samples with
+ * millisecond resolution into Gorilla compressed blocks. Full block is sealed
+ * and blocks older than retention (relative to the newest sample of the
+ * series) are dropped. Series that stop reporting are expired by sweep(), which
+ * checks a slice of devices per tick against the newest sample of the whole
+ * store. Memory limit is a hard cap: when memory of the store exceeds it, the
+ * oldest blocks of the whole store, open ones included, are evicted first, and
+ * devices left without blocks release their slot for the next new device.
+ * History of evicted devices is dropped by remove() before their ids are recycled.
+ * Samples of a batch are appended under single lock, so writer contention is
+ * one lock per batch.
+ */
+class HistoryStore final
+{
+public:
+    // blocks of one series in append order
+    struct SeriesView
+    {
+        const std::string *name;
+        std::vector<const GorillaBlock *> blocks;
+    };
+
+    HistoryStore() = delete;
+
+    /**
+     * @brief enable history store; must be called before any batch is appended
+     *
+     * @param enabled false keeps store disabled and append() returns immediately
+     * @param retention retention of samples in milliseconds
+     * @param memoryLimit memory limit of all blocks in bytes
+     */
+    static void configure(const bool enabled, const uint64_t retention, const uint64_t memoryLimit);
+
+    /**
+     * @brief append all measured values of aggregated batch; records without valid timestamp are skipped
+     *
+     * @param batch batch after RecordBatch::aggregate()
+     */
+    static void append(const RecordBatch &batch);
+
+    /**
+     * @brief drop expired blocks of the next slice of devices, so series that stopped reporting
+     * expire as well; called periodically by main loop
+     *
+     * @param now current time in milliseconds since Unix epoch; retention is measured from the
+     * newest sample of the store, but never from a time ahead of now
+     */
+    static void sweep(const int64_t now);
+
+    /**
+     * @brief drop history of evicted devices, so their ids can be recycled
+     *
+     * @param deviceIds ids of evicted devices; unknown ids are ignored
+     */
+    static void remove(const std::vector<uint32_t> &deviceIds);
+
+    /**
+     * @brief Get samples of one series within time range in append order
+     *
+     * @param name device name
+     * @param kind measurement kind
+     * @param from first timestamp in milliseconds since Unix epoch
+     * @param to last timestamp in milliseconds since Unix epoch
+     * @param limit maximum number of returned samples
+     * @param samples output text with one "timestamp: value; " line per sample
+     * @return true on success
+     * @return false if history is disabled or device is not known
+     */
+    static bool query(const std::string &name, const unsigned kind, const int64_t from, const int64_t to,
+                      const uint64_t limit, std::string &samples);
+
+    /**
+     * @brief call function with blocks of one measurement of all devices whose name starts with prefix;
+     * store is locked until function returns, so function should only copy what it needs
+     *
+     * @param kind measurement kind
+     * @param prefix device name prefix; empty selects all devices
+     * @param function callable accepting (const std::vector<SeriesView> &)
+     * @return true on success
+     * @return false if history is disabled
+     */
+    template <typename F>
+    static bool withSeries(const unsigned kind, const std::string &prefix, F function)
+    {
+        std::lock_guard<std::mutex> lock(historyLock);
+
+        if (!enabled)
+        {
+            return false;
+        }
+
+        std::vector<SeriesView> views;
+
+        for (const auto &device : devices)
+        {
+            if (device.series.empty() || (device.name.compare(0, prefix.size(), prefix) != 0))
+            {
+                continue;
+            }
+
+            const Series &series(device.series[kind]);
+            SeriesView view;
+            view.name = &device.name;
+
+            for (const auto &sealed : series.sealed)
+            {
+                view.blocks.push_back(&sealed.block);
+            }
+
+            if (series.open.getCount() != 0)
+            {
+                view.blocks.push_back(&series.open);
+            }
+
+            views.push_back(std::move(view));
+        }
+
+        function(views);
+        return true;
+    }
+
+    /**
+     * @brief copy compressed blocks of every series; store is locked only while blocks are copied,
+     * so copies are decoded without delaying writers
+     *
+     * @param names output device names
+     * @param blocks output blocks of every series in append order indexed by device * catalog size + measurement kind
+     * @return true on success
+     * @return false if history is disabled
+     */
+    static bool copyBlocks(std::vector<std::string> &names, std::vector<std::vector<GorillaBlock>> &blocks);
+
+    /**
+     * @brief Get number of series, blocks, samples and memory usage of store
+     *
+     * @return std::string
+     */
+    static std::string getStatus(void);
+
+private:
+    // devices checked by one sweep
+    static const size_t sweepDevices = 4096;
+    // block order is compacted once it holds this many more entries than there are blocks
+    static const size_t compactSlack = 4096;
+
+    struct SealedBlock
+    {
+        uint64_t sequence;
+        GorillaBlock block;
+    };
+
+    struct Series
+    {
+        std::vector<SealedBlock> sealed;
+        GorillaBlock open;
+        // sequence of open block, assigned by its first sample
+        uint64_t openSequence;
+    };
+
+    struct DeviceHistory
+    {
+        uint32_t id;
+        std::string name;
+        // indexed by measurement kind; sized to catalog when device is inserted, empty in released slot
+        std::vector<Series> series;
+    };
+
+    // block in order of its first sample
+    struct BlockEntry
+    {
+        uint32_t device;
+        uint32_t kind;
+        uint64_t sequence;
+    };
+
+    /**
+     * @brief append sample to series; full open block is sealed and expired blocks are dropped
+     *
+     * @param device device index
+     * @param kind measurement kind
+     * @param timestamp timestamp in milliseconds
+     * @param value measured value
+     */
+    static void appendSample(const uint32_t device, const uint32_t kind, const int64_t timestamp, const double value);
+
+    /**
+     * @brief drop blocks of series whose samples are all older than horizon
+     *
+     * @param series series
+     * @param horizon oldest timestamp that is kept
+     */
+    static void expire(Series &series, const int64_t horizon);
+
+    /**
+     * @brief drop open block of series
+     *
+     * @param series series
+     */
+    static void dropOpen(Series &series);
+
+    /**
+     * @brief check if any series of device holds a block
+     *
+     * @param device device index
+     * @return true if some block is stored
+     * @return false if device has no samples
+     */
+    static bool hasBlocks(const uint32_t device);
+
+    /**
+     * @brief drop blocks of device and release its slot for reuse
+     *
+     * @param device device index
+     */
+    static void releaseDevice(const uint32_t device);
+
+    /**
+     * @brief check if block of entry is still stored
+     *
+     * @param entry block order entry
+     * @return true if block is stored
+     * @return false if it was dropped
+     */
+    static bool isStored(const BlockEntry &entry);
+
+    /**
+     * @brief evict oldest blocks until memory usage is within limit
+     *
+     */
+    static void trim(void);
+
+    static std::mutex historyLock;
+    static bool enabled;
+    static int64_t retention;
+    static uint64_t memoryLimit;
+    static std::vector<DeviceHistory> devices;
+    static FlatHashMap<uint32_t> deviceIndex;
+    // released device slots
+    static std::vector<uint32_t> freeDevices;
+    // every stored block and entries of dropped blocks not compacted yet
+    static std::deque<BlockEntry> blockOrder;
+    static uint64_t blockCount;
+    static uint64_t nextSequence;
+    static int64_t newestTimestamp;
+    static size_t sweepPosition;
+    static uint64_t memoryBytes;
+    static uint64_t sampleCount;
+    static uint64_t expiredBlocks;
+    static uint64_t evictedBlocks;
+};
+
+#endif
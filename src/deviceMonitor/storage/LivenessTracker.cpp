@@ -0,0 +1,269 @@
+#include "LivenessTracker.hpp"
+#include "DataStorage.hpp"
+#include "NameDictionary.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+std::mutex LivenessTracker::trackerLock;
+bool LivenessTracker::enabled(false);
+bool LivenessTracker::evictIdle(false);
+uint64_t LivenessTracker::offlineTimeout(0);
+uint64_t LivenessTracker::retention(0);
+std::string LivenessTracker::archiveFile;
+std::unique_ptr<TimingWheel> LivenessTracker::wheel;
+std::vector<LivenessTracker::Device> LivenessTracker::devices;
+std::vector<uint32_t> LivenessTracker::freeEntries;
+uint32_t LivenessTracker::offlineHead(TimingWheel::none);
+uint64_t LivenessTracker::offlineCount(0);
+uint64_t LivenessTracker::evictedCount(0);
+std::mutex LivenessTracker::registrationLock;
+std::vector<std::pair<uint32_t, DeviceTable::DeviceRecord *>> LivenessTracker::registrations;
+
+namespace
+{
+    // length of wheel tick in liveness clock units
+    const int64_t tickLength = 1000;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LivenessTracker::configure(const bool enabled, const uint64_t offlineTimeout, const bool evict, const uint64_t retention,
+                                const std::string &archiveFile)
+{
+    std::lock_guard<std::mutex> lock(trackerLock);
+    LivenessTracker::enabled = enabled;
+    LivenessTracker::offlineTimeout = std::max<uint64_t>(offlineTimeout, 1);
+    // device is offline before it is evicted
+    LivenessTracker::retention = std::max(retention, LivenessTracker::offlineTimeout);
+    LivenessTracker::evictIdle = evict;
+    LivenessTracker::archiveFile = archiveFile;
+    wheel.reset(new TimingWheel(static_cast<uint64_t>(getTime() / tickLength)));
+
+    if (enabled)
+    {
+        LOG_FMT_INF("liveness tracking enabled; offline timeout %" PRIu64 " s; eviction %s after %" PRIu64 " s",
+                    LivenessTracker::offlineTimeout, evict ? "enabled" : "disabled", LivenessTracker::retention);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int64_t LivenessTracker::getTime(void)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LivenessTracker::track(const uint32_t deviceId, DeviceTable::DeviceRecord &record)
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(registrationLock);
+    registrations.emplace_back(deviceId, &record);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LivenessTracker::tick(std::vector<uint32_t> &evicted)
+try
+{
+    evicted.clear();
+
+    if (!enabled)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(trackerLock);
+        std::vector<std::pair<uint32_t, DeviceTable::DeviceRecord *>> added;
+
+        {
+            std::lock_guard<std::mutex> registration(registrationLock);
+            added.swap(registrations);
+        }
+
+        for (const auto &device : added)
+        {
+            uint32_t entry(static_cast<uint32_t>(devices.size()));
+
+            if (!freeEntries.empty())
+            {
+                entry = freeEntries.back();
+                freeEntries.pop_back();
+            }
+            else
+            {
+                devices.emplace_back();
+            }
+
+            devices[entry] = Device{device.first, device.second, false, TimingWheel::none, TimingWheel::none};
+            wheel->schedule(entry, getLastSeen(devices[entry]) + offlineTimeout);
+        }
+
+        const uint64_t now(static_cast<uint64_t>(getTime() / tickLength));
+        wheel->advance(now, [now, &evicted](const uint32_t entry)
+                       { expire(entry, now, evicted); });
+    }
+
+    if (evicted.empty())
+    {
+        return;
+    }
+
+    // batches still holding ids of evicted devices are applied before devices are removed; devices they
+    // inserted again are removed as well, so nothing keeps the ids once they are recycled
+    NameDictionary::retire(evicted);
+
+    {
+        std::vector<uint32_t> sorted(evicted);
+        std::sort(sorted.begin(), sorted.end());
+        std::lock_guard<std::mutex> registration(registrationLock);
+        registrations.erase(std::remove_if(registrations.begin(), registrations.end(),
+                                           [&sorted](const std::pair<uint32_t, DeviceTable::DeviceRecord *> &device)
+                                           { return std::binary_search(sorted.begin(), sorted.end(), device.first); }),
+                            registrations.end());
+    }
+
+    std::ofstream archive;
+
+    if (!archiveFile.empty())
+    {
+        archive.open(archiveFile, std::ios::out | std::ios::app);
+
+        if (!archive)
+        {
+            LOG_FMT_ERR("unable to open device archive %s; counters of evicted devices are dropped", archiveFile.c_str());
+        }
+    }
+
+    // records are removed after tracker forgot them, so nothing reads them once they are recycled
+    DataStorage::evict(evicted, archive.is_open() ? &archive : nullptr);
+
+    std::lock_guard<std::mutex> lock(trackerLock);
+    evictedCount += evicted.size();
+    LOG_FMT_INF("evicted %zu idle devices", evicted.size());
+}
+catch (const std::exception &ex)
+{
+    // devices may still be stored, so their ids are not recycled
+    evicted.clear();
+    LOG_FMT_ERR("unable to update device liveness: %s", ex.what());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string LivenessTracker::getOffline(void)
+{
+    std::lock_guard<std::mutex> lock(trackerLock);
+    std::stringstream ss;
+    const uint64_t now(static_cast<uint64_t>(getTime() / tickLength));
+
+    for (uint32_t entry(offlineHead); entry != TimingWheel::none; entry = devices[entry].nextOffline)
+    {
+        const Device &device(devices[entry]);
+        const uint64_t lastSeen(getLastSeen(device));
+
+        // device that came back since its last check is online already
+        if (lastSeen + offlineTimeout > now)
+        {
+            continue;
+        }
+
+        ss.write(device.record->name, device.record->nameLength);
+        ss << ':' << " idle: " << now - lastSeen << "; " << std::endl;
+    }
+
+    ss << "offline: " << offlineCount << "; "
+       << "tracked: " << devices.size() - freeEntries.size() << "; "
+       << "evicted: " << evictedCount << "; " << std::endl;
+
+    return ss.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LivenessTracker::expire(const uint32_t entry, const uint64_t now, std::vector<uint32_t> &evicted)
+{
+    Device &device(devices[entry]);
+    const uint64_t lastSeen(getLastSeen(device));
+
+    if (lastSeen + offlineTimeout > now)
+    {
+        if (device.offline)
+        {
+            unlinkOffline(entry);
+        }
+
+        wheel->schedule(entry, lastSeen + offlineTimeout);
+        return;
+    }
+
+    if (!device.offline)
+    {
+        linkOffline(entry);
+    }
+
+    if (!evictIdle)
+    {
+        // offline device is checked once per timeout period, so it goes online again in time
+        wheel->schedule(entry, now + offlineTimeout);
+        return;
+    }
+
+    if (lastSeen + retention > now)
+    {
+        wheel->schedule(entry, std::min(lastSeen + retention, now + offlineTimeout));
+        return;
+    }
+
+    unlinkOffline(entry);
+    evicted.push_back(device.deviceId);
+    device.record = nullptr;
+    freeEntries.push_back(entry);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t LivenessTracker::getLastSeen(const Device &device)
+{
+    return static_cast<uint64_t>(device.record->lastSeen.load(std::memory_order_relaxed) / tickLength);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LivenessTracker::linkOffline(const uint32_t entry)
+{
+    Device &device(devices[entry]);
+    device.offline = true;
+    device.previousOffline = TimingWheel::none;
+    device.nextOffline = offlineHead;
+
+    if (offlineHead != TimingWheel::none)
+    {
+        devices[offlineHead].previousOffline = entry;
+    }
+
+    offlineHead = entry;
+    offlineCount++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LivenessTracker::unlinkOffline(const uint32_t entry)
+{
+    Device &device(devices[entry]);
+
+    if (device.previousOffline != TimingWheel::none)
+    {
+        devices[device.previousOffline].nextOffline = device.nextOffline;
+    }
+    else
+    {
+        offlineHead = device.nextOffline;
+    }
+
+    if (device.nextOffline != TimingWheel::none)
+    {
+        devices[device.nextOffline].previousOffline = device.previousOffline;
+    }
+
+    device.offline = false;
+    offlineCount--;
+}
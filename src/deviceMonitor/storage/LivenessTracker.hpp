@@ -0,0 +1,137 @@
+#ifndef LIVENESSTRACKER_HPP
+#define LIVENESSTRACKER_HPP
+
+#include "DeviceTable.hpp"
+#include "TimingWheel.hpp"
+#include "Logger.hpp"
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief detection of silent devices and eviction of idle ones
+ *
+ * Writers only store time of the batch into device record. Every device has
+ * one entry on a timing wheel with one second ticks, due when the device would
+ * time out if nothing more arrived; when it expires, the tracker reads the real
+ * last seen time and either reschedules the entry or marks the device offline.
+ * Per message cost is a single store and wheel work is one step per device and
+ * timeout period. Offline devices are kept in their own list, so listing them
+ * does not scan the device table; they are checked again every timeout period
+ * and, if eviction is enabled, removed from storage once idle beyond retention.
+ */
+class LivenessTracker final
+{
+public:
+    LivenessTracker() = delete;
+
+    /**
+     * @brief enable tracker; must be called before any batch is added to storage
+     *
+     * @param enabled false keeps tracker disabled and track() and tick() return immediately
+     * @param offlineTimeout seconds without message after which device is offline
+     * @param evict true to remove devices from storage when idle beyond retention
+     * @param retention seconds without message after which offline device is evicted
+     * @param archiveFile file receiving final counters of evicted devices; empty disables archive
+     */
+    static void configure(const bool enabled, const uint64_t offlineTimeout, const bool evict, const uint64_t retention,
+                          const std::string &archiveFile);
+
+    /**
+     * @brief Get current time of liveness clock (steady clock milliseconds)
+     *
+     * @return int64_t
+     */
+    static int64_t getTime(void);
+
+    /**
+     * @brief start tracking new device; called once by writer that inserted the record
+     *
+     * @param deviceId device id
+     * @param record device record with last seen time already set
+     */
+    static void track(const uint32_t deviceId, DeviceTable::DeviceRecord &record);
+
+    /**
+     * @brief advance timing wheel to current time, update offline devices and evict idle ones;
+     * called periodically by application main loop, which must not hold NameDictionary::Guard
+     *
+     * @param evicted output ids of devices removed from data storage; retired in NameDictionary,
+     * so caller recycles them once other stores keyed by id forgot them
+     */
+    static void tick(std::vector<uint32_t> &evicted);
+
+    /**
+     * @brief Get offline devices with seconds since their last message, followed by counts
+     *
+     * @return std::string
+     */
+    static std::string getOffline(void);
+
+private:
+    struct Device
+    {
+        uint32_t deviceId;
+        // nullptr marks free entry
+        DeviceTable::DeviceRecord *record;
+        bool offline;
+        // neighbours in list of offline devices
+        uint32_t previousOffline;
+        uint32_t nextOffline;
+    };
+
+    /**
+     * @brief handle expired wheel entry of device
+     *
+     * @param entry device entry
+     * @param now current tick
+     * @param evicted ids of devices to evict
+     */
+    static void expire(const uint32_t entry, const uint64_t now, std::vector<uint32_t> &evicted);
+
+    /**
+     * @brief Get last seen time of device in ticks
+     *
+     * @param device tracked device
+     * @return uint64_t
+     */
+    static uint64_t getLastSeen(const Device &device);
+
+    /**
+     * @brief add device to head of offline list
+     *
+     * @param entry device entry
+     */
+    static void linkOffline(const uint32_t entry);
+
+    /**
+     * @brief remove device from offline list
+     *
+     * @param entry device entry
+     */
+    static void unlinkOffline(const uint32_t entry);
+
+    // guards everything below except registrations
+    static std::mutex trackerLock;
+    static bool enabled;
+    static bool evictIdle;
+    static uint64_t offlineTimeout;
+    static uint64_t retention;
+    static std::string archiveFile;
+    static std::unique_ptr<TimingWheel> wheel;
+    static std::vector<Device> devices;
+    static std::vector<uint32_t> freeEntries;
+    static uint32_t offlineHead;
+    static uint64_t offlineCount;
+    static uint64_t evictedCount;
+
+    // devices inserted by writers since last tick; separate lock keeps writers off the wheel
+    static std::mutex registrationLock;
+    static std::vector<std::pair<uint32_t, DeviceTable::DeviceRecord *>> registrations;
+};
+
+#endif
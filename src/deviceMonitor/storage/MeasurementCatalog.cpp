@@ -0,0 +1,327 @@
+#include "MeasurementCatalog.hpp"
+#include "FlatHashMap.hpp"
+#include "Logger.hpp"
+#include "fnv.hpp"
+#include <cstring>
+#include <fstream>
+#include <rapidjson/istreamwrapper.h>
+
+std::vector<std::string> MeasurementCatalog::kinds;
+std::vector<MeasurementCatalog::Fault> MeasurementCatalog::faults;
+uint64_t MeasurementCatalog::fingerprint(0);
+std::vector<MeasurementCatalog::Slot> MeasurementCatalog::slots;
+uint64_t MeasurementCatalog::seed(0);
+unsigned MeasurementCatalog::shift(64);
+bool MeasurementCatalog::wholeKeys(false);
+
+namespace
+{
+    // largest perfect hash table tried before loading fails
+    const size_t maxTableSize(1 << 16);
+
+    ////////////////////////////////////////////////////////////////////////////
+    bool isNumber(const rapidjson::Value &property)
+    {
+        return property.IsObject() && property.HasMember("type") && property["type"].IsString() &&
+               ((strcmp(property["type"].GetString(), "number") == 0) || (strcmp(property["type"].GetString(), "integer") == 0));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool MeasurementCatalog::load(const std::string &schemaFile)
+try
+{
+    std::ifstream inputFileStream(schemaFile);
+    rapidjson::IStreamWrapper inputStreamWrapper(inputFileStream);
+    rapidjson::Document jsonDocument;
+
+    if (!inputFileStream.is_open() || jsonDocument.ParseStream(inputStreamWrapper).HasParseError())
+    {
+        LOG_FMT_ERR("unable to read message schema %s", schemaFile.c_str());
+        return false;
+    }
+
+    return load(jsonDocument);
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to load measurement catalog: %s", ex.what());
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool MeasurementCatalog::load(const rapidjson::Value &schema)
+{
+    kinds.clear();
+    faults.clear();
+
+    if (!schema.IsObject() || !schema.HasMember("properties") || !schema["properties"].IsObject())
+    {
+        LOG_MSG_ERR("message schema has no properties");
+        return false;
+    }
+
+    const rapidjson::Value &properties(schema["properties"]);
+    std::string keys;
+
+    for (auto property(properties.MemberBegin()); property != properties.MemberEnd(); ++property)
+    {
+        const std::string key(property->name.GetString(), property->name.GetStringLength());
+        const rapidjson::Value &definition(property->value);
+
+        if ((key == "name") || (key == "timestamp") || !definition.IsObject() || !definition.HasMember("properties") ||
+            !definition["properties"].IsObject() || !definition["properties"].HasMember("value") ||
+            !isNumber(definition["properties"]["value"]))
+        {
+            continue;
+        }
+
+        if (kinds.size() == maxKinds)
+        {
+            LOG_FMT_ERR("message schema defines more than %u measurements", maxKinds);
+            return false;
+        }
+
+        kinds.push_back(key);
+        keys.append(key).push_back('\0');
+        const rapidjson::Value &fields(definition["properties"]);
+
+        if (!fields.HasMember("fault") || !fields["fault"].IsObject() || !fields["fault"].HasMember("enum") ||
+            !fields["fault"]["enum"].IsArray())
+        {
+            continue;
+        }
+
+        const rapidjson::Value &values(fields["fault"]["enum"]);
+
+        for (auto fault(values.Begin()); fault != values.End(); ++fault)
+        {
+            // empty value reports no fault
+            if (!fault->IsString() || (fault->GetStringLength() == 0))
+            {
+                continue;
+            }
+
+            if (faults.size() == maxFaults)
+            {
+                LOG_FMT_ERR("message schema defines more than %u faults", maxFaults);
+                return false;
+            }
+
+            faults.push_back(Fault{std::string(fault->GetString(), fault->GetStringLength()), static_cast<unsigned>(kinds.size() - 1)});
+            keys.append(fault->GetString(), fault->GetStringLength()).push_back('\0');
+        }
+
+        keys.push_back('\0');
+    }
+
+    if (kinds.empty())
+    {
+        LOG_MSG_ERR("message schema defines no measurement");
+        return false;
+    }
+
+    fingerprint = fnv::Fnv64a(keys.data(), keys.size());
+    buildTable();
+
+    if (slots.empty())
+    {
+        LOG_MSG_ERR("unable to build dispatch table of message keys");
+        return false;
+    }
+
+    std::string names;
+
+    for (const auto &kind : kinds)
+    {
+        names += names.empty() ? kind : ", " + kind;
+    }
+
+    LOG_FMT_INF("measurement catalog: %s; %zu faults; dispatch table of %zu slots", names.c_str(), faults.size(), slots.size());
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint8_t MeasurementCatalog::lookup(const char *key, const uint32_t length)
+{
+    uint64_t head;
+    uint64_t tail;
+    getWords(key, length, head, tail);
+    const Slot &slot(slots[getSlot(key, length, head, tail)]);
+
+    // words hold all bytes of keys up to 16 bytes
+    if ((slot.head != head) || (slot.tail != tail) || (slot.key.size() != length) ||
+        ((length > 16) && (memcmp(slot.key.data(), key, length) != 0)))
+    {
+        return fieldUnknown;
+    }
+
+    return slot.code;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool MeasurementCatalog::find(const std::string &key, unsigned &kind)
+{
+    const uint8_t code(lookup(key.data(), static_cast<uint32_t>(key.size())));
+
+    if (code >= kinds.size())
+    {
+        return false;
+    }
+
+    kind = code;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint8_t MeasurementCatalog::findFault(const unsigned kind, const char *fault, const uint32_t length)
+{
+    // measurement has only few faults
+    for (size_t index(0); index < faults.size(); ++index)
+    {
+        if ((faults[index].kind == kind) && (faults[index].key.size() == length) && (memcmp(faults[index].key.data(), fault, length) == 0))
+        {
+            return static_cast<uint8_t>(index);
+        }
+    }
+
+    return noFault;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const char *MeasurementCatalog::getKey(const unsigned kind)
+{
+    return kinds[kind].c_str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const char *MeasurementCatalog::getFaultKey(const unsigned fault)
+{
+    return faults[fault].key.c_str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned MeasurementCatalog::getFaultKind(const unsigned fault)
+{
+    return faults[fault].kind;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t MeasurementCatalog::getFingerprint(void)
+{
+    return fingerprint;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MeasurementCatalog::buildTable(void)
+{
+    std::vector<Slot> keys;
+
+    for (size_t kind(0); kind < kinds.size(); ++kind)
+    {
+        keys.push_back(makeSlot(kinds[kind], static_cast<uint8_t>(kind)));
+    }
+
+    keys.push_back(makeSlot("name", fieldName));
+    keys.push_back(makeSlot("timestamp", fieldTimestamp));
+
+    // keys alike in length, head and tail can not be told apart by any seed; such schema hashes whole keys
+    wholeKeys = false;
+
+    for (size_t first(0); first < keys.size(); ++first)
+    {
+        for (size_t second(first + 1); second < keys.size(); ++second)
+        {
+            wholeKeys = wholeKeys || ((keys[first].head == keys[second].head) && (keys[first].tail == keys[second].tail) &&
+                                      (keys[first].key.size() == keys[second].key.size())) ||
+                        (getWordHash(keys[first]) == getWordHash(keys[second]));
+        }
+    }
+
+    size_t tableSize(8);
+    shift = 61;
+
+    while (tableSize < 2 * keys.size())
+    {
+        tableSize <<= 1;
+        --shift;
+    }
+
+    // few keys in a table twice their count find collision free seed within several tries
+    for (; tableSize <= maxTableSize; tableSize <<= 1, --shift)
+    {
+        for (uint64_t attempt(0); attempt < 64; ++attempt)
+        {
+            // multiplier of multiply-shift hashing must be odd
+            seed = hashMix(attempt) | 1;
+            slots.assign(tableSize, makeSlot(std::string(), fieldUnknown));
+            bool collision(false);
+
+            for (const auto &key : keys)
+            {
+                Slot &slot(slots[getSlot(key.key.data(), static_cast<uint32_t>(key.key.size()), key.head, key.tail)]);
+                collision = collision || !slot.key.empty();
+                slot = key;
+            }
+
+            if (!collision)
+            {
+                return;
+            }
+        }
+    }
+
+    slots.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MeasurementCatalog::Slot MeasurementCatalog::makeSlot(const std::string &key, const uint8_t code)
+{
+    Slot slot{key, 0, 0, code};
+    getWords(key.data(), static_cast<uint32_t>(key.size()), slot.head, slot.tail);
+    return slot;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MeasurementCatalog::getWords(const char *key, const uint32_t length, uint64_t &head, uint64_t &tail)
+{
+    // fixed size copies compile to unaligned loads; first and last word overlap for short keys
+    if (length >= 8)
+    {
+        memcpy(&head, key, 8);
+        memcpy(&tail, key + length - 8, 8);
+        return;
+    }
+
+    if (length >= 4)
+    {
+        uint32_t first;
+        uint32_t last;
+        memcpy(&first, key, 4);
+        memcpy(&last, key + length - 4, 4);
+        head = first;
+        tail = last;
+        return;
+    }
+
+    head = 0;
+    tail = 0;
+
+    for (uint32_t index(0); index < length; ++index)
+    {
+        head = (head << 8) | static_cast<uint8_t>(key[index]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t MeasurementCatalog::getWordHash(const Slot &slot)
+{
+    return (slot.head * 0x9e3779b97f4a7c15ULL) ^ slot.tail ^ slot.key.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t MeasurementCatalog::getSlot(const char *key, const uint32_t length, const uint64_t head, const uint64_t tail)
+{
+    const uint64_t hash(wholeKeys ? fnv::Fnv64a(key, length) : ((head * 0x9e3779b97f4a7c15ULL) ^ tail ^ length));
+    return static_cast<size_t>((hash * seed) >> shift);
+}
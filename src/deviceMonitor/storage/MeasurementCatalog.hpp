@@ -0,0 +1,204 @@
+#ifndef MEASUREMENTCATALOG_HPP
+#define MEASUREMENTCATALOG_HPP
+
+#include <cinttypes>
+#include <rapidjson/document.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief measurement kinds and their faults read from message schema
+ *
+ * Every property of the schema that is an object with numeric "value" is one
+ * measurement kind; non-empty values of its "fault" enum are its faults. Kinds
+ * and faults get dense indexes in schema order, so storage keeps counters of
+ * a device in arrays sized to the catalog. Message members are dispatched by
+ * a perfect hash built when the catalog is loaded: every known key (including
+ * "name" and "timestamp") has its own slot, so one multiply-shift hash of its
+ * first and last word and one comparison of those words classify any member.
+ * Catalog is loaded once before any message is processed and does not change
+ * afterwards.
+ */
+class MeasurementCatalog final
+{
+public:
+    // upper bounds of catalog size; kinds and faults of a record are stored in one byte
+    static const unsigned maxKinds = 16;
+    static const unsigned maxFaults = 64;
+
+    // codes of message members returned by lookup() besides measurement kinds
+    static const uint8_t fieldName = maxKinds;
+    static const uint8_t fieldTimestamp = maxKinds + 1;
+    static const uint8_t fieldUnknown = maxKinds + 2;
+
+    // fault index of measurement without fault
+    static const uint8_t noFault = UINT8_MAX;
+
+    MeasurementCatalog() = delete;
+
+    /**
+     * @brief load catalog from message schema file
+     *
+     * @param schemaFile JSON schema of messages
+     * @return true on success
+     * @return false if schema can not be read or defines no or too many measurements
+     */
+    static bool load(const std::string &schemaFile);
+
+    /**
+     * @brief load catalog from parsed message schema
+     *
+     * @param schema JSON schema of messages
+     * @return true on success
+     * @return false if schema defines no or too many measurements
+     */
+    static bool load(const rapidjson::Value &schema);
+
+    /**
+     * @brief classify message member by its key
+     *
+     * @param key member key, need not be terminated
+     * @param length key length
+     * @return uint8_t measurement kind, fieldName, fieldTimestamp or fieldUnknown
+     */
+    static uint8_t lookup(const char *key, const uint32_t length);
+
+    /**
+     * @brief find measurement kind by its key
+     *
+     * @param key measurement key
+     * @param kind output kind
+     * @return true on success
+     * @return false if key is not a measurement of catalog
+     */
+    static bool find(const std::string &key, unsigned &kind);
+
+    /**
+     * @brief find fault of measurement by "fault" value
+     *
+     * @param kind measurement kind
+     * @param fault "fault" value, need not be terminated
+     * @param length value length
+     * @return uint8_t fault index or noFault if value is not known fault of this measurement
+     */
+    static uint8_t findFault(const unsigned kind, const char *fault, const uint32_t length);
+
+    /**
+     * @brief Get number of measurement kinds; inline as it bounds every loop over measurements
+     *
+     * @return unsigned
+     */
+    static unsigned size(void) { return static_cast<unsigned>(kinds.size()); }
+
+    /**
+     * @brief Get number of faults of all measurements
+     *
+     * @return unsigned
+     */
+    static unsigned getFaultCount(void) { return static_cast<unsigned>(faults.size()); }
+
+    /**
+     * @brief Get key of measurement kind
+     *
+     * @param kind measurement kind
+     * @return const char*
+     */
+    static const char *getKey(const unsigned kind);
+
+    /**
+     * @brief Get key of fault
+     *
+     * @param fault fault index
+     * @return const char*
+     */
+    static const char *getFaultKey(const unsigned fault);
+
+    /**
+     * @brief Get measurement kind reporting fault
+     *
+     * @param fault fault index
+     * @return unsigned
+     */
+    static unsigned getFaultKind(const unsigned fault);
+
+    /**
+     * @brief Get hash of all keys in catalog order; files storing counters by index
+     * record it to detect catalog changes
+     *
+     * @return uint64_t
+     */
+    static uint64_t getFingerprint(void);
+
+private:
+    struct Slot
+    {
+        std::string key;
+        uint64_t head;
+        uint64_t tail;
+        uint8_t code;
+    };
+
+    struct Fault
+    {
+        std::string key;
+        unsigned kind;
+    };
+
+    /**
+     * @brief find seed and table size under which all member keys get distinct slots
+     *
+     */
+    static void buildTable(void);
+
+    /**
+     * @brief make slot of key with its words
+     *
+     * @param key key
+     * @param code code returned by lookup()
+     * @return Slot
+     */
+    static Slot makeSlot(const std::string &key, const uint8_t code);
+
+    /**
+     * @brief Get first and last bytes of key as two words; together with length they tell apart
+     * any keys of up to 16 bytes
+     *
+     * @param key key
+     * @param length key length
+     * @param head first up to eight bytes
+     * @param tail last up to eight bytes
+     */
+    static void getWords(const char *key, const uint32_t length, uint64_t &head, uint64_t &tail);
+
+    /**
+     * @brief Get hash of slot key from its length and words
+     *
+     * @param slot slot
+     * @return uint64_t
+     */
+    static uint64_t getWordHash(const Slot &slot);
+
+    /**
+     * @brief Get slot of key under current seed by multiply-shift hashing of its words, or of
+     * whole key if the catalog has keys that are alike in those
+     *
+     * @param key key
+     * @param length key length
+     * @param head first word of key
+     * @param tail last word of key
+     * @return size_t
+     */
+    static size_t getSlot(const char *key, const uint32_t length, const uint64_t head, const uint64_t tail);
+
+    static std::vector<std::string> kinds;
+    static std::vector<Fault> faults;
+    static uint64_t fingerprint;
+    // perfect hash table of member keys; empty key marks unused slot
+    static std::vector<Slot> slots;
+    // odd multiplier and shift of multiply-shift hashing
+    static uint64_t seed;
+    static unsigned shift;
+    static bool wholeKeys;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "MeasurementStats.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+////////////////////////////////////////////////////////////////////////////////
+void MeasurementStats::merge(const MeasurementStats &other)
+{
+    if (other.count == 0)
+    {
+        return;
+    }
+
+    if (count == 0)
+    {
+        *this = other;
+        return;
+    }
+
+    const double thisCount(static_cast<double>(count));
+    const double otherCount(static_cast<double>(other.count));
+    const double total(thisCount + otherCount);
+    const double delta(other.mean - mean);
+
+    mean += delta * otherCount / total;
+    m2 += other.m2 + delta * delta * thisCount * otherCount / total;
+    minimum = std::min(minimum, other.minimum);
+    maximum = std::max(maximum, other.maximum);
+    last = other.last;
+    count += other.count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double MeasurementStats::getVariance(void) const
+{
+    return (count == 0) ? 0.0 : m2 / static_cast<double>(count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AtomicMeasurementStats::add(const MeasurementStats &stats)
+{
+    if (stats.count == 0)
+    {
+        return;
+    }
+
+    // first writer after clear() picks the shift, the others use the one it won with
+    double base(shift.load(std::memory_order_relaxed));
+
+    if (std::isnan(base) && shift.compare_exchange_strong(base, stats.mean, std::memory_order_relaxed))
+    {
+        base = stats.mean;
+    }
+
+    const double statsCount(static_cast<double>(stats.count));
+    const double deviation(stats.mean - base);
+    double value(sum.load(std::memory_order_relaxed));
+
+    while (!sum.compare_exchange_weak(value, value + statsCount * deviation, std::memory_order_relaxed))
+    {
+    }
+
+    value = squares.load(std::memory_order_relaxed);
+
+    while (!squares.compare_exchange_weak(value, value + stats.m2 + statsCount * deviation * deviation, std::memory_order_relaxed))
+    {
+    }
+
+    value = minimum.load(std::memory_order_relaxed);
+
+    while ((stats.minimum < value) && !minimum.compare_exchange_weak(value, stats.minimum, std::memory_order_relaxed))
+    {
+    }
+
+    value = maximum.load(std::memory_order_relaxed);
+
+    while ((stats.maximum > value) && !maximum.compare_exchange_weak(value, stats.maximum, std::memory_order_relaxed))
+    {
+    }
+
+    // batches of one epoch are not ordered among writers; any of them is the last one
+    last.store(stats.last, std::memory_order_relaxed);
+    count.fetch_add(stats.count, std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AtomicMeasurementStats::get(MeasurementStats &stats) const
+{
+    stats.count = count.load(std::memory_order_relaxed);
+
+    if (stats.count == 0)
+    {
+        stats = MeasurementStats();
+        return;
+    }
+
+    const double statsCount(static_cast<double>(stats.count));
+    const double deviations(sum.load(std::memory_order_relaxed));
+    stats.mean = shift.load(std::memory_order_relaxed) + deviations / statsCount;
+    stats.m2 = std::max(squares.load(std::memory_order_relaxed) - deviations * deviations / statsCount, 0.0);
+    stats.minimum = minimum.load(std::memory_order_relaxed);
+    stats.maximum = maximum.load(std::memory_order_relaxed);
+    stats.last = last.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AtomicMeasurementStats::clear(void)
+{
+    // NaN marks shift not chosen yet
+    count.store(0, std::memory_order_relaxed);
+    shift.store(std::numeric_limits<double>::quiet_NaN(), std::memory_order_relaxed);
+    sum.store(0.0, std::memory_order_relaxed);
+    squares.store(0.0, std::memory_order_relaxed);
+    minimum.store(std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+    maximum.store(-std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+    last.store(0.0, std::memory_order_relaxed);
+}
@@ -0,0 +1,79 @@
+#ifndef MEASUREMENTSTATS_HPP
+#define MEASUREMENTSTATS_HPP
+
+#include <atomic>
+#include <cinttypes>
+
+/**
+ * @brief streaming statistics of one measurement
+ *
+ * Mean and sum of squared deviations are kept in Welford form, so partial
+ * statistics (i.e. of one batch) are merged by parallel variant of Welford's
+ * update (Chan et al.) without loss of precision. Zero initialized object is empty.
+ */
+struct MeasurementStats
+{
+    uint64_t count;
+    double minimum;
+    double maximum;
+    double mean;
+    // sum of squared deviations from mean
+    double m2;
+    double last;
+
+    /**
+     * @brief merge statistics of values that came after values of this object
+     *
+     * @param other statistics to merge
+     */
+    void merge(const MeasurementStats &other);
+
+    /**
+     * @brief Get population variance
+     *
+     * @return double variance; zero if there are no values
+     */
+    double getVariance(void) const;
+};
+
+/**
+ * @brief statistics of one measurement updated by concurrent writers without lock
+ *
+ * Values are summed as deviations from a shift, the mean of the first statistics
+ * added after clear(), so that sum of squares does not lose the variance to
+ * cancellation; conversion back to Welford form happens only when the statistics
+ * are read. Object must be cleared before first use.
+ */
+struct AtomicMeasurementStats
+{
+    std::atomic<uint64_t> count;
+    std::atomic<double> shift;
+    // sum of deviations from shift and sum of their squares
+    std::atomic<double> sum;
+    std::atomic<double> squares;
+    std::atomic<double> minimum;
+    std::atomic<double> maximum;
+    std::atomic<double> last;
+
+    /**
+     * @brief add statistics of values; safe to call concurrently
+     *
+     * @param stats added statistics
+     */
+    void add(const MeasurementStats &stats);
+
+    /**
+     * @brief Get statistics in Welford form; concurrent add() may be seen partially
+     *
+     * @param stats output statistics
+     */
+    void get(MeasurementStats &stats) const;
+
+    /**
+     * @brief reset to no values; no add() may run concurrently
+     *
+     */
+    void clear(void);
+};
+
+#endif
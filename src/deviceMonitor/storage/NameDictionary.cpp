@@ -0,0 +1,394 @@
+#include "NameDictionary.hpp"
+#include "../runtime/MemoryArena.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+const size_t NameDictionary::nameBlockSize;
+std::mutex NameDictionary::dictionaryLock;
+std::mutex NameDictionary::retireLock;
+WriteEpoch NameDictionary::readers;
+std::atomic<NameDictionary::Index *> NameDictionary::index(nullptr);
+std::vector<std::unique_ptr<NameDictionary::Index>> NameDictionary::generations;
+std::atomic<NameDictionary::Entry *> NameDictionary::chunks[(UINT32_MAX >> NameDictionary::chunkBits) + 1];
+char *NameDictionary::nameBlock(nullptr);
+size_t NameDictionary::nameBlockUsed(0);
+std::vector<uint32_t> NameDictionary::freeIds;
+std::vector<std::vector<char *>> NameDictionary::freeNames;
+std::atomic<uint32_t> NameDictionary::count(0);
+std::atomic<uint32_t> NameDictionary::live(0);
+size_t NameDictionary::occupied(0);
+std::atomic<uint64_t> NameDictionary::collisions(0);
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t NameDictionary::intern(const char *name, const uint32_t length, const uint64_t hash)
+{
+    uint32_t id(0);
+
+    if (find(name, length, hash, id))
+    {
+        return id;
+    }
+
+    std::lock_guard<std::mutex> lock(dictionaryLock);
+
+    // tombstones of retired names take slots as well
+    if ((index.load(std::memory_order_relaxed) == nullptr) || (4 * (occupied + 1) > 3 * (index.load(std::memory_order_relaxed)->mask + 1)))
+    {
+        if (!grow())
+        {
+            return noId;
+        }
+    }
+
+    // name might have been inserted by other writer since lock-free lookup failed
+    bool collision(false);
+    const uint32_t stored(lookup(*index.load(std::memory_order_relaxed), name, length, hash, collision));
+
+    if (stored != 0)
+    {
+        return stored - 1;
+    }
+
+    const uint32_t used(count.load(std::memory_order_relaxed));
+    id = freeIds.empty() ? used : freeIds.back();
+
+    if (freeIds.empty() && (used == maxNames))
+    {
+        throw std::length_error("name dictionary is full");
+    }
+
+    if (freeIds.empty() && (used % chunkSize == 0) && (chunks[used >> chunkBits].load(std::memory_order_relaxed) == nullptr))
+    {
+        // entries are written only when used, so untouched part of chunk stays unmapped
+        Entry *chunk(static_cast<Entry *>(MemoryArena::allocate(MemoryArena::subsystemNames, chunkSize * sizeof(Entry))));
+
+        if (chunk == nullptr)
+        {
+            return noId;
+        }
+
+        chunks[used >> chunkBits].store(chunk, std::memory_order_release);
+    }
+
+    uint32_t capacity(0);
+    char *copy(allocateName(length, capacity));
+
+    if (copy == nullptr)
+    {
+        return noId;
+    }
+
+    std::memcpy(copy, name, length);
+
+    Entry &entry(getEntry(id));
+    entry.name = copy;
+    entry.length = length;
+    entry.capacity = capacity;
+    entry.hash = hash;
+    entry.state.store(stateLive, std::memory_order_relaxed);
+
+    if (freeIds.empty())
+    {
+        count.store(used + 1, std::memory_order_relaxed);
+    }
+    else
+    {
+        freeIds.pop_back();
+    }
+
+    publish(*index.load(std::memory_order_relaxed), hash, id);
+    occupied++;
+    live.store(live.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    if (collision)
+    {
+        collisions.fetch_add(1, std::memory_order_relaxed);
+        LOG_FMT_WRN("device name %s collides with earlier name of hash %016" PRIx64 "; kept as separate device",
+                    std::string(name, length).c_str(), hash);
+    }
+
+    return id;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool NameDictionary::find(const char *name, const uint32_t length, const uint64_t hash, uint32_t &id)
+{
+    const Index *current(index.load(std::memory_order_acquire));
+
+    if (current == nullptr)
+    {
+        return false;
+    }
+
+    bool collision(false);
+    const uint32_t stored(lookup(*current, name, length, hash, collision));
+
+    if (stored == 0)
+    {
+        return false;
+    }
+
+    id = stored - 1;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool NameDictionary::pin(const uint32_t id)
+{
+    uint32_t expected(stateLive);
+    return getEntry(id).state.compare_exchange_strong(expected, statePinned) || (expected == statePinned);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NameDictionary::retire(const std::vector<uint32_t> &ids)
+{
+    std::lock_guard<std::mutex> retiring(retireLock);
+    size_t reclaimable(0);
+
+    {
+        std::lock_guard<std::mutex> lock(dictionaryLock);
+
+        for (const uint32_t id : ids)
+        {
+            Entry &entry(getEntry(id));
+            uint32_t expected(stateLive);
+
+            // pinning and retiring exclude each other, so rollup keeps its id
+            if (entry.state.compare_exchange_strong(expected, stateRetired))
+            {
+                unpublish(*index.load(std::memory_order_relaxed), entry.hash, id);
+                live.store(live.load(std::memory_order_relaxed) - 1, std::memory_order_release);
+            }
+        }
+
+        reclaimable = generations.size() - 1;
+    }
+
+    // every guard that found retired id or used replaced index entered before the flip; guards
+    // entered after it see the tombstones
+    readers.flip();
+
+    std::lock_guard<std::mutex> lock(dictionaryLock);
+
+    // generations are only appended, so marked ones are still the first
+    for (size_t generation(0); generation < reclaimable; ++generation)
+    {
+        MemoryArena::discharge(MemoryArena::subsystemNames, sizeof(Index) + (generations[generation]->mask + 1) * sizeof(Slot));
+    }
+
+    generations.erase(generations.begin(), generations.begin() + static_cast<std::ptrdiff_t>(reclaimable));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NameDictionary::recycle(const std::vector<uint32_t> &ids)
+{
+    std::lock_guard<std::mutex> retireGuard(retireLock);
+
+    // readers that found ids in a store before it forgot them may still read their names
+    readers.flip();
+
+    std::lock_guard<std::mutex> lock(dictionaryLock);
+
+    for (const uint32_t id : ids)
+    {
+        Entry &entry(getEntry(id));
+        uint32_t expected(stateRetired);
+
+        if (!entry.state.compare_exchange_strong(expected, stateFree))
+        {
+            continue;
+        }
+
+        const size_t granules(entry.capacity / nameGranule);
+
+        if (freeNames.size() <= granules)
+        {
+            freeNames.resize(granules + 1);
+        }
+
+        freeNames[granules].push_back(entry.name);
+        entry.name = nullptr;
+        entry.length = 0;
+        entry.capacity = 0;
+        freeIds.push_back(id);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const char *NameDictionary::getName(const uint32_t id)
+{
+    return getEntry(id).name;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t NameDictionary::getLength(const uint32_t id)
+{
+    return getEntry(id).length;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t NameDictionary::getHash(const uint32_t id)
+{
+    return getEntry(id).hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t NameDictionary::size(void)
+{
+    return live.load(std::memory_order_acquire);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t NameDictionary::getCollisions(void)
+{
+    return collisions.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t NameDictionary::lookup(const Index &index, const char *name, const uint32_t length, const uint64_t hash, bool &collision)
+{
+    for (size_t slot(hashMix(hash) & index.mask);; slot = (slot + 1) & index.mask)
+    {
+        // acquire pairs with release in publish(), so hash and entry of the id are visible
+        const uint32_t stored(index.slots[slot].id.load(std::memory_order_acquire));
+
+        if (stored == 0)
+        {
+            return 0;
+        }
+
+        if ((stored == removedSlot) || (index.slots[slot].hash.load(std::memory_order_relaxed) != hash))
+        {
+            continue;
+        }
+
+        const Entry &entry(getEntry(stored - 1));
+
+        if ((entry.length == length) && (std::memcmp(entry.name, name, length) == 0))
+        {
+            return stored;
+        }
+
+        collision = true;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NameDictionary::publish(Index &index, const uint64_t hash, const uint32_t id)
+{
+    size_t slot(hashMix(hash) & index.mask);
+
+    while (index.slots[slot].id.load(std::memory_order_relaxed) != 0)
+    {
+        slot = (slot + 1) & index.mask;
+    }
+
+    index.slots[slot].hash.store(hash, std::memory_order_relaxed);
+    index.slots[slot].id.store(id + 1, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NameDictionary::unpublish(Index &index, const uint64_t hash, const uint32_t id)
+{
+    for (size_t slot(hashMix(hash) & index.mask);; slot = (slot + 1) & index.mask)
+    {
+        const uint32_t stored(index.slots[slot].id.load(std::memory_order_relaxed));
+
+        if (stored == 0)
+        {
+            return;
+        }
+
+        if (stored == id + 1)
+        {
+            // slot stays occupied, so probe sequences passing through it stay intact
+            index.slots[slot].id.store(removedSlot, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool NameDictionary::grow(void)
+{
+    const Index *previous(index.load(std::memory_order_relaxed));
+    size_t capacity(1024);
+
+    // rebuilt index is at most 3/8 full, so it takes as many new names again before next rebuild
+    while (8 * (static_cast<size_t>(live.load(std::memory_order_relaxed)) + 1) > 3 * capacity)
+    {
+        capacity *= 2;
+    }
+
+    if (!MemoryArena::charge(MemoryArena::subsystemNames, sizeof(Index) + capacity * sizeof(Slot)))
+    {
+        return false;
+    }
+
+    std::unique_ptr<Index> grown(new Index(capacity));
+
+    if (previous != nullptr)
+    {
+        for (size_t slot(0); slot <= previous->mask; ++slot)
+        {
+            const uint32_t stored(previous->slots[slot].id.load(std::memory_order_relaxed));
+
+            if ((stored != 0) && (stored != removedSlot))
+            {
+                publish(*grown, previous->slots[slot].hash.load(std::memory_order_relaxed), stored - 1);
+            }
+        }
+    }
+
+    occupied = live.load(std::memory_order_relaxed);
+    index.store(grown.get(), std::memory_order_release);
+    generations.push_back(std::move(grown));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+char *NameDictionary::allocateName(const uint32_t length, uint32_t &capacity)
+{
+    // empty name takes one granule as well, so every storage can be recycled
+    const size_t granules(std::max<size_t>((static_cast<size_t>(length) + nameGranule - 1) / nameGranule, 1));
+
+    if (granules * nameGranule > UINT32_MAX)
+    {
+        return nullptr;
+    }
+
+    capacity = static_cast<uint32_t>(granules * nameGranule);
+
+    if ((granules < freeNames.size()) && !freeNames[granules].empty())
+    {
+        char *storage(freeNames[granules].back());
+        freeNames[granules].pop_back();
+        return storage;
+    }
+
+    if ((nameBlock == nullptr) || (nameBlockUsed + capacity > nameBlockSize))
+    {
+        // names longer than block get block of their own
+        char *block(static_cast<char *>(MemoryArena::allocate(MemoryArena::subsystemNames, std::max<size_t>(nameBlockSize, capacity))));
+
+        if (block == nullptr)
+        {
+            return nullptr;
+        }
+
+        nameBlock = block;
+        nameBlockUsed = 0;
+    }
+
+    char *storage(nameBlock + nameBlockUsed);
+    nameBlockUsed += capacity;
+    return storage;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NameDictionary::Entry &NameDictionary::getEntry(const uint32_t id)
+{
+    return chunks[id >> chunkBits].load(std::memory_order_acquire)[id & (chunkSize - 1)];
+}
@@ -0,0 +1,262 @@
+#ifndef NAMEDICTIONARY_HPP
+#define NAMEDICTIONARY_HPP
+
+#include "FlatHashMap.hpp"
+#include "WriteEpoch.hpp"
+#include "Logger.hpp"
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief process wide dictionary of interned device names with dense 32-bit ids
+ *
+ * Every distinct name is copied into blocks that never move and gets a free id,
+ * so ids can index arrays and name pointers stay valid while the id is in use.
+ * Lookup takes name bytes with their precomputed 64-bit hash and no lock:
+ * slots of open addressing index hold (hash, id) and are published by release
+ * store of the id, grown index replaces the old one like in DeviceTable.
+ * Equal hashes are confirmed by comparing names, so names whose hashes collide
+ * get distinct ids instead of being merged. Only insertion of a new name takes
+ * the dictionary lock. Ids of evicted devices are retired: their slots become
+ * tombstones, so the name gets a new id when it is seen again, and once every
+ * thread that could hold the old id has left its Guard and every store keyed
+ * by id has forgotten it, the id and its name storage are recycled for the
+ * next new name. Ids pinned by rollup records are never retired. Entries and
+ * names are taken from MemoryArena; once its budget is reached new names are
+ * refused until evicted ones are recycled, while known names are still found.
+ */
+class NameDictionary final
+{
+public:
+    // returned by intern() when new name does not fit in memory budget
+    static const uint32_t noId = UINT32_MAX;
+
+    // keeps ids found or interned by its owner from being recycled while it exists; held by every
+    // thread using ids while eviction may run, for as long as it uses them
+    class Guard final
+    {
+    public:
+        Guard() : guard(readers) {}
+
+    private:
+        WriteEpoch::Guard guard;
+    };
+
+    NameDictionary() = delete;
+
+    /**
+     * @brief find id of name or insert name with next id
+     *
+     * @param name name bytes, need not be terminated
+     * @param length name length
+     * @param hash 64-bit hash of name (fnv::Fnv64a)
+     * @return uint32_t dense id or noId if name is new and memory budget is reached
+     */
+    static uint32_t intern(const char *name, const uint32_t length, const uint64_t hash);
+
+    /**
+     * @brief find id of name without inserting
+     *
+     * @param name name bytes, need not be terminated
+     * @param length name length
+     * @param hash 64-bit hash of name (fnv::Fnv64a)
+     * @param id output id
+     * @return true if name is known
+     * @return false if name was never interned
+     */
+    static bool find(const char *name, const uint32_t length, const uint64_t hash, uint32_t &id);
+
+    /**
+     * @brief keep id published and its name unchanged for process lifetime; used for names
+     * referenced by records that are never evicted
+     *
+     * @param id id returned by intern()
+     * @return true on success
+     * @return false if id is being retired; caller interns the name again later
+     */
+    static bool pin(const uint32_t id);
+
+    /**
+     * @brief remove names of ids from index, so they are interned with new ids from now on, and
+     * wait until every Guard that may hold them is left; pinned ids are skipped. Called by one thread
+     * at a time, which must not hold a Guard
+     *
+     * @param ids ids of evicted devices
+     */
+    static void retire(const std::vector<uint32_t> &ids);
+
+    /**
+     * @brief give ids retired by retire() and their name storage to new names once every Guard that
+     * may have found them in a store is left; every store keyed by id must have forgotten them before.
+     * Called by one thread at a time, which must not hold a Guard
+     *
+     * @param ids ids passed to retire()
+     */
+    static void recycle(const std::vector<uint32_t> &ids);
+
+    /**
+     * @brief Get interned name of id returned by intern() or find()
+     *
+     * @param id dense id
+     * @return const char* name bytes, not terminated; valid until id is recycled
+     */
+    static const char *getName(const uint32_t id);
+
+    /**
+     * @brief Get length of interned name
+     *
+     * @param id dense id
+     * @return uint32_t
+     */
+    static uint32_t getLength(const uint32_t id);
+
+    /**
+     * @brief Get hash the name was interned with
+     *
+     * @param id dense id
+     * @return uint64_t fnv::Fnv64a of name
+     */
+    static uint64_t getHash(const uint32_t id);
+
+    /**
+     * @brief Get number of interned names, retired ones excluded
+     *
+     * @return uint32_t
+     */
+    static uint32_t size(void);
+
+    /**
+     * @brief Get number of interned names whose hash equals hash of an earlier name
+     *
+     * @return uint64_t
+     */
+    static uint64_t getCollisions(void);
+
+private:
+    static const unsigned chunkBits = 16;
+    static const uint32_t chunkSize = 1u << chunkBits;
+    static const size_t nameBlockSize = 65536;
+    // name storage is taken in multiples of granule, so freed storage fits names of similar length
+    static const uint32_t nameGranule = 16;
+    // all 32-bit ids fit; one id is left for the empty slot mark
+    static const uint32_t maxNames = UINT32_MAX - 1;
+
+    // state of entry; zeroed chunk memory starts live
+    enum State : uint32_t
+    {
+        stateLive = 0,
+        statePinned,
+        stateRetired,
+        stateFree
+    };
+
+    struct Entry
+    {
+        char *name;
+        uint32_t length;
+        // size of name storage
+        uint32_t capacity;
+        uint64_t hash;
+        std::atomic<uint32_t> state;
+    };
+
+    struct Slot
+    {
+        std::atomic<uint64_t> hash;
+        // id + 1; zero marks empty slot, removedSlot slot of retired id
+        std::atomic<uint32_t> id;
+    };
+
+    // maximum id + 1 is maxNames, so the mark never equals a stored id
+    static const uint32_t removedSlot = UINT32_MAX;
+
+    struct Index
+    {
+        Index(const size_t capacity) : mask(capacity - 1), slots(new Slot[capacity]()) {}
+        size_t mask;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    /**
+     * @brief find name in given index
+     *
+     * @param index dictionary index
+     * @param name name bytes
+     * @param length name length
+     * @param hash name hash
+     * @param collision set to true if other name with the same hash was passed
+     * @return uint32_t id + 1 or zero if name is not present
+     */
+    static uint32_t lookup(const Index &index, const char *name, const uint32_t length, const uint64_t hash, bool &collision);
+
+    /**
+     * @brief publish id in index; dictionary lock must be held
+     *
+     * @param index dictionary index with at least one free slot
+     * @param hash name hash
+     * @param id dense id
+     */
+    static void publish(Index &index, const uint64_t hash, const uint32_t id);
+
+    /**
+     * @brief replace slot of id with tombstone; dictionary lock must be held
+     *
+     * @param index dictionary index containing id
+     * @param hash name hash
+     * @param id published id
+     */
+    static void unpublish(Index &index, const uint64_t hash, const uint32_t id);
+
+    /**
+     * @brief publish index with all ids and no tombstones, sized to twice the number of names;
+     * dictionary lock must be held
+     *
+     * @return true on success
+     * @return false if memory budget does not allow the index
+     */
+    static bool grow(void);
+
+    /**
+     * @brief take storage for name from recycled storage of its size or from name block;
+     * dictionary lock must be held
+     *
+     * @param length name length
+     * @param capacity output size of storage
+     * @return char* storage or nullptr if memory budget is reached
+     */
+    static char *allocateName(const uint32_t length, uint32_t &capacity);
+
+    /**
+     * @brief Get entry of id
+     *
+     * @param id published id
+     * @return Entry&
+     */
+    static Entry &getEntry(const uint32_t id);
+
+    static std::mutex dictionaryLock;
+    // taken by retire(), so only one thread flips readers at a time
+    static std::mutex retireLock;
+    static WriteEpoch readers;
+    static std::atomic<Index *> index;
+    // older generations are kept until retire() waited for lookups that may still use them
+    static std::vector<std::unique_ptr<Index>> generations;
+    // chunks of entries indexed by id >> chunkBits; published by release store. Chunks and names
+    // are allocated from MemoryArena and never freed, only recycled
+    static std::atomic<Entry *> chunks[(UINT32_MAX >> chunkBits) + 1];
+    static char *nameBlock;
+    static size_t nameBlockUsed;
+    // recycled ids and name storage indexed by its size in granules
+    static std::vector<uint32_t> freeIds;
+    static std::vector<std::vector<char *>> freeNames;
+    // ids ever taken, live names and occupied slots of current index including tombstones
+    static std::atomic<uint32_t> count;
+    static std::atomic<uint32_t> live;
+    static size_t occupied;
+    static std::atomic<uint64_t> collisions;
+};
+
+#endif
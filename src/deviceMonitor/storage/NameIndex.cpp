@@ -0,0 +1,391 @@
+#include "NameIndex.hpp"
+#include "NameDictionary.hpp"
+#include "../runtime/MemoryArena.hpp"
+#include <algorithm>
+#include <cstring>
+#include <endian.h>
+
+namespace
+{
+    ////////////////////////////////////////////////////////////////////////////
+    int compareNames(const char *first, const uint32_t firstLength, const char *second, const uint32_t secondLength)
+    {
+        const int result(memcmp(first, second, std::min(firstLength, secondLength)));
+
+        if (result != 0)
+        {
+            return result;
+        }
+
+        return (firstLength < secondLength) ? -1 : ((firstLength > secondLength) ? 1 : 0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NameIndex::NameIndex() : count(0), charged(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NameIndex::~NameIndex()
+{
+    for (Leaf *leaf : leaves)
+    {
+        delete leaf;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NameIndex::insert(const uint32_t id)
+{
+    const Probe probe(makeProbe(NameDictionary::getName(id), NameDictionary::getLength(id), id));
+    const Entry &entry(probe.entry);
+    std::lock_guard<std::mutex> lock(indexLock);
+
+    if (leaves.empty())
+    {
+        // index memory only follows devices already admitted by memory budget
+        MemoryArena::charge(MemoryArena::subsystemDevices, sizeof(Leaf), false);
+        leaves.push_back(new Leaf());
+        leaves.back()->count = 0;
+        firsts.push_back(entry);
+        account();
+    }
+
+    size_t position(findLeaf(probe));
+    Leaf *leaf(leaves[position]);
+    uint32_t slot(findEntry(*leaf, probe));
+
+    if ((slot < leaf->count) && (leaf->entries[slot].id == id))
+    {
+        return;
+    }
+
+    if (leaf->count == leafCapacity)
+    {
+        // upper half moves to new leaf behind the full one
+        MemoryArena::charge(MemoryArena::subsystemDevices, sizeof(Leaf), false);
+        Leaf *upper(new Leaf());
+        upper->count = leafCapacity / 2;
+        leaf->count = leafCapacity - upper->count;
+        memcpy(upper->entries, leaf->entries + leaf->count, upper->count * sizeof(Entry));
+        leaves.insert(leaves.begin() + static_cast<std::ptrdiff_t>(position) + 1, upper);
+        firsts.insert(firsts.begin() + static_cast<std::ptrdiff_t>(position) + 1, upper->entries[0]);
+        account();
+
+        if (slot > leaf->count)
+        {
+            slot -= leaf->count;
+            leaf = upper;
+            position++;
+        }
+    }
+
+    memmove(leaf->entries + slot + 1, leaf->entries + slot, (leaf->count - slot) * sizeof(Entry));
+    leaf->entries[slot] = entry;
+    leaf->count++;
+    count++;
+
+    if (slot == 0)
+    {
+        firsts[position] = entry;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NameIndex::insert(const std::vector<uint32_t> &ids)
+{
+    if (ids.empty())
+    {
+        return;
+    }
+
+    // added names are sorted once and merged with indexed ones into new leaves; searching the
+    // leaf of every name separately costs cache misses on random leaves
+    std::vector<Probe> added;
+    added.reserve(ids.size());
+
+    for (const uint32_t id : ids)
+    {
+        added.push_back(makeProbe(NameDictionary::getName(id), NameDictionary::getLength(id), id));
+    }
+
+    std::sort(added.begin(), added.end(), [](const Probe &first, const Probe &second)
+              {
+                  if (first.entry.key != second.entry.key)
+                  {
+                      return first.entry.key < second.entry.key;
+                  }
+
+                  if (first.entry.tail != second.entry.tail)
+                  {
+                      return first.entry.tail < second.entry.tail;
+                  }
+
+                  return compareNames(first.name, first.length, second.name, second.length) < 0; });
+
+    added.erase(std::unique(added.begin(), added.end(), [](const Probe &first, const Probe &second)
+                            { return first.entry.id == second.entry.id; }),
+                added.end());
+
+    std::lock_guard<std::mutex> lock(indexLock);
+    std::vector<Leaf *> built;
+    built.reserve((count + added.size()) / fillCapacity + 1);
+    auto next(added.begin());
+
+    for (Leaf *leaf : leaves)
+    {
+        for (uint32_t slot(0); slot < leaf->count; ++slot)
+        {
+            const Entry &entry(leaf->entries[slot]);
+
+            while ((next != added.end()) && (compare(entry, *next) > 0))
+            {
+                append(built, next->entry);
+                ++next;
+                count++;
+            }
+
+            // equal names are the same interned id
+            if ((next != added.end()) && (next->entry.id == entry.id))
+            {
+                ++next;
+            }
+
+            append(built, entry);
+        }
+
+        // old leaves are freed while new ones are filled, so memory grows by one leaf at most
+        delete leaf;
+        MemoryArena::discharge(MemoryArena::subsystemDevices, sizeof(Leaf));
+    }
+
+    for (; next != added.end(); ++next)
+    {
+        append(built, next->entry);
+        count++;
+    }
+
+    leaves.swap(built);
+    firsts.clear();
+
+    for (const Leaf *leaf : leaves)
+    {
+        firsts.push_back(leaf->entries[0]);
+    }
+
+    account();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NameIndex::remove(const uint32_t id)
+{
+    const Probe probe(makeProbe(NameDictionary::getName(id), NameDictionary::getLength(id), id));
+    std::lock_guard<std::mutex> lock(indexLock);
+
+    if (leaves.empty())
+    {
+        return;
+    }
+
+    const size_t position(findLeaf(probe));
+    Leaf &leaf(*leaves[position]);
+    const uint32_t slot(findEntry(leaf, probe));
+
+    if ((slot == leaf.count) || (leaf.entries[slot].id != id))
+    {
+        return;
+    }
+
+    leaf.count--;
+    memmove(leaf.entries + slot, leaf.entries + slot + 1, (leaf.count - slot) * sizeof(Entry));
+    count--;
+
+    if (leaf.count == 0)
+    {
+        delete leaves[position];
+        MemoryArena::discharge(MemoryArena::subsystemDevices, sizeof(Leaf));
+        leaves.erase(leaves.begin() + static_cast<std::ptrdiff_t>(position));
+        firsts.erase(firsts.begin() + static_cast<std::ptrdiff_t>(position));
+        account();
+        return;
+    }
+
+    if (slot == 0)
+    {
+        firsts[position] = leaf.entries[0];
+    }
+
+    // sparse leaves are merged with a neighbour, so listing does not walk many almost empty leaves
+    if ((position + 1 < leaves.size()) && (leaf.count + leaves[position + 1]->count <= mergeCapacity))
+    {
+        merge(position);
+    }
+    else if ((position != 0) && (leaves[position - 1]->count + leaf.count <= mergeCapacity))
+    {
+        merge(position - 1);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool NameIndex::list(const std::string &lower, const bool exclusive, const std::string &prefix, const std::string &upper,
+                     const size_t limit, std::vector<uint32_t> &ids) const
+{
+    const Probe lowerProbe(makeProbe(lower.data(), static_cast<uint32_t>(lower.size()), 0));
+    const Probe upperProbe(makeProbe(upper.data(), static_cast<uint32_t>(upper.size()), 0));
+    std::lock_guard<std::mutex> lock(indexLock);
+
+    if (leaves.empty())
+    {
+        return false;
+    }
+
+    size_t position(findLeaf(lowerProbe));
+    uint32_t slot(findEntry(*leaves[position], lowerProbe));
+    size_t listed(0);
+
+    if (exclusive && (slot < leaves[position]->count) &&
+        (compare(leaves[position]->entries[slot], lowerProbe) == 0))
+    {
+        slot++;
+    }
+
+    while (position < leaves.size())
+    {
+        const Leaf &leaf(*leaves[position]);
+
+        if (slot == leaf.count)
+        {
+            position++;
+            slot = 0;
+            continue;
+        }
+
+        const Entry &entry(leaf.entries[slot]);
+
+        // names are ordered, so the first name outside prefix or range ends the listing
+        if (!upper.empty() && (compare(entry, upperProbe) >= 0))
+        {
+            return false;
+        }
+
+        if (!prefix.empty() && ((NameDictionary::getLength(entry.id) < prefix.size()) ||
+                                (memcmp(NameDictionary::getName(entry.id), prefix.data(), prefix.size()) != 0)))
+        {
+            return false;
+        }
+
+        if (listed == limit)
+        {
+            return true;
+        }
+
+        ids.push_back(entry.id);
+        listed++;
+        slot++;
+    }
+
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t NameIndex::size(void) const
+{
+    std::lock_guard<std::mutex> lock(indexLock);
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NameIndex::Probe NameIndex::makeProbe(const char *name, const uint32_t length, const uint32_t id)
+{
+    uint64_t key(0);
+    uint32_t tail(0);
+    memcpy(&key, name, std::min<uint32_t>(length, sizeof(key)));
+
+    if (length > sizeof(key))
+    {
+        memcpy(&tail, name + sizeof(key), std::min<uint32_t>(length - static_cast<uint32_t>(sizeof(key)), sizeof(tail)));
+    }
+
+    return Probe{Entry{be64toh(key), be32toh(tail), id}, name, length};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int NameIndex::compare(const Entry &entry, const Probe &probe)
+{
+    if (entry.key != probe.entry.key)
+    {
+        return (entry.key < probe.entry.key) ? -1 : 1;
+    }
+
+    if (entry.tail != probe.entry.tail)
+    {
+        return (entry.tail < probe.entry.tail) ? -1 : 1;
+    }
+
+    // zero padding makes keys of "ab" and "ab\0" equal; full names decide
+    return compareNames(NameDictionary::getName(entry.id), NameDictionary::getLength(entry.id), probe.name, probe.length);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t NameIndex::findLeaf(const Probe &probe) const
+{
+    // last leaf whose first entry is not greater than name
+    const auto found(std::upper_bound(firsts.begin(), firsts.end(), probe, [](const Probe &probe, const Entry &entry)
+                                      { return compare(entry, probe) > 0; }));
+    return (found == firsts.begin()) ? 0 : static_cast<size_t>(found - firsts.begin()) - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t NameIndex::findEntry(const Leaf &leaf, const Probe &probe)
+{
+    const Entry *found(std::lower_bound(leaf.entries, leaf.entries + leaf.count, probe, [](const Entry &entry, const Probe &probe)
+                                        { return compare(entry, probe) < 0; }));
+    return static_cast<uint32_t>(found - leaf.entries);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NameIndex::append(std::vector<Leaf *> &built, const Entry &entry)
+{
+    if (built.empty() || (built.back()->count == fillCapacity))
+    {
+        MemoryArena::charge(MemoryArena::subsystemDevices, sizeof(Leaf), false);
+        built.push_back(new Leaf());
+        built.back()->count = 0;
+    }
+
+    Leaf &leaf(*built.back());
+    leaf.entries[leaf.count++] = entry;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NameIndex::merge(const size_t position)
+{
+    Leaf &target(*leaves[position]);
+    Leaf *source(leaves[position + 1]);
+    memcpy(target.entries + target.count, source->entries, source->count * sizeof(Entry));
+    target.count += source->count;
+
+    delete source;
+    MemoryArena::discharge(MemoryArena::subsystemDevices, sizeof(Leaf));
+    leaves.erase(leaves.begin() + static_cast<std::ptrdiff_t>(position) + 1);
+    firsts.erase(firsts.begin() + static_cast<std::ptrdiff_t>(position) + 1);
+    account();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NameIndex::account(void)
+{
+    const uint64_t bytes(leaves.capacity() * sizeof(Leaf *) + firsts.capacity() * sizeof(Entry));
+
+    if (bytes > charged)
+    {
+        MemoryArena::charge(MemoryArena::subsystemDevices, bytes - charged, false);
+    }
+    else
+    {
+        MemoryArena::discharge(MemoryArena::subsystemDevices, charged - bytes);
+    }
+
+    charged = bytes;
+}
@@ -0,0 +1,182 @@
+#ifndef NAMEINDEX_HPP
+#define NAMEINDEX_HPP
+
+#include <cinttypes>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief ordered index of device names for prefix and range listing
+ *
+ * Two level B+tree: sorted leaves of up to 256 entries under one sorted
+ * directory holding the first entry of every leaf. Entry is the first twelve
+ * name bytes as big endian integers and the dense id of the name in 16 bytes,
+ * so most comparisons are integer compares and the full name is read from
+ * NameDictionary only when first bytes are equal. Insert and remove find
+ * their leaf by binary search of the directory and shift at most one leaf;
+ * full leaf is split in halves, sparse neighbours are merged. Many names,
+ * e.g. from a checkpoint, are sorted once and merged with the index in one
+ * pass instead of being inserted one by one. Listing seeks
+ * to the lower bound and walks leaves in order, so its cost depends on the
+ * number of listed names, not on the number of devices. One lock guards the
+ * index; it is taken by writers only when a device is added or removed.
+ */
+class NameIndex final
+{
+public:
+    /**
+     * @brief Construct a new empty Name Index object
+     *
+     */
+    NameIndex();
+
+    /**
+     * @brief Destroy the Name Index object and free its leaves
+     *
+     */
+    ~NameIndex();
+
+    NameIndex(const NameIndex &) = delete;
+    NameIndex &operator=(const NameIndex &) = delete;
+
+    /**
+     * @brief add name; names already present are ignored
+     *
+     * @param id id of interned name
+     */
+    void insert(const uint32_t id);
+
+    /**
+     * @brief add many names at once; cheaper than inserting them one by one once they are more
+     * than a small part of the index
+     *
+     * @param ids ids of interned names; names already present are ignored
+     */
+    void insert(const std::vector<uint32_t> &ids);
+
+    /**
+     * @brief remove name; names not present are ignored
+     *
+     * @param id id of interned name
+     */
+    void remove(const uint32_t id);
+
+    /**
+     * @brief list ids of names in ascending byte order
+     *
+     * @param lower first listed name or the name just before it if exclusive; empty starts at the first name
+     * @param exclusive lower itself is not listed
+     * @param prefix only names starting with prefix are listed; empty lists all
+     * @param upper names from upper on are not listed; empty is unlimited
+     * @param limit maximum number of listed names
+     * @param ids output ids; previous content is kept
+     * @return true if more names would follow the listed ones
+     * @return false if listing is complete
+     */
+    bool list(const std::string &lower, const bool exclusive, const std::string &prefix, const std::string &upper,
+              const size_t limit, std::vector<uint32_t> &ids) const;
+
+    /**
+     * @brief Get number of indexed names
+     *
+     * @return uint64_t
+     */
+    uint64_t size(void) const;
+
+private:
+    static const uint32_t leafCapacity = 256;
+    // neighbour leaves are merged once both fit in this many entries
+    static const uint32_t mergeCapacity = leafCapacity / 2;
+    // leaves built from sorted names are filled to this many entries, leaving room for inserts
+    static const uint32_t fillCapacity = leafCapacity * 3 / 4;
+
+    struct Entry
+    {
+        // first eight name bytes and next four, big endian and zero padded
+        uint64_t key;
+        uint32_t tail;
+        uint32_t id;
+    };
+
+    // searched name with its entry keys
+    struct Probe
+    {
+        Entry entry;
+        const char *name;
+        uint32_t length;
+    };
+
+    struct Leaf
+    {
+        uint32_t count;
+        Entry entries[leafCapacity];
+    };
+
+    /**
+     * @brief build entry keys of name
+     *
+     * @param name name bytes
+     * @param length name length
+     * @param id id of name, if interned
+     * @return Probe
+     */
+    static Probe makeProbe(const char *name, const uint32_t length, const uint32_t id);
+
+    /**
+     * @brief compare indexed name with searched name
+     *
+     * @param entry indexed entry
+     * @param probe searched name
+     * @return int negative, zero or positive if indexed name is less, equal or greater
+     */
+    static int compare(const Entry &entry, const Probe &probe);
+
+    /**
+     * @brief find leaf that holds name or would hold it; index must not be empty
+     *
+     * @param probe searched name
+     * @return size_t leaf position in directory
+     */
+    size_t findLeaf(const Probe &probe) const;
+
+    /**
+     * @brief find position of first entry not less than name
+     *
+     * @param leaf leaf
+     * @param probe searched name
+     * @return uint32_t position in leaf, count of leaf if every entry is less
+     */
+    static uint32_t findEntry(const Leaf &leaf, const Probe &probe);
+
+    /**
+     * @brief append entry to leaves being built, starting new leaf once the last one is filled
+     *
+     * @param built leaves being built
+     * @param entry appended entry
+     */
+    static void append(std::vector<Leaf *> &built, const Entry &entry);
+
+    /**
+     * @brief merge leaf behind given one into it and remove it from directory
+     *
+     * @param position directory position of the first leaf
+     */
+    void merge(const size_t position);
+
+    /**
+     * @brief account directory growth and shrinking to memory arena
+     *
+     */
+    void account(void);
+
+    mutable std::mutex indexLock;
+    std::vector<Leaf *> leaves;
+    // first entry of every leaf; directory is searched without touching leaves
+    std::vector<Entry> firsts;
+    uint64_t count;
+    // directory bytes charged to memory arena
+    uint64_t charged;
+};
+
+#endif
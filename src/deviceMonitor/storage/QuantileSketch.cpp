@@ -0,0 +1,299 @@
+#include "QuantileSketch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+const int32_t QuantileSketch::bucketCount;
+// defaults correspond to relative accuracy of 2%
+const double QuantileSketch::minIndexable(1e-9);
+double QuantileSketch::gamma(1.02 / 0.98);
+double QuantileSketch::inverseLogGamma(1.0 / std::log(1.02 / 0.98));
+int32_t QuantileSketch::minIndex(static_cast<int32_t>(std::ceil(std::log(1e-9) / std::log(1.02 / 0.98))));
+
+////////////////////////////////////////////////////////////////////////////////
+bool QuantileSketch::setRelativeAccuracy(const double accuracy)
+{
+    if (!(accuracy > 0.0) || !(accuracy < 1.0))
+    {
+        return false;
+    }
+
+    gamma = (1.0 + accuracy) / (1.0 - accuracy);
+    inverseLogGamma = 1.0 / std::log(gamma);
+    minIndex = static_cast<int32_t>(std::ceil(std::log(minIndexable) * inverseLogGamma));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double QuantileSketch::getRelativeAccuracy(void)
+{
+    return (gamma - 1.0) / (gamma + 1.0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QuantileSketch::add(const double value)
+{
+    const int32_t key(getKey(value));
+
+    addKey(key, 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QuantileSketch::addKey(const int32_t key, const uint64_t count)
+{
+    if (key > 0)
+    {
+        positive.add(key, count);
+    }
+    else if (key < 0)
+    {
+        negative.add(-key, count);
+    }
+    else
+    {
+        zeroCount += count;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t QuantileSketch::getCount(void) const
+{
+    return zeroCount + positive.count + negative.count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double QuantileSketch::getQuantile(const double quantile) const
+{
+    const uint64_t count(getCount());
+
+    if (count == 0)
+    {
+        return 0.0;
+    }
+
+    const uint64_t rank(static_cast<uint64_t>(quantile * static_cast<double>(count - 1)));
+    uint64_t seen(0);
+
+    // negative values from the largest magnitude, zero, then positive values
+    if (negative.count != 0)
+    {
+        for (int32_t bucket(bucketCount - 1); bucket >= 0; --bucket)
+        {
+            seen += negative.buckets[bucket];
+
+            if (seen > rank)
+            {
+                return -getValue(negative.lowKey + bucket);
+            }
+        }
+    }
+
+    seen += zeroCount;
+
+    if ((seen > rank) || (positive.count == 0))
+    {
+        return 0.0;
+    }
+
+    for (int32_t bucket(0); bucket < bucketCount; ++bucket)
+    {
+        seen += positive.buckets[bucket];
+
+        if (seen > rank)
+        {
+            return getValue(positive.lowKey + bucket);
+        }
+    }
+
+    return getValue(positive.lowKey + bucketCount - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QuantileSketch::mergeInto(merged_t &merged) const
+{
+    if (zeroCount != 0)
+    {
+        merged[0] += zeroCount;
+    }
+
+    for (int32_t bucket(0); bucket < bucketCount; ++bucket)
+    {
+        if (positive.buckets[bucket] != 0)
+        {
+            merged[positive.lowKey + bucket] += positive.buckets[bucket];
+        }
+
+        if (negative.buckets[bucket] != 0)
+        {
+            merged[-(negative.lowKey + bucket)] += negative.buckets[bucket];
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double QuantileSketch::getQuantile(const merged_t &merged, const double quantile)
+{
+    uint64_t count(0);
+
+    for (const auto &bucket : merged)
+    {
+        count += bucket.second;
+    }
+
+    if (count == 0)
+    {
+        return 0.0;
+    }
+
+    const uint64_t rank(static_cast<uint64_t>(quantile * static_cast<double>(count - 1)));
+    uint64_t seen(0);
+
+    for (const auto &bucket : merged)
+    {
+        seen += bucket.second;
+
+        if (seen > rank)
+        {
+            return (bucket.first < 0) ? -getValue(-bucket.first) : getValue(bucket.first);
+        }
+    }
+
+    return getValue(merged.rbegin()->first);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool QuantileSketch::Pending::add(const double value, int32_t &key, uint32_t &count)
+{
+    key = getKey(value);
+
+    if (key == 0)
+    {
+        zeroCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    const unsigned sign((key > 0) ? 0 : 1);
+    const int32_t magnitude(std::abs(key));
+    int32_t lowKey(lowKeys[sign].load(std::memory_order_relaxed));
+
+    // first value places the window like it does in empty store; writers losing the race use the winner's window
+    if ((lowKey == 0) && lowKeys[sign].compare_exchange_strong(lowKey, std::max(magnitude - bucketCount / 2, 1), std::memory_order_relaxed))
+    {
+        lowKey = std::max(magnitude - bucketCount / 2, 1);
+    }
+
+    const int32_t index(std::max(magnitude - lowKey, 0));
+
+    if (index >= bucketCount)
+    {
+        count = 1;
+        return false;
+    }
+
+    if (buckets[sign][index].fetch_add(1, std::memory_order_relaxed) != std::numeric_limits<uint16_t>::max())
+    {
+        return true;
+    }
+
+    // bucket wrapped to zero; values it held are handed over
+    key = (sign == 0) ? lowKey + index : -(lowKey + index);
+    count = std::numeric_limits<uint16_t>::max() + 1;
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QuantileSketch::Pending::mergeInto(QuantileSketch &sketch)
+{
+    sketch.zeroCount += zeroCount.load(std::memory_order_relaxed);
+    zeroCount.store(0, std::memory_order_relaxed);
+
+    for (unsigned sign(0); sign < 2; ++sign)
+    {
+        const int32_t lowKey(lowKeys[sign].load(std::memory_order_relaxed));
+        Store &store((sign == 0) ? sketch.positive : sketch.negative);
+
+        for (int32_t bucket(0); (lowKey != 0) && (bucket < bucketCount); ++bucket)
+        {
+            const uint16_t added(buckets[sign][bucket].load(std::memory_order_relaxed));
+
+            if (added != 0)
+            {
+                store.add(lowKey + bucket, added);
+                buckets[sign][bucket].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        // window of sketch only slides up, so values of the next epoch are collapsed the same way
+        lowKeys[sign].store((store.count != 0) ? store.lowKey : 0, std::memory_order_relaxed);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QuantileSketch::Store::add(const int32_t key, const uint64_t added)
+{
+    int32_t index(key - lowKey);
+
+    if (count == 0)
+    {
+        // first value is placed in the middle of the window
+        lowKey = std::max(key - bucketCount / 2, 1);
+        index = key - lowKey;
+    }
+    else if (index < 0)
+    {
+        index = 0;
+    }
+    else if (index >= bucketCount)
+    {
+        // slide window up; buckets falling out of it are collapsed into the new first bucket
+        const int32_t shift(std::min(index - (bucketCount - 1), bucketCount));
+        uint32_t collapsed(0);
+
+        for (int32_t bucket(0); bucket < bucketCount; ++bucket)
+        {
+            if (bucket <= shift)
+            {
+                collapsed += buckets[bucket];
+            }
+            else
+            {
+                buckets[bucket - shift] = buckets[bucket];
+            }
+        }
+
+        for (int32_t bucket(std::max(bucketCount - shift, 1)); bucket < bucketCount; ++bucket)
+        {
+            buckets[bucket] = 0;
+        }
+
+        buckets[0] = collapsed;
+        lowKey = key - (bucketCount - 1);
+        index = bucketCount - 1;
+    }
+
+    buckets[index] += static_cast<uint32_t>(added);
+    count += added;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int32_t QuantileSketch::getKey(const double value)
+{
+    const double magnitude(std::fabs(value));
+
+    if (!(magnitude >= minIndexable))
+    {
+        return 0;
+    }
+
+    // key 1 belongs to the smallest indexable magnitude, key 0 to zero
+    const int32_t key(static_cast<int32_t>(std::ceil(std::log(magnitude) * inverseLogGamma)) - minIndex + 1);
+    return (value < 0.0) ? -key : key;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double QuantileSketch::getValue(const int32_t key)
+{
+    // middle of bucket (gamma^(i-1), gamma^i] in terms of relative error
+    return 2.0 * std::pow(gamma, key + minIndex - 1) / (gamma + 1.0);
+}
@@ -0,0 +1,172 @@
+#ifndef QUANTILESKETCH_HPP
+#define QUANTILESKETCH_HPP
+
+#include <atomic>
+#include <cinttypes>
+#include <map>
+
+/**
+ * @brief fixed size mergeable quantile sketch with relative error guarantee (DDSketch)
+ *
+ * Magnitude of value is mapped to logarithmic bucket key, so every quantile is
+ * reported with configured relative accuracy. Positive and negative values are
+ * kept in separate stores, each a window of bucketCount consecutive keys; zero
+ * (and magnitudes below minIndexable) is only counted. When a magnitude above the
+ * window arrives the window slides up and smallest magnitudes are collapsed into
+ * its first bucket, so accuracy of both tails is always kept. Adding value is a
+ * single bucket increment. Zero initialized object is empty.
+ */
+class QuantileSketch final
+{
+public:
+    static const int32_t bucketCount = 64;
+
+    // merged sketches without window limit; signed key -> count
+    typedef std::map<int32_t, uint64_t> merged_t;
+
+    /**
+     * @brief set relative accuracy of all sketches; must be called before any value is added
+     *
+     * @param accuracy relative accuracy in (0, 1)
+     * @return true on success
+     * @return false if accuracy is out of range
+     */
+    static bool setRelativeAccuracy(const double accuracy);
+
+    /**
+     * @brief Get relative accuracy of all sketches
+     *
+     * @return double
+     */
+    static double getRelativeAccuracy(void);
+
+    /**
+     * @brief add value
+     *
+     * @param value measured value
+     */
+    void add(const double value);
+
+    /**
+     * @brief Get number of added values
+     *
+     * @return uint64_t
+     */
+    uint64_t getCount(void) const;
+
+    /**
+     * @brief Get value at given quantile
+     *
+     * @param quantile quantile in [0, 1]
+     * @return double value; zero if sketch is empty
+     */
+    double getQuantile(const double quantile) const;
+
+    /**
+     * @brief add buckets of this sketch to merged sketch
+     *
+     * @param merged merged sketch
+     */
+    void mergeInto(merged_t &merged) const;
+
+    /**
+     * @brief Get value at given quantile of merged sketch
+     *
+     * @param merged merged sketch
+     * @param quantile quantile in [0, 1]
+     * @return double value; zero if merged sketch is empty
+     */
+    static double getQuantile(const merged_t &merged, const double quantile);
+
+    /**
+     * @brief add count of values with given signed key, e.g. values that did not fit in Pending
+     *
+     * @param key signed bucket key
+     * @param count number of values
+     */
+    void addKey(const int32_t key, const uint64_t count);
+
+    /**
+     * @brief values added by concurrent writers without lock until they are merged into a sketch
+     *
+     * Window of every sign is fixed while values are added: it is aligned with the
+     * window of the sketch by mergeInto() or, if the sketch has none, placed by the
+     * first value. Smaller magnitudes are collapsed into the first bucket just like
+     * the sketch would do; a magnitude above the window or a bucket wrapping around
+     * its 16-bit count is returned to the caller, which adds it by addKey() later.
+     * Zero initialized object is empty.
+     */
+    class Pending final
+    {
+    public:
+        /**
+         * @brief add value; safe to call concurrently
+         *
+         * @param value measured value
+         * @param key signed key of values that were not added
+         * @param count number of values that were not added
+         * @return true if value was added
+         * @return false if caller has to add count values of key to the sketch itself
+         */
+        bool add(const double value, int32_t &key, uint32_t &count);
+
+        /**
+         * @brief add values to sketch and reset, window aligned with the sketch; no add() may run concurrently
+         *
+         * @param sketch target sketch
+         */
+        void mergeInto(QuantileSketch &sketch);
+
+    private:
+        std::atomic<uint64_t> zeroCount;
+        // first key of positive and negative window; zero until window is placed
+        std::atomic<int32_t> lowKeys[2];
+        std::atomic<uint16_t> buckets[2][bucketCount];
+    };
+
+private:
+    // window of consecutive magnitude keys
+    struct Store
+    {
+        uint64_t count;
+        // key of first bucket
+        int32_t lowKey;
+        uint32_t buckets[bucketCount];
+
+        /**
+         * @brief count magnitude key
+         *
+         * @param key key >= 1
+         * @param added number of values
+         */
+        void add(const int32_t key, const uint64_t added);
+    };
+
+    /**
+     * @brief map value to signed bucket key
+     *
+     * @param value
+     * @return int32_t
+     */
+    static int32_t getKey(const double value);
+
+    /**
+     * @brief map magnitude key (>= 1) to magnitude representing the bucket
+     *
+     * @param key
+     * @return double
+     */
+    static double getValue(const int32_t key);
+
+    static double gamma;
+    static double inverseLogGamma;
+    // smallest magnitude distinguished from zero and its logarithmic index
+    static const double minIndexable;
+    static int32_t minIndex;
+
+    uint64_t zeroCount;
+    Store positive;
+    Store negative;
+};
+
+#endif
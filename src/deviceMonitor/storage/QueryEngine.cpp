@@ -0,0 +1,298 @@
+#include "QueryEngine.hpp"
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+std::mutex QueryEngine::poolLock;
+std::condition_variable QueryEngine::poolSignal;
+std::deque<std::function<void()>> QueryEngine::jobs;
+std::vector<std::thread> QueryEngine::workers;
+bool QueryEngine::running(false);
+
+namespace
+{
+    // independent accumulators per kernel; 4 doubles fill one AVX register or two SSE2 registers
+    const uint32_t laneCount = 4;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool QueryEngine::start(const size_t threads)
+try
+{
+    std::lock_guard<std::mutex> lock(poolLock);
+    running = true;
+
+    for (size_t worker(0); worker < threads; ++worker)
+    {
+        workers.emplace_back(workerBody);
+    }
+
+    LOG_FMT_INF("query engine started with %zu pool threads", threads);
+    return true;
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_FTL("unable to start query threads; %s", ex.what());
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QueryEngine::stop(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(poolLock);
+        running = false;
+    }
+
+    poolSignal.notify_all();
+
+    for (auto &worker : workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+
+    workers.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool QueryEngine::aggregate(const std::string &prefix, const unsigned kind, const int64_t from, const int64_t to, std::string &result)
+try
+{
+    std::vector<SeriesScan> scans;
+
+    // only summaries and boundary block copies are taken under history lock
+    if (!HistoryStore::withSeries(kind, prefix, [&scans, from, to](const std::vector<HistoryStore::SeriesView> &views)
+                                  {
+                                      scans.resize(views.size());
+
+                                      for (size_t device(0); device < views.size(); ++device)
+                                      {
+                                          scanSeries(views[device], from, to, scans[device]);
+                                      }
+                                  }))
+    {
+        return false;
+    }
+
+    runParallel(scans.size(), [&scans, from, to](const size_t device)
+                { decodeSeries(from, to, scans[device]); });
+
+    std::stringstream ss;
+    Aggregate total{0, 0.0, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+    ScanStatistics scan{0, 0, 0, 0};
+
+    auto write([&ss](const Aggregate &aggregate)
+               {
+                   ss << "count: " << aggregate.count << "; "
+                      << "sum: " << aggregate.sum << "; "
+                      << "avg: " << aggregate.sum / static_cast<double>(aggregate.count) << "; "
+                      << "min: " << aggregate.minimum << "; "
+                      << "max: " << aggregate.maximum << "; " << std::endl;
+               });
+
+    for (const auto &series : scans)
+    {
+        const Aggregate &aggregate(series.aggregate);
+        scan.skippedBlocks += series.statistics.skippedBlocks;
+        scan.summarizedBlocks += series.statistics.summarizedBlocks;
+        scan.decodedBlocks += series.statistics.decodedBlocks;
+        scan.decodedSamples += series.statistics.decodedSamples;
+
+        if (aggregate.count == 0)
+        {
+            continue;
+        }
+
+        total.count += aggregate.count;
+        total.sum += aggregate.sum;
+        total.minimum = std::min(total.minimum, aggregate.minimum);
+        total.maximum = std::max(total.maximum, aggregate.maximum);
+
+        ss << series.name << ':' << ' ';
+        write(aggregate);
+    }
+
+    ss << "total: ";
+
+    if (total.count != 0)
+    {
+        write(total);
+    }
+    else
+    {
+        ss << "count: 0; " << std::endl;
+    }
+
+    ss << "skippedBlocks: " << scan.skippedBlocks << "; "
+       << "summarizedBlocks: " << scan.summarizedBlocks << "; "
+       << "decodedBlocks: " << scan.decodedBlocks << "; "
+       << "decodedSamples: " << scan.decodedSamples << "; " << std::endl;
+
+    result = ss.str();
+    return true;
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to aggregate history: %s", ex.what());
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QueryEngine::aggregateColumns(const int64_t *timestamps, const double *values, const uint32_t count,
+                                   const int64_t from, const int64_t to, Aggregate &result)
+{
+    uint64_t counts[laneCount] = {0, 0, 0, 0};
+    double sums[laneCount] = {0.0, 0.0, 0.0, 0.0};
+    double minimums[laneCount];
+    double maximums[laneCount];
+    std::fill(minimums, minimums + laneCount, result.minimum);
+    std::fill(maximums, maximums + laneCount, result.maximum);
+
+    // rows outside range are masked instead of branched on; lanes are independent, so sums are not reassociated
+    const uint32_t vectorEnd(count - count % laneCount);
+
+    for (uint32_t row(0); row < vectorEnd; row += laneCount)
+    {
+        for (uint32_t lane(0); lane < laneCount; ++lane)
+        {
+            const int64_t timestamp(timestamps[row + lane]);
+            const double value(values[row + lane]);
+            const bool inside((timestamp >= from) & (timestamp <= to));
+
+            counts[lane] += inside ? 1 : 0;
+            sums[lane] += inside ? value : 0.0;
+            minimums[lane] = (inside & (value < minimums[lane])) ? value : minimums[lane];
+            maximums[lane] = (inside & (value > maximums[lane])) ? value : maximums[lane];
+        }
+    }
+
+    for (uint32_t row(vectorEnd); row < count; ++row)
+    {
+        const bool inside((timestamps[row] >= from) & (timestamps[row] <= to));
+
+        counts[0] += inside ? 1 : 0;
+        sums[0] += inside ? values[row] : 0.0;
+        minimums[0] = (inside & (values[row] < minimums[0])) ? values[row] : minimums[0];
+        maximums[0] = (inside & (values[row] > maximums[0])) ? values[row] : maximums[0];
+    }
+
+    for (uint32_t lane(0); lane < laneCount; ++lane)
+    {
+        result.count += counts[lane];
+        result.sum += sums[lane];
+        result.minimum = std::min(result.minimum, minimums[lane]);
+        result.maximum = std::max(result.maximum, maximums[lane]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QueryEngine::scanSeries(const HistoryStore::SeriesView &view, const int64_t from, const int64_t to, SeriesScan &scan)
+{
+    scan.name = *view.name;
+    scan.aggregate = Aggregate{0, 0.0, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+    scan.statistics = ScanStatistics{0, 0, 0, 0};
+
+    for (const GorillaBlock *block : view.blocks)
+    {
+        if ((block->getMaxTimestamp() < from) || (block->getMinTimestamp() > to))
+        {
+            scan.statistics.skippedBlocks++;
+        }
+        else if ((block->getMinTimestamp() >= from) && (block->getMaxTimestamp() <= to))
+        {
+            scan.aggregate.count += block->getCount();
+            scan.aggregate.sum += block->getSum();
+            scan.aggregate.minimum = std::min(scan.aggregate.minimum, block->getMinValue());
+            scan.aggregate.maximum = std::max(scan.aggregate.maximum, block->getMaxValue());
+            scan.statistics.summarizedBlocks++;
+        }
+        else
+        {
+            scan.boundaryBlocks.push_back(*block);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QueryEngine::decodeSeries(const int64_t from, const int64_t to, SeriesScan &scan)
+{
+    int64_t timestamps[GorillaBlock::maxSamples];
+    double values[GorillaBlock::maxSamples];
+
+    for (const auto &block : scan.boundaryBlocks)
+    {
+        block.decode(timestamps, values);
+        aggregateColumns(timestamps, values, block.getCount(), from, to, scan.aggregate);
+        scan.statistics.decodedBlocks++;
+        scan.statistics.decodedSamples += block.getCount();
+    }
+
+    scan.boundaryBlocks.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QueryEngine::runParallel(const size_t tasks, const std::function<void(size_t)> &function)
+{
+    std::atomic<size_t> nextTask(0);
+    std::mutex doneLock;
+    std::condition_variable doneSignal;
+    size_t activeHelpers(0);
+
+    auto body([&nextTask, tasks, &function]()
+              {
+                  for (size_t task(nextTask++); task < tasks; task = nextTask++)
+                  {
+                      function(task);
+                  }
+              });
+
+    {
+        std::lock_guard<std::mutex> lock(poolLock);
+
+        // tasks are taken dynamically, so helpers finding no work return at once
+        for (size_t helper(0); running && (helper < workers.size()) && (helper + 1 < tasks); ++helper)
+        {
+            activeHelpers++;
+            jobs.emplace_back([&body, &doneLock, &doneSignal, &activeHelpers]()
+                              {
+                                  body();
+                                  std::lock_guard<std::mutex> lock(doneLock);
+                                  activeHelpers--;
+                                  doneSignal.notify_one();
+                              });
+        }
+    }
+
+    poolSignal.notify_all();
+    body();
+
+    std::unique_lock<std::mutex> lock(doneLock);
+    doneSignal.wait(lock, [&activeHelpers]()
+                    { return activeHelpers == 0; });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QueryEngine::workerBody(void)
+{
+    std::unique_lock<std::mutex> lock(poolLock);
+
+    while (true)
+    {
+        poolSignal.wait(lock, []()
+                        { return !running || !jobs.empty(); });
+
+        if (jobs.empty())
+        {
+            return;
+        }
+
+        std::function<void()> job(std::move(jobs.front()));
+        jobs.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
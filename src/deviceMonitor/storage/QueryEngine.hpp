@@ -0,0 +1,141 @@
+#ifndef QUERYENGINE_HPP
+#define QUERYENGINE_HPP
+
+#include "HistoryStore.hpp"
+#include "Logger.hpp"
+#include <atomic>
+#include <cinttypes>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief range aggregation (count, sum, avg, min, max) over history store
+ *
+ * Devices selected by name prefix are aggregated in parallel by a pool of
+ * query threads. Blocks outside the time range are skipped, blocks entirely
+ * inside it are answered from their value summary and only blocks crossing
+ * range boundaries are decoded into columns. Summaries are read and boundary
+ * blocks are copied while history store is locked; copies are decoded after
+ * the lock is released, so writers wait only for the copy. Column kernels keep several
+ * independent accumulator lanes, so the compiler can map them to SIMD instructions
+ * without relaxing floating point semantics.
+ */
+class QueryEngine final
+{
+public:
+    QueryEngine() = delete;
+
+    /**
+     * @brief start query thread pool
+     *
+     * @param threads number of pool threads; calling thread always takes part in query as well
+     * @return true on success
+     * @return false if threads could not be created
+     */
+    static bool start(const size_t threads);
+
+    /**
+     * @brief stop and join query thread pool
+     *
+     */
+    static void stop(void);
+
+    /**
+     * @brief aggregate one measurement of selected devices over time range
+     *
+     * @param prefix device name prefix; empty selects all devices
+     * @param kind measurement kind
+     * @param from first timestamp in milliseconds since Unix epoch
+     * @param to last timestamp in milliseconds since Unix epoch
+     * @param result output text with one line per device, total and scan statistics
+     * @return true on success
+     * @return false if history is disabled
+     */
+    static bool aggregate(const std::string &prefix, const unsigned kind, const int64_t from, const int64_t to, std::string &result);
+
+private:
+    struct Aggregate
+    {
+        uint64_t count;
+        double sum;
+        double minimum;
+        double maximum;
+    };
+
+    struct ScanStatistics
+    {
+        uint64_t skippedBlocks;
+        uint64_t summarizedBlocks;
+        uint64_t decodedBlocks;
+        uint64_t decodedSamples;
+    };
+
+    /**
+     * @brief aggregate values of columns whose timestamp lies within range
+     *
+     * @param timestamps timestamp column
+     * @param values value column
+     * @param count number of rows
+     * @param from first timestamp
+     * @param to last timestamp
+     * @param result aggregate to update
+     */
+    static void aggregateColumns(const int64_t *timestamps, const double *values, const uint32_t count,
+                                 const int64_t from, const int64_t to, Aggregate &result);
+
+    // summary of blocks of one series and copies of blocks left to decode
+    struct SeriesScan
+    {
+        std::string name;
+        Aggregate aggregate;
+        ScanStatistics statistics;
+        std::vector<GorillaBlock> boundaryBlocks;
+    };
+
+    /**
+     * @brief skip blocks of one series outside range, aggregate summaries of blocks inside it
+     * and copy blocks crossing range boundaries; called while history store is locked
+     *
+     * @param view series blocks
+     * @param from first timestamp
+     * @param to last timestamp
+     * @param scan output scan of series
+     */
+    static void scanSeries(const HistoryStore::SeriesView &view, const int64_t from, const int64_t to, SeriesScan &scan);
+
+    /**
+     * @brief decode copied boundary blocks of one series and aggregate their samples within range
+     *
+     * @param from first timestamp
+     * @param to last timestamp
+     * @param scan scan of series to update
+     */
+    static void decodeSeries(const int64_t from, const int64_t to, SeriesScan &scan);
+
+    /**
+     * @brief call function for every task index on pool threads and calling thread; returns when all are done
+     *
+     * @param tasks number of tasks
+     * @param function callable accepting task index
+     */
+    static void runParallel(const size_t tasks, const std::function<void(size_t)> &function);
+
+    /**
+     * @brief body of pool thread
+     *
+     */
+    static void workerBody(void);
+
+    static std::mutex poolLock;
+    static std::condition_variable poolSignal;
+    static std::deque<std::function<void()>> jobs;
+    static std::vector<std::thread> workers;
+    static bool running;
+};
+
+#endif
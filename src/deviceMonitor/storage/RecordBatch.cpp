@@ -0,0 +1,419 @@
+#include "RecordBatch.hpp"
+#include "NameDictionary.hpp"
+#include "fnv.hpp"
+#include <cstring>
+#include <limits>
+
+////////////////////////////////////////////////////////////////////////////////
+RecordBatch::RecordBatch(const size_t capacity)
+{
+    deviceIds.reserve(capacity);
+    timestamps.reserve(capacity);
+
+    for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+    {
+        present[kind].reserve(capacity);
+        values[kind].reserve(capacity);
+        faults[kind].reserve(capacity);
+    }
+
+    groupOf.reserve(capacity);
+    order.reserve(capacity);
+    sortedPresent.reserve(capacity);
+    sortedValues.reserve(capacity);
+    deltas.reserve(capacity);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool RecordBatch::append(const rapidjson::Value &message)
+{
+    const unsigned kindCount(MeasurementCatalog::size());
+    const char *name(nullptr);
+    uint32_t nameLength(0);
+    int64_t micros(0);
+    uint8_t measured[MeasurementCatalog::maxKinds];
+    double measuredValues[MeasurementCatalog::maxKinds];
+    uint8_t measuredFaults[MeasurementCatalog::maxKinds];
+
+    for (unsigned kind(0); kind < kindCount; ++kind)
+    {
+        measured[kind] = 0;
+        measuredValues[kind] = 0.0;
+        measuredFaults[kind] = MeasurementCatalog::noFault;
+    }
+
+    // every member is classified by one perfect hash probe instead of a search per known key
+    for (auto member(message.MemberBegin()); member != message.MemberEnd(); ++member)
+    {
+        const uint8_t code(MeasurementCatalog::lookup(member->name.GetString(), member->name.GetStringLength()));
+
+        if (code < kindCount)
+        {
+            measured[code] = 1;
+            parseMeasurement(code, member->value, measuredValues[code], measuredFaults[code]);
+        }
+        else if ((code == MeasurementCatalog::fieldName) && member->value.IsString())
+        {
+            name = member->value.GetString();
+            nameLength = member->value.GetStringLength();
+        }
+        else if ((code == MeasurementCatalog::fieldTimestamp) && member->value.IsString())
+        {
+            // malformed timestamp is kept as zero
+            parseTimestamp(member->value.GetString(), member->value.GetStringLength(), micros);
+        }
+    }
+
+    if (name == nullptr)
+    {
+        return false;
+    }
+
+    return append(name, nameLength, micros, measured, measuredValues, measuredFaults);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool RecordBatch::append(const char *name, const uint32_t nameLength, const int64_t timestamp, const uint8_t (&measured)[MeasurementCatalog::maxKinds],
+                         const double (&measuredValues)[MeasurementCatalog::maxKinds], const uint8_t (&measuredFaults)[MeasurementCatalog::maxKinds])
+{
+    // name is hashed in place; known names are found without lock or allocation
+    const uint32_t deviceId(NameDictionary::intern(name, nameLength, fnv::Fnv64a(name, nameLength)));
+
+    if (deviceId == NameDictionary::noId)
+    {
+        return false;
+    }
+
+    deviceIds.push_back(deviceId);
+    timestamps.push_back(timestamp);
+
+    for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+    {
+        present[kind].push_back(measured[kind]);
+        values[kind].push_back(measuredValues[kind]);
+        faults[kind].push_back(measuredFaults[kind]);
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RecordBatch::clear(void)
+{
+    deviceIds.clear();
+    timestamps.clear();
+
+    for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+    {
+        present[kind].clear();
+        values[kind].clear();
+        faults[kind].clear();
+    }
+
+    deltas.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t RecordBatch::size(void) const
+{
+    return deviceIds.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool RecordBatch::empty(void) const
+{
+    return deviceIds.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string RecordBatch::getName(const uint32_t record) const
+{
+    return std::string(NameDictionary::getName(deviceIds[record]), NameDictionary::getLength(deviceIds[record]));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t RecordBatch::getDeviceId(const uint32_t record) const
+{
+    return deviceIds[record];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool RecordBatch::isPresent(const unsigned kind, const uint32_t record) const
+{
+    return present[kind][record] != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int64_t RecordBatch::getTimestamp(const uint32_t record) const
+{
+    return timestamps[record];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double RecordBatch::getValue(const unsigned kind, const uint32_t record) const
+{
+    return values[kind][record];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint8_t RecordBatch::getFault(const unsigned kind, const uint32_t record) const
+{
+    return faults[kind][record];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const std::vector<RecordBatch::DeviceDelta> &RecordBatch::getDeltas(void) const
+{
+    return deltas;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const MeasurementStats *RecordBatch::getStats(const DeviceDelta &delta) const
+{
+    return deltaStats.data() + static_cast<size_t>(&delta - deltas.data()) * MeasurementCatalog::size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const uint32_t *RecordBatch::getFaultCounts(const DeviceDelta &delta) const
+{
+    return deltaFaults.data() + static_cast<size_t>(&delta - deltas.data()) * MeasurementCatalog::getFaultCount();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const std::vector<uint32_t> &RecordBatch::getOrder(void) const
+{
+    return order;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const std::vector<RecordBatch::DeviceDelta> &RecordBatch::aggregate(void)
+{
+    const uint32_t recordCount(static_cast<uint32_t>(deviceIds.size()));
+    deltas.clear();
+
+    // hash partition - assign dense group index to each distinct device; table is kept at most half full
+    size_t tableSize(16);
+
+    while (tableSize < 2 * static_cast<size_t>(recordCount))
+    {
+        tableSize <<= 1;
+    }
+
+    const size_t mask(tableSize - 1);
+    slots.assign(tableSize, 0);
+    groupOf.resize(recordCount);
+
+    for (uint32_t record(0); record < recordCount; ++record)
+    {
+        const uint32_t id(deviceIds[record]);
+        // ids are dense, so low bits spread them without mixing
+        size_t slot(static_cast<size_t>(id) & mask);
+
+        // slot holds group index + 1; zero marks empty slot
+        while ((slots[slot] != 0) && (deltas[slots[slot] - 1].deviceId != id))
+        {
+            slot = (slot + 1) & mask;
+        }
+
+        if (slots[slot] == 0)
+        {
+            deltas.push_back(DeviceDelta{id, record, 0});
+            slots[slot] = static_cast<uint32_t>(deltas.size());
+        }
+
+        groupOf[record] = slots[slot] - 1;
+        deltas[groupOf[record]].messageCount++;
+    }
+
+    // counting sort - records of each device form one contiguous run
+    groupCursor.resize(deltas.size());
+    uint32_t runStart(0);
+
+    for (size_t group(0); group < deltas.size(); ++group)
+    {
+        groupCursor[group] = runStart;
+        runStart += deltas[group].messageCount;
+    }
+
+    order.resize(recordCount);
+
+    for (uint32_t record(0); record < recordCount; ++record)
+    {
+        order[groupCursor[groupOf[record]]++] = record;
+    }
+
+    // statistics of every measurement over device runs; inner loops are branch free and vectorizable
+    const unsigned kindCount(MeasurementCatalog::size());
+    const unsigned faultCount(MeasurementCatalog::getFaultCount());
+    sortedPresent.resize(recordCount);
+    sortedValues.resize(recordCount);
+    deltaStats.assign(deltas.size() * kindCount, MeasurementStats());
+    deltaFaults.assign(deltas.size() * faultCount, 0);
+
+    for (unsigned kind(0); kind < kindCount; ++kind)
+    {
+        gather(kind);
+        runStart = 0;
+
+        for (size_t group(0); group < deltas.size(); ++group)
+        {
+            const uint32_t runEnd(runStart + deltas[group].messageCount);
+            computeStats(runStart, runEnd, deltaStats[group * kindCount + kind]);
+            runStart = runEnd;
+        }
+    }
+
+    // faults are rare, so they are counted directly from unsorted columns
+    for (uint32_t record(0); record < recordCount; ++record)
+    {
+        for (unsigned kind(0); kind < kindCount; ++kind)
+        {
+            const uint8_t fault(faults[kind][record]);
+
+            if (fault != MeasurementCatalog::noFault)
+            {
+                deltaFaults[groupOf[record] * faultCount + fault]++;
+            }
+        }
+    }
+
+    return deltas;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool RecordBatch::parseTimestamp(const char *text, const size_t length, int64_t &micros)
+{
+    // fixed layout "YYYY-MM-DDTHH:MM:SS.ffffff" followed by "UTC" or "Z"
+    static const char layout[] = "dddd-dd-ddTdd:dd:dd.dddddd";
+    const size_t layoutLength(sizeof(layout) - 1);
+
+    if ((length < layoutLength) ||
+        !(((length == layoutLength + 3) && (memcmp(text + layoutLength, "UTC", 3) == 0)) ||
+          ((length == layoutLength + 1) && (text[layoutLength] == 'Z'))))
+    {
+        return false;
+    }
+
+    for (size_t position(0); position < layoutLength; ++position)
+    {
+        if ((layout[position] == 'd') ? ((text[position] < '0') || (text[position] > '9')) : (text[position] != layout[position]))
+        {
+            return false;
+        }
+    }
+
+    auto number([text](const size_t position, const size_t digits)
+                {
+                    int64_t value(0);
+
+                    for (size_t digit(0); digit < digits; ++digit)
+                    {
+                        value = 10 * value + (text[position + digit] - '0');
+                    }
+
+                    return value;
+                });
+
+    int64_t year(number(0, 4));
+    const int64_t month(number(5, 2));
+    const int64_t day(number(8, 2));
+
+    if ((month < 1) || (month > 12) || (day < 1) || (day > 31))
+    {
+        return false;
+    }
+
+    // days from civil date (proleptic Gregorian calendar), era of 400 years starting in March
+    year -= (month <= 2) ? 1 : 0;
+    const int64_t era(year / 400);
+    const int64_t yearOfEra(year - era * 400);
+    const int64_t dayOfYear((153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 + day - 1);
+    const int64_t dayOfEra(yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear);
+    const int64_t days(era * 146097 + dayOfEra - 719468);
+
+    const int64_t seconds(days * 86400 + number(11, 2) * 3600 + number(14, 2) * 60 + number(17, 2));
+    micros = seconds * 1000000 + number(20, 6);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RecordBatch::parseMeasurement(const unsigned kind, const rapidjson::Value &measurement, double &value, uint8_t &fault)
+{
+    if (!measurement.IsObject())
+    {
+        return;
+    }
+
+    for (auto member(measurement.MemberBegin()); member != measurement.MemberEnd(); ++member)
+    {
+        const char *key(member->name.GetString());
+        const uint32_t length(member->name.GetStringLength());
+
+        if ((length == 5) && (memcmp(key, "value", 5) == 0) && member->value.IsNumber())
+        {
+            value = member->value.GetDouble();
+        }
+        else if ((length == 5) && (memcmp(key, "fault", 5) == 0) && member->value.IsString() && (member->value.GetStringLength() != 0))
+        {
+            fault = MeasurementCatalog::findFault(kind, member->value.GetString(), member->value.GetStringLength());
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RecordBatch::gather(const unsigned kind)
+{
+    const uint8_t *presentColumn(present[kind].data());
+    const double *valueColumn(values[kind].data());
+    const uint32_t recordCount(static_cast<uint32_t>(order.size()));
+
+    for (uint32_t position(0); position < recordCount; ++position)
+    {
+        sortedPresent[position] = presentColumn[order[position]];
+        sortedValues[position] = valueColumn[order[position]];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RecordBatch::computeStats(const uint32_t runStart, const uint32_t runEnd, MeasurementStats &stats) const
+{
+    const uint8_t *present(sortedPresent.data());
+    const double *value(sortedValues.data());
+    uint32_t count(0);
+    double sum(0.0);
+    double minimum(std::numeric_limits<double>::infinity());
+    double maximum(-std::numeric_limits<double>::infinity());
+    double last(0.0);
+
+    for (uint32_t position(runStart); position < runEnd; ++position)
+    {
+        const bool isPresent(present[position] != 0);
+        count += present[position];
+        sum += isPresent ? value[position] : 0.0;
+        minimum = (isPresent && (value[position] < minimum)) ? value[position] : minimum;
+        maximum = (isPresent && (value[position] > maximum)) ? value[position] : maximum;
+        last = isPresent ? value[position] : last;
+    }
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    // two pass variance of run; merged into storage by parallel Welford update
+    const double mean(sum / count);
+    double m2(0.0);
+
+    for (uint32_t position(runStart); position < runEnd; ++position)
+    {
+        const double deviation(value[position] - mean);
+        m2 += (present[position] != 0) ? deviation * deviation : 0.0;
+    }
+
+    stats.count = count;
+    stats.minimum = minimum;
+    stats.maximum = maximum;
+    stats.mean = mean;
+    stats.m2 = m2;
+    stats.last = last;
+}
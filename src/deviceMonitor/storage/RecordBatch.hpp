@@ -0,0 +1,238 @@
+#ifndef RECORDBATCH_HPP
+#define RECORDBATCH_HPP
+
+#include "MeasurementCatalog.hpp"
+#include "MeasurementStats.hpp"
+#include <cinttypes>
+#include <rapidjson/document.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief batch of received messages stored as struct-of-arrays
+ *
+ * Message processor collects messages into batch and storage applies whole
+ * batch at once. Members of message are classified by MeasurementCatalog in
+ * a single pass, and measurements are kept in columns indexed by measurement
+ * kind of the catalog. Device name is interned (NameDictionary) when message is
+ * appended, so records carry dense device id instead of the name. Aggregation
+ * groups records by device id (hash partition), orders them by group (counting
+ * sort) and computes measurement statistics and fault counts over contiguous
+ * runs, so storage has to look up every device only once per batch.
+ * All buffers are reused between batches.
+ */
+class RecordBatch final
+{
+public:
+    // merged update for one device; statistics and fault counts are kept by batch (getStats(), getFaultCounts())
+    struct DeviceDelta
+    {
+        // dense id of interned device name
+        uint32_t deviceId;
+        uint32_t firstRecord;
+        uint32_t messageCount;
+    };
+
+    /**
+     * @brief Construct a new Record Batch object
+     *
+     * @param capacity expected maximum number of records
+     */
+    RecordBatch(const size_t capacity);
+
+    /**
+     * @brief extract device name, measured values and faults from validated message
+     *
+     * @param message JSON message
+     * @return true if message was appended
+     * @return false if message is missing device name or device is new and does not fit in memory budget
+     */
+    bool append(const rapidjson::Value &message);
+
+    /**
+     * @brief append already extracted record; used when records are read back from write-ahead log
+     *
+     * @param name device name bytes, need not be terminated
+     * @param nameLength name length
+     * @param timestamp microseconds since Unix epoch; zero if unknown
+     * @param measured presence of measurements indexed by measurement kind
+     * @param measuredValues measured values indexed by measurement kind
+     * @param measuredFaults fault index of measurements or MeasurementCatalog::noFault if there is no fault
+     * @return true if record was appended
+     * @return false if device is new and its name does not fit in memory budget
+     */
+    bool append(const char *name, const uint32_t nameLength, const int64_t timestamp, const uint8_t (&measured)[MeasurementCatalog::maxKinds],
+                const double (&measuredValues)[MeasurementCatalog::maxKinds], const uint8_t (&measuredFaults)[MeasurementCatalog::maxKinds]);
+
+    /**
+     * @brief remove all records; allocated memory is kept for next batch
+     *
+     */
+    void clear(void);
+
+    /**
+     * @brief Get number of records in batch
+     *
+     * @return size_t
+     */
+    size_t size(void) const;
+
+    /**
+     * @brief check if batch contains any record
+     *
+     * @return true if batch is empty
+     * @return false if batch is not empty
+     */
+    bool empty(void) const;
+
+    /**
+     * @brief Get the device name of given record
+     *
+     * @param record record index
+     * @return std::string
+     */
+    std::string getName(const uint32_t record) const;
+
+    /**
+     * @brief Get dense device id of given record
+     *
+     * @param record record index
+     * @return uint32_t id of interned device name
+     */
+    uint32_t getDeviceId(const uint32_t record) const;
+
+    /**
+     * @brief check if record contains given measurement
+     *
+     * @param kind measurement kind
+     * @param record record index
+     * @return true if measurement is present
+     * @return false if measurement is not present
+     */
+    bool isPresent(const unsigned kind, const uint32_t record) const;
+
+    /**
+     * @brief Get the timestamp of given record
+     *
+     * @param record record index
+     * @return int64_t microseconds since Unix epoch; zero if message timestamp is malformed
+     */
+    int64_t getTimestamp(const uint32_t record) const;
+
+    /**
+     * @brief Get the measured value of given record
+     *
+     * @param kind measurement kind
+     * @param record record index
+     * @return double measured value; zero if measurement is not present
+     */
+    double getValue(const unsigned kind, const uint32_t record) const;
+
+    /**
+     * @brief Get the fault of measurement of given record
+     *
+     * @param kind measurement kind
+     * @param record record index
+     * @return uint8_t fault index or MeasurementCatalog::noFault if there is no fault
+     */
+    uint8_t getFault(const unsigned kind, const uint32_t record) const;
+
+    /**
+     * @brief group records by device and compute merged updates
+     *
+     * @return const std::vector<DeviceDelta>& one delta per distinct device in batch
+     */
+    const std::vector<DeviceDelta> &aggregate(void);
+
+    /**
+     * @brief Get deltas computed by last aggregate() call
+     *
+     * @return const std::vector<DeviceDelta>&
+     */
+    const std::vector<DeviceDelta> &getDeltas(void) const;
+
+    /**
+     * @brief Get statistics of delta indexed by measurement kind; statistics of measurement
+     * not present in any record of the device are zero
+     *
+     * @param delta delta returned by aggregate() or getDeltas()
+     * @return const MeasurementStats* MeasurementCatalog::size() statistics
+     */
+    const MeasurementStats *getStats(const DeviceDelta &delta) const;
+
+    /**
+     * @brief Get fault counts of delta indexed by fault
+     *
+     * @param delta delta returned by aggregate() or getDeltas()
+     * @return const uint32_t* MeasurementCatalog::getFaultCount() counts
+     */
+    const uint32_t *getFaultCounts(const DeviceDelta &delta) const;
+
+    /**
+     * @brief Get record indexes ordered by device; records of n-th delta form n-th contiguous run
+     *
+     * @return const std::vector<uint32_t>&
+     */
+    const std::vector<uint32_t> &getOrder(void) const;
+
+    /**
+     * @brief parse message timestamp in "YYYY-MM-DDTHH:MM:SS.ffffffUTC" (or "Z") format
+     *
+     * @param text timestamp text
+     * @param length text length
+     * @param micros output microseconds since Unix epoch
+     * @return true on success
+     * @return false if text is malformed
+     */
+    static bool parseTimestamp(const char *text, const size_t length, int64_t &micros);
+
+private:
+    /**
+     * @brief extract value and fault of one measurement of message
+     *
+     * @param kind measurement kind
+     * @param measurement JSON measurement object
+     * @param value output measured value; left untouched if missing
+     * @param fault output fault index; left untouched if there is no known fault
+     */
+    static void parseMeasurement(const unsigned kind, const rapidjson::Value &measurement, double &value, uint8_t &fault);
+
+    /**
+     * @brief copy presence and values of measurement to sorted buffers in device order
+     *
+     * @param kind measurement kind
+     */
+    void gather(const unsigned kind);
+
+    /**
+     * @brief compute statistics of measurement over one device run of sorted buffers
+     *
+     * @param runStart first position of run
+     * @param runEnd position after last position of run
+     * @param stats output statistics; left untouched if measurement is not present in run
+     */
+    void computeStats(const uint32_t runStart, const uint32_t runEnd, MeasurementStats &stats) const;
+
+    // record columns
+    std::vector<uint32_t> deviceIds;
+    std::vector<int64_t> timestamps;
+    // only first MeasurementCatalog::size() columns are used
+    std::vector<uint8_t> present[MeasurementCatalog::maxKinds];
+    std::vector<double> values[MeasurementCatalog::maxKinds];
+    // fault index of measurement; MeasurementCatalog::noFault if there is no fault
+    std::vector<uint8_t> faults[MeasurementCatalog::maxKinds];
+
+    // aggregation scratch buffers
+    std::vector<uint32_t> slots;
+    std::vector<uint32_t> groupOf;
+    std::vector<uint32_t> groupCursor;
+    std::vector<uint32_t> order;
+    std::vector<uint8_t> sortedPresent;
+    std::vector<double> sortedValues;
+    std::vector<DeviceDelta> deltas;
+    // statistics and fault counts of n-th delta start at n * MeasurementCatalog::size() and n * getFaultCount()
+    std::vector<MeasurementStats> deltaStats;
+    std::vector<uint32_t> deltaFaults;
+};
+
+#endif
@@ -0,0 +1,212 @@
+#include "SpaceSaving.hpp"
+#include <algorithm>
+
+const uint32_t SpaceSaving::none;
+
+////////////////////////////////////////////////////////////////////////////////
+SpaceSaving::SpaceSaving(const uint32_t capacity) : capacity(std::max<uint32_t>(capacity, 1)),
+                                                   counters(this->capacity),
+                                                   buckets(static_cast<size_t>(this->capacity) + 1),
+                                                   index(static_cast<size_t>(this->capacity) + 1)
+{
+    clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SpaceSaving::add(const uint32_t key, const uint64_t weight)
+{
+    if (weight == 0)
+    {
+        return;
+    }
+
+    total += weight;
+    // one probe both finds tracked key and reserves slot for new one
+    bool inserted(false);
+    uint32_t &found(index.findOrInsert(key, none, inserted));
+
+    if (!inserted)
+    {
+        const uint32_t counter(found);
+        const uint32_t bucket(counters[counter].bucket);
+        detach(counter);
+        place(counter, bucket, buckets[bucket].count + weight);
+
+        if (buckets[bucket].first == none)
+        {
+            removeBucket(bucket);
+        }
+
+        return;
+    }
+
+    if (used < capacity)
+    {
+        const uint32_t counter(used++);
+        found = counter;
+        counters[counter].key = key;
+        counters[counter].error = 0;
+        place(counter, none, weight);
+        return;
+    }
+
+    // new key takes over the counter of a minimum key together with its count as error
+    const uint32_t bucket(firstBucket);
+    const uint32_t counter(buckets[bucket].first);
+    const uint64_t minimum(buckets[bucket].count);
+    // erase may move slots, so the reserved one is filled first
+    found = counter;
+    index.erase(counters[counter].key);
+    counters[counter].key = key;
+    counters[counter].error = minimum;
+    detach(counter);
+    place(counter, bucket, minimum + weight);
+
+    if (buckets[bucket].first == none)
+    {
+        removeBucket(bucket);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SpaceSaving::remove(const uint32_t key)
+{
+    const uint32_t *found(index.find(key));
+
+    if (found == nullptr)
+    {
+        return false;
+    }
+
+    const uint32_t counter(*found);
+    const uint32_t bucket(counters[counter].bucket);
+    detach(counter);
+
+    if (buckets[bucket].first == none)
+    {
+        removeBucket(bucket);
+    }
+
+    index.erase(key);
+    const uint32_t last(--used);
+
+    // last counter fills the hole, so tracked counters stay the first used ones
+    if (counter != last)
+    {
+        counters[counter] = counters[last];
+        const Counter &moved(counters[counter]);
+        (moved.previous == none ? buckets[moved.bucket].first : counters[moved.previous].next) = counter;
+
+        if (moved.next != none)
+        {
+            counters[moved.next].previous = counter;
+        }
+
+        *index.find(moved.key) = counter;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SpaceSaving::clear(void)
+{
+    index.clear();
+    firstBucket = none;
+    lastBucket = none;
+    used = 0;
+    total = 0;
+
+    // free buckets are chained through next
+    for (uint32_t bucket(0); bucket < buckets.size(); ++bucket)
+    {
+        buckets[bucket].next = bucket + 1;
+    }
+
+    buckets.back().next = none;
+    freeBucket = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t SpaceSaving::getTotal(void) const
+{
+    return total;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t SpaceSaving::getThreshold(void) const
+{
+    return (used < capacity) ? 0 : buckets[firstBucket].count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t SpaceSaving::size(void) const
+{
+    return used;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t SpaceSaving::getCapacity(void) const
+{
+    return capacity;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SpaceSaving::place(const uint32_t counter, const uint32_t after, const uint64_t target)
+{
+    uint32_t previous(after);
+    uint32_t next((after == none) ? firstBucket : buckets[after].next);
+
+    while ((next != none) && (buckets[next].count < target))
+    {
+        previous = next;
+        next = buckets[next].next;
+    }
+
+    uint32_t bucket(next);
+
+    if ((next == none) || (buckets[next].count != target))
+    {
+        bucket = freeBucket;
+        freeBucket = buckets[bucket].next;
+        buckets[bucket].count = target;
+        buckets[bucket].first = none;
+        buckets[bucket].previous = previous;
+        buckets[bucket].next = next;
+        (previous == none ? firstBucket : buckets[previous].next) = bucket;
+        (next == none ? lastBucket : buckets[next].previous) = bucket;
+    }
+
+    counters[counter].bucket = bucket;
+    counters[counter].previous = none;
+    counters[counter].next = buckets[bucket].first;
+
+    if (buckets[bucket].first != none)
+    {
+        counters[buckets[bucket].first].previous = counter;
+    }
+
+    buckets[bucket].first = counter;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SpaceSaving::detach(const uint32_t counter)
+{
+    const Counter &detached(counters[counter]);
+    (detached.previous == none ? buckets[detached.bucket].first : counters[detached.previous].next) = detached.next;
+
+    if (detached.next != none)
+    {
+        counters[detached.next].previous = detached.previous;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SpaceSaving::removeBucket(const uint32_t bucket)
+{
+    const Bucket &removed(buckets[bucket]);
+    (removed.previous == none ? firstBucket : buckets[removed.previous].next) = removed.next;
+    (removed.next == none ? lastBucket : buckets[removed.next].previous) = removed.previous;
+    buckets[bucket].next = freeBucket;
+    freeBucket = bucket;
+}
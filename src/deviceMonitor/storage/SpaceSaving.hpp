@@ -0,0 +1,158 @@
+#ifndef SPACESAVING_HPP
+#define SPACESAVING_HPP
+
+#include "FlatHashMap.hpp"
+#include <cinttypes>
+#include <vector>
+
+/**
+ * @brief Space-Saving summary of the most frequent keys in fixed memory
+ *
+ * At most capacity keys are tracked, each with its weighted count and the
+ * maximum overestimation of that count. Key that is not tracked replaces the
+ * key with the minimum count and inherits that count as its error, so every
+ * key weighing more than total / capacity is guaranteed to be tracked and
+ * its true count lies within [count - error, count]. Counters are kept in a
+ * stream summary: an ordered list of buckets of equal count, each with a list
+ * of its counters, so the minimum is always the first bucket and adding weight
+ * moves the counter only past buckets of counts it skips - O(1) for small
+ * weights. Not thread safe.
+ */
+class SpaceSaving final
+{
+public:
+    static const uint32_t none = UINT32_MAX;
+
+    /**
+     * @brief Construct a new empty Space Saving object
+     *
+     * @param capacity maximum number of tracked keys; at least 1
+     */
+    SpaceSaving(const uint32_t capacity);
+
+    /**
+     * @brief add weight to key, replacing the minimum key if summary is full and key is not tracked
+     *
+     * @param key key
+     * @param weight weight added; zero is ignored
+     */
+    void add(const uint32_t key, const uint64_t weight);
+
+    /**
+     * @brief stop tracking key; its count stays in total
+     *
+     * @param key key
+     * @return true if key was tracked
+     * @return false if key is not tracked
+     */
+    bool remove(const uint32_t key);
+
+    /**
+     * @brief remove all keys; memory is kept
+     *
+     */
+    void clear(void);
+
+    /**
+     * @brief call function for tracked keys from the highest count down
+     *
+     * @param limit maximum number of keys visited
+     * @param function callable accepting (uint32_t key, uint64_t count, uint64_t error)
+     */
+    template <typename F>
+    void forEachTop(uint32_t limit, F function) const
+    {
+        for (uint32_t bucket(lastBucket); (bucket != none) && (limit > 0); bucket = buckets[bucket].previous)
+        {
+            for (uint32_t counter(buckets[bucket].first); (counter != none) && (limit > 0); counter = counters[counter].next)
+            {
+                function(counters[counter].key, buckets[bucket].count, counters[counter].error);
+                limit--;
+            }
+        }
+    }
+
+    /**
+     * @brief Get sum of all added weights
+     *
+     * @return uint64_t
+     */
+    uint64_t getTotal(void) const;
+
+    /**
+     * @brief Get upper bound of count of any key that is not tracked
+     *
+     * @return uint64_t minimum tracked count if summary is full, otherwise zero
+     */
+    uint64_t getThreshold(void) const;
+
+    /**
+     * @brief Get number of tracked keys
+     *
+     * @return uint32_t
+     */
+    uint32_t size(void) const;
+
+    /**
+     * @brief Get maximum number of tracked keys
+     *
+     * @return uint32_t
+     */
+    uint32_t getCapacity(void) const;
+
+private:
+    struct Counter
+    {
+        uint32_t key;
+        uint32_t bucket;
+        uint32_t previous;
+        uint32_t next;
+        uint64_t error;
+    };
+
+    struct Bucket
+    {
+        uint64_t count;
+        uint32_t first;
+        uint32_t previous;
+        uint32_t next;
+    };
+
+    /**
+     * @brief link counter into bucket of target count, searching buckets after given one
+     *
+     * @param counter detached counter
+     * @param after bucket the search starts after or none to start at the minimum
+     * @param target new count of counter; higher than count of bucket after
+     */
+    void place(const uint32_t counter, const uint32_t after, const uint64_t target);
+
+    /**
+     * @brief unlink counter from its bucket; bucket may be left empty
+     *
+     * @param counter linked counter
+     */
+    void detach(const uint32_t counter);
+
+    /**
+     * @brief unlink empty bucket from bucket list and return it to free buckets
+     *
+     * @param bucket empty bucket
+     */
+    void removeBucket(const uint32_t bucket);
+
+    const uint32_t capacity;
+    std::vector<Counter> counters;
+    // one bucket per distinct count plus one for a counter in transit
+    std::vector<Bucket> buckets;
+    // tracked key to counter index
+    FlatHashMap<uint32_t> index;
+    // bucket of the lowest and of the highest count
+    uint32_t firstBucket;
+    uint32_t lastBucket;
+    uint32_t freeBucket;
+    uint32_t used;
+    uint64_t total;
+};
+
+#endif
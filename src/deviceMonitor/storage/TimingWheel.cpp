@@ -0,0 +1,110 @@
+#include "TimingWheel.hpp"
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////////////////
+TimingWheel::TimingWheel(const uint64_t now) : current(now)
+{
+    std::fill(heads, heads + levelCount * slotCount, static_cast<uint32_t>(none));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TimingWheel::schedule(const uint32_t entry, uint64_t deadline)
+{
+    if (entry >= links.size())
+    {
+        links.resize(entry + 1, Link{0, none, none, none});
+    }
+
+    cancel(entry);
+
+    const uint64_t horizon(uint64_t(1) << (levelCount * slotBits));
+    deadline = std::max(deadline, current + 1);
+    links[entry].deadline = std::min(deadline, current + horizon - 1);
+    link(entry);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TimingWheel::cancel(const uint32_t entry)
+{
+    if ((entry >= links.size()) || (links[entry].slot == none))
+    {
+        return;
+    }
+
+    Link &unlinked(links[entry]);
+
+    if (unlinked.previous != none)
+    {
+        links[unlinked.previous].next = unlinked.next;
+    }
+    else
+    {
+        heads[unlinked.slot] = unlinked.next;
+    }
+
+    if (unlinked.next != none)
+    {
+        links[unlinked.next].previous = unlinked.previous;
+    }
+
+    unlinked.slot = none;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t TimingWheel::getNow(void) const
+{
+    return current;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t TimingWheel::getSlot(const unsigned level, const uint64_t deadline)
+{
+    return static_cast<uint32_t>(level * slotCount + ((deadline >> (level * slotBits)) & (slotCount - 1)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TimingWheel::link(const uint32_t entry)
+{
+    Link &linked(links[entry]);
+    const uint64_t delta(linked.deadline - current);
+    unsigned level(0);
+
+    // level n covers deadlines less than slotCount^(n+1) ticks ahead; its slot is reached before wrapping
+    while ((level + 1 < levelCount) && (delta >= (uint64_t(1) << ((level + 1) * slotBits))))
+    {
+        level++;
+    }
+
+    linked.slot = getSlot(level, linked.deadline);
+    linked.previous = none;
+    linked.next = heads[linked.slot];
+
+    if (linked.next != none)
+    {
+        links[linked.next].previous = entry;
+    }
+
+    heads[linked.slot] = entry;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t TimingWheel::detach(const uint32_t slot)
+{
+    const uint32_t first(heads[slot]);
+    heads[slot] = none;
+    return first;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TimingWheel::cascade(const unsigned level)
+{
+    uint32_t entry(detach(getSlot(level, current)));
+
+    // deadlines of cascaded entries are less than one slot of this level ahead, so they land lower
+    while (entry != none)
+    {
+        const uint32_t next(links[entry].next);
+        link(entry);
+        entry = next;
+    }
+}
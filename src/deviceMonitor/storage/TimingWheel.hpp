@@ -0,0 +1,141 @@
+#ifndef TIMINGWHEEL_HPP
+#define TIMINGWHEEL_HPP
+
+#include <cinttypes>
+#include <vector>
+
+/**
+ * @brief hierarchical timing wheel of entries identified by dense index
+ *
+ * Level n has slotCount slots each covering slotCount^n ticks. Entry is linked
+ * into slot of the lowest level whose range covers its deadline, so scheduling
+ * and cancelling are O(1). Advancing by one tick expires one slot of level 0;
+ * whenever a level wraps, the next slot of the level above is cascaded down.
+ * Deadlines further than the top level covers are clamped to its end, so the
+ * owner must check the real deadline of expired entry and schedule it again.
+ * Not thread safe.
+ */
+class TimingWheel final
+{
+public:
+    static const uint32_t none = UINT32_MAX;
+
+    /**
+     * @brief Construct a new empty Timing Wheel object
+     *
+     * @param now current tick
+     */
+    TimingWheel(const uint64_t now);
+
+    TimingWheel(const TimingWheel &) = delete;
+    TimingWheel &operator=(const TimingWheel &) = delete;
+
+    /**
+     * @brief schedule entry; entry that is already scheduled is moved
+     *
+     * @param entry entry index; links grow to cover it
+     * @param deadline tick of expiration; deadlines not after current tick expire on the next one
+     */
+    void schedule(const uint32_t entry, uint64_t deadline);
+
+    /**
+     * @brief unlink entry if it is scheduled
+     *
+     * @param entry entry index
+     */
+    void cancel(const uint32_t entry);
+
+    /**
+     * @brief advance wheel tick by tick up to given one and call function for every expired entry;
+     * expired entry is unlinked before the call, so function may schedule it again; function must
+     * not schedule or cancel other entries
+     *
+     * @param now new current tick; ticks not after the current one are ignored
+     * @param function callable accepting (uint32_t entry)
+     */
+    template <typename F>
+    void advance(const uint64_t now, F function)
+    {
+        while (current < now)
+        {
+            current++;
+
+            for (unsigned level(levelCount - 1); level > 0; --level)
+            {
+                // level wraps when all lower bits of current tick are zero
+                if ((current & ((uint64_t(1) << (level * slotBits)) - 1)) == 0)
+                {
+                    cascade(level);
+                }
+            }
+
+            uint32_t entry(detach(getSlot(0, current)));
+
+            while (entry != none)
+            {
+                const uint32_t next(links[entry].next);
+                links[entry].slot = none;
+                function(entry);
+                entry = next;
+            }
+        }
+    }
+
+    /**
+     * @brief Get current tick
+     *
+     * @return uint64_t
+     */
+    uint64_t getNow(void) const;
+
+private:
+    static const unsigned slotBits = 6;
+    static const uint32_t slotCount = 1 << slotBits;
+    static const unsigned levelCount = 4;
+
+    struct Link
+    {
+        uint64_t deadline;
+        // slot index over all levels or none if entry is not scheduled
+        uint32_t slot;
+        uint32_t previous;
+        uint32_t next;
+    };
+
+    /**
+     * @brief Get slot index of deadline at given level
+     *
+     * @param level wheel level
+     * @param deadline tick
+     * @return uint32_t
+     */
+    static uint32_t getSlot(const unsigned level, const uint64_t deadline);
+
+    /**
+     * @brief link entry into slot matching its deadline
+     *
+     * @param entry entry with deadline after current tick
+     */
+    void link(const uint32_t entry);
+
+    /**
+     * @brief empty slot
+     *
+     * @param slot slot index
+     * @return uint32_t first entry of detached list or none
+     */
+    uint32_t detach(const uint32_t slot);
+
+    /**
+     * @brief move entries of current slot of level to lower levels
+     *
+     * @param level level > 0
+     */
+    void cascade(const unsigned level);
+
+    uint64_t current;
+    std::vector<Link> links;
+    uint32_t heads[levelCount * slotCount];
+};
+
+#endif
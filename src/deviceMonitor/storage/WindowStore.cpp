@@ -0,0 +1,319 @@
+#include "WindowStore.hpp"
+#include "NameDictionary.hpp"
+#include "fnv.hpp"
+#include <algorithm>
+
+const char *const WindowStore::resolutionKeys[WindowStore::resolutionCount] = {"second", "minute", "hour"};
+const uint32_t WindowStore::ringSizes[WindowStore::resolutionCount] = {120, 120, 48};
+
+std::mutex WindowStore::windowLock;
+bool WindowStore::enabled(false);
+uint32_t WindowStore::lateness(0);
+std::vector<WindowStore::DeviceWindows> WindowStore::devices;
+FlatHashMap<uint32_t> WindowStore::deviceIndex;
+std::vector<uint32_t> WindowStore::freeDevices;
+unsigned WindowStore::stride(WindowStore::slotMeasurements);
+
+namespace
+{
+    // length of window in seconds indexed by Resolution
+    const uint32_t resolutionSeconds[] = {1, 60, 3600};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WindowStore::configure(const bool enabled, const uint64_t lateness)
+{
+    std::lock_guard<std::mutex> lock(windowLock);
+    WindowStore::enabled = enabled;
+    // open second windows must stay within ring next to the last minute of final ones
+    WindowStore::lateness = static_cast<uint32_t>(std::min<uint64_t>(lateness, 60));
+    stride = slotMeasurements + MeasurementCatalog::size();
+
+    if (enabled)
+    {
+        LOG_FMT_INF("event-time windows enabled; lateness %" PRIu32 " s", WindowStore::lateness);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WindowStore::count(const RecordBatch &batch)
+try
+{
+    if (!enabled || batch.empty())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(windowLock);
+    const std::vector<uint32_t> &order(batch.getOrder());
+    uint32_t runStart(0);
+
+    for (const auto &delta : batch.getDeltas())
+    {
+        bool inserted(false);
+        const uint32_t slot(freeDevices.empty() ? static_cast<uint32_t>(devices.size()) : freeDevices.back());
+        const uint32_t index(deviceIndex.findOrInsert(delta.deviceId, slot, inserted));
+
+        if (inserted)
+        {
+            if (index == devices.size())
+            {
+                devices.emplace_back();
+            }
+            else
+            {
+                freeDevices.pop_back();
+            }
+
+            DeviceWindows &device(devices[index]);
+            device.name = batch.getName(delta.firstRecord);
+            device.newest = 0;
+            device.rolledSeconds = 0;
+            device.rolledMinutes = 0;
+            device.lateDropped = 0;
+
+            for (unsigned resolution(0); resolution < resolutionCount; ++resolution)
+            {
+                device.rings[resolution].assign(static_cast<size_t>(ringSizes[resolution]) * stride, 0);
+            }
+        }
+
+        DeviceWindows &device(devices[index]);
+        const uint32_t runEnd(runStart + delta.messageCount);
+
+        for (uint32_t position(runStart); position < runEnd; ++position)
+        {
+            const uint32_t record(order[position]);
+            const int64_t second(batch.getTimestamp(record) / 1000000);
+
+            // timestamps before the first possible window or past 32-bit seconds are not counted
+            if ((second <= static_cast<int64_t>(lateness)) || (second > static_cast<int64_t>(UINT32_MAX)))
+            {
+                continue;
+            }
+
+            countRecord(device, static_cast<uint32_t>(second), batch, record);
+        }
+
+        runStart = runEnd;
+    }
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to count records into windows: %s", ex.what());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WindowStore::remove(const std::vector<uint32_t> &deviceIds)
+{
+    std::lock_guard<std::mutex> lock(windowLock);
+
+    for (const uint32_t deviceId : deviceIds)
+    {
+        const uint32_t *index(deviceIndex.find(deviceId));
+
+        if (index == nullptr)
+        {
+            continue;
+        }
+
+        DeviceWindows &device(devices[*index]);
+        std::string().swap(device.name);
+
+        for (unsigned resolution(0); resolution < resolutionCount; ++resolution)
+        {
+            std::vector<uint32_t>().swap(device.rings[resolution]);
+        }
+
+        freeDevices.push_back(*index);
+        deviceIndex.erase(deviceId);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WindowStore::query(const std::string &name, const Resolution resolution, uint32_t windowCount, std::string &rates)
+{
+    NameDictionary::Guard names;
+    std::lock_guard<std::mutex> lock(windowLock);
+    uint32_t deviceId(0);
+    const uint32_t *index(NameDictionary::find(name.data(), static_cast<uint32_t>(name.size()),
+                                             fnv::Fnv64a(name.data(), name.size()), deviceId)
+                                ? deviceIndex.find(deviceId)
+                                : nullptr);
+
+    if (!enabled || (index == nullptr))
+    {
+        return false;
+    }
+
+    const DeviceWindows &device(devices[*index]);
+    const uint32_t unit(resolutionSeconds[resolution]);
+    const uint32_t newestWindow(device.newest / unit);
+    windowCount = std::min(std::min(windowCount, ringSizes[resolution]), newestWindow);
+
+    // windows of the ring, oldest first
+    const uint32_t firstWindow(newestWindow - windowCount + 1);
+    std::vector<uint32_t> windows(static_cast<size_t>(windowCount) * stride, 0);
+    const std::vector<uint32_t> &ring(device.rings[resolution]);
+
+    for (uint32_t window(firstWindow); window <= newestWindow; ++window)
+    {
+        const uint32_t *slot(peekSlot(ring, window));
+        uint32_t *result(&windows[(window - firstWindow) * stride]);
+        result[slotWindow] = window;
+
+        if (slot[slotWindow] == window)
+        {
+            addCounters(result, slot);
+        }
+    }
+
+    // lower resolution windows not rolled up yet; at most lateness + 1 seconds and two minutes
+    auto addUnrolled([&windows, firstWindow, newestWindow](const uint32_t *slot, const uint32_t window)
+                     {
+                         if ((window >= firstWindow) && (window <= newestWindow))
+                         {
+                             addCounters(&windows[(window - firstWindow) * stride], slot);
+                         }
+                     });
+
+    if (resolution != resolutionSecond)
+    {
+        for (uint32_t second(device.rolledSeconds); second <= device.newest; ++second)
+        {
+            const uint32_t *slot(peekSlot(device.rings[resolutionSecond], second));
+
+            if (slot[slotWindow] == second)
+            {
+                addUnrolled(slot, second / unit);
+            }
+        }
+    }
+
+    if (resolution == resolutionHour)
+    {
+        for (uint32_t minute(device.rolledMinutes); minute <= device.newest / 60; ++minute)
+        {
+            const uint32_t *slot(peekSlot(device.rings[resolutionMinute], minute));
+
+            if (slot[slotWindow] == minute)
+            {
+                addUnrolled(slot, minute / 60);
+            }
+        }
+    }
+
+    std::stringstream ss;
+
+    for (size_t position(0); position < windows.size(); position += stride)
+    {
+        const uint32_t *window(&windows[position]);
+        ss << static_cast<uint64_t>(window[slotWindow]) * unit * 1000 << ':' << " messages: " << window[slotMessages] << "; ";
+
+        for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+        {
+            ss << MeasurementCatalog::getKey(kind) << ": " << window[slotMeasurements + kind] << "; ";
+        }
+
+        ss << std::endl;
+    }
+
+    ss << "lateDropped: " << device.lateDropped << "; " << std::endl;
+    rates = ss.str();
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WindowStore::countRecord(DeviceWindows &device, const uint32_t second, const RecordBatch &batch, const uint32_t record)
+{
+    if (device.newest == 0)
+    {
+        device.rolledSeconds = second - lateness;
+        device.rolledMinutes = device.rolledSeconds / 60;
+        device.newest = second;
+    }
+
+    if (second > device.newest)
+    {
+        std::vector<uint32_t> &seconds(device.rings[resolutionSecond]);
+        std::vector<uint32_t> &minutes(device.rings[resolutionMinute]);
+        std::vector<uint32_t> &hours(device.rings[resolutionHour]);
+        const uint32_t previousNewest(device.newest);
+        const uint32_t boundary(second - lateness);
+        device.newest = second;
+
+        // seconds which became final; only those up to previous newest timestamp can hold counters
+        const uint32_t secondsEnd(std::min(boundary, previousNewest + 1));
+
+        for (uint32_t window(device.rolledSeconds); window < secondsEnd; ++window)
+        {
+            const uint32_t *slot(peekSlot(seconds, window));
+
+            if (slot[slotWindow] == window)
+            {
+                addCounters(getSlot(minutes, window / 60), slot);
+            }
+        }
+
+        device.rolledSeconds = std::max(device.rolledSeconds, boundary);
+
+        // minutes whose all seconds are final
+        const uint32_t minuteBoundary(device.rolledSeconds / 60);
+        const uint32_t minutesEnd(std::min(minuteBoundary, previousNewest / 60 + 1));
+
+        for (uint32_t window(device.rolledMinutes); window < minutesEnd; ++window)
+        {
+            const uint32_t *slot(peekSlot(minutes, window));
+
+            if (slot[slotWindow] == window)
+            {
+                addCounters(getSlot(hours, window / 60), slot);
+            }
+        }
+
+        device.rolledMinutes = std::max(device.rolledMinutes, minuteBoundary);
+    }
+
+    if (second < device.rolledSeconds)
+    {
+        device.lateDropped++;
+        return;
+    }
+
+    uint32_t *slot(getSlot(device.rings[resolutionSecond], second));
+    slot[slotMessages]++;
+
+    for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+    {
+        slot[slotMeasurements + kind] += batch.isPresent(kind, record) ? 1u : 0u;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t *WindowStore::getSlot(std::vector<uint32_t> &ring, const uint32_t window)
+{
+    uint32_t *slot(&ring[(window % (ring.size() / stride)) * stride]);
+
+    if (slot[slotWindow] != window)
+    {
+        std::fill(slot, slot + stride, 0);
+        slot[slotWindow] = window;
+    }
+
+    return slot;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const uint32_t *WindowStore::peekSlot(const std::vector<uint32_t> &ring, const uint32_t window)
+{
+    return &ring[(window % (ring.size() / stride)) * stride];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WindowStore::addCounters(uint32_t *target, const uint32_t *source)
+{
+    for (unsigned counter(slotMessages); counter < stride; ++counter)
+    {
+        target[counter] += source[counter];
+    }
+}
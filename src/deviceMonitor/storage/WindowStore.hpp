@@ -0,0 +1,143 @@
+#ifndef WINDOWSTORE_HPP
+#define WINDOWSTORE_HPP
+
+#include "FlatHashMap.hpp"
+#include "RecordBatch.hpp"
+#include "Logger.hpp"
+#include <cinttypes>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief event-time tumbling windows of message and measurement counts per device
+ *
+ * Every device has fixed rings of second, minute and hour windows keyed by
+ * message timestamp. Records are counted only into second windows; a second
+ * window is final once the newest timestamp of the device is more than
+ * lateness seconds past it, and final windows are rolled up incrementally
+ * into their minute and complete minutes into their hour. Records later than
+ * lateness are dropped and counted. Queries combine a ring with the few not
+ * yet rolled up lower windows, so their cost depends only on number of windows.
+ * Rings of evicted devices are freed by remove() and their slots reused.
+ */
+class WindowStore final
+{
+public:
+    enum Resolution : uint8_t
+    {
+        resolutionSecond = 0,
+        resolutionMinute,
+        resolutionHour,
+        resolutionCount
+    };
+
+    // query names of resolutions indexed by Resolution
+    static const char *const resolutionKeys[resolutionCount];
+
+    // number of windows kept per resolution
+    static const uint32_t ringSizes[resolutionCount];
+
+    /**
+     * @brief enable window store; must be called before any batch is counted
+     *
+     * @param enabled false keeps store disabled and count() returns immediately
+     * @param lateness seconds a record may be late before it is dropped; limited to 60
+     */
+    static void configure(const bool enabled, const uint64_t lateness);
+
+    /**
+     * @brief count all records of aggregated batch; records without valid timestamp are skipped
+     *
+     * @param batch batch after RecordBatch::aggregate()
+     */
+    static void count(const RecordBatch &batch);
+
+    /**
+     * @brief drop windows of evicted devices, so their ids can be recycled
+     *
+     * @param deviceIds ids of evicted devices; unknown ids are ignored
+     */
+    static void remove(const std::vector<uint32_t> &deviceIds);
+
+    /**
+     * @brief Get message and measurement counts of last windows of device
+     *
+     * @param name device name
+     * @param resolution window resolution
+     * @param windowCount number of windows ending with the one of newest device timestamp
+     * @param rates output text with one line per window
+     * @return true on success
+     * @return false if store is disabled or device is not known
+     */
+    static bool query(const std::string &name, const Resolution resolution, uint32_t windowCount, std::string &rates);
+
+private:
+    // counters of one window are a slot of stride words: window (start time in units of its resolution,
+    // zero marks empty slot), messages and measurements indexed by measurement kind
+    static const unsigned slotWindow = 0;
+    static const unsigned slotMessages = 1;
+    static const unsigned slotMeasurements = 2;
+
+    struct DeviceWindows
+    {
+        std::string name;
+        // newest timestamp of device in seconds
+        uint32_t newest;
+        // all seconds / minutes before these are rolled up into next resolution
+        uint32_t rolledSeconds;
+        uint32_t rolledMinutes;
+        uint64_t lateDropped;
+        // ringSizes[resolution] slots each
+        std::vector<uint32_t> rings[resolutionCount];
+    };
+
+    /**
+     * @brief count one record into its second window, rolling up windows that became final
+     *
+     * @param device device windows
+     * @param second record timestamp in seconds
+     * @param batch batch of the record
+     * @param record record index
+     */
+    static void countRecord(DeviceWindows &device, const uint32_t second, const RecordBatch &batch, const uint32_t record);
+
+    /**
+     * @brief Get slot of window, resetting it if it holds older window
+     *
+     * @param ring ring of windows
+     * @param window window
+     * @return uint32_t* slot
+     */
+    static uint32_t *getSlot(std::vector<uint32_t> &ring, const uint32_t window);
+
+    /**
+     * @brief Get slot of ring position without resetting it
+     *
+     * @param ring ring of windows
+     * @param window window
+     * @return const uint32_t* slot
+     */
+    static const uint32_t *peekSlot(const std::vector<uint32_t> &ring, const uint32_t window);
+
+    /**
+     * @brief add counters of source slot into target slot
+     *
+     * @param target
+     * @param source
+     */
+    static void addCounters(uint32_t *target, const uint32_t *source);
+
+    static std::mutex windowLock;
+    static bool enabled;
+    static uint32_t lateness;
+    static std::vector<DeviceWindows> devices;
+    static FlatHashMap<uint32_t> deviceIndex;
+    // slots of removed devices
+    static std::vector<uint32_t> freeDevices;
+    // words per slot; fixed once catalog is loaded
+    static unsigned stride;
+};
+
+#endif
@@ -0,0 +1,773 @@
+#include "WriteAheadLog.hpp"
+#include "DataStorage.hpp"
+#include "NameDictionary.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+const char *const WriteAheadLog::durabilityKeys[WriteAheadLog::durabilityCount] = {"write", "group", "sync"};
+
+std::mutex WriteAheadLog::logLock;
+std::condition_variable WriteAheadLog::writeSignal;
+std::condition_variable WriteAheadLog::durableSignal;
+std::string WriteAheadLog::pending;
+uint64_t WriteAheadLog::pendingEpoch(0);
+std::chrono::steady_clock::time_point WriteAheadLog::groupStart;
+uint64_t WriteAheadLog::appendedBytes(0);
+uint64_t WriteAheadLog::durableBytes(0);
+uint32_t WriteAheadLog::syncWaiters(0);
+bool WriteAheadLog::running(false);
+std::deque<WriteAheadLog::Segment> WriteAheadLog::segments;
+uint64_t WriteAheadLog::nextSequence(0);
+std::string WriteAheadLog::directory;
+bool WriteAheadLog::opened(false);
+int WriteAheadLog::descriptor(-1);
+uint64_t WriteAheadLog::segmentBytes(0);
+WriteAheadLog::Durability WriteAheadLog::durability(WriteAheadLog::durabilityGroup);
+uint64_t WriteAheadLog::groupBytes(0);
+std::chrono::milliseconds WriteAheadLog::groupDelay(0);
+uint64_t WriteAheadLog::segmentSize(0);
+std::thread WriteAheadLog::writer;
+uint64_t WriteAheadLog::recordCount(0);
+uint64_t WriteAheadLog::groupCount(0);
+bool WriteAheadLog::failed(false);
+
+namespace
+{
+    // segment starts with magic and format version followed by fingerprint of measurement catalog
+    const char LOG_MAGIC[8] = {'D', 'M', 'W', 'A', 'L', 0, 0, 3};
+    const size_t SEGMENT_HEADER_SIZE(sizeof(LOG_MAGIC) + sizeof(uint64_t));
+    const char SEGMENT_PREFIX[] = "segment-";
+    const char SEGMENT_SUFFIX[] = ".wal";
+
+    ////////////////////////////////////////////////////////////////////////////
+    uint64_t checksum(const char *data, const size_t size)
+    {
+        // FNV-1a over 64-bit words; detects torn and partially written frames
+        uint64_t hash(0xcbf29ce484222325ULL);
+        size_t position(0);
+
+        for (; position + sizeof(uint64_t) <= size; position += sizeof(uint64_t))
+        {
+            uint64_t word;
+            memcpy(&word, data + position, sizeof(word));
+            hash = (hash ^ word) * 0x100000001b3ULL;
+            hash ^= hash >> 32;
+        }
+
+        for (; position < size; ++position)
+        {
+            hash = (hash ^ static_cast<uint8_t>(data[position])) * 0x100000001b3ULL;
+        }
+
+        return hash;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    void writeLength(uint64_t length, std::string &output)
+    {
+        while (length >= 0x80)
+        {
+            output.push_back(static_cast<char>((length & 0x7f) | 0x80));
+            length >>= 7;
+        }
+
+        output.push_back(static_cast<char>(length));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    template <typename T>
+    void writeRaw(const T &value, std::string &output)
+    {
+        output.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    bool readLength(const char *data, const size_t size, size_t &position, uint64_t &length)
+    {
+        length = 0;
+
+        for (unsigned shift(0); (position < size) && (shift < 64); shift += 7)
+        {
+            const uint8_t byte(static_cast<uint8_t>(data[position++]));
+            length |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    template <typename T>
+    bool readRaw(const char *data, const size_t size, size_t &position, T &value)
+    {
+        if (size - position < sizeof(value))
+        {
+            return false;
+        }
+
+        memcpy(&value, data + position, sizeof(value));
+        position += sizeof(value);
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    bool createDirectories(const std::string &path)
+    {
+        for (size_t position(path.find('/', 1)); ; position = path.find('/', position + 1))
+        {
+            const std::string partial(path.substr(0, position));
+
+            if (!partial.empty() && (mkdir(partial.c_str(), 0750) != 0) && (errno != EEXIST))
+            {
+                return false;
+            }
+
+            if (position == std::string::npos)
+            {
+                return true;
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    bool syncDirectory(const std::string &path)
+    {
+        // created and removed files survive power loss only once their directory is synced
+        const int descriptor(open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+
+        if (descriptor < 0)
+        {
+            return false;
+        }
+
+        const bool synced(fsync(descriptor) == 0);
+        close(descriptor);
+        return synced;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WriteAheadLog::parseDurability(const std::string &text, Durability &durability)
+{
+    for (uint8_t key(0); key < durabilityCount; ++key)
+    {
+        if (text == durabilityKeys[key])
+        {
+            durability = static_cast<Durability>(key);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WriteAheadLog::replay(const std::string &directory, const size_t batchSize, const uint64_t firstEpoch)
+try
+{
+    const std::chrono::steady_clock::time_point replayStart(std::chrono::steady_clock::now());
+    WriteAheadLog::directory = directory;
+    DIR *dir(opendir(directory.c_str()));
+
+    if (dir == nullptr)
+    {
+        if (errno == ENOENT)
+        {
+            return true;
+        }
+
+        LOG_FMT_ERR("unable to open write-ahead log directory %s; %s", directory.c_str(), strerror(errno));
+        return false;
+    }
+
+    std::vector<uint64_t> found;
+    const size_t prefixLength(sizeof(SEGMENT_PREFIX) - 1);
+    const size_t suffixLength(sizeof(SEGMENT_SUFFIX) - 1);
+
+    for (struct dirent *entry(readdir(dir)); entry != nullptr; entry = readdir(dir))
+    {
+        const std::string fileName(entry->d_name);
+
+        if ((fileName.size() <= prefixLength + suffixLength) ||
+            (fileName.compare(0, prefixLength, SEGMENT_PREFIX) != 0) ||
+            (fileName.compare(fileName.size() - suffixLength, suffixLength, SEGMENT_SUFFIX) != 0))
+        {
+            continue;
+        }
+
+        const std::string number(fileName.substr(prefixLength, fileName.size() - prefixLength - suffixLength));
+
+        if (number.find_first_not_of("0123456789") == std::string::npos)
+        {
+            found.push_back(std::stoull(number));
+        }
+    }
+
+    closedir(dir);
+    std::sort(found.begin(), found.end());
+
+    RecordBatch batch(batchSize);
+    uint64_t records(0);
+    uint64_t lastEpoch(0);
+    bool cut(false);
+
+    for (const uint64_t sequence : found)
+    {
+        // new segments are numbered after every segment found, including dropped ones
+        nextSequence = sequence + 1;
+
+        // frames after a cut would leave a gap in replayed batches; they are kept aside for inspection
+        if (cut)
+        {
+            const std::string path(segmentPath(sequence));
+            const std::string dropped(path + ".dropped");
+            LOG_FMT_ERR("dropping write-ahead log segment %s that follows a cut segment; kept as %s", path.c_str(), dropped.c_str());
+
+            if (::rename(path.c_str(), dropped.c_str()) != 0)
+            {
+                LOG_FMT_ERR("unable to rename write-ahead log segment %s; %s", path.c_str(), strerror(errno));
+                return false;
+            }
+
+            continue;
+        }
+
+        uint64_t maxEpoch(0);
+
+        if (!replaySegment(segmentPath(sequence), batch, firstEpoch, maxEpoch, records, cut))
+        {
+            return false;
+        }
+
+        segments.push_back(Segment{sequence, maxEpoch});
+        lastEpoch = std::max(lastEpoch, maxEpoch);
+    }
+
+    // new frames must be ordered after every epoch seen in the log
+    DataStorage::resumeEpoch(lastEpoch);
+
+    const double elapsed(std::chrono::duration<double>(std::chrono::steady_clock::now() - replayStart).count());
+    LOG_FMT_INF("replayed %" PRIu64 " records from %zu write-ahead log segments in %.3f s; %.0f records/s",
+                records, segments.size(), elapsed, (elapsed > 0.0) ? static_cast<double>(records) / elapsed : 0.0);
+    return true;
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to replay write-ahead log: %s", ex.what());
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WriteAheadLog::replaySegment(const std::string &path, RecordBatch &batch, const uint64_t firstEpoch,
+                                  uint64_t &maxEpoch, uint64_t &records, bool &cut)
+{
+    struct stat status;
+    cut = false;
+
+    if (stat(path.c_str(), &status) != 0)
+    {
+        LOG_FMT_ERR("unable to access write-ahead log segment %s; %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    const uint64_t fileSize(static_cast<uint64_t>(status.st_size));
+    std::ifstream log(path, std::ios::binary | std::ios::in);
+    char magic[sizeof(LOG_MAGIC)];
+    uint64_t fingerprint(0);
+
+    if (!log.is_open())
+    {
+        LOG_FMT_ERR("unable to open write-ahead log segment %s", path.c_str());
+        return false;
+    }
+
+    if (fileSize < SEGMENT_HEADER_SIZE)
+    {
+        // segment created just before crash is cut to an empty segment, so it does not cut the log again
+        log.close();
+        cut = true;
+        LOG_FMT_WRN("write-ahead log segment %s ends inside its header; it is left empty", path.c_str());
+        std::string segmentHeader(LOG_MAGIC, sizeof(LOG_MAGIC));
+        writeRaw(MeasurementCatalog::getFingerprint(), segmentHeader);
+        std::ofstream rewritten(path, std::ios::binary | std::ios::out | std::ios::trunc);
+
+        if (!rewritten.write(segmentHeader.data(), static_cast<std::streamsize>(segmentHeader.size())) || !rewritten.flush())
+        {
+            LOG_FMT_ERR("unable to rewrite header of write-ahead log segment %s", path.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    if (!log.read(magic, sizeof(magic)) || (memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0) ||
+        !log.read(reinterpret_cast<char *>(&fingerprint), sizeof(fingerprint)))
+    {
+        LOG_FMT_ERR("file %s is not a write-ahead log segment", path.c_str());
+        return false;
+    }
+
+    // records store measurements by catalog index
+    if (fingerprint != MeasurementCatalog::getFingerprint())
+    {
+        LOG_FMT_ERR("write-ahead log segment %s was written with different measurement catalog", path.c_str());
+        return false;
+    }
+
+    std::string payload;
+    uint64_t position(SEGMENT_HEADER_SIZE);
+    FrameHeader header;
+
+    // replay stops at the first frame that is incomplete or damaged
+    while (log.read(reinterpret_cast<char *>(&header), sizeof(header)) &&
+           (position + sizeof(header) + header.payloadLength <= fileSize))
+    {
+        if (header.epoch < firstEpoch)
+        {
+            // frame is already contained in restored checkpoint; its checksum is not checked
+            log.seekg(header.payloadLength, std::ios::cur);
+            position += sizeof(header) + header.payloadLength;
+            maxEpoch = std::max(maxEpoch, header.epoch);
+            continue;
+        }
+
+        payload.resize(header.payloadLength);
+
+        if (!log.read(&payload[0], static_cast<std::streamsize>(payload.size())) ||
+            (checksum(payload.data(), payload.size()) != header.checksum))
+        {
+            break;
+        }
+
+        batch.clear();
+
+        if (!decode(payload.data(), payload.size(), header.recordCount, batch))
+        {
+            break;
+        }
+
+        batch.aggregate();
+        DataStorage::addBatch(batch);
+        position += sizeof(header) + header.payloadLength;
+        records += header.recordCount;
+        maxEpoch = std::max(maxEpoch, header.epoch);
+    }
+
+    log.close();
+
+    if (position < fileSize)
+    {
+        cut = true;
+        LOG_FMT_WRN("cutting off %" PRIu64 " bytes of incomplete frames at the end of write-ahead log segment %s",
+                    fileSize - position, path.c_str());
+
+        if (::truncate(path.c_str(), static_cast<off_t>(position)) != 0)
+        {
+            LOG_FMT_ERR("unable to truncate write-ahead log segment %s; %s", path.c_str(), strerror(errno));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string WriteAheadLog::segmentPath(const uint64_t sequence)
+{
+    char fileName[64];
+    snprintf(fileName, sizeof(fileName), "%s%020" PRIu64 "%s", SEGMENT_PREFIX, sequence, SEGMENT_SUFFIX);
+    return directory + '/' + fileName;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WriteAheadLog::startSegment(void)
+{
+    const std::string path(segmentPath(nextSequence));
+    const int segment(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0640));
+
+    if (segment < 0)
+    {
+        LOG_FMT_ERR("unable to create write-ahead log segment %s; %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    if (descriptor >= 0)
+    {
+        ::close(descriptor);
+    }
+
+    descriptor = segment;
+    segmentBytes = 0;
+
+    std::string segmentHeader(LOG_MAGIC, sizeof(LOG_MAGIC));
+    writeRaw(MeasurementCatalog::getFingerprint(), segmentHeader);
+
+    if (!writeGroup(segmentHeader) || !syncDirectory(directory))
+    {
+        LOG_FMT_ERR("unable to initialize write-ahead log segment %s; %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(logLock);
+    segments.push_back(Segment{nextSequence++, 0});
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WriteAheadLog::open(const std::string &directory, const Durability durability, const uint64_t groupBytes,
+                         const uint64_t groupDelay, const uint64_t segmentSize)
+try
+{
+    if (!createDirectories(directory))
+    {
+        LOG_FMT_ERR("unable to create write-ahead log directory %s; %s", directory.c_str(), strerror(errno));
+        return false;
+    }
+
+    WriteAheadLog::directory = directory;
+    WriteAheadLog::durability = durability;
+    WriteAheadLog::groupBytes = groupBytes;
+    WriteAheadLog::groupDelay = std::chrono::milliseconds(groupDelay);
+    WriteAheadLog::segmentSize = segmentSize;
+
+    // segments left from previous run are never appended to; their tail may have been cut off
+    if (!startSegment())
+    {
+        return false;
+    }
+
+    running = true;
+    writer = std::thread(writerBody);
+    opened = true;
+
+    LOG_FMT_INF("write-ahead log opened in %s; durability %s; group %" PRIu64 " bytes or %" PRIu64 " ms",
+                directory.c_str(), durabilityKeys[durability], groupBytes, groupDelay);
+    return true;
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to start write-ahead log writer: %s", ex.what());
+    running = false;
+    ::close(descriptor);
+    descriptor = -1;
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WriteAheadLog::append(const RecordBatch &batch, const uint64_t epoch)
+try
+{
+    if (!opened || batch.empty())
+    {
+        return;
+    }
+
+    // frames are encoded outside the lock; buffer is reused by every processor thread
+    thread_local std::string frame;
+    encode(batch, epoch, frame);
+
+    std::unique_lock<std::mutex> lock(logLock);
+
+    if (failed)
+    {
+        return;
+    }
+
+    // writer that falls behind slows processors down instead of growing the group without bound
+    durableSignal.wait(lock, []
+                       { return pending.empty() || (pending.size() < 4 * groupBytes); });
+
+    if (pending.empty())
+    {
+        groupStart = std::chrono::steady_clock::now();
+        writeSignal.notify_one();
+    }
+
+    pending.append(frame);
+    pendingEpoch = std::max(pendingEpoch, epoch);
+    appendedBytes += frame.size();
+    recordCount += batch.size();
+
+    if (pending.size() >= groupBytes)
+    {
+        writeSignal.notify_one();
+    }
+
+    if (durability != durabilitySync)
+    {
+        return;
+    }
+
+    const uint64_t position(appendedBytes);
+    syncWaiters++;
+    writeSignal.notify_one();
+    durableSignal.wait(lock, [position]
+                       { return durableBytes >= position; });
+    syncWaiters--;
+}
+catch (const std::exception &ex)
+{
+    LOG_FMT_ERR("unable to append batch to write-ahead log: %s", ex.what());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WriteAheadLog::truncate(const uint64_t epoch)
+{
+    std::vector<uint64_t> removed;
+
+    {
+        std::lock_guard<std::mutex> lock(logLock);
+
+        // written segment is kept even if checkpoint covers it; it is removed once rotated
+        while ((segments.size() > 1) && (segments.front().maxEpoch <= epoch))
+        {
+            removed.push_back(segments.front().sequence);
+            segments.pop_front();
+        }
+    }
+
+    for (const uint64_t sequence : removed)
+    {
+        if (unlink(segmentPath(sequence).c_str()) != 0)
+        {
+            LOG_FMT_WRN("unable to remove write-ahead log segment %s; %s", segmentPath(sequence).c_str(), strerror(errno));
+        }
+    }
+
+    if (!removed.empty())
+    {
+        LOG_FMT_INF("removed %zu write-ahead log segments covered by checkpoint of epoch %" PRIu64, removed.size(), epoch);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WriteAheadLog::close(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(logLock);
+
+        if (!running)
+        {
+            return;
+        }
+
+        running = false;
+    }
+
+    writeSignal.notify_all();
+    writer.join();
+
+    opened = false;
+    ::close(descriptor);
+    descriptor = -1;
+
+    LOG_FMT_INF("write-ahead log closed; records: %" PRIu64 "; bytes: %" PRIu64 "; groups: %" PRIu64 "; records per group: %.1f",
+                recordCount, appendedBytes, groupCount,
+                (groupCount != 0) ? static_cast<double>(recordCount) / static_cast<double>(groupCount) : 0.0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WriteAheadLog::encode(const RecordBatch &batch, const uint64_t epoch, std::string &frame)
+{
+    FrameHeader header;
+    header.recordCount = static_cast<uint32_t>(batch.size());
+    header.epoch = epoch;
+    frame.assign(sizeof(header), '\0');
+
+    for (uint32_t record(0); record < header.recordCount; ++record)
+    {
+        const uint32_t deviceId(batch.getDeviceId(record));
+        const uint32_t nameLength(NameDictionary::getLength(deviceId));
+        uint64_t measuredMask(0);
+        uint64_t faultMask(0);
+
+        writeLength(nameLength, frame);
+        frame.append(NameDictionary::getName(deviceId), nameLength);
+        writeRaw(batch.getTimestamp(record), frame);
+
+        for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+        {
+            if (batch.isPresent(kind, record))
+            {
+                measuredMask |= 1u << kind;
+            }
+
+            if (batch.getFault(kind, record) != MeasurementCatalog::noFault)
+            {
+                faultMask |= 1u << kind;
+            }
+        }
+
+        // masks of a few measurements take one byte each
+        writeLength(measuredMask, frame);
+        writeLength(faultMask, frame);
+
+        // absent measurements and faults take no space
+        for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+        {
+            if ((measuredMask & (1u << kind)) != 0)
+            {
+                writeRaw(batch.getValue(kind, record), frame);
+            }
+
+            if ((faultMask & (1u << kind)) != 0)
+            {
+                frame.push_back(static_cast<char>(batch.getFault(kind, record)));
+            }
+        }
+    }
+
+    header.payloadLength = static_cast<uint32_t>(frame.size() - sizeof(header));
+    header.checksum = checksum(frame.data() + sizeof(header), header.payloadLength);
+    memcpy(&frame[0], &header, sizeof(header));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WriteAheadLog::decode(const char *payload, const size_t size, const uint32_t recordCount, RecordBatch &batch)
+{
+    size_t position(0);
+
+    for (uint32_t record(0); record < recordCount; ++record)
+    {
+        uint64_t nameLength(0);
+        int64_t timestamp(0);
+        uint64_t measuredMask(0);
+        uint64_t faultMask(0);
+        uint8_t measured[MeasurementCatalog::maxKinds];
+        double values[MeasurementCatalog::maxKinds];
+        uint8_t faults[MeasurementCatalog::maxKinds];
+
+        if (!readLength(payload, size, position, nameLength) || (nameLength > size - position))
+        {
+            return false;
+        }
+
+        const char *name(payload + position);
+        position += nameLength;
+
+        if (!readRaw(payload, size, position, timestamp) || !readLength(payload, size, position, measuredMask) ||
+            !readLength(payload, size, position, faultMask) || ((measuredMask | faultMask) >> MeasurementCatalog::size() != 0))
+        {
+            return false;
+        }
+
+        for (unsigned kind(0); kind < MeasurementCatalog::size(); ++kind)
+        {
+            measured[kind] = ((measuredMask & (1u << kind)) != 0) ? 1 : 0;
+            values[kind] = 0.0;
+            faults[kind] = MeasurementCatalog::noFault;
+
+            if ((measured[kind] != 0) && !readRaw(payload, size, position, values[kind]))
+            {
+                return false;
+            }
+
+            if (((faultMask & (1u << kind)) != 0) &&
+                (!readRaw(payload, size, position, faults[kind]) || (faults[kind] >= MeasurementCatalog::getFaultCount()) ||
+                 (MeasurementCatalog::getFaultKind(faults[kind]) != kind)))
+            {
+                return false;
+            }
+        }
+
+        // records of new devices over memory budget are dropped as they are on ingest
+        batch.append(name, static_cast<uint32_t>(nameLength), timestamp, measured, values, faults);
+    }
+
+    return position == size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WriteAheadLog::writeGroup(const std::string &group)
+{
+    size_t written(0);
+
+    while (written < group.size())
+    {
+        const ssize_t result(write(descriptor, group.data() + written, group.size() - written));
+
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        written += static_cast<size_t>(result);
+    }
+
+    segmentBytes += written;
+
+    return (durability == durabilityWrite) || (fdatasync(descriptor) == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WriteAheadLog::writerBody(void)
+{
+    std::string group;
+    std::unique_lock<std::mutex> lock(logLock);
+
+    while (true)
+    {
+        writeSignal.wait(lock, []
+                         { return !pending.empty() || !running; });
+
+        if (pending.empty())
+        {
+            // stop was requested and everything is written
+            break;
+        }
+
+        // group grows until it is full or old enough, unless somebody waits for it
+        writeSignal.wait_until(lock, groupStart + groupDelay, []
+                               { return (pending.size() >= groupBytes) || (syncWaiters != 0) || !running; });
+
+        // buffers are swapped, so neither of them is reallocated once both have grown
+        group.swap(pending);
+        pending.clear();
+        const uint64_t position(appendedBytes);
+        const uint64_t groupEpoch(pendingEpoch);
+        durableSignal.notify_all();
+
+        lock.unlock();
+        bool written(failed || (segmentBytes < segmentSize) || startSegment());
+        int error(errno);
+
+        if (written && !failed)
+        {
+            written = writeGroup(group);
+            error = errno;
+        }
+
+        lock.lock();
+        // segment may be deleted only once every frame in it is covered by a checkpoint
+        segments.back().maxEpoch = std::max(segments.back().maxEpoch, groupEpoch);
+
+        if (!written && !failed)
+        {
+            // frames after partially written group would never be replayed, so logging stops;
+            // waiting processors are released and storage keeps working without durability
+            LOG_FMT_ERR("unable to write write-ahead log; logging stopped; %s", strerror(error));
+            failed = true;
+        }
+
+        durableBytes = position;
+        groupCount++;
+        durableSignal.notify_all();
+    }
+}
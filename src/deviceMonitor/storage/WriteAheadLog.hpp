@@ -0,0 +1,231 @@
+#ifndef WRITEAHEADLOG_HPP
+#define WRITEAHEADLOG_HPP
+
+#include "RecordBatch.hpp"
+#include "Logger.hpp"
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @brief append-only log of processed records with group commit and replay on start
+ *
+ * Every batch is encoded by the processor thread into one frame (payload length,
+ * record count, storage write epoch and checksum followed by records in compact
+ * binary form: name, timestamp, presence and fault masks, values and faults of
+ * present measurements indexed by MeasurementCatalog) and appended to a shared group. Dedicated writer thread
+ * writes whole group with one write() and, unless durability is "write", one
+ * fdatasync() once the group grows over configured size or age, so the cost of
+ * a sync is shared by all batches of the group. With "sync" durability processors wait until their batch
+ * is synced before applying it; groups are then formed by batches arriving while
+ * the previous sync runs. Log is split into segment files rotated by size, each
+ * starting with the catalog fingerprint, so a changed schema is not replayed;
+ * segments whose frames all belong to epochs covered by a storage checkpoint
+ * are deleted. On start frames of later epochs are replayed into data storage
+ * and a frame torn by crash at the end of a segment is cut off. Replay stops at
+ * the first cut segment and later segments are moved aside, so storage always
+ * recovers a prefix of the log without a gap.
+ */
+class WriteAheadLog final
+{
+public:
+    enum Durability : uint8_t
+    {
+        // written to file without sync; survives process crash but not power loss
+        durabilityWrite = 0,
+        // synced per group; processors do not wait
+        durabilityGroup,
+        // synced per group; processors wait for sync before applying batch
+        durabilitySync,
+        durabilityCount
+    };
+
+    // configuration values indexed by Durability
+    static const char *const durabilityKeys[durabilityCount];
+
+    WriteAheadLog() = delete;
+
+    /**
+     * @brief find durability by its configuration value
+     *
+     * @param text configuration value
+     * @param durability output durability
+     * @return true on success
+     * @return false if value is not known
+     */
+    static bool parseDurability(const std::string &text, Durability &durability);
+
+    /**
+     * @brief apply frames of existing segments to data storage; must be called before open()
+     *
+     * @param directory segment directory; missing directory is an empty log
+     * @param batchSize number of records expected in one frame
+     * @param firstEpoch frames of earlier epochs are already in storage and are skipped
+     * @return true on success, including segments with torn tail; segments after the first
+     * cut one are renamed with ".dropped" suffix and not replayed
+     * @return false if segment can not be read or is not a log
+     */
+    static bool replay(const std::string &directory, const size_t batchSize, const uint64_t firstEpoch);
+
+    /**
+     * @brief open new segment for appending and start writer thread
+     *
+     * @param directory segment directory; missing directories are created
+     * @param durability when written groups are synced and whether processors wait for it
+     * @param groupBytes group is written once it grows over this size in bytes
+     * @param groupDelay or once it is this many milliseconds old
+     * @param segmentSize segment is rotated when it grows over this size in bytes
+     * @return true on success
+     * @return false on failure
+     */
+    static bool open(const std::string &directory, const Durability durability, const uint64_t groupBytes,
+                     const uint64_t groupDelay, const uint64_t segmentSize);
+
+    /**
+     * @brief append batch to log; does nothing if log is not open. With "sync" durability
+     * returns after batch is synced. May be called from several threads at once.
+     *
+     * @param batch records collected by message processor
+     * @param epoch storage write epoch the batch is applied in
+     */
+    static void append(const RecordBatch &batch, const uint64_t epoch);
+
+    /**
+     * @brief delete segments other than the one being written whose frames all belong
+     * to given or earlier epochs
+     *
+     * @param epoch last epoch covered by durable storage checkpoint
+     */
+    static void truncate(const uint64_t epoch);
+
+    /**
+     * @brief write and sync remaining group, stop writer thread and close log
+     *
+     */
+    static void close(void);
+
+private:
+    struct FrameHeader
+    {
+        uint32_t payloadLength;
+        uint32_t recordCount;
+        uint64_t epoch;
+        uint64_t checksum;
+    };
+
+    struct Segment
+    {
+        uint64_t sequence;
+        // latest epoch of frames in segment
+        uint64_t maxEpoch;
+    };
+
+    /**
+     * @brief encode batch into frame
+     *
+     * @param batch record batch
+     * @param epoch write epoch of batch
+     * @param frame output frame; previous content is replaced
+     */
+    static void encode(const RecordBatch &batch, const uint64_t epoch, std::string &frame);
+
+    /**
+     * @brief decode records of frame payload and append them to batch
+     *
+     * @param payload frame payload
+     * @param size payload size
+     * @param recordCount number of records in payload
+     * @param batch output batch
+     * @return true on success
+     * @return false if payload is malformed
+     */
+    static bool decode(const char *payload, const size_t size, const uint32_t recordCount, RecordBatch &batch);
+
+    /**
+     * @brief apply frames of one segment from given epoch on and cut off its torn tail
+     *
+     * @param path segment file
+     * @param batch batch used for decoded records
+     * @param firstEpoch frames of earlier epochs are skipped
+     * @param maxEpoch output latest epoch of complete frames
+     * @param records output number of replayed records
+     * @param cut output true if segment ended before its end of file, so no later segment may follow it
+     * @return true on success
+     * @return false if segment can not be read or is not a log
+     */
+    static bool replaySegment(const std::string &path, RecordBatch &batch, const uint64_t firstEpoch,
+                              uint64_t &maxEpoch, uint64_t &records, bool &cut);
+
+    /**
+     * @brief build segment file path from its sequence number
+     *
+     * @param sequence segment sequence number
+     * @return std::string
+     */
+    static std::string segmentPath(const uint64_t sequence);
+
+    /**
+     * @brief create next segment, make it current and register it; called before writer thread
+     * starts or by writer thread
+     *
+     * @return true on success
+     * @return false on I/O error
+     */
+    static bool startSegment(void);
+
+    /**
+     * @brief write whole group to log file and sync it according to durability
+     *
+     * @param group encoded frames
+     * @return true on success
+     * @return false on I/O error
+     */
+    static bool writeGroup(const std::string &group);
+
+    /**
+     * @brief body of writer thread
+     *
+     */
+    static void writerBody(void);
+
+    static std::mutex logLock;
+    // wakes writer thread when group is started, full or awaited
+    static std::condition_variable writeSignal;
+    // wakes processors waiting for written group or for space in group
+    static std::condition_variable durableSignal;
+    static std::string pending;
+    // latest epoch of frames in pending group
+    static uint64_t pendingEpoch;
+    static std::chrono::steady_clock::time_point groupStart;
+    // log positions in bytes since open; appended is end of pending group, durable end of last written one
+    static uint64_t appendedBytes;
+    static uint64_t durableBytes;
+    static uint32_t syncWaiters;
+    static bool running;
+
+    // segments on disk, oldest first; the last one is written. Guarded by log lock.
+    static std::deque<Segment> segments;
+    static uint64_t nextSequence;
+    static std::string directory;
+
+    // set by open() before processors start and cleared by close() after they stop
+    static bool opened;
+    // current segment; owned by writer thread while it runs
+    static int descriptor;
+    static uint64_t segmentBytes;
+    static Durability durability;
+    static uint64_t groupBytes;
+    static std::chrono::milliseconds groupDelay;
+    static uint64_t segmentSize;
+    static std::thread writer;
+
+    static uint64_t recordCount;
+    static uint64_t groupCount;
+    static bool failed;
+};
+
+#endif
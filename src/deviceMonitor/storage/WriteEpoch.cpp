@@ -0,0 +1,66 @@
+#include "WriteEpoch.hpp"
+#include <thread>
+
+////////////////////////////////////////////////////////////////////////////////
+WriteEpoch::WriteEpoch() : epoch(0)
+{
+    writers[0].store(0);
+    writers[1].store(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t WriteEpoch::enter(void)
+{
+    while (true)
+    {
+        const uint64_t current(epoch.load());
+        const unsigned parity(static_cast<unsigned>(current & 1));
+        writers[parity].fetch_add(1);
+
+        // either flip() sees this writer or this writer sees the flip and retries in new epoch
+        if (epoch.load() == current)
+        {
+            return current;
+        }
+
+        writers[parity].fetch_sub(1);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WriteEpoch::leave(const uint64_t entered)
+{
+    writers[entered & 1].fetch_sub(1, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned WriteEpoch::flip(void)
+{
+    const unsigned parity(static_cast<unsigned>(epoch.fetch_add(1) & 1));
+
+    // writers hold the epoch only while applying one batch
+    while (writers[parity].load() != 0)
+    {
+        std::this_thread::yield();
+    }
+
+    return parity;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t WriteEpoch::getCurrent(void) const
+{
+    return epoch.load();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WriteEpoch::resume(const uint64_t epoch)
+{
+    const uint64_t current(this->epoch.load());
+
+    if (current <= epoch)
+    {
+        // even distance keeps parity
+        this->epoch.store(current + ((epoch - current) / 2 + 1) * 2);
+    }
+}
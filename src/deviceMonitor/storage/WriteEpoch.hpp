@@ -0,0 +1,99 @@
+#ifndef WRITEEPOCH_HPP
+#define WRITEEPOCH_HPP
+
+#include <atomic>
+#include <cinttypes>
+
+/**
+ * @brief splits concurrent writers into alternating epochs for snapshot reads
+ *
+ * Writers enter current epoch and write into data set selected by its parity.
+ * Reader flips the epoch and waits only until writers still in the closed epoch
+ * leave (one batch at most); new writers already use the other data set, so
+ * the reader can fold closed data set into its snapshot without blocking them.
+ * Only one reader may flip at a time.
+ */
+class WriteEpoch final
+{
+public:
+    // keeps writer inside entered epoch for its lifetime
+    class Guard final
+    {
+    public:
+        Guard(WriteEpoch &epoch) : epoch(epoch), entered(epoch.enter()) {}
+        ~Guard() { epoch.leave(entered); }
+
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+
+        /**
+         * @brief Get parity of entered epoch
+         *
+         * @return unsigned
+         */
+        unsigned getParity(void) const { return static_cast<unsigned>(entered & 1); }
+
+        /**
+         * @brief Get number of entered epoch
+         *
+         * @return uint64_t
+         */
+        uint64_t getEpoch(void) const { return entered; }
+
+    private:
+        WriteEpoch &epoch;
+        const uint64_t entered;
+    };
+
+    /**
+     * @brief Construct a new Write Epoch object
+     *
+     */
+    WriteEpoch();
+
+    WriteEpoch(const WriteEpoch &) = delete;
+    WriteEpoch &operator=(const WriteEpoch &) = delete;
+
+    /**
+     * @brief enter current epoch
+     *
+     * @return uint64_t number of entered epoch; its parity (0 or 1) selects data set to write
+     */
+    uint64_t enter(void);
+
+    /**
+     * @brief leave epoch entered by enter()
+     *
+     * @param entered value returned by enter()
+     */
+    void leave(const uint64_t entered);
+
+    /**
+     * @brief start new epoch and wait until all writers of the previous one leave
+     *
+     * @return unsigned parity of closed epoch; its data set is not written until next flip
+     */
+    unsigned flip(void);
+
+    /**
+     * @brief Get number of current epoch; stable only while caller is the only one to flip
+     *
+     * @return uint64_t
+     */
+    uint64_t getCurrent(void) const;
+
+    /**
+     * @brief move current epoch past given number keeping its parity, so data set
+     * written by next writers does not change; no writer may be inside any epoch
+     *
+     * @param epoch number the current epoch must exceed
+     */
+    void resume(const uint64_t epoch);
+
+private:
+    std::atomic<uint64_t> epoch;
+    // number of writers inside epoch of given parity; separate line from epoch read by every writer
+    alignas(64) std::atomic<uint64_t> writers[2];
+};
+
+#endif
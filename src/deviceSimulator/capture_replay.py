@@ -0,0 +1,341 @@
+#!/usr/bin/python3
+"""
+Replay tool for ingress captures of device monitor
+
+Script reads capture file written by device monitor ("capture.enabled") and
+sends captured messages again, so production load patterns become repeatable
+performance tests.
+
+1) messages are decoded from MessageCodec form back to JSON
+2) every message is sent when its recorded arrival time (scaled by speed) is
+   due: speed 1 replays at recorded pace, N at N times faster, "max" without
+   any waiting
+3) messages are sent to REST API of device monitor, or printed as JSON lines
+   for any other API (e.g. piped into another client)
+4) after replay achieved rate, lag behind schedule and errors are printed
+
+usage: capture_replay.py FILE [--speed 1|N|max] [--address A] [--port P]
+                              [--url U] [--connections N] [--retime] [--stdout]
+"""
+
+################################################################################
+
+import argparse
+import http.client
+import json
+import queue
+import struct
+import sys
+import threading
+import time
+
+################################################################################
+
+CAPTURE_MAGIC = b"DMCAP\x00\x00\x01"
+
+TAG_NULL = 0
+TAG_FALSE = 1
+TAG_TRUE = 2
+TAG_INT64 = 3
+TAG_UINT64 = 4
+TAG_DOUBLE = 5
+TAG_STRING = 6
+TAG_OBJECT = 7
+TAG_ARRAY = 8
+
+################################################################################
+
+
+class CaptureReader:
+    """
+    class reads capture file record by record
+    """
+
+    def __init__(self, path):
+        with open(path, "rb") as capture:
+            self.__data = capture.read()
+
+        if self.__data[:len(CAPTURE_MAGIC)] != CAPTURE_MAGIC:
+            raise ValueError("{0} is not a capture file".format(path))
+
+        self.start_time = struct.unpack_from(
+            "<q", self.__data, len(CAPTURE_MAGIC))[0] / 1000000.0
+        self.__position = len(CAPTURE_MAGIC) + 8
+
+    def __read_length(self):
+        value = 0
+        shift = 0
+
+        while True:
+            byte = self.__data[self.__position]
+            self.__position += 1
+            value |= (byte & 0x7f) << shift
+            shift += 7
+
+            if (byte & 0x80) == 0:
+                return value
+
+    def __read_raw(self, fmt):
+        value = struct.unpack_from(fmt, self.__data, self.__position)[0]
+        self.__position += struct.calcsize(fmt)
+        return value
+
+    def __read_string(self):
+        length = self.__read_length()
+        value = self.__data[self.__position:self.__position + length]
+        self.__position += length
+        return value.decode("utf-8")
+
+    def __read_value(self):
+        tag = self.__data[self.__position]
+        self.__position += 1
+
+        if tag == TAG_NULL:
+            return None
+        if tag == TAG_FALSE:
+            return False
+        if tag == TAG_TRUE:
+            return True
+        if tag == TAG_INT64:
+            return self.__read_raw("<q")
+        if tag == TAG_UINT64:
+            return self.__read_raw("<Q")
+        if tag == TAG_DOUBLE:
+            return self.__read_raw("<d")
+        if tag == TAG_STRING:
+            return self.__read_string()
+        if tag == TAG_OBJECT:
+            value = {}
+            for _ in range(self.__read_length()):
+                key = self.__read_string()
+                value[key] = self.__read_value()
+            return value
+        if tag == TAG_ARRAY:
+            return [self.__read_value() for _ in range(self.__read_length())]
+
+        raise ValueError("unknown tag {0} at offset {1}".format(
+            tag, self.__position - 1))
+
+    def records(self):
+        """
+        generator of (seconds since capture start, message) pairs; a record
+        torn at the end of file is ignored
+        """
+        offset = 0.0
+
+        while self.__position < len(self.__data):
+            try:
+                offset += self.__read_length() / 1000000.0
+                length = self.__read_length()
+                end = self.__position + length
+
+                if end > len(self.__data):
+                    return
+
+                message = self.__read_value()
+            except IndexError:
+                return
+
+            if self.__position != end:
+                raise ValueError("malformed record ending at offset {0}".format(end))
+
+            yield offset, message
+
+################################################################################
+
+
+class HttpSender:
+    """
+    class sends messages to REST API; every worker thread has its own connection
+    """
+
+    def __init__(self, address, port, url):
+        self.__address = address
+        self.__port = port
+        self.__url = url
+        self.__local = threading.local()
+
+    def send(self, message):
+        """
+        send one message; returns True if API accepted it
+        """
+        if not hasattr(self.__local, "connection"):
+            self.__local.connection = http.client.HTTPConnection(
+                self.__address, self.__port)
+
+        try:
+            self.__local.connection.request(
+                method="POST",
+                url=self.__url,
+                body=json.dumps(message),
+            )
+            response = self.__local.connection.getresponse()
+            response.read()
+            return response.status == 200
+        except (OSError, http.client.HTTPException):
+            self.__local.connection.close()
+            del self.__local.connection
+            return False
+
+
+class StdoutSender:
+    """
+    class prints messages as JSON lines
+    """
+
+    def __init__(self):
+        self.__lock = threading.Lock()
+
+    def send(self, message):
+        """
+        print one message
+        """
+        line = json.dumps(message)
+
+        with self.__lock:
+            sys.stdout.write(line + "\n")
+
+        return True
+
+################################################################################
+
+
+class Replay:
+    """
+    this class drives a sender from capture file at given speed
+    """
+
+    def __init__(self, reader, sender, speed=1.0, connections=1, retime=False):
+        self.__reader = reader
+        self.__sender = sender
+        self.__speed = speed
+        self.__retime = retime
+        self.__queue = queue.Queue(maxsize=connections * 64)
+        self.__workers = [threading.Thread(target=self.__work)
+                          for _ in range(connections)]
+        self.__lock = threading.Lock()
+        self.sent = 0
+        self.errors = 0
+        self.max_lag = 0.0
+        self.total_lag = 0.0
+        self.captured_duration = 0.0
+        self.elapsed = 0.0
+
+    def __work(self):
+        while True:
+            message = self.__queue.get()
+
+            if message is None:
+                return
+
+            accepted = self.__sender.send(message)
+
+            with self.__lock:
+                self.sent += 1
+                if not accepted:
+                    self.errors += 1
+
+    @staticmethod
+    def __timestamp(now):
+        fraction_part = str((now % 1) * 1000000).split('.')[0]
+        return time.strftime("%Y-%m-%dT%H:%M:%S.{0}UTC".format(fraction_part),
+                             time.gmtime(now))
+
+    def run(self):
+        """
+        execute replay
+        """
+        for worker in self.__workers:
+            worker.start()
+
+        start = time.monotonic()
+
+        for offset, message in self.__reader.records():
+            self.captured_duration = offset
+
+            if self.__speed > 0:
+                due = start + offset / self.__speed
+                now = time.monotonic()
+
+                if due > now:
+                    time.sleep(due - now)
+                else:
+                    self.max_lag = max(self.max_lag, now - due)
+                    self.total_lag += now - due
+
+            # event-time windows and liveness expect current timestamps
+            if self.__retime and isinstance(message, dict) and "timestamp" in message:
+                message["timestamp"] = self.__timestamp(time.time())
+
+            self.__queue.put(message)
+
+        for _ in self.__workers:
+            self.__queue.put(None)
+
+        for worker in self.__workers:
+            worker.join()
+
+        self.elapsed = time.monotonic() - start
+
+    def print_results(self):
+        """
+        method will print replay totals
+        """
+        captured_rate = self.sent / self.captured_duration if self.captured_duration > 0 else 0.0
+        achieved_rate = self.sent / self.elapsed if self.elapsed > 0 else 0.0
+
+        print("messages sent            = {0} (errors {1})".format(self.sent, self.errors))
+        print("captured duration        = {0:.3f} s ({1:.1f} msg/s)".format(
+            self.captured_duration, captured_rate))
+        print("replay duration          = {0:.3f} s ({1:.1f} msg/s)".format(
+            self.elapsed, achieved_rate))
+
+        if self.__speed > 0:
+            print("lag behind schedule      = max {0:.3f} s, avg {1:.6f} s".format(
+                self.max_lag, self.total_lag / self.sent if self.sent > 0 else 0.0))
+
+################################################################################
+
+
+def parse_speed(text):
+    """
+    function parses replay speed; "max" disables waiting
+    """
+    if text == "max":
+        return 0.0
+
+    speed = float(text)
+
+    if speed <= 0:
+        raise argparse.ArgumentTypeError("speed must be positive or max")
+
+    return speed
+
+
+PARSER = argparse.ArgumentParser(description="replay device monitor ingress capture")
+PARSER.add_argument("file", help="capture file")
+PARSER.add_argument("--speed", type=parse_speed, default=1.0,
+                    help="1 for recorded pace, N for N times faster, max for no waiting")
+PARSER.add_argument("--address", default="127.0.0.1")
+PARSER.add_argument("--port", type=int, default=50000)
+PARSER.add_argument("--url", default="/device/measurement")
+PARSER.add_argument("--connections", type=int, default=1,
+                    help="number of concurrent senders")
+PARSER.add_argument("--retime", action="store_true",
+                    help="replace message timestamps with replay time")
+PARSER.add_argument("--stdout", action="store_true",
+                    help="print messages as JSON lines instead of sending them")
+ARGS = PARSER.parse_args()
+
+READER = CaptureReader(ARGS.file)
+SENDER = StdoutSender() if ARGS.stdout else HttpSender(ARGS.address, ARGS.port, ARGS.url)
+APP = Replay(READER, SENDER, ARGS.speed, max(1, ARGS.connections), ARGS.retime)
+
+APP.run()
+
+# totals go to stderr when messages themselves are printed
+if ARGS.stdout:
+    sys.stdout.flush()
+    sys.stdout = sys.stderr
+
+APP.print_results()
@@ -3,14 +3,19 @@
 namespace fnv
 {
     fnv64_t Fnv64a(const std::string& str)
+    {
+        return Fnv64a(str.data(), str.size());
+    }
+
+    fnv64_t Fnv64a(const char* data, const size_t length)
     {
         fnv64_t hash((fnv64_t)(0xcbf29ce484222325ULL));
 
-        for (auto& c : str)
+        for (size_t i = 0; i < length; ++i)
         {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wsign-conversion"
-            hash ^= ((uint64_t)(c));
+            hash ^= ((uint64_t)(data[i]));
 #pragma GCC diagnostic pop
             hash += (hash << 1) + (hash << 4) + (hash << 5) + (hash << 7) + (hash << 8) + (hash << 40);
         }
@@ -2,6 +2,7 @@
 #define FNV_HPP
 
 #include <cinttypes>
+#include <cstddef>
 #include <string>
 
 namespace fnv
@@ -17,6 +18,15 @@ namespace fnv
      * @return fnv64_t computed hash value
      */
     fnv64_t Fnv64a(const std::string& str);
+
+    /**
+     * @brief  calculate Fnv64a hash from given memory block without constructing string
+     *
+     * @param data input data
+     * @param length length of input data
+     * @return fnv64_t computed hash value
+     */
+    fnv64_t Fnv64a(const char* data, const size_t length);
 }
 
 #endif
\ No newline at end of file
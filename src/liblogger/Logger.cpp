@@ -74,6 +74,13 @@ namespace logger
     static pthread_mutex_t loggerDataLock = PTHREAD_MUTEX_INITIALIZER;
     static pthread_mutex_t streamLock = PTHREAD_MUTEX_INITIALIZER;
 
+    /* written message nodes kept for reuse and count of all allocated nodes; guarded by pool lock */
+    static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+    static logMessage_t* freeMessages = NULL;
+    static int freeLength = 0;
+    static size_t liveMessages = 0;
+    static size_t peakMessages = 0;
+
     /* log data instance */
     static logData_t loggerData;
 
@@ -86,6 +93,8 @@ namespace logger
     inline int lockStream(void) __attribute__((always_inline));
     inline int unlockStream(void) __attribute__((always_inline));
     inline logMessage_t* popMessage() __attribute__((always_inline));
+    inline logMessage_t* allocateMessage(void) __attribute__((always_inline));
+    inline void releaseMessage(logMessage_t* message) __attribute__((always_inline));
 
     /*=====================================================================*/
     inline int lockLoggerData(void)
@@ -229,6 +238,66 @@ namespace logger
         return message;
     }
 
+    /*=====================================================================*/
+    inline logMessage_t* allocateMessage(void)
+    {
+        logMessage_t* message = NULL;
+
+        if (pthread_mutex_lock(&poolLock) != 0)
+        {
+            perror("FTL unable to lock logger pool mutex");
+            return NULL;
+        }
+
+        /* reuse written node if there is one */
+        if (freeMessages != NULL)
+        {
+            message = freeMessages;
+            freeMessages = freeMessages->next;
+            freeLength--;
+        }
+        else if ((message = (logMessage_t*) malloc(sizeof(logMessage_t))) != NULL)
+        {
+            liveMessages++;
+            peakMessages = (liveMessages > peakMessages) ? liveMessages : peakMessages;
+        }
+
+        pthread_mutex_unlock(&poolLock);
+
+        if (message != NULL)
+        {
+            message->next = NULL;
+        }
+
+        return message;
+    }
+
+    /*=====================================================================*/
+    inline void releaseMessage(logMessage_t* message)
+    {
+        if (pthread_mutex_lock(&poolLock) != 0)
+        {
+            perror("FTL unable to lock logger pool mutex");
+            return;
+        }
+
+        /* nodes over pool size are returned to the heap */
+        if (freeLength < LOG_MESSAGE_POOL_SIZE)
+        {
+            message->next = freeMessages;
+            freeMessages = message;
+            freeLength++;
+            message = NULL;
+        }
+        else
+        {
+            liveMessages--;
+        }
+
+        pthread_mutex_unlock(&poolLock);
+        free(message);
+    }
+
     /*=====================================================================*/
     int logWriteMessage_f(const logSeverityLevel_t severity,
                             const int line,
@@ -265,7 +334,7 @@ namespace logger
         }
 
         /* allocate memory for new message */
-        logMessage_t* newMessage = (logMessage_t*) calloc(1, sizeof(logMessage_t));
+        logMessage_t* newMessage = allocateMessage();
 
         if (newMessage == NULL)
         {
@@ -288,7 +357,7 @@ namespace logger
         /* lock message queue */
         if (lockLoggerQueue() != 0)
         {
-            free(newMessage);
+            releaseMessage(newMessage);
             return LOG_EXIT_FAILURE;
         }
 
@@ -466,8 +535,8 @@ namespace logger
             /* write message */
             writeMessage(stream, message);
 
-            /* destroy message  */
-            free(message);
+            /* return message node to pool */
+            releaseMessage(message);
         }
 
         return NULL;
@@ -531,7 +600,7 @@ namespace logger
             logMessage_t* toDelete = loggerData.first;
             writeMessage(loggerData.stream, toDelete);
             loggerData.first = loggerData.first->next;
-            free(toDelete);
+            releaseMessage(toDelete);
         }
 
         loggerData.first = NULL;
@@ -663,6 +732,50 @@ namespace logger
         return unlockStream();
     }
 
+    /*=====================================================================*/
+    int logGetThread_f(pthread_t* thread)
+    {
+        if (thread == NULL)
+        {
+            return LOG_EXIT_FAILURE;
+        }
+
+        if (lockLoggerData() != 0)
+        {
+            return LOG_EXIT_FAILURE;
+        }
+
+        int rc = LOG_EXIT_FAILURE;
+
+        if (loggerData.isInitialized == True_e)
+        {
+            *thread = loggerData.logThread;
+            rc = LOG_EXIT_SUCCESS;
+        }
+
+        unlockLoggerData();
+        return rc;
+    }
+
+    /*=====================================================================*/
+    int logGetMemoryUsage_f(size_t* live, size_t* peak)
+    {
+        if ((live == NULL) || (peak == NULL))
+        {
+            return LOG_EXIT_FAILURE;
+        }
+
+        if (pthread_mutex_lock(&poolLock) != 0)
+        {
+            return LOG_EXIT_FAILURE;
+        }
+
+        *live = liveMessages * sizeof(logMessage_t);
+        *peak = peakMessages * sizeof(logMessage_t);
+        pthread_mutex_unlock(&poolLock);
+        return LOG_EXIT_SUCCESS;
+    }
+
     #ifdef __cplusplus
 } // namespace logger
     #endif
\ No newline at end of file
@@ -7,6 +7,8 @@
     #include <stdio.h>
 #endif
 
+#include <pthread.h>
+
 #ifdef __cplusplus
 namespace logger
 {
@@ -15,6 +17,8 @@ namespace logger
 #define LOG_EXIT_FAILURE -1
 #define LOG_EXIT_SUCCESS 0
 #define LOG_MESSAGE_BUFFER_SIZE 1024
+/* number of written message nodes kept for reuse instead of being freed */
+#define LOG_MESSAGE_POOL_SIZE 64
 
     typedef enum
     {
@@ -83,6 +87,23 @@ namespace logger
      */
     int logUnlockLoggerStream();
 
+    /**
+     * @brief get identifier of logger thread (i.e. to set its scheduling/placement)
+     *
+     * @param thread output thread identifier
+     * @return int returns LOG_EXIT_SUCCESS on success; LOG_EXIT_FAILURE if logger is not initialized
+     */
+    int logGetThread_f(pthread_t* thread);
+
+    /**
+     * @brief get memory held by message nodes (queued, being written and kept for reuse)
+     *
+     * @param live output bytes held now
+     * @param peak output highest bytes held since start
+     * @return int returns LOG_EXIT_SUCCESS on success; LOG_EXIT_FAILURE on failure
+     */
+    int logGetMemoryUsage_f(size_t* live, size_t* peak);
+
 
 #ifdef __cplusplus
 #define LOG_MSG_DEV(_MSG_) logger::logWriteMessage_f(logger::logDev_e, __LINE__, __FILE__, __func__, _MSG_)
@@ -2,6 +2,8 @@
 #include <system_error>
 #include <cstring>
 #include <sstream>
+#include <pthread.h>
+#include <sys/signalfd.h>
 
 namespace sighandler
 {
@@ -119,4 +121,33 @@ namespace sighandler
 
         return 0;
     }
+
+    ///////////////////////////////////////////////////////////////////////
+    int SignalHandler::createSignalFd(const std::vector<int> &signalNumbers)
+    {
+        sigset_t signalSet;
+        sigemptyset(&signalSet);
+
+        for (const int signalNumber : signalNumbers)
+        {
+            if ((isValidSignalNumber(signalNumber) != 0) || (sigaddset(&signalSet, signalNumber) != 0))
+            {
+                return -1;
+            }
+        }
+
+        if (pthread_sigmask(SIG_BLOCK, &signalSet, nullptr) != 0)
+        {
+            return -2;
+        }
+
+        const int descriptor(signalfd(-1, &signalSet, SFD_NONBLOCK | SFD_CLOEXEC));
+
+        if (descriptor < 0)
+        {
+            return -3;
+        }
+
+        return descriptor;
+    }
 }
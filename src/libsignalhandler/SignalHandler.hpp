@@ -5,6 +5,7 @@
 #include <map>
 #include <stack>
 #include <stdexcept>
+#include <vector>
 
 namespace sighandler
 {
@@ -60,6 +61,15 @@ namespace sighandler
          */
         int isValidSignalNumber(const int signalNumber);
 
+        /**
+         * @brief block given signals and create descriptor for synchronous signal reading;
+         * call before any thread is created so that all threads inherit the signal mask
+         *
+         * @param signalNumbers signals delivered through descriptor
+         * @return int signal file descriptor on success; value < 0 on failure
+         */
+        int createSignalFd(const std::vector<int> &signalNumbers);
+
     private:
         /**
          * @brief Construct a new Signal Handler object